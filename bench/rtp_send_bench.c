@@ -0,0 +1,183 @@
+/**
+ * @file rtp_send_bench.c
+ * @brief 内置 RTSP 服务端 UDP 发送路径的主机端微基准
+ *
+ * 在本机启动 common/rtsp/rtsp_server.c，用一个 UDP 客户端 SETUP/PLAY 后，
+ * 按 1080p 4Mbps (GOP 30) 的帧大小构造 H.264 码流调用 rtsp_tx_video，统计每帧的
+ * 发送系统调用次数与发送线程 CPU 时间。发送方式由 RTSP_SERVER_UDP_BATCH 编译期选择：
+ *
+ *   for m in 0 1 2; do
+ *       gcc -O2 -DRTSP_SERVER_UDP_BATCH=$m -DRTSP_SERVER_PACE_KBPS=0 -Icommon -Icommon/rtsp \
+ *           bench/rtp_send_bench.c common/rtsp/rtsp_server.c common/rtsp/rtp.c -o rtp_send_bench$m
+ *       ./rtp_send_bench$m [frames] [port]
+ *   done
+ *
+ * 0 = 逐包 sendto，1 = sendmmsg，2 = sendmmsg + UDP GSO。
+ * 去掉 -DRTSP_SERVER_PACE_KBPS=0 可观察默认节拍下关键帧的发送耗时。
+ */
+
+#include "rtsp_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_FRAMES      300
+#define DEFAULT_PORT        8554
+#define BENCH_GOP           30
+#define BENCH_IDR_BYTES     (120 * 1024)
+#define BENCH_P_BYTES       (14 * 1024)
+
+int enable_minilog = 0;
+int rkipc_log_level = 1;  // 只打印警告和错误
+
+static int64_t clock_us(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 发送请求并驱动服务端事件处理，直到收到完整应答
+ */
+static int rtsp_request(rtsp_demo_handle demo, int fd, const char *req, char *resp, int size) {
+    int len = 0;
+
+    if (send(fd, req, strlen(req), 0) < 0) return -1;
+    for (int i = 0; i < 200; i++) {
+        rtsp_do_event(demo);
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 5) <= 0) continue;
+        int n = recv(fd, resp + len, size - 1 - len, 0);
+        if (n <= 0) return -1;
+        len += n;
+        resp[len] = '\0';
+        if (strstr(resp, "\r\n\r\n")) return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief 构造一帧 Annex-B 码流，负载不含 00 00，关键帧带 SPS/PPS
+ */
+static int build_frame(unsigned char *buf, int size, int key) {
+    static const unsigned char sps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0xac, 0xd1, 0x00, 0x78};
+    static const unsigned char pps[] = {0, 0, 0, 1, 0x68, 0xeb, 0xef, 0x2c};
+    int len = 0;
+
+    if (key) {
+        memcpy(buf, sps, sizeof(sps));
+        memcpy(buf + sizeof(sps), pps, sizeof(pps));
+        len = sizeof(sps) + sizeof(pps);
+    }
+    buf[len++] = 0;
+    buf[len++] = 0;
+    buf[len++] = 0;
+    buf[len++] = 1;
+    buf[len++] = key ? 0x65 : 0x41;
+    for (; len < size; len++) buf[len] = (unsigned char)(rand() % 255 + 1);
+    return size;
+}
+
+static void drain(int fd, int *packets) {
+    char buf[2048];
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) (*packets)++;
+}
+
+int main(int argc, char **argv) {
+    int frames = (argc > 1) ? atoi(argv[1]) : DEFAULT_FRAMES;
+    int port = (argc > 2) ? atoi(argv[2]) : DEFAULT_PORT;
+    char req[512], resp[4096];
+
+    rtsp_demo_handle demo = create_rtsp_demo(port);
+    if (!demo) return 1;
+    rtsp_session_handle session = rtsp_new_session(demo, "/live/0");
+    rtsp_set_video(session, RTSP_CODEC_ID_VIDEO_H264, NULL, 0);
+
+    // UDP 接收端，接收缓冲区足够装下一个关键帧
+    int sink = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 4 * 1024 * 1024;
+    struct sockaddr_in addr = {0};
+    socklen_t alen = sizeof(addr);
+    setsockopt(sink, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink, (struct sockaddr *)&addr, sizeof(addr));
+    getsockname(sink, (struct sockaddr *)&addr, &alen);
+    int sink_port = ntohs(addr.sin_port);
+
+    int ctrl = socket(AF_INET, SOCK_STREAM, 0);
+    addr.sin_port = htons(port);
+    if (connect(ctrl, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        return 1;
+    }
+    snprintf(req, sizeof(req),
+             "SETUP rtsp://127.0.0.1:%d/live/0/trackID=0 RTSP/1.0\r\nCSeq: 1\r\n"
+             "Transport: RTP/AVP;unicast;client_port=%d-%d\r\n\r\n",
+             port, sink_port, sink_port + 1);
+    char *sess;
+    if (rtsp_request(demo, ctrl, req, resp, sizeof(resp)) < 0 ||
+        !(sess = strstr(resp, "Session: "))) {
+        fprintf(stderr, "SETUP failed:\n%s\n", resp);
+        return 1;
+    }
+    unsigned int session_id = (unsigned int)strtoul(sess + 9, NULL, 16);
+    snprintf(req, sizeof(req),
+             "PLAY rtsp://127.0.0.1:%d/live/0 RTSP/1.0\r\nCSeq: 2\r\nSession: %08X\r\n\r\n", port,
+             session_id);
+    if (rtsp_request(demo, ctrl, req, resp, sizeof(resp)) < 0 || strncmp(resp, "RTSP/1.0 200", 12)) {
+        fprintf(stderr, "PLAY failed:\n%s\n", resp);
+        return 1;
+    }
+
+    unsigned char *idr = (unsigned char *)malloc(BENCH_IDR_BYTES);
+    unsigned char *p = (unsigned char *)malloc(BENCH_P_BYTES);
+    build_frame(idr, BENCH_IDR_BYTES, 1);
+    build_frame(p, BENCH_P_BYTES, 0);
+
+    int received = 0;
+    int64_t cpu_total = 0, cpu_idr = 0, wall_idr = 0;
+    int idr_count = 0;
+    for (int i = 0; i < frames; i++) {
+        int key = (i % BENCH_GOP) == 0;
+        int64_t wall = clock_us(CLOCK_MONOTONIC);
+        int64_t cpu = clock_us(CLOCK_THREAD_CPUTIME_ID);
+        rtsp_tx_video(session, key ? idr : p, key ? BENCH_IDR_BYTES : BENCH_P_BYTES,
+                      (uint64_t)i * 33333);
+        cpu = clock_us(CLOCK_THREAD_CPUTIME_ID) - cpu;
+        wall = clock_us(CLOCK_MONOTONIC) - wall;
+        cpu_total += cpu;
+        if (key) {
+            cpu_idr += cpu;
+            wall_idr += wall;
+            idr_count++;
+        }
+        drain(sink, &received);
+    }
+    usleep(20000);
+    drain(sink, &received);
+
+    rtsp_tx_stats stats;
+    rtsp_get_tx_stats(session, &stats);
+    static const char *modes[] = {"sendto", "sendmmsg", "sendmmsg+gso"};
+    printf("mode %-13s frames=%llu packets/frame=%.1f syscalls/frame=%.2f "
+           "cpu/frame=%lldus idr: cpu=%lldus wall=%lldus  received=%d/%llu\n",
+           modes[RTSP_SERVER_UDP_BATCH], (unsigned long long)stats.frames,
+           (double)stats.packets / stats.frames, (double)stats.syscalls / stats.frames,
+           (long long)(cpu_total / frames), (long long)(cpu_idr / idr_count),
+           (long long)(wall_idr / idr_count), received, (unsigned long long)stats.packets);
+
+    close(ctrl);
+    rtsp_del_demo(demo);
+    close(sink);
+    free(idr);
+    free(p);
+    return 0;
+}
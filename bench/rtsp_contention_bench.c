@@ -0,0 +1,544 @@
+/**
+ * @file rtsp_contention_bench.c
+ * @brief RTSP 封装层双路码流争用的主机端微基准
+ *
+ * 用桩实现替换 librtsp (rtsp_tx_video 按会话睡眠固定时长模拟发送阻塞)，
+ * 对比旧实现 (全局互斥锁内联 tx + do_event) 与当前 common/rtsp/rtsp.c
+ * (每会话无锁入队 + 独立发送线程)：
+ *
+ *   gcc -O2 -pthread -Icommon -Icommon/rtsp -Icommon/param -Isim/include \
+ *       bench/rtsp_contention_bench.c common/rtsp/rtsp.c -o rtsp_contention_bench
+ *   ./rtsp_contention_bench [frames] [main_tx_us] [sub_tx_us]
+ *
+ * 两个推流线程各按 30fps 写入，主码流单帧发送耗时 main_tx_us (默认 25ms，模拟慢链路)，
+ * 子码流 sub_tx_us (默认 300us)。每路输出：
+ * - write:   推流线程调用写入接口的耗时 (推流线程被阻塞多久)
+ * - deliver: 写入到 rtsp_tx_video 开始发送的耗时 (帧在封装层等待多久)
+ *
+ * 加 -DAPP_NATIVE_RTSP 并链接内置服务端时测慢 TCP 客户端 (rtsp.c 固定监听 554，需要 root)：
+ *
+ *   gcc -O2 -pthread -DAPP_NATIVE_RTSP -Icommon -Icommon/rtsp -Icommon/param -Isim/include \
+ *       bench/rtsp_contention_bench.c common/rtsp/rtsp.c common/rtsp/rtsp_server.c \
+ *       common/rtsp/rtp.c -o rtsp_slow_client_bench
+ *   ./rtsp_slow_client_bench [frames]
+ *
+ * 回环上主码流 (/live/0) 有一个 TCP 交织客户端，接收窗口很小且每 10ms 只读 1KB；
+ * 子码流 (/live/1) 有一个正常读取的 TCP 客户端，另有一个连接每 20ms 发一次 OPTIONS。输出：
+ * - deliver: 子码流写入到客户端收到该帧第一个包的耗时
+ * - options: OPTIONS 往返 (事件线程拿到写锁的快慢)
+ * - 慢客户端被断开的时刻
+ * 发送线程在读锁内阻塞于慢客户端时，写者优先的锁会让事件线程和子码流的发送线程一起等待。
+ */
+
+#include "rtsp.h"
+#ifdef APP_NATIVE_RTSP
+#include "rtsp_server.h"
+#else
+#include "rtsp_demo.h"
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef APP_NATIVE_RTSP
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#endif
+
+#define DEFAULT_FRAMES      150
+#define BENCH_STREAMS       2
+#define BENCH_FPS           30
+#define EVENT_COST_US       50
+
+int enable_minilog = 0;
+int rkipc_log_level = 1;  // 只打印警告和错误
+
+typedef struct {
+    int id;
+    int tx_us;
+    int delivered;
+    int64_t deliver_us[4096];
+} BenchSession;
+
+typedef struct {
+    int id;
+    int frames;
+    int size;
+    int (*write)(int id, unsigned char *buffer, unsigned int size, int64_t pts);
+    int64_t write_us[4096];
+} BenchProducer;
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int rk_param_get_int(const char *entry, int default_val) {
+    (void)entry;
+    return default_val;
+}
+
+#ifndef APP_NATIVE_RTSP
+static int g_tx_us[BENCH_STREAMS] = {25000, 300};
+
+/* =========================================================================
+ *                              librtsp 桩
+ * ========================================================================= */
+
+rtsp_demo_handle create_rtsp_demo(int port) {
+    (void)port;
+    return malloc(1);
+}
+
+rtsp_session_handle rtsp_new_session(rtsp_demo_handle demo, const char *path) {
+    (void)demo;
+    BenchSession *s = (BenchSession *)calloc(1, sizeof(BenchSession));
+    s->id = atoi(path + strlen("/live/"));
+    s->tx_us = g_tx_us[s->id % BENCH_STREAMS];
+    return s;
+}
+
+int rtsp_set_video(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len) {
+    (void)session; (void)codec_id; (void)codec_data; (void)data_len;
+    return 0;
+}
+
+int rtsp_set_audio(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len) {
+    (void)session; (void)codec_id; (void)codec_data; (void)data_len;
+    return 0;
+}
+
+int rtsp_set_audio_sample_rate(rtsp_session_handle session, int sample_rate) {
+    (void)session; (void)sample_rate;
+    return 0;
+}
+
+int rtsp_set_audio_channels(rtsp_session_handle session, int channels) {
+    (void)session; (void)channels;
+    return 0;
+}
+
+int rtsp_tx_video(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+    (void)frame;
+    BenchSession *s = (BenchSession *)session;
+    if (s->delivered < 4096) {
+        s->deliver_us[s->delivered++] = now_us() - (int64_t)ts;
+    }
+    usleep(s->tx_us);
+    return len;
+}
+
+int rtsp_tx_audio(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+    (void)session; (void)frame; (void)ts;
+    return len;
+}
+
+int rtsp_sync_video_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime) {
+    (void)session; (void)ts; (void)ntptime;
+    return 0;
+}
+
+int rtsp_sync_audio_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime) {
+    (void)session; (void)ts; (void)ntptime;
+    return 0;
+}
+
+static BenchSession *g_finished[BENCH_STREAMS];
+
+void rtsp_del_session(rtsp_session_handle session) {
+    BenchSession *s = (BenchSession *)session;
+    g_finished[s->id % BENCH_STREAMS] = s;  // 由 main 打印后释放
+}
+
+void rtsp_del_demo(rtsp_demo_handle demo) {
+    free(demo);
+}
+
+int rtsp_do_event(rtsp_demo_handle demo) {
+    (void)demo;
+    usleep(EVENT_COST_US);
+    return 0;
+}
+
+uint64_t rtsp_get_reltime(void) {
+    return (uint64_t)now_us();
+}
+
+uint64_t rtsp_get_ntptime(void) {
+    return (uint64_t)now_us();
+}
+
+/* =========================================================================
+ *                              旧实现 (全局锁内联发送)
+ * ========================================================================= */
+
+static pthread_mutex_t g_legacy_mutex = PTHREAD_MUTEX_INITIALIZER;
+static rtsp_demo_handle g_legacy_demo;
+static rtsp_session_handle g_legacy_sessions[BENCH_STREAMS];
+
+static int legacy_write(int id, unsigned char *buffer, unsigned int size, int64_t pts) {
+    pthread_mutex_lock(&g_legacy_mutex);
+    rtsp_tx_video(g_legacy_sessions[id], buffer, (int)size, (uint64_t)pts);
+    rtsp_do_event(g_legacy_demo);
+    pthread_mutex_unlock(&g_legacy_mutex);
+    return 0;
+}
+
+#endif /* !APP_NATIVE_RTSP */
+
+/* =========================================================================
+ *                              测试
+ * ========================================================================= */
+
+static void *producer_thread(void *arg) {
+    BenchProducer *p = (BenchProducer *)arg;
+    unsigned char *buf = (unsigned char *)malloc((size_t)p->size);
+    const unsigned char sps[] = {0, 0, 0, 1, 0x67};
+    memset(buf, 0xa5, (size_t)p->size);  // 非零填充, 打包时不会被当作结尾的补零去掉
+    memcpy(buf, sps, sizeof(sps));  // 以 SPS 开头, 队列满后的丢帧立即恢复
+
+    int64_t next = now_us();
+    for (int i = 0; i < p->frames; i++) {
+        next += 1000000 / BENCH_FPS;
+        int64_t wait = next - now_us();
+        if (wait > 0) usleep((useconds_t)wait);
+
+        // 写入时刻以十六进制写在 NAL 头之后 (不会形成起始码)，客户端据此计算送达延迟
+        int64_t start = now_us();
+        char stamp[17];
+        snprintf(stamp, sizeof(stamp), "%016llx", (unsigned long long)start);
+        memcpy(buf + sizeof(sps), stamp, 16);
+        p->write(p->id, buf, (unsigned int)p->size, start);
+        p->write_us[i] = now_us() - start;
+    }
+    free(buf);
+    return NULL;
+}
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_dist(const char *what, int64_t *v, int n) {
+    if (n <= 0) {
+        printf("  %-8s n=0\n", what);
+        return;
+    }
+    qsort(v, (size_t)n, sizeof(v[0]), cmp_i64);
+    printf("  %-8s n=%-4d p50=%6lldus p99=%6lldus max=%6lldus\n", what, n,
+           (long long)v[n / 2], (long long)v[(n * 99) / 100], (long long)v[n - 1]);
+}
+
+#ifndef APP_NATIVE_RTSP
+/**
+ * @brief 两路同时推流，teardown 负责发完剩余帧并删除会话 (填充 g_finished)
+ */
+static void run(const char *name, int frames,
+                int (*write)(int, unsigned char *, unsigned int, int64_t),
+                void (*teardown)(void)) {
+    static BenchProducer producers[BENCH_STREAMS];
+    pthread_t tids[BENCH_STREAMS];
+    const int sizes[BENCH_STREAMS] = {60 * 1024, 8 * 1024};
+
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        memset(&producers[i], 0, sizeof(producers[i]));
+        producers[i].id = i;
+        producers[i].frames = frames;
+        producers[i].size = sizes[i];
+        producers[i].write = write;
+        pthread_create(&tids[i], NULL, producer_thread, &producers[i]);
+    }
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    teardown();
+
+    printf("%s:\n", name);
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        BenchSession *s = g_finished[i];
+        printf(" stream %d (tx %dus)\n", i, g_tx_us[i]);
+        print_dist("write", producers[i].write_us, frames);
+        print_dist("deliver", s->deliver_us, s->delivered);
+        free(s);
+        g_finished[i] = NULL;
+    }
+}
+
+static void legacy_init(void) {
+    char path[16];
+    g_legacy_demo = create_rtsp_demo(554);
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        snprintf(path, sizeof(path), "/live/%d", i);
+        g_legacy_sessions[i] = rtsp_new_session(g_legacy_demo, path);
+    }
+}
+
+static void legacy_teardown(void) {
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        rtsp_del_session(g_legacy_sessions[i]);
+    }
+    rtsp_del_demo(g_legacy_demo);
+}
+
+static void session_init(void) {
+    char path[16];
+    rkipc_rtsp_init();
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        snprintf(path, sizeof(path), "/live/%d", i);
+        rkipc_rtsp_add_session(i, path, "H.264");
+    }
+}
+
+static void session_teardown(void) {
+    usleep((useconds_t)g_tx_us[0] * 8 + 100000);  // 等发送线程发完队列中的帧
+    rkipc_rtsp_deinit();
+}
+
+int main(int argc, char **argv) {
+    int frames = (argc > 1) ? atoi(argv[1]) : DEFAULT_FRAMES;
+    if (frames <= 0 || frames > 4096) frames = DEFAULT_FRAMES;
+    if (argc > 2) g_tx_us[0] = atoi(argv[2]);
+    if (argc > 3) g_tx_us[1] = atoi(argv[3]);
+
+    printf("RTSP contention benchmark: %d frames x %d streams @ %dfps\n", frames, BENCH_STREAMS,
+           BENCH_FPS);
+    legacy_init();
+    run("global lock (inline)", frames, legacy_write, legacy_teardown);
+    session_init();
+    run("per-session sender", frames, rkipc_rtsp_write_video_frame, session_teardown);
+    return 0;
+}
+
+#else /* APP_NATIVE_RTSP */
+
+/* =========================================================================
+ *                              慢 TCP 客户端 (内置服务端)
+ * ========================================================================= */
+
+#define SLOW_RCVBUF             4096
+#define SLOW_READ_BYTES         1024
+#define SLOW_READ_INTERVAL_US   10000
+#define OPTIONS_INTERVAL_US     20000
+#define MAX_SAMPLES             4096
+
+static volatile int g_clients_running;
+static int64_t g_slow_closed_us;        // 慢客户端被服务端断开的时刻 (0 表示一直连着)
+
+typedef struct {
+    int fd;
+    int n;
+    int64_t us[MAX_SAMPLES];
+} ClientSamples;
+
+static int bench_connect(int rcvbuf) {
+    struct sockaddr_in addr;
+    struct timeval tv = {0, 100000};
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd < 0) return -1;
+    if (rcvbuf > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(554);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 发送请求并逐字节读到回复头结束 (不多读后面的 RTP)，返回往返耗时，失败 -1
+ */
+static int64_t bench_request(int fd, const char *req, char *reply, size_t size) {
+    int64_t start = now_us();
+    size_t len = 0;
+
+    if (send(fd, req, strlen(req), MSG_NOSIGNAL) < 0) return -1;
+    while (len + 1 < size) {
+        ssize_t n = recv(fd, reply + len, 1, 0);
+        if (n <= 0) {
+            if (n < 0 && g_clients_running) continue;  // 接收超时, 继续等
+            return -1;
+        }
+        len++;
+        reply[len] = '\0';
+        if (len >= 4 && !memcmp(reply + len - 4, "\r\n\r\n", 4)) return now_us() - start;
+    }
+    return -1;
+}
+
+static int bench_play(int id, int rcvbuf) {
+    char req[256];
+    char reply[1024];
+    char session[32] = "";
+    int fd = bench_connect(rcvbuf);
+
+    if (fd < 0) return -1;
+    snprintf(req, sizeof(req),
+             "SETUP rtsp://127.0.0.1/live/%d/trackID=0 RTSP/1.0\r\nCSeq: 1\r\n"
+             "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n\r\n", id);
+    const char *p;
+    if (bench_request(fd, req, reply, sizeof(reply)) < 0 || !(p = strstr(reply, "Session: "))) {
+        close(fd);
+        return -1;
+    }
+    sscanf(p + 9, "%31[^;\r]", session);
+    snprintf(req, sizeof(req), "PLAY rtsp://127.0.0.1/live/%d RTSP/1.0\r\nCSeq: 2\r\nSession: %s\r\n\r\n",
+             id, session);
+    if (bench_request(fd, req, reply, sizeof(reply)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void *slow_client_thread(void *arg) {
+    int fd = *(int *)arg;
+    char buf[SLOW_READ_BYTES];
+
+    while (g_clients_running) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {  // 关闭或被 RST
+            g_slow_closed_us = now_us();
+            break;
+        }
+        usleep(SLOW_READ_INTERVAL_US);
+    }
+    return NULL;
+}
+
+static int recv_exact(int fd, uint8_t *buf, int len) {
+    int got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, buf + got, (size_t)(len - got), 0);
+        if (n <= 0) {
+            if (n < 0 && g_clients_running) continue;
+            return -1;
+        }
+        got += (int)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief 正常读取的 TCP 客户端：FU-A 起始分片的负载里取出写入时刻，记录送达延迟
+ */
+static void *reader_client_thread(void *arg) {
+    ClientSamples *cs = (ClientSamples *)arg;
+    uint8_t buf[65536];
+
+    while (g_clients_running) {
+        if (recv_exact(cs->fd, buf, 4) < 0 || buf[0] != '$') break;
+        int len = (buf[2] << 8) | buf[3];
+        if (recv_exact(cs->fd, buf, len) < 0) break;
+        // RTP 头 12 字节，随后 FU 指示、FU 头 (S 位)，再后是 NAL 头之后的数据
+        if (len < 12 + 2 + 16 || (buf[12] & 0x1f) != 28 || !(buf[13] & 0x80)) continue;
+        char stamp[17];
+        memcpy(stamp, buf + 14, 16);
+        stamp[16] = '\0';
+        int64_t sent = (int64_t)strtoull(stamp, NULL, 16);
+        if (cs->n < MAX_SAMPLES) cs->us[cs->n++] = now_us() - sent;
+    }
+    return NULL;
+}
+
+static void *options_client_thread(void *arg) {
+    ClientSamples *cs = (ClientSamples *)arg;
+    char reply[512];
+    const char *req = "OPTIONS rtsp://127.0.0.1/live/1 RTSP/1.0\r\nCSeq: 9\r\n\r\n";
+
+    while (g_clients_running) {
+        int64_t rtt = bench_request(cs->fd, req, reply, sizeof(reply));
+        if (rtt < 0) break;
+        if (cs->n < MAX_SAMPLES) cs->us[cs->n++] = rtt;
+        usleep(OPTIONS_INTERVAL_US);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int frames = (argc > 1) ? atoi(argv[1]) : DEFAULT_FRAMES * 2;
+    if (frames <= 0 || frames > 4096) frames = DEFAULT_FRAMES * 2;
+    static BenchProducer producers[BENCH_STREAMS];
+    static ClientSamples reader, options;
+    const int sizes[BENCH_STREAMS] = {60 * 1024, 8 * 1024};
+    pthread_t producer_tids[BENCH_STREAMS];
+    pthread_t slow_tid, reader_tid, options_tid;
+    char path[16];
+
+    printf("RTSP slow TCP client benchmark: %d frames x %d streams @ %dfps\n", frames,
+           BENCH_STREAMS, BENCH_FPS);
+    if (rkipc_rtsp_init() != 0) {
+        fprintf(stderr, "rtsp init failed (port 554 needs root)\n");
+        return 1;
+    }
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        snprintf(path, sizeof(path), "/live/%d", i);
+        rkipc_rtsp_add_session(i, path, "H.264");
+    }
+
+    g_clients_running = 1;
+    int slow_fd = bench_play(0, SLOW_RCVBUF);
+    reader.fd = bench_play(1, 0);
+    options.fd = bench_connect(0);
+    if (slow_fd < 0 || reader.fd < 0 || options.fd < 0) {
+        fprintf(stderr, "rtsp clients failed to connect\n");
+        return 1;
+    }
+    int64_t start = now_us();
+    pthread_create(&slow_tid, NULL, slow_client_thread, &slow_fd);
+    pthread_create(&reader_tid, NULL, reader_client_thread, &reader);
+    pthread_create(&options_tid, NULL, options_client_thread, &options);
+
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        memset(&producers[i], 0, sizeof(producers[i]));
+        producers[i].id = i;
+        producers[i].frames = frames;
+        producers[i].size = sizes[i];
+        producers[i].write = rkipc_rtsp_write_video_frame;
+        pthread_create(&producer_tids[i], NULL, producer_thread, &producers[i]);
+    }
+    for (int i = 0; i < BENCH_STREAMS; i++) {
+        pthread_join(producer_tids[i], NULL);
+    }
+    usleep(200000);
+
+    g_clients_running = 0;
+    pthread_join(slow_tid, NULL);
+    pthread_join(reader_tid, NULL);
+    pthread_join(options_tid, NULL);
+    close(slow_fd);
+    close(reader.fd);
+    close(options.fd);
+
+    printf("stream 0 (slow client reads %dB / %dms):\n", SLOW_READ_BYTES, SLOW_READ_INTERVAL_US / 1000);
+    print_dist("write", producers[0].write_us, frames);
+    if (g_slow_closed_us)
+        printf("  slow client disconnected after %lld ms\n", (long long)(g_slow_closed_us - start) / 1000);
+    else
+        printf("  slow client still connected\n");
+    printf("stream 1 (normal client):\n");
+    print_dist("write", producers[1].write_us, frames);
+    print_dist("deliver", reader.us, reader.n);
+    printf("event thread:\n");
+    print_dist("options", options.us, options.n);
+
+    rkipc_rtsp_deinit();
+    return 0;
+}
+
+#endif /* APP_NATIVE_RTSP */
@@ -53,6 +53,7 @@ int destroy_font() {
 	if (face_) {
 		FT_Done_Face(face_);
 		face_ = NULL;
+		slot_ = NULL;
 	}
 	if (library_) {
 		FT_Done_FreeType(library_);
@@ -190,6 +191,11 @@ void draw_argb8888_text(unsigned char *buffer, int buf_w, int buf_h, const wchar
 	// LOG_DEBUG("len is %d\n", len);
 	pen_.x = 0;
 	pen_.y = 0;
+	// 字体未加载时 slot_ 为空
+	if (!slot_) {
+		LOG_INFO("please check font_path %s\n", *font_path_);
+		return;
+	}
 	for (int i = 0; i < len; i++) {
 		draw_argb8888_wchar(buffer, buf_w, buf_h, wstr[i]);
 		pen_.x += slot_->advance.x;
@@ -11,11 +11,32 @@
 #define LOG_TAG "param.c"
 
 #define MAX_SECTION_KEYS 1024
+#define MAX_PARAM_LISTENERS 8
 
 char g_ini_path_[256];
 dictionary *g_ini_d_;
 static pthread_mutex_t g_param_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// 参数变更监听者，在 rk_param_set_* 返回前 (g_param_mutex 已释放) 回调
+typedef struct {
+	char prefix[32];
+	rk_param_listener_cb cb;
+	void *arg;
+} rk_param_listener;
+
+static rk_param_listener g_param_listeners[MAX_PARAM_LISTENERS];
+static pthread_mutex_t g_listener_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void rk_param_notify(const char *entry) {
+	pthread_mutex_lock(&g_listener_mutex);
+	for (int i = 0; i < MAX_PARAM_LISTENERS; i++) {
+		rk_param_listener *l = &g_param_listeners[i];
+		if (l->cb && !strncasecmp(entry, l->prefix, strlen(l->prefix)))
+			l->cb(entry, l->arg);
+	}
+	pthread_mutex_unlock(&g_listener_mutex);
+}
+
 int rk_param_dump() {
 	const char *section_name;
 	const char *keys[MAX_SECTION_KEYS];
@@ -62,11 +83,12 @@ int rk_param_get_int(const char *entry, int default_val) {
 }
 
 int rk_param_set_int(const char *entry, int val) {
-	char tmp[8];
-	sprintf(tmp, "%d", val);
+	char tmp[16];
+	snprintf(tmp, sizeof(tmp), "%d", val);
 	pthread_mutex_lock(&g_param_mutex);
 	iniparser_set(g_ini_d_, entry, tmp);
 	pthread_mutex_unlock(&g_param_mutex);
+	rk_param_notify(entry);
 
 	return 0;
 }
@@ -80,10 +102,54 @@ const char *rk_param_get_string(const char *entry, const char *default_val) {
 	return ret;
 }
 
+int rk_param_has_section(const char *section) {
+	int ret;
+	pthread_mutex_lock(&g_param_mutex);
+	ret = g_ini_d_ ? iniparser_find_entry(g_ini_d_, section) : 0;
+	pthread_mutex_unlock(&g_param_mutex);
+
+	return ret;
+}
+
 int rk_param_set_string(const char *entry, const char *val) {
 	pthread_mutex_lock(&g_param_mutex);
 	iniparser_set(g_ini_d_, entry, val);
 	pthread_mutex_unlock(&g_param_mutex);
+	rk_param_notify(entry);
+
+	return 0;
+}
+
+int rk_param_add_listener(const char *prefix, rk_param_listener_cb cb, void *arg) {
+	int ret = -1;
+	if (!prefix || !cb)
+		return -1;
+	pthread_mutex_lock(&g_listener_mutex);
+	for (int i = 0; i < MAX_PARAM_LISTENERS; i++) {
+		rk_param_listener *l = &g_param_listeners[i];
+		if (l->cb)
+			continue;
+		snprintf(l->prefix, sizeof(l->prefix), "%s", prefix);
+		l->cb = cb;
+		l->arg = arg;
+		ret = 0;
+		break;
+	}
+	pthread_mutex_unlock(&g_listener_mutex);
+	if (ret)
+		LOG_ERROR("too many param listeners, %s not added\n", prefix);
+
+	return ret;
+}
+
+int rk_param_remove_listener(rk_param_listener_cb cb, void *arg) {
+	pthread_mutex_lock(&g_listener_mutex);
+	for (int i = 0; i < MAX_PARAM_LISTENERS; i++) {
+		rk_param_listener *l = &g_param_listeners[i];
+		if (l->cb == cb && l->arg == arg)
+			memset(l, 0, sizeof(*l));
+	}
+	pthread_mutex_unlock(&g_listener_mutex);
 
 	return 0;
 }
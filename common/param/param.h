@@ -5,10 +5,17 @@
 
 extern dictionary *g_ini_d_;
 
+// 参数变更回调，entry 为 "section:key"。回调在设置参数的线程中执行，
+// 可以读取参数，但不能再调用 rk_param_set_* 或增删监听者。
+typedef void (*rk_param_listener_cb)(const char *entry, void *arg);
+
 int rk_param_get_int(const char *entry, int default_val);
 int rk_param_set_int(const char *entry, int val);
 const char *rk_param_get_string(const char *entry, const char *default_val);
 int rk_param_set_string(const char *entry, const char *val);
+int rk_param_has_section(const char *section);
+int rk_param_add_listener(const char *prefix, rk_param_listener_cb cb, void *arg);
+int rk_param_remove_listener(rk_param_listener_cb cb, void *arg);
 int rk_param_save();
 int rk_param_init(char *ini_path);
 int rk_param_deinit();
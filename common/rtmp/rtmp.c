@@ -10,7 +10,10 @@
 #endif
 #define LOG_TAG "rtmp.c"
 
-static int g_rtmp_enable[3] = {0, 0, 0};
+// rkmuxer 的 0~2 号保留给录像，RTMP 使用 3~5 号 (配置加载时按 APP_RTMP_MAX_STREAMS 拒绝更大的 ID)
+#define RTMP_MAX_STREAMS 3
+
+static int g_rtmp_enable[RTMP_MAX_STREAMS] = {0, 0, 0};
 static VideoParam g_video_param;
 static pthread_mutex_t g_rtmp_mutex = PTHREAD_MUTEX_INITIALIZER;
 // static AudioParam g_audio_param;
@@ -19,6 +22,10 @@ int rk_rtmp_init(int id, const char *rtmp_url) {
 	int ret = 0;
 	char entry[128] = {'\0'};
 	LOG_DEBUG("begin\n");
+	if (id < 0 || id >= RTMP_MAX_STREAMS) {
+		LOG_ERROR("rtmp stream id %d out of range (max %d)\n", id, RTMP_MAX_STREAMS);
+		return -1;
+	}
 	system("ifconfig lo up");
 
 	// set g_video_param
@@ -67,6 +74,8 @@ int rk_rtmp_init(int id, const char *rtmp_url) {
 
 int rk_rtmp_deinit(int id) {
 	LOG_DEBUG("begin\n");
+	if (id < 0 || id >= RTMP_MAX_STREAMS)
+		return -1;
 	pthread_mutex_lock(&g_rtmp_mutex);
 	g_rtmp_enable[id] = 0;
 	rkmuxer_deinit(id + 3);
@@ -78,6 +87,8 @@ int rk_rtmp_deinit(int id) {
 
 int rk_rtmp_write_video_frame(int id, unsigned char *buffer, unsigned int buffer_size,
                               int64_t present_time, int key_frame) {
+	if (id < 0 || id >= RTMP_MAX_STREAMS)
+		return -1;
 	pthread_mutex_lock(&g_rtmp_mutex);
 	if (g_rtmp_enable[id])
 		rkmuxer_write_video_frame(id + 3, buffer, buffer_size, present_time, key_frame);
@@ -88,6 +99,8 @@ int rk_rtmp_write_video_frame(int id, unsigned char *buffer, unsigned int buffer
 
 int rk_rtmp_write_audio_frame(int id, unsigned char *buffer, unsigned int buffer_size,
                               int64_t present_time) {
+	if (id < 0 || id >= RTMP_MAX_STREAMS)
+		return -1;
 	if (g_rtmp_enable[id]) {
 		pthread_mutex_lock(&g_rtmp_mutex);
 		rkmuxer_write_audio_frame(id + 3, buffer, buffer_size, present_time);
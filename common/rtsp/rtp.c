@@ -0,0 +1,175 @@
+// Copyright 2021 Rockchip Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "rtp.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// H.264 FU-A / H.265 FU 的 NAL 类型
+#define RTP_H264_FU_A 28
+#define RTP_H265_FU 49
+// 访问单元分隔符，RTP 中没有意义，打包时跳过
+#define RTP_H264_AUD 9
+#define RTP_H265_AUD 35
+
+static void rtp_put16(uint8_t *p, uint16_t v) {
+	p[0] = v >> 8;
+	p[1] = v & 0xff;
+}
+
+static void rtp_put32(uint8_t *p, uint32_t v) {
+	p[0] = v >> 24;
+	p[1] = (v >> 16) & 0xff;
+	p[2] = (v >> 8) & 0xff;
+	p[3] = v & 0xff;
+}
+
+const uint8_t *rtp_next_nal(const uint8_t *p, const uint8_t *end, int *nal_len) {
+	const uint8_t *nal = NULL;
+
+	while (p + 3 <= end) {
+		if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+			nal = p + 3;
+			break;
+		}
+		p++;
+	}
+	if (!nal || nal >= end)
+		return NULL;
+
+	p = nal;
+	while (p + 3 <= end && !(p[0] == 0 && p[1] == 0 && (p[2] == 1 || p[2] == 0)))
+		p++;
+	if (p + 3 > end)
+		p = end;
+	// 00 00 00 01 的第一个 0 不属于本 NAL
+	while (p > nal && p[-1] == 0)
+		p--;
+	*nal_len = (int)(p - nal);
+	return nal;
+}
+
+static rtp_packet *rtp_packet_add(rtp_stream *st, rtp_packet_list *list, uint32_t timestamp,
+                                  const uint8_t *payload, int payload_len) {
+	if (list->count == list->cap) {
+		int cap = list->cap ? list->cap * 2 : 64;
+		rtp_packet *pkts = realloc(list->pkts, (size_t)cap * sizeof(rtp_packet));
+		if (!pkts)
+			return NULL;
+		list->pkts = pkts;
+		list->cap = cap;
+	}
+
+	rtp_packet *pkt = &list->pkts[list->count++];
+	uint8_t *hdr = rtp_packet_header(pkt);
+	hdr[0] = 0x80; // V=2
+	hdr[1] = st->payload_type;
+	rtp_put16(hdr + 2, st->seq++);
+	rtp_put32(hdr + 4, timestamp);
+	rtp_put32(hdr + 8, st->ssrc);
+	pkt->hdr_len = RTP_HEADER_SIZE;
+	pkt->payload = payload;
+	pkt->payload_len = payload_len;
+	list->octets += payload_len;
+	return pkt;
+}
+
+static int rtp_pack_nal(rtp_stream *st, rtp_packet_list *list, const uint8_t *nal, int len,
+                        uint32_t timestamp) {
+	int hdr = st->h265 ? 2 : 1;
+	rtp_packet *pkt;
+
+	if (len <= RTP_MAX_PAYLOAD)
+		return rtp_packet_add(st, list, timestamp, nal, len) ? 0 : -1;
+
+	// 分片：NAL 头换成 FU 指示 + FU 头 (写在包头部区)，负载从 NAL 头之后开始切分
+	uint8_t type = st->h265 ? (nal[0] >> 1) & 0x3f : nal[0] & 0x1f;
+	int chunk = RTP_MAX_PAYLOAD - hdr - 1;
+	const uint8_t *p = nal + hdr;
+	int left = len - hdr;
+	int first = 1;
+
+	while (left > 0) {
+		int n = left < chunk ? left : chunk;
+		pkt = rtp_packet_add(st, list, timestamp, p, n);
+		if (!pkt)
+			return -1;
+		uint8_t *fu = rtp_packet_header(pkt) + RTP_HEADER_SIZE;
+		if (st->h265) {
+			fu[0] = (nal[0] & 0x81) | (RTP_H265_FU << 1);
+			fu[1] = nal[1];
+		} else {
+			fu[0] = (nal[0] & 0xe0) | RTP_H264_FU_A;
+		}
+		fu[hdr] = type | (first ? 0x80 : 0) | (n == left ? 0x40 : 0);
+		pkt->hdr_len += hdr + 1;
+		list->octets += hdr + 1;
+		p += n;
+		left -= n;
+		first = 0;
+	}
+	return 0;
+}
+
+int rtp_pack_frame(rtp_stream *st, rtp_packet_list *list, const uint8_t *frame, int len,
+                   uint32_t timestamp) {
+	const uint8_t *end = frame + len;
+	const uint8_t *nal;
+	int nal_len;
+
+	list->count = 0;
+	list->octets = 0;
+	while ((nal = rtp_next_nal(frame, end, &nal_len)) != NULL) {
+		frame = nal + nal_len;
+		if (nal_len < (st->h265 ? 3 : 2))
+			continue;
+		int type = st->h265 ? (nal[0] >> 1) & 0x3f : nal[0] & 0x1f;
+		if (type == (st->h265 ? RTP_H265_AUD : RTP_H264_AUD))
+			continue;
+		if (rtp_pack_nal(st, list, nal, nal_len, timestamp) < 0)
+			return -1;
+	}
+	if (list->count > 0)
+		rtp_packet_header(&list->pkts[list->count - 1])[1] |= 0x80; // marker: 访问单元最后一个包
+
+	return list->count;
+}
+
+void rtp_packet_list_free(rtp_packet_list *list) {
+	free(list->pkts);
+	memset(list, 0, sizeof(*list));
+}
+
+int rtcp_build_sr(uint8_t *buf, int size, uint32_t ssrc, uint64_t ntp, uint32_t rtp_ts,
+                  uint32_t packets, uint32_t octets, const char *cname) {
+	int cname_len = (int)strlen(cname);
+	if (cname_len > 255)
+		cname_len = 255;
+	// SDES: 头 4 + SSRC 4 + CNAME 项 (2 + 文本) + END，补齐到 4 字节
+	int sdes_len = (8 + 2 + cname_len + 1 + 3) & ~3;
+	if (size < 28 + sdes_len)
+		return -1;
+
+	buf[0] = 0x80; // V=2, RC=0
+	buf[1] = 200;  // SR
+	rtp_put16(buf + 2, 28 / 4 - 1);
+	rtp_put32(buf + 4, ssrc);
+	rtp_put32(buf + 8, (uint32_t)(ntp >> 32));
+	rtp_put32(buf + 12, (uint32_t)ntp);
+	rtp_put32(buf + 16, rtp_ts);
+	rtp_put32(buf + 20, packets);
+	rtp_put32(buf + 24, octets);
+
+	uint8_t *sdes = buf + 28;
+	memset(sdes, 0, sdes_len);
+	sdes[0] = 0x81; // V=2, SC=1
+	sdes[1] = 202;  // SDES
+	rtp_put16(sdes + 2, sdes_len / 4 - 1);
+	rtp_put32(sdes + 4, ssrc);
+	sdes[8] = 1; // CNAME
+	sdes[9] = cname_len;
+	memcpy(sdes + 10, cname, cname_len);
+
+	return 28 + sdes_len;
+}
@@ -0,0 +1,75 @@
+// Copyright 2021 Rockchip Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef __RTP_H__
+#define __RTP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RTP 固定头长度 (无 CSRC、无扩展)
+#define RTP_HEADER_SIZE 12
+// TCP 交织传输时每个包前的 "$ 通道 长度" 前缀 (RFC 2326 10.12)
+#define RTP_TCP_PREFIX 4
+// 单个 RTP 包的最大负载 (含 FU 头)，保证 IP 包不超过 1500 字节的以太网 MTU
+#ifndef RTP_MAX_PAYLOAD
+#define RTP_MAX_PAYLOAD 1400
+#endif
+// FU 头的最大长度 (H.265 的负载头 2 字节 + FU 头 1 字节)
+#define RTP_FU_HEADER_MAX 3
+
+// 一路 RTP 流的发送状态，同一会话的所有客户端共用 (打包一次，发给所有人)
+typedef struct {
+	uint8_t payload_type;
+	int h265;
+	uint16_t seq;  // 下一个包的序号
+	uint32_t ssrc;
+} rtp_stream;
+
+// 一个 RTP 包：头部 (TCP 交织前缀 + RTP 头 + FU 头) 存在描述符内，
+// 负载直接指向帧内的 NAL 数据，发送时用 iovec 拼接，码流字节不拷贝
+typedef struct {
+	const uint8_t *payload;
+	uint16_t payload_len;
+	uint8_t hdr_len; // RTP 头 + FU 头，不含前缀
+	uint8_t hdr[RTP_TCP_PREFIX + RTP_HEADER_SIZE + RTP_FU_HEADER_MAX];
+} rtp_packet;
+
+// 一帧打包后的 RTP 包描述符 (头部区)
+typedef struct {
+	rtp_packet *pkts;
+	int count;
+	int cap;
+	uint32_t octets;  // 本帧负载字节数 (RTCP SR 的 octet count 只计负载)
+} rtp_packet_list;
+
+// 在 [p, end) 中查找下一个 Annex-B NAL，返回 NAL 起始 (不含起始码)，没有时返回 NULL
+const uint8_t *rtp_next_nal(const uint8_t *p, const uint8_t *end, int *nal_len);
+
+// 把一帧 Annex-B 码流打包为单 NAL 包或 FU 分片 (RFC 6184 / RFC 7798)，
+// 最后一个包置 marker；返回包数，内存不足返回 -1。
+// 包的负载指向 frame，发送完成前 frame 必须保持有效
+int rtp_pack_frame(rtp_stream *st, rtp_packet_list *list, const uint8_t *frame, int len,
+                   uint32_t timestamp);
+
+// RTP 头起始 (前面 RTP_TCP_PREFIX 字节留给 TCP 交织前缀)
+static inline uint8_t *rtp_packet_header(rtp_packet *pkt) { return pkt->hdr + RTP_TCP_PREFIX; }
+
+// RTP 包长度 (头 + 负载，不含前缀)
+static inline int rtp_packet_len(const rtp_packet *pkt) { return pkt->hdr_len + pkt->payload_len; }
+
+void rtp_packet_list_free(rtp_packet_list *list);
+
+// 构造 RTCP 复合包 SR + SDES(CNAME)，返回长度，缓冲区不足返回 -1
+int rtcp_build_sr(uint8_t *buf, int size, uint32_t ssrc, uint64_t ntp, uint32_t rtp_ts,
+                  uint32_t packets, uint32_t octets, const char *cname);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -1,139 +1,570 @@
 // Copyright 2021 Rockchip Electronics Co., Ltd. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
+#define _GNU_SOURCE // PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
 #include "common.h"
+#include "rtsp.h"
+#ifdef APP_NATIVE_RTSP
+#include "rtsp_server.h"
+#else
 #include "rtsp_demo.h"
+#endif
+
+#include <poll.h>
+#include <sys/eventfd.h>
 
 #ifdef LOG_TAG
 #undef LOG_TAG
 #endif
 #define LOG_TAG "rtsp.c"
 
-pthread_mutex_t g_rtsp_mutex = PTHREAD_MUTEX_INITIALIZER;
-rtsp_demo_handle g_rtsplive = NULL;
-rtsp_session_handle g_rtsp_session_0 = NULL;
-rtsp_session_handle g_rtsp_session_1 = NULL;
-rtsp_session_handle g_rtsp_session_2 = NULL;
+// 每个会话每种媒体的入队槽位数 (2 的幂)，I/O 线程跟不上时新帧被丢弃
+#define RTSP_INGEST_SLOTS 8
+// 事件线程处理周期 (毫秒)，决定握手与 RTCP 的响应延迟 (librtsp 不提供 fd，只能定时轮询)
+#define RTSP_IO_IDLE_MS 10
+// 发送线程空闲时的检查周期 (毫秒)，入队会立即唤醒，这里只是兜底
+#define RTSP_SENDER_IDLE_MS 100
+
+// 入队槽位，data 只在槽位空闲时由生产者扩容。
+// frame 指向待发送的码流：拷贝入队时等于 data，引用入队时指向调用者的缓冲区，
+// 发送完成 (或丢弃) 后调用 release 归还
+typedef struct {
+	unsigned char *data;
+	unsigned int cap;
+	const unsigned char *frame;
+	unsigned int len;
+	int64_t pts;
+	void (*release)(void *opaque);
+	void *opaque;
+} rtsp_ingest_slot;
+
+// 单生产者单消费者无锁队列：推流线程写 head，会话发送线程写 tail
+typedef struct {
+	rtsp_ingest_slot slots[RTSP_INGEST_SLOTS];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t dropped;
+	uint32_t key_requests; // 溢出后请求关键帧的次数
+	int wait_key; // 丢帧后等待关键帧，避免发送无法解码的 P 帧
+} rtsp_ingest_queue;
 
-int rkipc_rtsp_init(const char *rtsp_url_0, const char *rtsp_url_1, const char *rtsp_url_2) {
-	const char *tmp_output_data_type = "H.264";
+// 会话表项：librtsp 会话句柄、入队队列与该会话独占的发送线程
+typedef struct {
+	rtsp_session_handle handle;
+	int active; // 会话已创建，可以入队 (原子访问)
+	int codec;
+	rtsp_ingest_queue video;
+	rtsp_ingest_queue audio;
+	pthread_t thread;
+	int running;
+	int sleeping; // 发送线程即将进入 poll，生产者需要唤醒 (原子访问)
+	int wake_fd;
+} rtsp_session_entry;
 
+// 读锁：各会话发送线程调用 rtsp_tx_*，不同会话互不等待；
+// 写锁：rtsp_do_event (接入/断开客户端会修改会话的客户端列表) 与增删会话。
+// 读锁按帧持有，写者优先：多路会话连续发送时事件线程也能及时拿到写锁
+#ifdef PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
+static pthread_rwlock_t g_rtsp_lock = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+#else
+static pthread_rwlock_t g_rtsp_lock = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+static rtsp_demo_handle g_rtsplive = NULL;
+// 会话表，下标即码流 ID
+static rtsp_session_entry g_rtsp_sessions[RTSP_MAX_SESSIONS];
+
+static pthread_t g_rtsp_event_thread;
+static int g_rtsp_event_running = 0;
+static int g_rtsp_stop_fd = -1;
+// 客户端开始播放时请求关键帧 (只有内置服务端会回调)
+static int (*g_rtsp_keyframe_request)(int id) = NULL;
+
+// 码流是否以参数集或 IDR 开头 (VENC 输出的关键帧以 SPS/VPS 开头)
+static int rtsp_frame_is_key(int codec, const unsigned char *buf, unsigned int len) {
+	unsigned int i = 0;
+	while (i + 3 < len && !(buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1))
+		i++;
+	if (i + 3 >= len)
+		return 0;
+	unsigned char nal = buf[i + 3];
+	if (codec == RTSP_CODEC_ID_VIDEO_H265) {
+		int type = (nal >> 1) & 0x3f;
+		return type == 32 || type == 33 || type == 19 || type == 20;
+	}
+	int type = nal & 0x1f;
+	return type == 7 || type == 5;
+}
+
+// 与发送线程的 "置睡眠标志 -> 检查队列" 配对，两侧都用全屏障，入队后不会漏掉唤醒
+static void rtsp_session_wake(rtsp_session_entry *s) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&s->sleeping, 0, __ATOMIC_SEQ_CST)) {
+		uint64_t one = 1;
+		if (write(s->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+			LOG_ERROR("wake rtsp sender failed: %s\n", strerror(errno));
+	}
+}
+
+// 等待 fd 可读或超时，并清空 eventfd 计数
+static void rtsp_wait_fd(int fd, int timeout_ms) {
+	struct pollfd pfd = {fd, POLLIN, 0};
+	if (poll(&pfd, 1, timeout_ms) > 0) {
+		uint64_t count;
+		if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+			LOG_ERROR("read eventfd failed: %s\n", strerror(errno));
+	}
+}
+
+// 生产者入队，队列满时丢弃新帧 (视频随后丢到下一个关键帧)。
+// release 为 NULL 时拷贝入队，否则只保存引用，入队失败时立即 release
+static int rtsp_ingest_push(rtsp_ingest_queue *q, int codec, const unsigned char *buffer,
+                            unsigned int buffer_size, int64_t present_time,
+                            void (*release)(void *opaque), void *opaque) {
+	uint32_t head = q->head;
+	uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+
+	if (q->wait_key) {
+		if (!rtsp_frame_is_key(codec, buffer, buffer_size))
+			goto drop;
+		q->wait_key = 0;
+	}
+	if (head - tail >= RTSP_INGEST_SLOTS) {
+		if (codec != RTSP_CODEC_ID_NONE)
+			q->wait_key = 1;
+		goto drop;
+	}
+
+	rtsp_ingest_slot *slot = &q->slots[head & (RTSP_INGEST_SLOTS - 1)];
+	if (release) {
+		slot->frame = buffer;
+	} else {
+		if (slot->cap < buffer_size) {
+			unsigned char *data = realloc(slot->data, buffer_size);
+			if (!data)
+				goto drop;
+			slot->data = data;
+			slot->cap = buffer_size;
+		}
+		memcpy(slot->data, buffer, buffer_size);
+		slot->frame = slot->data;
+	}
+	slot->len = buffer_size;
+	slot->pts = present_time;
+	slot->release = release;
+	slot->opaque = opaque;
+	__atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+
+drop:
+	if (release)
+		release(opaque);
+	if ((__atomic_add_fetch(&q->dropped, 1, __ATOMIC_RELAXED) & 0xff) == 1)
+		LOG_WARN("rtsp ingest queue full, %u frames dropped\n", q->dropped);
+	return -1;
+}
+
+static int rtsp_ingest_pending(const rtsp_ingest_queue *q) {
+	return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) != q->tail;
+}
+
+// 发送一帧视频，在 g_rtsp_lock 读锁下进行。内置服务端按批发送，
+// 批间的节拍等待在锁外进行，关键帧限速期间事件线程照常处理请求；
+// 其 socket 写不阻塞 (TCP 写不完的进入连接积压，溢出即断开)，慢客户端不会拉长临界区。
+// librtsp 的发送可能阻塞，只能按帧持锁缩短影响
+static void rtsp_send_video(rtsp_session_handle session, const rtsp_ingest_slot *slot) {
+#ifdef APP_NATIVE_RTSP
+	uint64_t wait_us;
+
+	pthread_rwlock_rdlock(&g_rtsp_lock);
+	int more = rtsp_tx_video_begin(session, slot->frame, slot->len, slot->pts) > 0;
+	while (more) {
+		more = rtsp_tx_video_next(session, &wait_us) > 0;
+		if (more && wait_us) {
+			pthread_rwlock_unlock(&g_rtsp_lock);
+			usleep(wait_us);
+			pthread_rwlock_rdlock(&g_rtsp_lock);
+		}
+	}
+	pthread_rwlock_unlock(&g_rtsp_lock);
+#else
+	pthread_rwlock_rdlock(&g_rtsp_lock);
+	rtsp_tx_video(session, slot->frame, slot->len, slot->pts);
+	pthread_rwlock_unlock(&g_rtsp_lock);
+#endif
+}
+
+// 消费者出队并发送，每帧单独持有 g_rtsp_lock 读锁
+static int rtsp_ingest_drain(rtsp_ingest_queue *q, rtsp_session_handle session, int video) {
+	uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+	uint32_t tail = q->tail;
+	int count = 0;
+
+	for (; tail != head; tail++, count++) {
+		rtsp_ingest_slot *slot = &q->slots[tail & (RTSP_INGEST_SLOTS - 1)];
+		if (video) {
+			rtsp_send_video(session, slot);
+		} else {
+			pthread_rwlock_rdlock(&g_rtsp_lock);
+			rtsp_tx_audio(session, slot->frame, slot->len, slot->pts);
+			pthread_rwlock_unlock(&g_rtsp_lock);
+		}
+		if (slot->release) {
+			slot->release(slot->opaque);
+			slot->release = NULL;
+		}
+		__atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+	}
+	return count;
+}
+
+// 发送线程退出后调用，归还未发送的引用并清空队列
+static void rtsp_ingest_release(rtsp_ingest_queue *q) {
+	for (uint32_t tail = q->tail; tail != q->head; tail++) {
+		rtsp_ingest_slot *slot = &q->slots[tail & (RTSP_INGEST_SLOTS - 1)];
+		if (slot->release) {
+			slot->release(slot->opaque);
+			slot->release = NULL;
+		}
+	}
+	q->tail = q->head;
+}
+
+static void rtsp_ingest_free(rtsp_ingest_queue *q) {
+	rtsp_ingest_release(q);
+	for (int i = 0; i < RTSP_INGEST_SLOTS; i++) {
+		free(q->slots[i].data);
+	}
+	memset(q, 0, sizeof(*q));
+}
+
+// 会话发送线程：只为本会话调用 rtsp_tx_*，另一路码流发送慢不会拖住本路
+static void *rtsp_session_thread(void *arg) {
+	rtsp_session_entry *s = (rtsp_session_entry *)arg;
+	char name[16];
+
+	snprintf(name, sizeof(name), "rtsp_tx%d", (int)(s - g_rtsp_sessions));
+	prctl(PR_SET_NAME, name, 0, 0, 0);
+
+	while (s->running) {
+		if (rtsp_ingest_pending(&s->video) || rtsp_ingest_pending(&s->audio)) {
+			rtsp_ingest_drain(&s->video, s->handle, 1);
+			rtsp_ingest_drain(&s->audio, s->handle, 0);
+		}
+
+		// 先声明即将睡眠再检查队列，避免错过检查之后入队的帧
+		__atomic_store_n(&s->sleeping, 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (!rtsp_ingest_pending(&s->video) && !rtsp_ingest_pending(&s->audio) && s->running)
+			rtsp_wait_fd(s->wake_fd, RTSP_SENDER_IDLE_MS);
+		__atomic_store_n(&s->sleeping, 0, __ATOMIC_RELAXED);
+	}
+
+	return NULL;
+}
+
+#ifdef APP_NATIVE_RTSP
+// 在锁外阻塞等待服务端的监听/连接/RTCP fd 与停止 eventfd，直到有请求到达或需要周期处理；
+// 返回 1 表示需要调用 rtsp_do_event
+static int rtsp_event_wait(void) {
+	struct pollfd pfds[1 + RTSP_SERVER_MAX_EVENT_FDS];
+	int timeout_ms;
+
+	// 连接只由本线程 (rtsp_do_event) 增删，释放锁后这些 fd 仍然有效
+	pthread_rwlock_rdlock(&g_rtsp_lock);
+	int nfds = rtsp_get_event_fds(g_rtsplive, pfds + 1, RTSP_SERVER_MAX_EVENT_FDS, &timeout_ms);
+	pthread_rwlock_unlock(&g_rtsp_lock);
+	if (nfds < 0)
+		nfds = 0;
+	pfds[0].fd = g_rtsp_stop_fd;
+	pfds[0].events = POLLIN;
+	pfds[0].revents = 0;
+	if (poll(pfds, nfds + 1, timeout_ms) < 0 && errno != EINTR) {
+		LOG_ERROR("rtsp event poll failed: %s\n", strerror(errno));
+		usleep(RTSP_IO_IDLE_MS * 1000);
+	}
+	if (pfds[0].revents & POLLIN) {
+		rtsp_wait_fd(g_rtsp_stop_fd, 0);
+		return 0;
+	}
+	return 1;
+}
+#endif
+
+// 事件线程：处理客户端握手、RTCP，推流线程不再进入 librtsp。
+// 内置服务端在锁外阻塞等待 fd，空闲时不唤醒；librtsp 每 RTSP_IO_IDLE_MS 轮询一次
+static void *rtsp_event_thread(void *arg) {
+	(void)arg;
+	prctl(PR_SET_NAME, "rtsp_event", 0, 0, 0);
+	LOG_INFO("rtsp event thread started\n");
+
+	while (g_rtsp_event_running) {
+#ifdef APP_NATIVE_RTSP
+		if (!rtsp_event_wait())
+			continue;
+		pthread_rwlock_wrlock(&g_rtsp_lock);
+		rtsp_do_event(g_rtsplive);
+		pthread_rwlock_unlock(&g_rtsp_lock);
+#else
+		pthread_rwlock_wrlock(&g_rtsp_lock);
+		rtsp_do_event(g_rtsplive);
+		pthread_rwlock_unlock(&g_rtsp_lock);
+		rtsp_wait_fd(g_rtsp_stop_fd, RTSP_IO_IDLE_MS);
+#endif
+	}
+
+	LOG_INFO("rtsp event thread stopped\n");
+	return NULL;
+}
+
+static void rtsp_request_keyframe(int id) {
+	int (*request)(int id) = __atomic_load_n(&g_rtsp_keyframe_request, __ATOMIC_ACQUIRE);
+	if (request)
+		request(id);
+}
+
+#ifdef APP_NATIVE_RTSP
+// 在事件线程中调用，参数为会话下标 (码流 ID)
+static void rtsp_on_play(void *arg) { rtsp_request_keyframe((int)(intptr_t)arg); }
+#endif
+
+// 停止会话的发送线程，调用者不能持有 g_rtsp_lock (发送线程可能正在等读锁)
+static void rtsp_session_stop(rtsp_session_entry *s) {
+	__atomic_store_n(&s->active, 0, __ATOMIC_RELEASE);
+	if (s->running) {
+		s->running = 0;
+		__atomic_store_n(&s->sleeping, 1, __ATOMIC_RELEASE);
+		rtsp_session_wake(s);
+		pthread_join(s->thread, NULL);
+	}
+	if (s->wake_fd >= 0) {
+		close(s->wake_fd);
+		s->wake_fd = -1;
+	}
+}
+
+int rkipc_rtsp_init(void) {
 	LOG_DEBUG("start\n");
-	pthread_mutex_lock(&g_rtsp_mutex);
+	pthread_rwlock_wrlock(&g_rtsp_lock);
 	g_rtsplive = create_rtsp_demo(554);
-	if (rtsp_url_0) {
-		g_rtsp_session_0 = rtsp_new_session(g_rtsplive, rtsp_url_0);
-		tmp_output_data_type = rk_param_get_string("video.0:output_data_type", "H.264");
-		if (!strcmp(tmp_output_data_type, "H.264"))
-			rtsp_set_video(g_rtsp_session_0, RTSP_CODEC_ID_VIDEO_H264, NULL, 0);
-		else if (!strcmp(tmp_output_data_type, "H.265"))
-			rtsp_set_video(g_rtsp_session_0, RTSP_CODEC_ID_VIDEO_H265, NULL, 0);
-		else
-			LOG_DEBUG("0 tmp_output_data_type is %s, not support\n", tmp_output_data_type);
-		rtsp_sync_video_ts(g_rtsp_session_0, rtsp_get_reltime(), rtsp_get_ntptime());
-		rtsp_set_audio(g_rtsp_session_0, RTSP_CODEC_ID_AUDIO_G711A, NULL, 0);
-		rtsp_sync_audio_ts(g_rtsp_session_0, rtsp_get_reltime(), rtsp_get_ntptime());
-		rtsp_set_audio_sample_rate(g_rtsp_session_0,
-		                           rk_param_get_int("audio.0:sample_rate", 16000));
-		rtsp_set_audio_channels(g_rtsp_session_0, rk_param_get_int("audio.0:channels", 2));
-	}
-	if (rtsp_url_1) {
-		g_rtsp_session_1 = rtsp_new_session(g_rtsplive, rtsp_url_1);
-		tmp_output_data_type = rk_param_get_string("video.1:output_data_type", "H.264");
-		if (!strcmp(tmp_output_data_type, "H.264"))
-			rtsp_set_video(g_rtsp_session_1, RTSP_CODEC_ID_VIDEO_H264, NULL, 0);
-		else if (!strcmp(tmp_output_data_type, "H.265"))
-			rtsp_set_video(g_rtsp_session_1, RTSP_CODEC_ID_VIDEO_H265, NULL, 0);
-		else
-			LOG_DEBUG("1 tmp_output_data_type is %s, not support\n", tmp_output_data_type);
-		rtsp_sync_video_ts(g_rtsp_session_1, rtsp_get_reltime(), rtsp_get_ntptime());
-		rtsp_set_audio(g_rtsp_session_1, RTSP_CODEC_ID_AUDIO_G711A, NULL, 0);
-		rtsp_sync_audio_ts(g_rtsp_session_1, rtsp_get_reltime(), rtsp_get_ntptime());
-		rtsp_set_audio_sample_rate(g_rtsp_session_1,
-		                           rk_param_get_int("audio.0:sample_rate", 16000));
-		rtsp_set_audio_channels(g_rtsp_session_1, rk_param_get_int("audio.0:channels", 2));
-	}
-	if (rtsp_url_2) {
-		g_rtsp_session_2 = rtsp_new_session(g_rtsplive, rtsp_url_2);
-		tmp_output_data_type = rk_param_get_string("video.2:output_data_type", "H.264");
-		if (!strcmp(tmp_output_data_type, "H.264"))
-			rtsp_set_video(g_rtsp_session_2, RTSP_CODEC_ID_VIDEO_H264, NULL, 0);
-		else if (!strcmp(tmp_output_data_type, "H.265"))
-			rtsp_set_video(g_rtsp_session_2, RTSP_CODEC_ID_VIDEO_H265, NULL, 0);
-		else
-			LOG_DEBUG("2 tmp_output_data_type is %s, not support\n", tmp_output_data_type);
-		rtsp_sync_video_ts(g_rtsp_session_2, rtsp_get_reltime(), rtsp_get_ntptime());
-		rtsp_set_audio(g_rtsp_session_2, RTSP_CODEC_ID_AUDIO_G711A, NULL, 0);
-		rtsp_sync_audio_ts(g_rtsp_session_2, rtsp_get_reltime(), rtsp_get_ntptime());
-		rtsp_set_audio_sample_rate(g_rtsp_session_2,
-		                           rk_param_get_int("audio.0:sample_rate", 16000));
-		rtsp_set_audio_channels(g_rtsp_session_2, rk_param_get_int("audio.0:channels", 2));
-	}
-
-	pthread_mutex_unlock(&g_rtsp_mutex);
+	pthread_rwlock_unlock(&g_rtsp_lock);
+	if (!g_rtsplive)
+		return -1;
+	for (int i = 0; i < RTSP_MAX_SESSIONS; i++)
+		g_rtsp_sessions[i].wake_fd = -1;
+
+	g_rtsp_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (g_rtsp_stop_fd < 0) {
+		LOG_ERROR("eventfd failed: %s\n", strerror(errno));
+		goto err;
+	}
+	g_rtsp_event_running = 1;
+	if (pthread_create(&g_rtsp_event_thread, NULL, rtsp_event_thread, NULL) != 0) {
+		LOG_ERROR("create rtsp event thread failed\n");
+		g_rtsp_event_running = 0;
+		close(g_rtsp_stop_fd);
+		g_rtsp_stop_fd = -1;
+		goto err;
+	}
 	LOG_DEBUG("end\n");
 
+	return 0;
+
+err:
+	pthread_rwlock_wrlock(&g_rtsp_lock);
+	rtsp_del_demo(g_rtsplive);
+	g_rtsplive = NULL;
+	pthread_rwlock_unlock(&g_rtsp_lock);
+	return -1;
+}
+
+int rkipc_rtsp_add_session(int id, const char *rtsp_url, const char *output_data_type) {
+	rtsp_session_handle session;
+	rtsp_session_entry *s;
+	int codec = RTSP_CODEC_ID_NONE;
+
+	if (id < 0 || id >= RTSP_MAX_SESSIONS || !rtsp_url) {
+		LOG_ERROR("invalid rtsp session %d\n", id);
+		return -1;
+	}
+	s = &g_rtsp_sessions[id];
+	pthread_rwlock_wrlock(&g_rtsp_lock);
+	if (g_rtsplive == NULL || s->handle) {
+		pthread_rwlock_unlock(&g_rtsp_lock);
+		LOG_ERROR("rtsp session %d: server not running or already added\n", id);
+		return -1;
+	}
+	session = rtsp_new_session(g_rtsplive, rtsp_url);
+	if (!session) {
+		pthread_rwlock_unlock(&g_rtsp_lock);
+		LOG_ERROR("rtsp_new_session %s failed\n", rtsp_url);
+		return -1;
+	}
+	if (!strcmp(output_data_type, "H.264"))
+		codec = RTSP_CODEC_ID_VIDEO_H264;
+	else if (!strcmp(output_data_type, "H.265"))
+		codec = RTSP_CODEC_ID_VIDEO_H265;
+	else
+		LOG_DEBUG("%d output_data_type is %s, not support\n", id, output_data_type);
+	if (codec != RTSP_CODEC_ID_NONE)
+		rtsp_set_video(session, codec, NULL, 0);
+	rtsp_sync_video_ts(session, rtsp_get_reltime(), rtsp_get_ntptime());
+	rtsp_set_audio(session, RTSP_CODEC_ID_AUDIO_G711A, NULL, 0);
+	rtsp_sync_audio_ts(session, rtsp_get_reltime(), rtsp_get_ntptime());
+	rtsp_set_audio_sample_rate(session, rk_param_get_int("audio.0:sample_rate", 16000));
+	rtsp_set_audio_channels(session, rk_param_get_int("audio.0:channels", 2));
+#ifdef APP_NATIVE_RTSP
+	rtsp_set_play_callback(session, rtsp_on_play, (void *)(intptr_t)id);
+#endif
+
+	s->handle = session;
+	s->codec = codec;
+	s->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	s->running = 1;
+	if (s->wake_fd < 0 || pthread_create(&s->thread, NULL, rtsp_session_thread, s) != 0) {
+		LOG_ERROR("rtsp session %d: start sender failed\n", id);
+		s->running = 0;
+		if (s->wake_fd >= 0)
+			close(s->wake_fd);
+		s->wake_fd = -1;
+		s->handle = NULL;
+		rtsp_del_session(session);
+		pthread_rwlock_unlock(&g_rtsp_lock);
+		return -1;
+	}
+	__atomic_store_n(&s->active, 1, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(&g_rtsp_lock);
+	LOG_INFO("rtsp session %d: %s (%s)\n", id, rtsp_url, output_data_type);
+
+	return 0;
+}
+
+// 码流销毁前调用：停止发送线程并归还入队的引用帧，之后的写入直接丢弃。
+// 会话本身保留到 rkipc_rtsp_deinit，客户端连接不受影响
+int rkipc_rtsp_stop_session(int id) {
+	if (id < 0 || id >= RTSP_MAX_SESSIONS)
+		return -1;
+	rtsp_session_entry *s = &g_rtsp_sessions[id];
+	rtsp_session_stop(s);
+	rtsp_ingest_release(&s->video); // 音频总是拷贝入队，不持有引用
+
 	return 0;
 }
 
 int rkipc_rtsp_deinit() {
 	LOG_DEBUG("%s\n", __func__);
-	pthread_mutex_lock(&g_rtsp_mutex);
-	if (g_rtsp_session_0) {
-		rtsp_del_session(g_rtsp_session_0);
-		g_rtsp_session_0 = NULL;
+	// 发送线程退出时会取读锁，先停线程再取写锁
+	for (int i = 0; i < RTSP_MAX_SESSIONS; i++)
+		rtsp_session_stop(&g_rtsp_sessions[i]);
+	if (g_rtsp_event_running) {
+		uint64_t one = 1;
+		g_rtsp_event_running = 0;
+		if (write(g_rtsp_stop_fd, &one, sizeof(one)) < 0)
+			LOG_ERROR("wake rtsp event thread failed: %s\n", strerror(errno));
+		pthread_join(g_rtsp_event_thread, NULL);
+		close(g_rtsp_stop_fd);
+		g_rtsp_stop_fd = -1;
 	}
-	if (g_rtsp_session_1) {
-		rtsp_del_session(g_rtsp_session_1);
-		g_rtsp_session_1 = NULL;
-	}
-	if (g_rtsp_session_2) {
-		rtsp_del_session(g_rtsp_session_2);
-		g_rtsp_session_2 = NULL;
+
+	pthread_rwlock_wrlock(&g_rtsp_lock);
+	for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+		rtsp_session_entry *s = &g_rtsp_sessions[i];
+		if (s->handle) {
+			if (s->video.dropped || s->audio.dropped)
+				LOG_INFO("rtsp session %d: ingest dropped %u video, %u audio frames, "
+				         "%u key requests\n",
+				         i, s->video.dropped, s->audio.dropped, s->video.key_requests);
+			rtsp_del_session(s->handle);
+			s->handle = NULL;
+		}
+		rtsp_ingest_free(&s->video);
+		rtsp_ingest_free(&s->audio);
 	}
 	if (g_rtsplive) {
 		rtsp_del_demo(g_rtsplive);
 		g_rtsplive = NULL;
 	}
-	pthread_mutex_unlock(&g_rtsp_mutex);
+	pthread_rwlock_unlock(&g_rtsp_lock);
 
 	return 0;
 }
 
+void rkipc_rtsp_set_keyframe_request(int (*request)(int id)) {
+	__atomic_store_n(&g_rtsp_keyframe_request, request, __ATOMIC_RELEASE);
+}
+
+// 入队后唤醒发送线程；队列刚溢出、开始丢到关键帧时请求 IDR，慢客户端不必等一个 GOP
+static void rtsp_video_after_push(int id, rtsp_session_entry *s, int was_waiting) {
+	rtsp_session_wake(s);
+	if (!was_waiting && s->video.wait_key) {
+		__atomic_add_fetch(&s->video.key_requests, 1, __ATOMIC_RELAXED);
+		rtsp_request_keyframe(id);
+	}
+}
+
+// 只拷贝入队并唤醒本会话的发送线程，不持锁、不进入 librtsp；同一 id 只能由一个线程写入
 int rkipc_rtsp_write_video_frame(int id, unsigned char *buffer, unsigned int buffer_size,
                                  int64_t present_time) {
-	pthread_mutex_lock(&g_rtsp_mutex);
-	if (g_rtsplive == NULL) {
-		pthread_mutex_unlock(&g_rtsp_mutex);
+	if (id < 0 || id >= RTSP_MAX_SESSIONS || !buffer || buffer_size == 0)
+		return -1;
+	rtsp_session_entry *s = &g_rtsp_sessions[id];
+	if (!__atomic_load_n(&s->active, __ATOMIC_ACQUIRE))
+		return -1;
+	int waiting = s->video.wait_key;
+	int ret = rtsp_ingest_push(&s->video, s->codec, buffer, buffer_size, present_time, NULL, NULL);
+	rtsp_video_after_push(id, s, waiting);
+
+	return ret;
+}
+
+// 引用入队：不拷贝码流，发送完成或丢弃后在发送线程 (失败时在调用线程) 调用 release(opaque)，
+// 此前 buffer 必须保持有效。返回 -1 时 release 已经调用过
+int rkipc_rtsp_write_video_frame_ref(int id, unsigned char *buffer, unsigned int buffer_size,
+                                     int64_t present_time, void (*release)(void *opaque),
+                                     void *opaque) {
+	if (id < 0 || id >= RTSP_MAX_SESSIONS || !buffer || buffer_size == 0 ||
+	    !__atomic_load_n(&g_rtsp_sessions[id].active, __ATOMIC_ACQUIRE)) {
+		release(opaque);
 		return -1;
 	}
-	if ((id == 0) && g_rtsp_session_0)
-		rtsp_tx_video(g_rtsp_session_0, buffer, buffer_size, present_time);
-	if ((id == 1) && g_rtsp_session_1)
-		rtsp_tx_video(g_rtsp_session_1, buffer, buffer_size, present_time);
-	if ((id == 2) && g_rtsp_session_2)
-		rtsp_tx_video(g_rtsp_session_2, buffer, buffer_size, present_time);
-	rtsp_do_event(g_rtsplive);
-	pthread_mutex_unlock(&g_rtsp_mutex);
+	rtsp_session_entry *s = &g_rtsp_sessions[id];
+	int waiting = s->video.wait_key;
+	int ret = rtsp_ingest_push(&s->video, s->codec, buffer, buffer_size, present_time, release,
+	                           opaque);
+	rtsp_video_after_push(id, s, waiting);
 
-	return 0;
+	return ret;
 }
 
+// 音频发往所有会话，只能由一个音频线程调用
 int rkipc_rtsp_write_audio_frame(int id, unsigned char *buffer, unsigned int buffer_size,
                                  int64_t present_time) {
-	pthread_mutex_lock(&g_rtsp_mutex);
-	if (g_rtsplive == NULL) {
-		pthread_mutex_unlock(&g_rtsp_mutex);
+	(void)id;
+	if (!buffer || buffer_size == 0)
 		return -1;
+	for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+		rtsp_session_entry *s = &g_rtsp_sessions[i];
+		if (!__atomic_load_n(&s->active, __ATOMIC_ACQUIRE))
+			continue;
+		rtsp_ingest_push(&s->audio, RTSP_CODEC_ID_NONE, buffer, buffer_size, present_time, NULL,
+		                 NULL);
+		rtsp_session_wake(s);
 	}
-	if (g_rtsp_session_0)
-		rtsp_tx_audio(g_rtsp_session_0, buffer, buffer_size, present_time);
-	if (g_rtsp_session_1)
-		rtsp_tx_audio(g_rtsp_session_1, buffer, buffer_size, present_time);
-	if (g_rtsp_session_2)
-		rtsp_tx_audio(g_rtsp_session_2, buffer, buffer_size, present_time);
-	rtsp_do_event(g_rtsplive);
-	pthread_mutex_unlock(&g_rtsp_mutex);
+
+	return 0;
+}
+
+int rkipc_rtsp_get_stats(int id, rkipc_rtsp_stats *stats) {
+	if (id < 0 || id >= RTSP_MAX_SESSIONS || !stats)
+		return -1;
+	rtsp_session_entry *s = &g_rtsp_sessions[id];
+	if (!__atomic_load_n(&s->active, __ATOMIC_ACQUIRE))
+		return -1;
+	uint32_t head = __atomic_load_n(&s->video.head, __ATOMIC_ACQUIRE);
+	uint32_t tail = __atomic_load_n(&s->video.tail, __ATOMIC_ACQUIRE);
+	stats->depth = head - tail;
+	stats->capacity = RTSP_INGEST_SLOTS;
+	stats->dropped = __atomic_load_n(&s->video.dropped, __ATOMIC_RELAXED);
+	stats->key_requests = __atomic_load_n(&s->video.key_requests, __ATOMIC_RELAXED);
 
 	return 0;
 }
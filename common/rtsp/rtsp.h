@@ -5,14 +5,37 @@
 #ifndef __RTSP_DEMO_H__
 #define __RTSP_DEMO_H__
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int rkipc_rtsp_init(const char *rtsp_url_0, const char *rtsp_url_1, const char *rtsp_url_2);
+// 会话表容量，会话下标即码流 ID
+#define RTSP_MAX_SESSIONS 8
+
+// 会话视频入队队列的统计 (供自适应码率采样)
+typedef struct {
+	unsigned int depth;        // 当前积压帧数
+	unsigned int capacity;     // 队列容量
+	unsigned int dropped;      // 累计丢帧数 (单调递增)
+	unsigned int key_requests; // 溢出后请求关键帧的次数
+} rkipc_rtsp_stats;
+
+int rkipc_rtsp_init(void);
+int rkipc_rtsp_add_session(int id, const char *rtsp_url, const char *output_data_type);
 int rkipc_rtsp_deinit();
+// 停止会话的发送线程并归还未发送的引用帧 (码流销毁前调用)，会话保留到 rkipc_rtsp_deinit
+int rkipc_rtsp_stop_session(int id);
+// 设置客户端开始播放时的关键帧请求函数 (参数为码流 ID)，使用 librtsp 时不会被调用
+void rkipc_rtsp_set_keyframe_request(int (*request)(int id));
 int rkipc_rtsp_write_video_frame(int id, unsigned char *buffer, unsigned int buffer_size,
                                  int64_t present_time);
+// 不拷贝码流的写入：发送完成或丢弃后调用 release(opaque)，此前 buffer 必须保持有效
+int rkipc_rtsp_write_video_frame_ref(int id, unsigned char *buffer, unsigned int buffer_size,
+                                     int64_t present_time, void (*release)(void *opaque),
+                                     void *opaque);
+int rkipc_rtsp_get_stats(int id, rkipc_rtsp_stats *stats);
 int rkipc_rtsp_write_audio_frame(int id, unsigned char *buffer, unsigned int buffer_size,
                                  int64_t present_time);
 
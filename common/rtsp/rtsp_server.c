@@ -0,0 +1,1250 @@
+// Copyright 2021 Rockchip Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#define _GNU_SOURCE // sendmmsg
+#include "rtsp_server.h"
+#include "log.h"
+#include "rtp.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "rtsp_server.c"
+
+// 会话 (挂载点) 上限
+#define RTSP_SERVER_MAX_SESSIONS 8
+// 单个请求 (请求行 + 头 + 消息体) 的最大长度
+#define RTSP_REQ_MAX 4096
+// 缓存的参数集最大长度
+#define RTSP_PARAM_MAX 256
+// 动态负载类型
+#define RTSP_VIDEO_PT 96
+// 1900-01-01 到 1970-01-01 的秒数
+#define RTSP_NTP_OFFSET 2208988800ULL
+// 一次批量发送的最大包数
+#define RTSP_SEND_BATCH 64
+// 一次 GSO 发送的最大分段数 (总长不能超过 64KB 的 UDP 报文上限)
+#define RTSP_GSO_MAX_SEGS (65000 / (RTP_HEADER_SIZE + RTP_MAX_PAYLOAD))
+
+// 旧工具链的头文件没有 UDP_SEGMENT (Linux 4.18 加入)
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+typedef struct rtsp_server rtsp_server;
+typedef struct rtsp_media rtsp_media;
+
+// 一条 RTSP 控制连接，SETUP 之后也是一个客户端 (每个连接只拉一路视频)
+typedef struct {
+	int fd; // -1 表示空闲
+	struct sockaddr_in peer;
+	char rbuf[RTSP_REQ_MAX];
+	int rlen;
+	uint64_t last_active_ms;
+	// 以下在 SETUP 后有效
+	rtsp_media *media;
+	uint32_t session_id;
+	int playing;
+	int tcp; // RTP over RTSP (交织)
+	int channel;
+	struct sockaddr_in rtp_addr;
+	struct sockaddr_in rtcp_addr;
+	int wait_key; // PLAY 后从关键帧开始发送
+	int dead;     // 发送失败，由 rtsp_do_event 关闭 (原子访问)
+	// 非阻塞写不完的字节 (RTSP 回复与交织的 RTP/RTCP 按序排队)，首次用到时分配
+	uint8_t *wbuf;
+	int woff;
+	int wlen; // 事件线程据此监听可写 (原子访问)
+	uint32_t packets;
+	uint32_t octets;
+	uint64_t last_sr_ms;
+} rtsp_conn;
+
+// 一个挂载点 (如 /live/0)，所有客户端共用一路 RTP 流：每帧只打包一次
+struct rtsp_media {
+	rtsp_server *server;
+	char path[64];
+	int codec;
+	rtp_stream rtp;
+	rtp_packet_list packets;
+	uint32_t ts_base;
+	uint32_t last_rtp_ts;
+	uint64_t last_tx_us; // 发送 last_rtp_ts 那一帧的单调时刻，用于推算 SR 中的 RTP 时间戳
+	uint8_t vps[RTSP_PARAM_MAX];
+	uint8_t sps[RTSP_PARAM_MAX];
+	uint8_t pps[RTSP_PARAM_MAX];
+	int vps_len;
+	int sps_len;
+	int pps_len;
+	rtsp_play_callback play_cb;
+	void *play_arg;
+	uint64_t pace_us; // 令牌桶节拍：已发送字节按限速折算后的完成时刻
+	rtsp_tx_stats stats;
+	// 分批发送中的帧 (rtsp_tx_video_begin 之后)，两批之间调用者可以释放锁
+	int tx_first; // 下一批的第一个包
+	int tx_last;  // 已扣除节拍的一批的结束位置，等于 tx_first 时下一批尚未计算
+	int tx_receivers;
+	rtsp_conn *tx_rx[RTSP_SERVER_MAX_CONNS];
+	uint32_t tx_rx_id[RTSP_SERVER_MAX_CONNS]; // 连接在两批之间被关闭或复用时按会话 ID 识别
+};
+
+struct rtsp_server {
+	int listen_fd;
+	int rtp_fd; // 所有 UDP 客户端共用的服务端 RTP/RTCP 端口对
+	int rtcp_fd;
+	int rtp_port;
+	int udp_mode; // RTSP_SERVER_UDP_BATCH，GSO 失败时降为 1 (原子访问)
+	uint32_t next_session_id;
+	rtsp_conn conns[RTSP_SERVER_MAX_CONNS];
+	rtsp_media *medias[RTSP_SERVER_MAX_SESSIONS];
+};
+
+static uint64_t rtsp_mono_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint32_t rtsp_random32(void) {
+	static uint32_t state;
+	if (!state)
+		state = (uint32_t)rtsp_mono_us() ^ ((uint32_t)getpid() << 16) ^ 0x9e3779b9;
+	// xorshift32，只用于 SSRC/会话 ID/时间戳基准，不要求密码学强度
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+uint64_t rtsp_get_reltime(void) { return rtsp_mono_us(); }
+
+uint64_t rtsp_get_ntptime(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ((uint64_t)ts.tv_sec + RTSP_NTP_OFFSET) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 当前时刻的 64 位 NTP 时间戳 (高 32 位秒，低 32 位小数)
+static uint64_t rtsp_ntp64(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	uint64_t frac = ((uint64_t)ts.tv_nsec << 32) / 1000000000;
+	return (((uint64_t)ts.tv_sec + RTSP_NTP_OFFSET) << 32) | frac;
+}
+
+static void rtsp_base64(const uint8_t *in, int len, char *out, int size) {
+	static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	int o = 0;
+
+	for (int i = 0; i < len && o + 4 < size; i += 3) {
+		uint32_t v = in[i] << 16;
+		if (i + 1 < len)
+			v |= in[i + 1] << 8;
+		if (i + 2 < len)
+			v |= in[i + 2];
+		out[o++] = tbl[(v >> 18) & 0x3f];
+		out[o++] = tbl[(v >> 12) & 0x3f];
+		out[o++] = i + 1 < len ? tbl[(v >> 6) & 0x3f] : '=';
+		out[o++] = i + 2 < len ? tbl[v & 0x3f] : '=';
+	}
+	out[o] = '\0';
+}
+
+/* ========================================================================== */
+/*                                  连接管理                                  */
+/* ========================================================================== */
+
+static int rtsp_client_count(const rtsp_server *srv) {
+	int n = 0;
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++) {
+		if (srv->conns[i].fd >= 0 && srv->conns[i].media)
+			n++;
+	}
+	return n;
+}
+
+static void rtsp_conn_close(rtsp_conn *c, const char *reason) {
+	if (c->fd < 0)
+		return;
+	LOG_INFO("client %s:%d closed (%s), %u packets sent\n", inet_ntoa(c->peer.sin_addr),
+	         ntohs(c->peer.sin_port), reason, c->packets);
+	// 跟不上的客户端直接复位，内核不再替它保留 socket 中已排队的数据
+	if (__atomic_load_n(&c->dead, __ATOMIC_RELAXED)) {
+		struct linger lg = {1, 0};
+		setsockopt(c->fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+	}
+	close(c->fd);
+	free(c->wbuf);
+	memset(c, 0, sizeof(*c));
+	c->fd = -1;
+}
+
+static void rtsp_conn_accept(rtsp_server *srv, uint64_t now_ms) {
+	struct sockaddr_in peer;
+	socklen_t alen = sizeof(peer);
+	int fd = accept(srv->listen_fd, (struct sockaddr *)&peer, &alen);
+	if (fd < 0)
+		return;
+
+	rtsp_conn *c = NULL;
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++) {
+		if (srv->conns[i].fd < 0) {
+			c = &srv->conns[i];
+			break;
+		}
+	}
+	if (!c) {
+		LOG_WARN("too many rtsp connections, reject %s\n", inet_ntoa(peer.sin_addr));
+		close(fd);
+		return;
+	}
+
+	// 收发都用 MSG_DONTWAIT，写不完的部分进入积压 (rtsp_conn_write)
+	int one = 1;
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	memset(c, 0, sizeof(*c));
+	c->fd = fd;
+	c->peer = peer;
+	c->last_active_ms = now_ms;
+	LOG_INFO("client %s:%d connected\n", inet_ntoa(peer.sin_addr), ntohs(peer.sin_port));
+}
+
+// 发送失败或跟不上：标记后由 rtsp_do_event 关闭。关闭读方向让连接立即可读，
+// 发送线程标记后事件线程马上被唤醒，不必等到下一次周期处理
+static void rtsp_conn_kill(rtsp_conn *c) {
+	if (!__atomic_exchange_n(&c->dead, 1, __ATOMIC_RELAXED))
+		shutdown(c->fd, SHUT_RD);
+}
+
+// 尽量写出积压，返回 0 表示已写完，1 表示 socket 已满仍有积压，-1 出错
+static int rtsp_conn_flush(rtsp_conn *c) {
+	while (c->wlen > 0) {
+		ssize_t n = send(c->fd, c->wbuf + c->woff, c->wlen, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+		}
+		c->woff += n;
+		__atomic_store_n(&c->wlen, c->wlen - (int)n, __ATOMIC_RELAXED);
+	}
+	c->woff = 0;
+	return 0;
+}
+
+// 把 iovec 剩余的内容追加到积压，超过 RTSP_SERVER_TCP_BACKLOG 返回 -1
+static int rtsp_conn_queue(rtsp_conn *c, const struct iovec *iov, int iovcnt) {
+	size_t total = 0;
+	for (int i = 0; i < iovcnt; i++)
+		total += iov[i].iov_len;
+	if (c->wlen + total > RTSP_SERVER_TCP_BACKLOG) {
+		errno = ENOBUFS;
+		return -1;
+	}
+	if (!c->wbuf && !(c->wbuf = malloc(RTSP_SERVER_TCP_BACKLOG)))
+		return -1;
+	if (c->woff + c->wlen + total > RTSP_SERVER_TCP_BACKLOG) {
+		memmove(c->wbuf, c->wbuf + c->woff, c->wlen);
+		c->woff = 0;
+	}
+	uint8_t *dst = c->wbuf + c->woff + c->wlen;
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+		dst += iov[i].iov_len;
+	}
+	__atomic_store_n(&c->wlen, c->wlen + (int)total, __ATOMIC_RELAXED);
+	return 0;
+}
+
+// 向控制连接按序写入，不阻塞：先写积压，没有积压时直接写，写不完的部分追加到积压。
+// 同一连接只由其挂载点的发送线程 (读锁) 或事件线程 (写锁) 调用，不会并发。
+// 积压超过上限或出错返回 -1；iov 会被修改
+static int rtsp_conn_write(rtsp_conn *c, struct iovec *iov, int iovcnt, uint64_t *syscalls) {
+	int ret = rtsp_conn_flush(c);
+	if (ret < 0)
+		return -1;
+
+	while (ret == 0 && iovcnt > 0) {
+		struct msghdr msg = {0};
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+		ssize_t n = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (syscalls)
+			(*syscalls)++;
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			return -1;
+		}
+		while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return iovcnt > 0 ? rtsp_conn_queue(c, iov, iovcnt) : 0;
+}
+
+/* ========================================================================== */
+/*                                  RTSP 请求                                 */
+/* ========================================================================== */
+
+// 取请求头的值 (不区分大小写)，不存在返回 -1
+static int rtsp_header(const char *req, const char *name, char *out, int size) {
+	int name_len = strlen(name);
+	const char *line = strstr(req, "\r\n");
+
+	while (line && line[2] != '\r' && line[2] != '\0') {
+		line += 2;
+		if (!strncasecmp(line, name, name_len) && line[name_len] == ':') {
+			const char *v = line + name_len + 1;
+			while (*v == ' ' || *v == '\t')
+				v++;
+			int n = 0;
+			while (v[n] && v[n] != '\r' && n < size - 1)
+				n++;
+			memcpy(out, v, n);
+			out[n] = '\0';
+			return n;
+		}
+		line = strstr(line, "\r\n");
+	}
+	return -1;
+}
+
+// 按 URL 路径查找挂载点，允许带 /trackID=N 之类的后缀
+static rtsp_media *rtsp_media_find(rtsp_server *srv, const char *url) {
+	const char *path = url;
+	if (!strncasecmp(path, "rtsp://", 7)) {
+		path = strchr(path + 7, '/');
+		if (!path)
+			return NULL;
+	}
+	for (int i = 0; i < RTSP_SERVER_MAX_SESSIONS; i++) {
+		rtsp_media *m = srv->medias[i];
+		if (!m)
+			continue;
+		int n = strlen(m->path);
+		if (!strncmp(path, m->path, n) && (path[n] == '\0' || path[n] == '/'))
+			return m;
+	}
+	return NULL;
+}
+
+static void rtsp_reply(rtsp_conn *c, int code, const char *status, const char *cseq,
+                       const char *headers, const char *body) {
+	char buf[RTSP_REQ_MAX];
+	int body_len = body ? strlen(body) : 0;
+	int n = snprintf(buf, sizeof(buf),
+	                 "RTSP/1.0 %d %s\r\nCSeq: %s\r\nServer: rv_demo\r\n%s"
+	                 "Content-Length: %d\r\n\r\n%s",
+	                 code, status, cseq, headers ? headers : "", body_len, body ? body : "");
+	if (n >= (int)sizeof(buf)) {
+		LOG_ERROR("rtsp response too long\n");
+		return;
+	}
+	struct iovec iov = {buf, (size_t)n};
+	if (rtsp_conn_write(c, &iov, 1, NULL) < 0)
+		rtsp_conn_kill(c);
+}
+
+static void rtsp_build_sdp(rtsp_conn *c, rtsp_media *m, char *sdp, int size) {
+	char ip[INET_ADDRSTRLEN] = "0.0.0.0";
+	char fmtp[6 * RTSP_PARAM_MAX + 128];
+	char b64[3][RTSP_PARAM_MAX * 2];
+	struct sockaddr_in local;
+	socklen_t alen = sizeof(local);
+
+	if (getsockname(c->fd, (struct sockaddr *)&local, &alen) == 0)
+		inet_ntop(AF_INET, &local.sin_addr, ip, sizeof(ip));
+
+	// 已经见过参数集时带上 sprop，客户端不必等到第一个关键帧就能初始化解码器
+	rtsp_base64(m->vps, m->vps_len, b64[0], sizeof(b64[0]));
+	rtsp_base64(m->sps, m->sps_len, b64[1], sizeof(b64[1]));
+	rtsp_base64(m->pps, m->pps_len, b64[2], sizeof(b64[2]));
+	if (m->codec == RTSP_CODEC_ID_VIDEO_H265) {
+		if (m->vps_len && m->sps_len && m->pps_len)
+			snprintf(fmtp, sizeof(fmtp), "a=fmtp:%d sprop-vps=%s;sprop-sps=%s;sprop-pps=%s\r\n",
+			         RTSP_VIDEO_PT, b64[0], b64[1], b64[2]);
+		else
+			fmtp[0] = '\0';
+	} else if (m->sps_len >= 4 && m->pps_len) {
+		snprintf(fmtp, sizeof(fmtp),
+		         "a=fmtp:%d packetization-mode=1;profile-level-id=%02X%02X%02X;"
+		         "sprop-parameter-sets=%s,%s\r\n",
+		         RTSP_VIDEO_PT, m->sps[1], m->sps[2], m->sps[3], b64[1], b64[2]);
+	} else {
+		snprintf(fmtp, sizeof(fmtp), "a=fmtp:%d packetization-mode=1\r\n", RTSP_VIDEO_PT);
+	}
+
+	snprintf(sdp, size,
+	         "v=0\r\no=- %u 1 IN IP4 %s\r\ns=rv_demo\r\nc=IN IP4 0.0.0.0\r\nt=0 0\r\n"
+	         "a=range:npt=0-\r\na=control:*\r\n"
+	         "m=video 0 RTP/AVP %d\r\na=rtpmap:%d %s/90000\r\n%sa=control:trackID=0\r\n",
+	         m->rtp.ssrc, ip, RTSP_VIDEO_PT, RTSP_VIDEO_PT,
+	         m->codec == RTSP_CODEC_ID_VIDEO_H265 ? "H265" : "H264", fmtp);
+}
+
+static void rtsp_on_setup(rtsp_server *srv, rtsp_conn *c, rtsp_media *m, const char *req,
+                          const char *cseq) {
+	char transport[256];
+	char headers[512];
+	int a, b, n;
+
+	if (c->media && c->media != m) {
+		rtsp_reply(c, 459, "Aggregate Operation Not Allowed", cseq, NULL, NULL);
+		return;
+	}
+	if (!c->media && rtsp_client_count(srv) >= RTSP_SERVER_MAX_CLIENTS) {
+		LOG_WARN("rtsp client limit %d reached\n", RTSP_SERVER_MAX_CLIENTS);
+		rtsp_reply(c, 453, "Not Enough Bandwidth", cseq, NULL, NULL);
+		return;
+	}
+	if (rtsp_header(req, "Transport", transport, sizeof(transport)) < 0) {
+		rtsp_reply(c, 461, "Unsupported Transport", cseq, NULL, NULL);
+		return;
+	}
+
+	const char *p;
+	if (strstr(transport, "RTP/AVP/TCP") && (p = strstr(transport, "interleaved="))) {
+		if (sscanf(p, "interleaved=%d", &a) != 1)
+			a = 0;
+		c->tcp = 1;
+		c->channel = a & 0xfe;
+		snprintf(headers, sizeof(headers),
+		         "Transport: RTP/AVP/TCP;unicast;interleaved=%d-%d;ssrc=%08X\r\n", c->channel,
+		         c->channel + 1, m->rtp.ssrc);
+	} else if (!strstr(transport, "multicast") && (p = strstr(transport, "client_port=")) &&
+	           (n = sscanf(p, "client_port=%d-%d", &a, &b)) >= 1) {
+		if (n == 1)
+			b = a + 1;
+		c->tcp = 0;
+		c->rtp_addr = c->peer;
+		c->rtp_addr.sin_port = htons(a);
+		c->rtcp_addr = c->peer;
+		c->rtcp_addr.sin_port = htons(b);
+		snprintf(headers, sizeof(headers),
+		         "Transport: RTP/AVP;unicast;client_port=%d-%d;server_port=%d-%d;ssrc=%08X\r\n",
+		         a, b, srv->rtp_port, srv->rtp_port + 1, m->rtp.ssrc);
+	} else {
+		rtsp_reply(c, 461, "Unsupported Transport", cseq, NULL, NULL);
+		return;
+	}
+
+	if (!c->media) {
+		c->media = m;
+		c->session_id = srv->next_session_id++;
+	}
+	snprintf(headers + strlen(headers), sizeof(headers) - strlen(headers),
+	         "Session: %08X;timeout=%d\r\n", c->session_id, RTSP_SERVER_TIMEOUT_SEC);
+	rtsp_reply(c, 200, "OK", cseq, headers, NULL);
+	LOG_INFO("client %s:%d setup %s over %s\n", inet_ntoa(c->peer.sin_addr),
+	         ntohs(c->peer.sin_port), m->path, c->tcp ? "TCP" : "UDP");
+}
+
+static void rtsp_handle_request(rtsp_server *srv, rtsp_conn *c, const char *req) {
+	char method[32], url[256], cseq[32], session[64], headers[512];
+	char sdp[6 * RTSP_PARAM_MAX + 512];
+
+	if (sscanf(req, "%31s %255s", method, url) != 2)
+		return;
+	if (rtsp_header(req, "CSeq", cseq, sizeof(cseq)) < 0)
+		strcpy(cseq, "0");
+	LOG_DEBUG("%s %s\n", method, url);
+
+	if (!strcmp(method, "OPTIONS")) {
+		rtsp_reply(c, 200, "OK", cseq,
+		           "Public: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, GET_PARAMETER\r\n",
+		           NULL);
+		return;
+	}
+	if (!strcmp(method, "GET_PARAMETER") || !strcmp(method, "SET_PARAMETER")) {
+		rtsp_reply(c, 200, "OK", cseq, NULL, NULL);
+		return;
+	}
+
+	rtsp_media *m = rtsp_media_find(srv, url);
+	if (!strcmp(method, "DESCRIBE")) {
+		if (!m) {
+			rtsp_reply(c, 404, "Not Found", cseq, NULL, NULL);
+			return;
+		}
+		rtsp_build_sdp(c, m, sdp, sizeof(sdp));
+		snprintf(headers, sizeof(headers),
+		         "Content-Base: %s/\r\nContent-Type: application/sdp\r\n", url);
+		rtsp_reply(c, 200, "OK", cseq, headers, sdp);
+		return;
+	}
+	if (!strcmp(method, "SETUP")) {
+		if (!m)
+			rtsp_reply(c, 404, "Not Found", cseq, NULL, NULL);
+		else
+			rtsp_on_setup(srv, c, m, req, cseq);
+		return;
+	}
+	if (strcmp(method, "PLAY") && strcmp(method, "PAUSE") && strcmp(method, "TEARDOWN")) {
+		rtsp_reply(c, 501, "Not Implemented", cseq, NULL, NULL);
+		return;
+	}
+
+	// 会话内请求：Session 头必须与 SETUP 分配的一致
+	if (!c->media || rtsp_header(req, "Session", session, sizeof(session)) < 0 ||
+	    strtoul(session, NULL, 16) != c->session_id) {
+		rtsp_reply(c, 454, "Session Not Found", cseq, NULL, NULL);
+		return;
+	}
+	snprintf(headers, sizeof(headers), "Session: %08X\r\n", c->session_id);
+
+	if (!strcmp(method, "PLAY")) {
+		rtsp_media *pm = c->media;
+		int n = strlen(headers);
+		// 聚合 URL 上的 PLAY 也按轨道 URL 回复 RTP-Info
+		snprintf(headers + n, sizeof(headers) - n,
+		         "Range: npt=0.000-\r\nRTP-Info: url=%s%s;seq=%u;rtptime=%u\r\n", url,
+		         strstr(url, "/trackID=") ? "" : "/trackID=0", pm->rtp.seq, pm->last_rtp_ts);
+		rtsp_reply(c, 200, "OK", cseq, headers, NULL);
+		if (!c->playing) {
+			c->playing = 1;
+			c->wait_key = 1;
+			LOG_INFO("client %s:%d playing %s\n", inet_ntoa(c->peer.sin_addr),
+			         ntohs(c->peer.sin_port), pm->path);
+			if (pm->play_cb)
+				pm->play_cb(pm->play_arg);
+		}
+	} else if (!strcmp(method, "PAUSE")) {
+		c->playing = 0;
+		rtsp_reply(c, 200, "OK", cseq, headers, NULL);
+	} else {
+		rtsp_reply(c, 200, "OK", cseq, headers, NULL);
+		c->playing = 0;
+		c->media = NULL;
+		c->session_id = 0;
+	}
+}
+
+// 从控制连接读取并处理完整的请求；TCP 交织的 RTCP ($ 帧) 只用于保活
+static void rtsp_conn_read(rtsp_server *srv, rtsp_conn *c, uint64_t now_ms) {
+	ssize_t n = recv(c->fd, c->rbuf + c->rlen, sizeof(c->rbuf) - 1 - c->rlen, MSG_DONTWAIT);
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+		rtsp_conn_close(c, n == 0 ? "peer closed" : strerror(errno));
+		return;
+	}
+	if (n < 0)
+		return;
+	c->rlen += n;
+	c->last_active_ms = now_ms;
+
+	while (c->rlen > 0 && c->fd >= 0) {
+		int used;
+		if (c->rbuf[0] == '$') {
+			if (c->rlen < 4)
+				break;
+			used = 4 + (((uint8_t)c->rbuf[2] << 8) | (uint8_t)c->rbuf[3]);
+			if (used > (int)sizeof(c->rbuf) - 1) {
+				rtsp_conn_close(c, "bad interleaved frame");
+				return;
+			}
+			if (c->rlen < used)
+				break;
+		} else {
+			c->rbuf[c->rlen] = '\0';
+			char *end = strstr(c->rbuf, "\r\n\r\n");
+			if (!end) {
+				if (c->rlen >= (int)sizeof(c->rbuf) - 1)
+					rtsp_conn_close(c, "request too large");
+				break;
+			}
+			char value[16];
+			int body = 0;
+			end[2] = '\0'; // 请求头以单个 \r\n 结尾，便于 rtsp_header 判断结束
+			if (rtsp_header(c->rbuf, "Content-Length", value, sizeof(value)) > 0)
+				body = atoi(value);
+			used = (int)(end - c->rbuf) + 4 + body;
+			if (body < 0 || used > (int)sizeof(c->rbuf) - 1) {
+				rtsp_conn_close(c, "request too large");
+				return;
+			}
+			if (c->rlen < used) {
+				end[2] = '\r';
+				break;
+			}
+			rtsp_handle_request(srv, c, c->rbuf);
+			if (c->fd < 0)
+				return;
+		}
+		c->rlen -= used;
+		memmove(c->rbuf, c->rbuf + used, c->rlen);
+	}
+}
+
+/* ========================================================================== */
+/*                                  RTP/RTCP                                  */
+/* ========================================================================== */
+
+// UDP 客户端的 RTCP (RR/BYE) 只用于保活
+static void rtsp_rtcp_read(rtsp_server *srv, int fd, uint64_t now_ms) {
+	uint8_t buf[1500];
+	struct sockaddr_in from;
+	socklen_t alen = sizeof(from);
+
+	while (recvfrom(fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &alen) >= 0) {
+		for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++) {
+			rtsp_conn *c = &srv->conns[i];
+			if (c->fd >= 0 && c->media && !c->tcp &&
+			    c->peer.sin_addr.s_addr == from.sin_addr.s_addr)
+				c->last_active_ms = now_ms;
+		}
+		alen = sizeof(from);
+	}
+}
+
+// 包的头部与负载各占一个 iovec，prefix 为 1 时头部包含 TCP 交织前缀
+static void rtsp_packet_iov(rtp_packet *pkt, struct iovec *iov, int prefix) {
+	iov[0].iov_base = prefix ? pkt->hdr : rtp_packet_header(pkt);
+	iov[0].iov_len = pkt->hdr_len + (prefix ? RTP_TCP_PREFIX : 0);
+	iov[1].iov_base = (void *)pkt->payload;
+	iov[1].iov_len = pkt->payload_len;
+}
+
+// 用 sendmmsg 发送 [first, last) 的包；GSO 模式下把等长的连续分片 (最后一个可以更短)
+// 合并为一条消息，由内核按 UDP_SEGMENT 切分，一次系统调用只走一遍协议栈
+static int rtsp_udp_send_batch(rtsp_server *srv, rtsp_conn *c, rtsp_media *m, int first,
+                               int last) {
+	rtp_packet *pkts = m->packets.pkts;
+	struct mmsghdr msgs[RTSP_SEND_BATCH];
+	struct iovec iovs[RTSP_SEND_BATCH * 2];
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} ctrl[RTSP_SEND_BATCH];
+	int start[RTSP_SEND_BATCH];
+	int gso = __atomic_load_n(&srv->udp_mode, __ATOMIC_RELAXED) == 2;
+	int nmsg = 0;
+
+	for (int i = first; i < last; nmsg++) {
+		int seg = rtp_packet_len(&pkts[i]);
+		int n = 1;
+		while (gso && i + n < last && n < RTSP_GSO_MAX_SEGS &&
+		       rtp_packet_len(&pkts[i + n - 1]) == seg && rtp_packet_len(&pkts[i + n]) <= seg)
+			n++;
+
+		struct msghdr *h = &msgs[nmsg].msg_hdr;
+		memset(h, 0, sizeof(*h));
+		h->msg_name = &c->rtp_addr;
+		h->msg_namelen = sizeof(c->rtp_addr);
+		h->msg_iov = &iovs[(i - first) * 2];
+		h->msg_iovlen = n * 2;
+		for (int k = 0; k < n; k++)
+			rtsp_packet_iov(&pkts[i + k], &iovs[(i - first + k) * 2], 0);
+		if (n > 1) {
+			h->msg_control = ctrl[nmsg].buf;
+			h->msg_controllen = sizeof(ctrl[nmsg].buf);
+			struct cmsghdr *cm = CMSG_FIRSTHDR(h);
+			cm->cmsg_level = SOL_UDP;
+			cm->cmsg_type = UDP_SEGMENT;
+			cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			*(uint16_t *)CMSG_DATA(cm) = seg;
+		}
+		start[nmsg] = i;
+		i += n;
+	}
+
+	for (int sent = 0; sent < nmsg;) {
+		int r = sendmmsg(srv->rtp_fd, msgs + sent, nmsg - sent, MSG_DONTWAIT);
+		m->stats.syscalls++;
+		if (r > 0) {
+			sent += r;
+			continue;
+		}
+		if (errno == EINTR)
+			continue;
+		if (gso && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT)) {
+			LOG_WARN("udp gso unavailable (%s), fall back to sendmmsg\n", strerror(errno));
+			__atomic_store_n(&srv->udp_mode, 1, __ATOMIC_RELAXED);
+			return rtsp_udp_send_batch(srv, c, m, start[sent], last);
+		}
+		return -1; // 发送缓冲区满 (EAGAIN) 等丢包由客户端处理
+	}
+	return 0;
+}
+
+// TCP 交织：前缀写在各包头部区，[first, last) 的头部与负载交替组成 iovec 一次写出，
+// 写不完的部分拷贝进积压 (交织流不能缺字节，帧在发完后就会归还)，积压溢出或出错返回 -1
+static int rtsp_tcp_send_batch(rtsp_conn *c, rtsp_media *m, int first, int last) {
+	rtp_packet *pkts = m->packets.pkts;
+	struct iovec iovs[RTSP_SEND_BATCH * 2];
+
+	for (int i = first; i < last; i++) {
+		rtp_packet *pkt = &pkts[i];
+		int len = rtp_packet_len(pkt);
+		pkt->hdr[0] = '$';
+		pkt->hdr[1] = c->channel;
+		pkt->hdr[2] = len >> 8;
+		pkt->hdr[3] = len & 0xff;
+		rtsp_packet_iov(pkt, &iovs[(i - first) * 2], 1);
+	}
+	return rtsp_conn_write(c, iovs, (last - first) * 2, &m->stats.syscalls);
+}
+
+// 把 [first, last) 的 RTP 包发给一个客户端，负载直接从帧数据发出
+static void rtsp_conn_send(rtsp_server *srv, rtsp_conn *c, rtsp_media *m, int first, int last) {
+	if (c->tcp) {
+		if (rtsp_tcp_send_batch(c, m, first, last) < 0) {
+			LOG_WARN("session %08X send failed: %s\n", c->session_id, strerror(errno));
+			rtsp_conn_kill(c);
+			return;
+		}
+		c->packets += last - first;
+		return;
+	}
+	if (__atomic_load_n(&srv->udp_mode, __ATOMIC_RELAXED) > 0) {
+		if (rtsp_udp_send_batch(srv, c, m, first, last) == 0)
+			c->packets += last - first;
+		return;
+	}
+	for (int i = first; i < last; i++) {
+		struct iovec iov[2];
+		struct msghdr msg = {0};
+		rtsp_packet_iov(&m->packets.pkts[i], iov, 0);
+		msg.msg_name = &c->rtp_addr;
+		msg.msg_namelen = sizeof(c->rtp_addr);
+		msg.msg_iov = iov;
+		msg.msg_iovlen = 2;
+		m->stats.syscalls++;
+		if (sendmsg(srv->rtp_fd, &msg, MSG_DONTWAIT) >= 0)
+			c->packets++;
+	}
+}
+
+// 令牌桶节拍：平均速率不超过 RTSP_SERVER_PACE_KBPS，允许 RTSP_SERVER_PACE_BURST 的突发，
+// 避免关键帧的几百个包瞬间打满交换机端口缓存。扣除 bytes 的令牌，返回发送前需要等待的微秒数
+static uint64_t rtsp_media_pace(rtsp_media *m, int bytes) {
+#if RTSP_SERVER_PACE_KBPS > 0
+	uint64_t credit = (uint64_t)RTSP_SERVER_PACE_BURST * 8000 / RTSP_SERVER_PACE_KBPS;
+	uint64_t now = rtsp_mono_us();
+
+	if (m->pace_us + credit < now)
+		m->pace_us = now - credit;
+	m->pace_us += (uint64_t)bytes * 8000 / RTSP_SERVER_PACE_KBPS;
+	if (m->pace_us <= now)
+		return 0;
+	m->stats.paced_us += m->pace_us - now;
+	return m->pace_us - now;
+#else
+	(void)m;
+	(void)bytes;
+	return 0;
+#endif
+}
+
+static void rtsp_send_sr(rtsp_server *srv, rtsp_conn *c, uint64_t now_ms) {
+	rtsp_media *m = c->media;
+	uint8_t buf[RTP_TCP_PREFIX + 128];
+	uint8_t *pkt = buf + RTP_TCP_PREFIX;
+
+	c->last_sr_ms = now_ms;
+	if (!c->packets)
+		return;
+	// RTP 时间戳按最近一帧外推到当前时刻，与 NTP 时间对应
+	uint32_t rtp_ts = m->last_rtp_ts + (uint32_t)((rtsp_mono_us() - m->last_tx_us) * 9 / 100);
+	int len = rtcp_build_sr(pkt, sizeof(buf) - RTP_TCP_PREFIX, m->rtp.ssrc, rtsp_ntp64(), rtp_ts,
+	                        c->packets, c->octets, "rv_demo");
+	if (len < 0)
+		return;
+	if (c->tcp) {
+		buf[0] = '$';
+		buf[1] = c->channel + 1;
+		buf[2] = len >> 8;
+		buf[3] = len & 0xff;
+		struct iovec iov = {buf, (size_t)len + RTP_TCP_PREFIX};
+		if (rtsp_conn_write(c, &iov, 1, NULL) < 0)
+			rtsp_conn_kill(c);
+	} else {
+		sendto(srv->rtcp_fd, pkt, len, MSG_DONTWAIT, (struct sockaddr *)&c->rtcp_addr,
+		       sizeof(c->rtcp_addr));
+	}
+}
+
+// 缓存关键帧开头的参数集，用于 DESCRIBE 的 sprop
+static void rtsp_media_cache_params(rtsp_media *m, const uint8_t *frame, int len) {
+	const uint8_t *end = frame + len;
+	const uint8_t *nal;
+	int nal_len;
+	int h265 = m->codec == RTSP_CODEC_ID_VIDEO_H265;
+
+	while ((nal = rtp_next_nal(frame, end, &nal_len)) != NULL) {
+		int type = h265 ? (nal[0] >> 1) & 0x3f : nal[0] & 0x1f;
+		uint8_t *dst;
+		int *dst_len;
+		if (h265 && type == 32) {
+			dst = m->vps, dst_len = &m->vps_len;
+		} else if ((h265 && type == 33) || (!h265 && type == 7)) {
+			dst = m->sps, dst_len = &m->sps_len;
+		} else if ((h265 && type == 34) || (!h265 && type == 8)) {
+			dst = m->pps, dst_len = &m->pps_len;
+		} else {
+			break; // 参数集之后是 SEI/片数据，不再扫描
+		}
+		if (nal_len <= RTSP_PARAM_MAX) {
+			memcpy(dst, nal, nal_len);
+			*dst_len = nal_len;
+		}
+		frame = nal + nal_len;
+	}
+}
+
+// 以参数集或 IDR 开头的帧可以作为新客户端的第一帧：返回 2 表示以参数集开头，1 表示 IDR
+static int rtsp_media_is_key(const rtsp_media *m, const uint8_t *frame, int len) {
+	int i = 0;
+	while (i + 3 < len && !(frame[i] == 0 && frame[i + 1] == 0 && frame[i + 2] == 1))
+		i++;
+	if (i + 3 >= len)
+		return 0;
+	if (m->codec == RTSP_CODEC_ID_VIDEO_H265) {
+		int type = (frame[i + 3] >> 1) & 0x3f;
+		return type >= 32 && type <= 34 ? 2 : (type == 19 || type == 20);
+	}
+	int type = frame[i + 3] & 0x1f;
+	return type == 7 || type == 8 ? 2 : type == 5;
+}
+
+/* ========================================================================== */
+/*                                  对外接口                                  */
+/* ========================================================================== */
+
+static int rtsp_udp_pair(rtsp_server *srv) {
+	for (int port = RTSP_SERVER_RTP_PORT; port < RTSP_SERVER_RTP_PORT + 200; port += 2) {
+		int fds[2] = {-1, -1};
+		int i;
+		for (i = 0; i < 2; i++) {
+			struct sockaddr_in addr = {0};
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_ANY);
+			addr.sin_port = htons(port + i);
+			fds[i] = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+			if (fds[i] < 0 || bind(fds[i], (struct sockaddr *)&addr, sizeof(addr)) < 0)
+				break;
+		}
+		if (i == 2) {
+			// 关键帧一次性写入上百个包，加大发送缓冲区 (实际值受 wmem_max 限制)
+			int sndbuf = 1024 * 1024;
+			setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+			srv->rtp_fd = fds[0];
+			srv->rtcp_fd = fds[1];
+			srv->rtp_port = port;
+			return 0;
+		}
+		for (i = 0; i < 2; i++) {
+			if (fds[i] >= 0)
+				close(fds[i]);
+		}
+	}
+	return -1;
+}
+
+rtsp_demo_handle create_rtsp_demo(int port) {
+	rtsp_server *srv = calloc(1, sizeof(*srv));
+	struct sockaddr_in addr = {0};
+	int one = 1;
+
+	if (!srv)
+		return NULL;
+	srv->listen_fd = srv->rtp_fd = srv->rtcp_fd = -1;
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++)
+		srv->conns[i].fd = -1;
+	srv->next_session_id = rtsp_random32();
+	srv->udp_mode = RTSP_SERVER_UDP_BATCH;
+
+	srv->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (srv->listen_fd < 0)
+		goto err;
+	setsockopt(srv->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(srv->listen_fd, 8) < 0) {
+		LOG_ERROR("rtsp listen on port %d failed: %s\n", port, strerror(errno));
+		goto err;
+	}
+	if (rtsp_udp_pair(srv) < 0) {
+		LOG_ERROR("no free rtp/rtcp port pair from %d\n", RTSP_SERVER_RTP_PORT);
+		goto err;
+	}
+	LOG_INFO("rtsp server listening on port %d, rtp/rtcp %d-%d\n", port, srv->rtp_port,
+	         srv->rtp_port + 1);
+	return srv;
+
+err:
+	rtsp_del_demo(srv);
+	return NULL;
+}
+
+rtsp_session_handle rtsp_new_session(rtsp_demo_handle demo, const char *path) {
+	rtsp_server *srv = demo;
+	if (!srv || !path)
+		return NULL;
+
+	for (int i = 0; i < RTSP_SERVER_MAX_SESSIONS; i++) {
+		if (srv->medias[i])
+			continue;
+		rtsp_media *m = calloc(1, sizeof(*m));
+		if (!m)
+			return NULL;
+		m->server = srv;
+		snprintf(m->path, sizeof(m->path), "%s%s", path[0] == '/' ? "" : "/", path);
+		m->codec = RTSP_CODEC_ID_VIDEO_H264;
+		m->rtp.payload_type = RTSP_VIDEO_PT;
+		m->rtp.seq = (uint16_t)rtsp_random32();
+		m->rtp.ssrc = rtsp_random32();
+		m->ts_base = rtsp_random32();
+		m->last_tx_us = rtsp_mono_us();
+		srv->medias[i] = m;
+		return m;
+	}
+	LOG_ERROR("too many rtsp sessions\n");
+	return NULL;
+}
+
+int rtsp_set_video(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len) {
+	rtsp_media *m = session;
+	if (!m)
+		return -1;
+	if (codec_id != RTSP_CODEC_ID_VIDEO_H264 && codec_id != RTSP_CODEC_ID_VIDEO_H265) {
+		LOG_ERROR("unsupported video codec 0x%x\n", codec_id);
+		return -1;
+	}
+	m->codec = codec_id;
+	m->rtp.h265 = codec_id == RTSP_CODEC_ID_VIDEO_H265;
+	if (codec_data && data_len > 0)
+		rtsp_media_cache_params(m, codec_data, data_len);
+	return 0;
+}
+
+// 音频暂不发送 (SDP 中没有音频轨)，保留接口与 librtsp 兼容
+int rtsp_set_audio(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len) {
+	(void)codec_id;
+	(void)codec_data;
+	(void)data_len;
+	return session ? 0 : -1;
+}
+
+int rtsp_set_audio_sample_rate(rtsp_session_handle session, int sample_rate) {
+	(void)sample_rate;
+	return session ? 0 : -1;
+}
+
+int rtsp_set_audio_channels(rtsp_session_handle session, int channels) {
+	(void)channels;
+	return session ? 0 : -1;
+}
+
+int rtsp_tx_audio(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+	(void)frame;
+	(void)ts;
+	return session ? len : -1;
+}
+
+int rtsp_get_tx_stats(rtsp_session_handle session, rtsp_tx_stats *stats) {
+	rtsp_media *m = session;
+	if (!m || !stats)
+		return -1;
+	*stats = m->stats;
+	return 0;
+}
+
+void rtsp_set_play_callback(rtsp_session_handle session, rtsp_play_callback cb, void *arg) {
+	rtsp_media *m = session;
+	if (!m)
+		return;
+	m->play_cb = cb;
+	m->play_arg = arg;
+}
+
+// RTP 时间戳直接由帧时间戳换算，SR 用单调时钟外推，不需要外部对时
+int rtsp_sync_video_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime) {
+	(void)ts;
+	(void)ntptime;
+	return session ? 0 : -1;
+}
+
+int rtsp_sync_audio_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime) {
+	(void)ts;
+	(void)ntptime;
+	return session ? 0 : -1;
+}
+
+int rtsp_tx_video_begin(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+	rtsp_media *m = session;
+	if (!m || !frame || len <= 0)
+		return -1;
+	rtsp_server *srv = m->server;
+	rtp_packet_list *list = &m->packets;
+
+	list->count = 0;
+	m->tx_first = m->tx_last = 0;
+	int key = rtsp_media_is_key(m, frame, len);
+	if (key == 2)
+		rtsp_media_cache_params(m, frame, len);
+
+	// 只有存在可以接收本帧的客户端时才打包，序号不会因无人观看而跳变
+	m->tx_receivers = 0;
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++) {
+		rtsp_conn *c = &srv->conns[i];
+		if (c->fd < 0 || c->media != m || !c->playing ||
+		    __atomic_load_n(&c->dead, __ATOMIC_RELAXED))
+			continue;
+		if (c->wait_key) {
+			if (!key)
+				continue;
+			c->wait_key = 0;
+		}
+		m->tx_rx_id[m->tx_receivers] = c->session_id;
+		m->tx_rx[m->tx_receivers++] = c;
+	}
+	if (!m->tx_receivers)
+		return 0;
+
+	uint32_t rtp_ts = m->ts_base + (uint32_t)(ts * 9 / 100);
+	if (rtp_pack_frame(&m->rtp, list, frame, len, rtp_ts) < 0) {
+		LOG_ERROR("rtp pack %d bytes failed\n", len);
+		list->count = 0;
+		return -1;
+	}
+	m->last_rtp_ts = rtp_ts;
+	m->last_tx_us = rtsp_mono_us();
+	m->stats.frames++;
+	m->stats.packets += (uint64_t)list->count * m->tx_receivers;
+	return list->count;
+}
+
+// 本帧的第 i 个接收者，两批之间已断开、暂停或被其他会话复用时返回 NULL
+static rtsp_conn *rtsp_tx_receiver(rtsp_media *m, int i) {
+	rtsp_conn *c = m->tx_rx[i];
+	if (c->fd < 0 || c->media != m || c->session_id != m->tx_rx_id[i] || !c->playing ||
+	    __atomic_load_n(&c->dead, __ATOMIC_RELAXED))
+		return NULL;
+	return c;
+}
+
+int rtsp_tx_video_next(rtsp_session_handle session, uint64_t *wait_us) {
+	rtsp_media *m = session;
+	if (!m)
+		return -1;
+	rtp_packet_list *list = &m->packets;
+
+	*wait_us = 0;
+	if (m->tx_first >= list->count)
+		return 0;
+	// 按节拍突发分批，每批依次发给各客户端，关键帧不会让后面的客户端等整帧发完
+	if (m->tx_last == m->tx_first) {
+		int bytes = rtp_packet_len(&list->pkts[m->tx_first]);
+		int last;
+		for (last = m->tx_first + 1; last < list->count && last - m->tx_first < RTSP_SEND_BATCH;
+		     last++) {
+			int len = rtp_packet_len(&list->pkts[last]);
+			if (bytes + len > RTSP_SERVER_PACE_BURST)
+				break;
+			bytes += len;
+		}
+		m->tx_last = last;
+		*wait_us = rtsp_media_pace(m, bytes);
+		if (*wait_us)
+			return 1;
+	}
+
+	for (int i = 0; i < m->tx_receivers; i++) {
+		rtsp_conn *c = rtsp_tx_receiver(m, i);
+		if (c)
+			rtsp_conn_send(m->server, c, m, m->tx_first, m->tx_last);
+	}
+	m->tx_first = m->tx_last;
+	if (m->tx_first < list->count)
+		return 1;
+
+	for (int i = 0; i < m->tx_receivers; i++) {
+		rtsp_conn *c = rtsp_tx_receiver(m, i);
+		if (c)
+			c->octets += list->octets;
+	}
+	return 0;
+}
+
+int rtsp_tx_video(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+	uint64_t wait_us;
+
+	int ret = rtsp_tx_video_begin(session, frame, len, ts);
+	if (ret < 0)
+		return -1;
+	while (ret > 0) {
+		ret = rtsp_tx_video_next(session, &wait_us);
+		if (ret > 0 && wait_us)
+			usleep(wait_us);
+	}
+	return len;
+}
+
+int rtsp_get_event_fds(rtsp_demo_handle demo, struct pollfd *fds, int max, int *timeout_ms) {
+	rtsp_server *srv = demo;
+	int nfds = 0;
+
+	*timeout_ms = -1;
+	if (!srv || max < 3)
+		return -1;
+	uint64_t now_ms = rtsp_mono_us() / 1000;
+
+	fds[nfds].fd = srv->listen_fd;
+	fds[nfds++].events = POLLIN;
+	fds[nfds].fd = srv->rtp_fd;
+	fds[nfds++].events = POLLIN;
+	fds[nfds].fd = srv->rtcp_fd;
+	fds[nfds++].events = POLLIN;
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS && nfds < max; i++) {
+		rtsp_conn *c = &srv->conns[i];
+		if (c->fd < 0)
+			continue;
+		fds[nfds].fd = c->fd;
+		fds[nfds++].events = POLLIN | (__atomic_load_n(&c->wlen, __ATOMIC_RELAXED) ? POLLOUT : 0);
+
+		// 最早的周期处理：会话超时，或下一次 RTCP SR
+		uint64_t due = c->last_active_ms + RTSP_SERVER_TIMEOUT_SEC * 1000ULL;
+		if (c->playing && c->last_sr_ms + RTSP_SERVER_SR_INTERVAL_MS < due)
+			due = c->last_sr_ms + RTSP_SERVER_SR_INTERVAL_MS;
+		if (__atomic_load_n(&c->dead, __ATOMIC_RELAXED))
+			due = now_ms;
+		int wait = due > now_ms ? (int)(due - now_ms) : 0;
+		if (*timeout_ms < 0 || wait < *timeout_ms)
+			*timeout_ms = wait;
+	}
+	for (int i = 0; i < nfds; i++)
+		fds[i].revents = 0;
+	return nfds;
+}
+
+int rtsp_do_event(rtsp_demo_handle demo) {
+	rtsp_server *srv = demo;
+	struct pollfd pfds[3 + RTSP_SERVER_MAX_CONNS];
+	rtsp_conn *owners[3 + RTSP_SERVER_MAX_CONNS];
+	int nfds = 0;
+
+	if (!srv)
+		return -1;
+	uint64_t now_ms = rtsp_mono_us() / 1000;
+
+	pfds[nfds].fd = srv->listen_fd;
+	pfds[nfds++].events = POLLIN;
+	pfds[nfds].fd = srv->rtp_fd;
+	pfds[nfds++].events = POLLIN;
+	pfds[nfds].fd = srv->rtcp_fd;
+	pfds[nfds++].events = POLLIN;
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++) {
+		if (srv->conns[i].fd < 0)
+			continue;
+		owners[nfds] = &srv->conns[i];
+		pfds[nfds].fd = srv->conns[i].fd;
+		pfds[nfds++].events = POLLIN | (srv->conns[i].wlen ? POLLOUT : 0);
+	}
+	if (poll(pfds, nfds, 0) < 0)
+		return errno == EINTR ? 0 : -1;
+
+	if (pfds[0].revents & POLLIN)
+		rtsp_conn_accept(srv, now_ms);
+	if (pfds[1].revents & POLLIN)
+		rtsp_rtcp_read(srv, srv->rtp_fd, now_ms);
+	if (pfds[2].revents & POLLIN)
+		rtsp_rtcp_read(srv, srv->rtcp_fd, now_ms);
+	for (int i = 3; i < nfds; i++) {
+		rtsp_conn *c = owners[i];
+		// 已标记的连接在下面按发送失败关闭 (rtsp_conn_kill 关闭读方向后它总是可读)
+		if (c->fd < 0 || __atomic_load_n(&c->dead, __ATOMIC_RELAXED))
+			continue;
+		if ((pfds[i].revents & POLLOUT) && rtsp_conn_flush(c) < 0)
+			rtsp_conn_kill(c);
+		else if (pfds[i].revents & ~POLLOUT)
+			rtsp_conn_read(srv, c, now_ms);
+	}
+
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++) {
+		rtsp_conn *c = &srv->conns[i];
+		if (c->fd < 0)
+			continue;
+		if (__atomic_load_n(&c->dead, __ATOMIC_RELAXED)) {
+			rtsp_conn_close(c, "send failed");
+		} else if (now_ms - c->last_active_ms > RTSP_SERVER_TIMEOUT_SEC * 1000ULL) {
+			rtsp_conn_close(c, "timeout");
+		} else if (c->playing && now_ms - c->last_sr_ms >= RTSP_SERVER_SR_INTERVAL_MS) {
+			rtsp_send_sr(srv, c, now_ms);
+		}
+	}
+	return 0;
+}
+
+void rtsp_del_session(rtsp_session_handle session) {
+	rtsp_media *m = session;
+	if (!m)
+		return;
+	rtsp_server *srv = m->server;
+
+	if (m->stats.frames)
+		LOG_INFO("%s: %llu frames, %llu packets, %.1f send syscalls/frame, paced %llu ms\n",
+		         m->path, (unsigned long long)m->stats.frames,
+		         (unsigned long long)m->stats.packets,
+		         (double)m->stats.syscalls / m->stats.frames,
+		         (unsigned long long)m->stats.paced_us / 1000);
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++) {
+		if (srv->conns[i].fd >= 0 && srv->conns[i].media == m)
+			rtsp_conn_close(&srv->conns[i], "session deleted");
+	}
+	for (int i = 0; i < RTSP_SERVER_MAX_SESSIONS; i++) {
+		if (srv->medias[i] == m)
+			srv->medias[i] = NULL;
+	}
+	rtp_packet_list_free(&m->packets);
+	free(m);
+}
+
+void rtsp_del_demo(rtsp_demo_handle demo) {
+	rtsp_server *srv = demo;
+	if (!srv)
+		return;
+
+	for (int i = 0; i < RTSP_SERVER_MAX_SESSIONS; i++) {
+		if (srv->medias[i])
+			rtsp_del_session(srv->medias[i]);
+	}
+	for (int i = 0; i < RTSP_SERVER_MAX_CONNS; i++)
+		rtsp_conn_close(&srv->conns[i], "server stopped");
+	if (srv->listen_fd >= 0)
+		close(srv->listen_fd);
+	if (srv->rtp_fd >= 0)
+		close(srv->rtp_fd);
+	if (srv->rtcp_fd >= 0)
+		close(srv->rtcp_fd);
+	free(srv);
+}
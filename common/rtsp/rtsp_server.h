@@ -0,0 +1,126 @@
+// Copyright 2021 Rockchip Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// 内置 RTSP/RTP 服务端，接口与 librtsp (rtsp_demo.h) 一致，可直接替换。
+// 支持 OPTIONS/DESCRIBE/SETUP/PLAY/TEARDOWN/GET_PARAMETER，RTP over UDP 与 TCP 交织，
+// H.264/H.265 按 RFC 6184/7798 打包，定期发送 RTCP SR。音频接口保留但不发送。
+// UDP 按批 sendmmsg (可选 UDP GSO) 发送，批间按令牌桶节拍限速。
+// RTP 负载直接引用 rtsp_tx_video 传入的帧，头部与负载用 iovec 拼接，码流不拷贝。
+//
+// 线程模型与 librtsp 相同，由调用者串行化：
+// - rtsp_do_event 与增删会话互斥 (rtsp.c 的写锁)
+// - 不同会话的 rtsp_tx_video 可以并行 (rtsp.c 的读锁)，同一会话只能由一个线程调用
+// - rtsp_tx_video 在内部等待发送节拍；调用者持锁时改用 rtsp_tx_video_begin/next，
+//   在两批之间释放锁等待，节拍等待不占用临界区
+// - socket 写全部不阻塞：UDP 发送缓冲区满时丢包，TCP 写不完的部分进入每连接的积压，
+//   由下一次发送或 rtsp_do_event (可写时) 继续写出，慢客户端不会让调用者在锁内等待
+
+#ifndef __RTSP_SERVER_H__
+#define __RTSP_SERVER_H__
+
+#include <poll.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 同时建立的 RTSP 控制连接上限，超出的连接被立即关闭
+#ifndef RTSP_SERVER_MAX_CONNS
+#define RTSP_SERVER_MAX_CONNS 16
+#endif
+// 同时 SETUP 的客户端上限 (所有会话合计)，超出时回复 453
+#ifndef RTSP_SERVER_MAX_CLIENTS
+#define RTSP_SERVER_MAX_CLIENTS 8
+#endif
+// 会话超时 (秒)：期间没有收到 RTSP 请求或 RTCP 的客户端被断开
+#ifndef RTSP_SERVER_TIMEOUT_SEC
+#define RTSP_SERVER_TIMEOUT_SEC 60
+#endif
+// RTCP SR 发送周期 (毫秒)
+#ifndef RTSP_SERVER_SR_INTERVAL_MS
+#define RTSP_SERVER_SR_INTERVAL_MS 5000
+#endif
+// TCP 连接的发送积压上限 (字节)，超出认为客户端跟不上并断开 (约 0.5 秒的 4Mbps 码流)
+#ifndef RTSP_SERVER_TCP_BACKLOG
+#define RTSP_SERVER_TCP_BACKLOG (256 * 1024)
+#endif
+// 服务端 RTP/RTCP 端口对的起始端口 (偶数)，被占用时依次向后尝试
+#ifndef RTSP_SERVER_RTP_PORT
+#define RTSP_SERVER_RTP_PORT 6970
+#endif
+
+// UDP 发送方式：0 逐包 sendto，1 sendmmsg 批量，2 sendmmsg + UDP GSO (内核不支持时自动退回 1)
+#ifndef RTSP_SERVER_UDP_BATCH
+#define RTSP_SERVER_UDP_BATCH 2
+#endif
+// 发送节拍：每个挂载点发往单个客户端的平均速率上限 (kbps)，0 表示不限速
+#ifndef RTSP_SERVER_PACE_KBPS
+#define RTSP_SERVER_PACE_KBPS 60000
+#endif
+// 节拍允许的突发字节数，也是一次批量发送的最大字节数
+#ifndef RTSP_SERVER_PACE_BURST
+#define RTSP_SERVER_PACE_BURST 32768
+#endif
+
+typedef void *rtsp_demo_handle;
+typedef void *rtsp_session_handle;
+
+enum {
+	RTSP_CODEC_ID_NONE = 0,
+	RTSP_CODEC_ID_VIDEO_H264 = 0x0001,
+	RTSP_CODEC_ID_VIDEO_H265,
+	RTSP_CODEC_ID_VIDEO_MPEG4,
+	RTSP_CODEC_ID_AUDIO_G711A = 0x4001,
+	RTSP_CODEC_ID_AUDIO_G711U,
+	RTSP_CODEC_ID_AUDIO_G726,
+	RTSP_CODEC_ID_AUDIO_AAC,
+};
+
+// 挂载点的发送统计，删除会话时也会打印
+typedef struct {
+	uint64_t frames;   // 有客户端接收、实际打包发送的帧数
+	uint64_t packets;  // 发出的 RTP 包数 (每个客户端各计一次)
+	uint64_t syscalls; // 发送 RTP 的系统调用次数
+	uint64_t paced_us; // 节拍等待的累计时长 (微秒)
+} rtsp_tx_stats;
+
+// 客户端 PLAY 时的回调 (在 rtsp_do_event 中调用)，一般用于请求关键帧缩短起播时间
+typedef void (*rtsp_play_callback)(void *arg);
+
+rtsp_demo_handle create_rtsp_demo(int port);
+rtsp_session_handle rtsp_new_session(rtsp_demo_handle demo, const char *path);
+int rtsp_set_video(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len);
+int rtsp_set_audio(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len);
+int rtsp_set_audio_sample_rate(rtsp_session_handle session, int sample_rate);
+int rtsp_set_audio_channels(rtsp_session_handle session, int channels);
+void rtsp_set_play_callback(rtsp_session_handle session, rtsp_play_callback cb, void *arg);
+int rtsp_get_tx_stats(rtsp_session_handle session, rtsp_tx_stats *stats);
+int rtsp_tx_video(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts);
+// 分批发送一帧：begin 只打包不发送，返回包数 (0 表示没有接收者)；之后反复调用 next，
+// 返回 1 表示还有数据，*wait_us 非 0 时应先等待该时长 (可以在锁外) 再调用；返回 0 表示发完。
+// frame 在发完之前必须保持有效 (RTP 负载直接引用)
+int rtsp_tx_video_begin(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts);
+int rtsp_tx_video_next(rtsp_session_handle session, uint64_t *wait_us);
+int rtsp_tx_audio(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts);
+int rtsp_sync_video_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime);
+int rtsp_sync_audio_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime);
+void rtsp_del_session(rtsp_session_handle session);
+void rtsp_del_demo(rtsp_demo_handle demo);
+int rtsp_do_event(rtsp_demo_handle demo);
+// rtsp_get_event_fds 最多填写的 fd 数
+#define RTSP_SERVER_MAX_EVENT_FDS (3 + RTSP_SERVER_MAX_CONNS)
+// 供事件线程在锁外阻塞等待：填写需要监听可读 (有积压的连接还要可写) 的 fd，返回个数；*timeout_ms 为距下一次
+// 周期处理 (会话超时、RTCP SR) 的毫秒数，-1 表示没有客户端，可以一直等。
+// 有 fd 可读或超时后再调用 rtsp_do_event。fd 只在 rtsp_do_event 与删除会话/服务端时关闭
+int rtsp_get_event_fds(rtsp_demo_handle demo, struct pollfd *fds, int max, int *timeout_ms);
+uint64_t rtsp_get_reltime(void);
+uint64_t rtsp_get_ntptime(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
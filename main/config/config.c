@@ -1,51 +1,364 @@
 #include "config.h"
+#include "log.h"
+#include "param.h"
 
-static const VideoConfig g_video_config = {
-    .vi_dev_id = APP_VI_DEV_ID,
-    .vi_pipe_id = APP_VI_PIPE_ID,
-    .vi_chn_id = APP_VI_CHN_ID,
-    .venc_chn_id = APP_VENC_CHN_ID,
-    .stream_id = APP_STREAM_ID,
-    .enable_rtsp = APP_STREAM0_ENABLE_RTSP,
-    .enable_rtmp = APP_STREAM0_ENABLE_RTMP,
-    .vi_entity_name = APP_VI_ENTITY_NAME,
-    .width = APP_VIDEO_WIDTH,
-    .height = APP_VIDEO_HEIGHT,
-    .fps = APP_VIDEO_FPS,
-    .bitrate = APP_VIDEO_BITRATE,
-    .gop = APP_VIDEO_GOP,
-    .codec = APP_VIDEO_CODEC,
-    .output_path = APP_VIDEO_OUTPUT_PATH,
-    .rtsp_url = APP_RTSP_URL,
-    .rtmp_url = APP_RTMP_URL,
-};
+#include <stdio.h>
+#include <string.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "config.c"
 
-const VideoConfig *app_video_config_get(void) {
-    return &g_video_config;
-}
-
-#if APP_ENABLE_SUB_STREAM == 1
-static const VideoConfig g_video1_config = {
-    .vi_dev_id = APP_VI_DEV_ID,
-    .vi_pipe_id = APP_VI_PIPE_ID,
-    .vi_chn_id = APP_VI_CHN_ID,
-    .venc_chn_id = APP_VENC1_CHN_ID,
-    .stream_id = APP_STREAM_ID_1,
-    .enable_rtsp = APP_STREAM1_ENABLE_RTSP,
-    .enable_rtmp = APP_STREAM1_ENABLE_RTMP,
-    .vi_entity_name = APP_VI_ENTITY_NAME,
-    .width = APP_VIDEO1_WIDTH,
-    .height = APP_VIDEO1_HEIGHT,
-    .fps = APP_VIDEO1_FPS,
-    .bitrate = APP_VIDEO1_BITRATE,
-    .gop = APP_VIDEO1_GOP,
-    .codec = APP_VIDEO1_CODEC,
-    .output_path = APP_VIDEO1_OUTPUT_PATH,
-    .rtsp_url = APP_RTSP_URL_1,
-    .rtmp_url = APP_RTMP_URL_1,
+// 编译期默认值：主码流与子码流。
+static const VideoConfig g_video_defaults[] = {
+    {
+        .vi_dev_id = APP_VI_DEV_ID,
+        .vi_pipe_id = APP_VI_PIPE_ID,
+        .vi_chn_id = APP_VI_CHN_ID,
+        .venc_chn_id = APP_VENC_CHN_ID,
+        .stream_id = APP_STREAM_ID,
+        .enable_rtsp = APP_STREAM0_ENABLE_RTSP,
+        .enable_rtmp = APP_STREAM0_ENABLE_RTMP,
+        .vi_entity_name = APP_VI_ENTITY_NAME,
+        .width = APP_VIDEO_WIDTH,
+        .height = APP_VIDEO_HEIGHT,
+        .fps = APP_VIDEO_FPS,
+        .bitrate = APP_VIDEO_BITRATE,
+        .gop = APP_VIDEO_GOP,
+        .codec = APP_VIDEO_CODEC,
+        .output_path = APP_VIDEO_OUTPUT_PATH,
+        .rtsp_url = APP_RTSP_URL,
+        .rtmp_url = APP_RTMP_URL,
+        .scale_from = -1,
+        .vi_capture = APP_VI_CAPTURE,
+    },
+    {
+        .vi_dev_id = APP_VI_DEV_ID,
+        .vi_pipe_id = APP_VI_PIPE_ID,
+        .vi_chn_id = APP_VI1_CHN_ID,
+        .venc_chn_id = APP_VENC1_CHN_ID,
+        .stream_id = APP_STREAM_ID_1,
+        .enable_rtsp = APP_STREAM1_ENABLE_RTSP,
+        .enable_rtmp = APP_STREAM1_ENABLE_RTMP,
+        .vi_entity_name = APP_VI1_ENTITY_NAME,
+        .width = APP_VIDEO1_WIDTH,
+        .height = APP_VIDEO1_HEIGHT,
+        .fps = APP_VIDEO1_FPS,
+        .bitrate = APP_VIDEO1_BITRATE,
+        .gop = APP_VIDEO1_GOP,
+        .codec = APP_VIDEO1_CODEC,
+        .output_path = APP_VIDEO1_OUTPUT_PATH,
+        .rtsp_url = APP_RTSP_URL_1,
+        .rtmp_url = APP_RTMP_URL_1,
+        .scale_from = -1,
+        .vi_capture = APP_VI_CAPTURE,
+    },
 };
 
-const VideoConfig *app_video1_config_get(void) {
-    return &g_video1_config;
+#define VIDEO_DEFAULT_COUNT ((int)(sizeof(g_video_defaults) / sizeof(g_video_defaults[0])))
+
+// 码流表条目：VideoConfig 中的字符串指向同一条目内的缓冲区，
+// 不引用 INI 字典 (rk_param_reload 后字典内存会被释放)。
+typedef struct {
+    VideoConfig cfg;
+    char vi_entity_name[32];
+    char output_path[128];
+    char rtsp_url[64];
+    char rtmp_url[256];
+} VideoConfigEntry;
+
+static VideoConfigEntry g_video_table[APP_MAX_STREAMS];
+static int g_video_count = 0;
+
+static int video_param_get_int(int id, const char *key, int default_val) {
+    char entry[64];
+    snprintf(entry, sizeof(entry), "video.%d:%s", id, key);
+    return rk_param_get_int(entry, default_val);
+}
+
+static void video_param_get_string(int id, const char *key, const char *default_val,
+                                   char *buf, size_t size) {
+    char entry[64];
+    snprintf(entry, sizeof(entry), "video.%d:%s", id, key);
+    const char *val = rk_param_get_string(entry, default_val);
+    snprintf(buf, size, "%s", val ? val : "");
+}
+
+/**
+ * @brief 第 id 路的默认配置 (超出编译期默认表的码流以主码流为模板)
+ */
+static void video_config_default(int id, VideoConfig *cfg, char *rtsp_url, size_t rtsp_size,
+                                 char *output_path, size_t output_size) {
+    if (id < VIDEO_DEFAULT_COUNT) {
+        *cfg = g_video_defaults[id];
+        snprintf(rtsp_url, rtsp_size, "%s", cfg->rtsp_url);
+        snprintf(output_path, output_size, "%s", cfg->output_path);
+        return;
+    }
+
+    *cfg = g_video_defaults[0];
+    cfg->venc_chn_id = id;
+    cfg->stream_id = id;
+    cfg->enable_rtsp = 1;
+    cfg->enable_rtmp = 0;
+    snprintf(rtsp_url, rtsp_size, "/live/%d", id);
+    snprintf(output_path, output_size, "/tmp/rv_demo_%d.h264", id);
 }
+
+/**
+ * @brief 加载第 id 路码流
+ *
+ * @return 0 成功，-1 参数非法
+ */
+static int video_config_load_one(int id, VideoConfigEntry *entry) {
+    VideoConfig def;
+    char def_rtsp_url[64];
+    char def_output_path[128];
+    VideoConfig *cfg = &entry->cfg;
+
+    video_config_default(id, &def, def_rtsp_url, sizeof(def_rtsp_url),
+                         def_output_path, sizeof(def_output_path));
+    *cfg = def;
+    cfg->stream_id = id;
+
+    cfg->width = video_param_get_int(id, "width", def.width);
+    cfg->height = video_param_get_int(id, "height", def.height);
+    cfg->fps = video_param_get_int(id, "dst_frame_rate_num", def.fps);
+    // max_rate 单位 kbps，与 rtmp.c 换算一致
+    int max_rate = video_param_get_int(id, "max_rate", -1);
+    cfg->bitrate = max_rate < 0 ? def.bitrate : max_rate * 1024;
+    cfg->gop = video_param_get_int(id, "gop", def.gop);
+    cfg->venc_chn_id = video_param_get_int(id, "venc_chn", def.venc_chn_id);
+    cfg->vi_dev_id = video_param_get_int(id, "vi_dev", def.vi_dev_id);
+    cfg->vi_pipe_id = video_param_get_int(id, "vi_pipe", def.vi_pipe_id);
+    cfg->vi_chn_id = video_param_get_int(id, "vi_chn", def.vi_chn_id);
+    cfg->enable_rtsp = video_param_get_int(id, "enable_rtsp", def.enable_rtsp);
+    cfg->enable_rtmp = video_param_get_int(id, "enable_rtmp", def.enable_rtmp);
+    cfg->scale_from = video_param_get_int(id, "scale_from", def.scale_from);
+    cfg->vi_capture = video_param_get_int(id, "vi_capture", def.vi_capture);
+
+    char encoder[8];
+    video_param_get_string(id, "encoder", "hw", encoder, sizeof(encoder));
+    if (!strcmp(encoder, "soft")) {
+        // 软件编码从采集流水线取帧, scale_from 时取源码流的 VI 通道并由编码器缩放
+        cfg->soft_encode = 1;
+        cfg->vi_capture = 1;
+    } else if (strcmp(encoder, "hw") != 0) {
+        LOG_ERROR("video.%d: encoder %s not supported (hw/soft)\n", id, encoder);
+        return -1;
+    }
+    if (cfg->scale_from >= 0 && cfg->vi_capture && !cfg->soft_encode) {
+        LOG_WARN("video.%d: vi_capture ignored for RGA-scaled stream\n", id);
+        cfg->vi_capture = 0;
+    }
+    if (cfg->enable_rtmp && id >= APP_RTMP_MAX_STREAMS) {
+        LOG_ERROR("video.%d: RTMP only supported for video.0 ~ video.%d, disabled\n", id,
+                  APP_RTMP_MAX_STREAMS - 1);
+        cfg->enable_rtmp = 0;
+    }
+
+    char codec[16];
+    video_param_get_string(id, "output_data_type",
+                           def.codec == APP_VIDEO_CODEC_H265 ? "H.265" : "H.264",
+                           codec, sizeof(codec));
+    if (!strcmp(codec, "H.265")) {
+        cfg->codec = APP_VIDEO_CODEC_H265;
+    } else if (!strcmp(codec, "H.264")) {
+        cfg->codec = APP_VIDEO_CODEC_H264;
+    } else if (!strcmp(codec, "MJPEG")) {
+        cfg->codec = APP_VIDEO_CODEC_MJPEG;
+    } else {
+        LOG_ERROR("video.%d: output_data_type %s not supported\n", id, codec);
+        return -1;
+    }
+
+    video_param_get_string(id, "vi_entity", def.vi_entity_name,
+                           entry->vi_entity_name, sizeof(entry->vi_entity_name));
+    video_param_get_string(id, "rtsp_url", def_rtsp_url,
+                           entry->rtsp_url, sizeof(entry->rtsp_url));
+    video_param_get_string(id, "rtmp_url", def.rtmp_url,
+                           entry->rtmp_url, sizeof(entry->rtmp_url));
+    video_param_get_string(id, "output_path", def_output_path,
+                           entry->output_path, sizeof(entry->output_path));
+    cfg->vi_entity_name = entry->vi_entity_name[0] ? entry->vi_entity_name : NULL;
+    cfg->rtsp_url = entry->rtsp_url;
+    cfg->rtmp_url = entry->rtmp_url;
+    cfg->output_path = entry->output_path;
+
+    if (cfg->width <= 0 || cfg->height <= 0 || cfg->fps <= 0 || cfg->bitrate <= 0 ||
+        cfg->gop <= 0 || cfg->venc_chn_id < 0) {
+        LOG_ERROR("video.%d: invalid parameters (%dx%d@%d, %d bps, gop %d, venc %d)\n", id,
+                  cfg->width, cfg->height, cfg->fps, cfg->bitrate, cfg->gop, cfg->venc_chn_id);
+        return -1;
+    }
+    if (cfg->soft_encode && cfg->codec == APP_VIDEO_CODEC_H265) {
+        LOG_ERROR("video.%d: soft encoder supports H.264 and MJPEG only\n", id);
+        return -1;
+    }
+    if (cfg->codec == APP_VIDEO_CODEC_MJPEG) {
+        if (!cfg->soft_encode) {
+            LOG_ERROR("video.%d: MJPEG requires encoder = soft\n", id);
+            return -1;
+        }
+        // MJPEG 只用于抓图: 每帧覆盖写入 output_path
+        if (cfg->enable_rtsp || cfg->enable_rtmp) {
+            LOG_WARN("video.%d: RTSP/RTMP not supported for MJPEG, snapshots only\n", id);
+            cfg->enable_rtsp = 0;
+            cfg->enable_rtmp = 0;
+        }
+        if (!cfg->output_path[0]) {
+            LOG_WARN("video.%d: MJPEG stream without output_path\n", id);
+        }
+    } else if (!cfg->enable_rtsp && !cfg->enable_rtmp) {
+        LOG_WARN("video.%d: no RTSP/RTMP output enabled\n", id);
+    }
+#if !APP_Test_RTSP
+    if (cfg->enable_rtsp) {
+        LOG_WARN("video.%d: RTSP not compiled in (APP_Test_RTSP=0), ignored\n", id);
+    }
+#endif
+#if !APP_Test_RTMP
+    if (cfg->enable_rtmp) {
+        LOG_WARN("video.%d: RTMP not compiled in (APP_Test_RTMP=0), ignored\n", id);
+    }
 #endif
+
+    return 0;
+}
+
+/**
+ * @brief 绑定 RGA 缩放码流的源码流 (源必须是已加载的硬件 Bind 码流)
+ *
+ * 缩放码流沿用源码流的 VI 通道，分辨率不能大于源，且满足 RGA/VENC 的 16x2 对齐。
+ *
+ * @return 0 成功，-1 参数非法
+ */
+static int video_config_resolve_scale(VideoConfigEntry *entry) {
+    VideoConfig *cfg = &entry->cfg;
+    const VideoConfig *src = NULL;
+
+    for (int i = 0; i < g_video_count; i++) {
+        if (g_video_table[i].cfg.stream_id == cfg->scale_from) {
+            src = &g_video_table[i].cfg;
+            break;
+        }
+    }
+    if (!src || src->scale_from >= 0) {
+        LOG_ERROR("video.%d: scale_from %d must be an earlier VI-bound stream\n",
+                  cfg->stream_id, cfg->scale_from);
+        return -1;
+    }
+    if (cfg->width > src->width || cfg->height > src->height ||
+        (cfg->width % 16) != 0 || (cfg->height % 2) != 0) {
+        LOG_ERROR("video.%d: scaled size %dx%d invalid for source %dx%d (16x2 aligned, no upscale)\n",
+                  cfg->stream_id, cfg->width, cfg->height, src->width, src->height);
+        return -1;
+    }
+
+    cfg->vi_dev_id = src->vi_dev_id;
+    cfg->vi_pipe_id = src->vi_pipe_id;
+    cfg->vi_chn_id = src->vi_chn_id;
+    snprintf(entry->vi_entity_name, sizeof(entry->vi_entity_name), "%s",
+             src->vi_entity_name ? src->vi_entity_name : "");
+    cfg->vi_entity_name = entry->vi_entity_name[0] ? entry->vi_entity_name : NULL;
+    return 0;
+}
+
+/**
+ * @brief 码流是否自行从 VI 通道 GetChnFrame 取帧 (RGA 缩放线程或非 Bind 采集线程)
+ */
+static int video_config_pulls_vi(const VideoConfig *cfg) {
+    return cfg->scale_from >= 0 || cfg->vi_capture;
+}
+
+int app_video_config_load(void) {
+    g_video_count = 0;
+    memset(g_video_table, 0, sizeof(g_video_table));
+
+    for (int id = 0; id < APP_MAX_STREAMS; id++) {
+        char section[16];
+        snprintf(section, sizeof(section), "video.%d", id);
+        if (id >= APP_DEFAULT_STREAMS && !rk_param_has_section(section)) continue;
+        if (!video_param_get_int(id, "enable", 1)) continue;
+
+        VideoConfigEntry *entry = &g_video_table[g_video_count];
+        if (video_config_load_one(id, entry) != 0) continue;
+        if (entry->cfg.scale_from >= 0 && video_config_resolve_scale(entry) != 0) continue;
+
+        // 一个 VENC 通道只能属于一路码流 (软件编码不占用 VENC 通道)
+        int duplicate = 0;
+        for (int i = 0; i < g_video_count && !entry->cfg.soft_encode; i++) {
+            if (!g_video_table[i].cfg.soft_encode &&
+                g_video_table[i].cfg.venc_chn_id == entry->cfg.venc_chn_id) {
+                LOG_ERROR("video.%d: VENC channel %d already used by video.%d\n",
+                          id, entry->cfg.venc_chn_id, g_video_table[i].cfg.stream_id);
+                duplicate = 1;
+                break;
+            }
+        }
+        if (duplicate) continue;
+
+        // 同一 VI 通道的每帧只交给一个 GetChnFrame 调用者, 两路同时取帧时各自只得到约一半帧率
+        for (int i = 0; i < g_video_count && video_config_pulls_vi(&entry->cfg); i++) {
+            const VideoConfig *other = &g_video_table[i].cfg;
+            if (video_config_pulls_vi(other) && other->vi_pipe_id == entry->cfg.vi_pipe_id &&
+                other->vi_chn_id == entry->cfg.vi_chn_id) {
+                LOG_ERROR("video.%d: VI %d/%d frames already taken by video.%d "
+                          "(scale_from/vi_capture streams cannot share a VI channel)\n",
+                          id, entry->cfg.vi_pipe_id, entry->cfg.vi_chn_id, other->stream_id);
+                duplicate = 1;
+                break;
+            }
+        }
+        if (duplicate) continue;
+
+        const VideoConfig *cfg = &entry->cfg;
+        static const char *const codec_names[] = {"H.264", "H.265", "MJPEG"};
+        if (cfg->soft_encode) {
+            LOG_INFO("video.%d: %dx%d@%d %s %d kbps gop %d, VI %d/%d -> soft encoder, "
+                     "rtsp=%d rtmp=%d\n",
+                     id, cfg->width, cfg->height, cfg->fps, codec_names[cfg->codec],
+                     cfg->bitrate / 1024, cfg->gop, cfg->vi_pipe_id, cfg->vi_chn_id,
+                     cfg->enable_rtsp, cfg->enable_rtmp);
+        } else {
+            LOG_INFO("video.%d: %dx%d@%d %s %d kbps gop %d, VI %d/%d%s -> VENC %d, rtsp=%d rtmp=%d\n",
+                     id, cfg->width, cfg->height, cfg->fps, codec_names[cfg->codec],
+                     cfg->bitrate / 1024, cfg->gop, cfg->vi_pipe_id, cfg->vi_chn_id,
+                     cfg->scale_from >= 0 ? " (RGA)" : cfg->vi_capture ? " (capture)" : "",
+                     cfg->venc_chn_id,
+                     cfg->enable_rtsp, cfg->enable_rtmp);
+        }
+        g_video_count++;
+    }
+
+    return g_video_count;
+}
+
+int app_video_config_count(void) {
+    return g_video_count;
+}
+
+const VideoConfig *app_video_config_at(int index) {
+    if (index < 0 || index >= g_video_count) return NULL;
+    return &g_video_table[index].cfg;
+}
+
+const VideoConfig *app_video_config_find(int stream_id) {
+    for (int i = 0; i < g_video_count; i++) {
+        if (g_video_table[i].cfg.stream_id == stream_id) return &g_video_table[i].cfg;
+    }
+    return NULL;
+}
+
+int app_video_config_set_rc(int stream_id, int bitrate, int fps, int gop) {
+    for (int i = 0; i < g_video_count; i++) {
+        VideoConfig *cfg = &g_video_table[i].cfg;
+        if (cfg->stream_id != stream_id) continue;
+        if (bitrate > 0) cfg->bitrate = bitrate;
+        if (fps > 0) cfg->fps = fps;
+        if (gop > 0) cfg->gop = gop;
+        return 0;
+    }
+    return -1;
+}
@@ -12,6 +12,9 @@ extern "C" {
 // ISP 实体名，需要与 media-ctl 图一致。
 #define APP_VI_ENTITY_NAME "rkispp_scale0"
 
+// 以下 APP_VIDEO* / APP_STREAM* 参数只是码流表的默认值，
+// 运行时由 INI 的 [video.N] 段覆盖 (见 app_video_config_load)。
+
 // 采集/编码参数（主码流）。
 #define APP_VIDEO_WIDTH 1920
 #define APP_VIDEO_HEIGHT 1080
@@ -19,19 +22,67 @@ extern "C" {
 #define APP_VIDEO_BITRATE 4000000
 #define APP_VIDEO_GOP 60
 
-// 采集/编码参数（次码流）。默认与主码流一致，避免缩放依赖。
-#define APP_VIDEO1_WIDTH APP_VIDEO_WIDTH
-#define APP_VIDEO1_HEIGHT APP_VIDEO_HEIGHT
+// 采集/编码参数（次码流）。默认取 ISPP 硬件缩放输出 rkispp_scale1 (最大 1280x720)，
+// 编码器和 DDR 只处理子码流尺寸；ISPP 缩放通道不可用时可在 INI 中用 scale_from 改为 RGA 缩放。
+#define APP_VIDEO1_WIDTH 640
+#define APP_VIDEO1_HEIGHT 360
 #define APP_VIDEO1_FPS APP_VIDEO_FPS
-#define APP_VIDEO1_BITRATE APP_VIDEO_BITRATE
+#define APP_VIDEO1_BITRATE 512000
 #define APP_VIDEO1_GOP APP_VIDEO_GOP
+#define APP_VI1_CHN_ID 1
+#define APP_VI1_ENTITY_NAME "rkispp_scale1"
 
 // 编码格式选择。
 #define APP_VIDEO_CODEC_H264 0
 #define APP_VIDEO_CODEC_H265 1
+#define APP_VIDEO_CODEC_MJPEG 2                 // 仅软件编码 (encoder = soft)
 #define APP_VIDEO_CODEC APP_VIDEO_CODEC_H264    // 编码格式选择H264
 #define APP_VIDEO1_CODEC APP_VIDEO_CODEC_H264
 
+// VENC 码流缓冲区数量 (u32StreamBufCnt)。
+#define APP_VENC_STREAM_BUF_CNT     5
+// 码流零拷贝：推流线程直接引用 VENC 码流包，全部消费者处理完才 ReleaseStream。
+#define APP_VENC_ZERO_COPY          1
+// 零拷贝时至少留给编码器的空闲码流缓冲区数量，在途引用达到上限后回退为拷贝。
+#define APP_VENC_ZERO_COPY_RESERVE  2
+// 推流端丢帧或新客户端接入时请求 IDR 的最小间隔 (毫秒)，窗口内的请求合并到窗口结束后下发。
+#define APP_VENC_IDR_MIN_INTERVAL_MS 500
+// VENC 取流模型：1 为单个收割线程 epoll 等待所有通道 fd；0 为每个通道一个编码线程。
+#define APP_VENC_HARVESTER          0
+// VI→VENC 默认模式 (INI 的 vi_capture 可按码流覆盖)：0 为硬件 Bind；1 为采集线程 GetChnFrame，
+// 经处理阶段 (rk_video_add_stage) 后由送帧线程 SendFrame，并统计各阶段延迟直方图。
+#define APP_VI_CAPTURE              0
+// 非 Bind 模式旁路处理阶段 (VIDEO_STAGE_TAP) 的工作线程数，所有码流共用；0 表示在送帧线程中同步执行。
+#define APP_FRAME_STAGE_WORKERS     2
+// 软件编码 (INI 的 encoder = soft)：码流不占用 VENC 通道，由采集流水线取帧后经 libavcodec 编码
+// (H.264 / MJPEG)。每路一个编码器，线程数为 0 时由 libavcodec 自动选择。
+#define APP_SOFT_ENCODER_THREADS    1
+// 码流拷贝使用预分配的分级缓冲池，避免长期运行的堆碎片。
+#define APP_PACKET_POOL_ENABLE      1
+// 每路码流缓冲池内存预算 (KB)，0 表示按码率与队列容量自动计算。
+#define APP_PACKET_POOL_BUDGET_KB   0
+// 线程间帧队列使用单生产者单消费者无锁实现 (0 为互斥锁实现)。
+#define APP_FRAME_QUEUE_LOCKFREE    1
+// 码流扇出：编码结果写入广播环，RTSP/RTMP/录像各自一个线程读取，
+// 慢输出独立丢帧到下一个关键帧。0 为所有输出在同一推流线程中串行执行。
+#define APP_STREAM_FANOUT           1
+// 自适应码率：按推流输出的积压、丢帧和写入耗时带迟滞地调整 VENC 目标码率/帧率。
+#define APP_ABR_ENABLE              1
+// 自适应码率的采样周期 (毫秒)。
+#define APP_ABR_INTERVAL_MS         500
+// 自适应码率的下限：码率不低于配置码率的该百分比，码率到下限后帧率不低于 APP_ABR_MIN_FPS。
+#define APP_ABR_MIN_BITRATE_PCT     25
+#define APP_ABR_MIN_FPS             10
+// RTSP 输出是否参与自适应码率 (0 时只看 RTMP 等上行输出，局域网 RTSP 客户端慢不会拉低码率)。
+#define APP_ABR_WATCH_RTSP          0
+// 帧级延迟跟踪：编码码流在 GetStream、入队、出队、RTSP/RTMP 写入返回处打点，
+// 性能报告 TRACE[n] 行给出各阶段 p50/p95/p99；收到 SIGUSR1 时把最近的事件导出为 Chrome trace JSON。
+#define APP_FRAME_TRACE             1
+#define APP_FRAME_TRACE_DUMP_PATH   "/tmp/rv_demo_trace.json"
+// 码流队列 (APP_STREAM_FANOUT=0) 满时的溢出策略：
+// 0 阻塞等待，超时丢弃新帧；1 丢弃最旧的整个 GOP；2 丢弃新帧直到下一个关键帧。
+#define APP_STREAM_QUEUE_OVERFLOW   1
+
 // === 流媒体业务开关配置 ===
 
 // 主码流 (Stream 0) 开关
@@ -50,6 +101,11 @@ extern "C" {
 #define APP_Test_PERF_MONITOR       1       // 性能监控开关
 #define APP_Test_SAVE_FILE          0       // 保存裸码流文件开关（默认不开）
 
+// OpenMetrics 指标导出 (依赖 APP_Test_PERF_MONITOR)：内嵌 HTTP 服务，
+// GET http://<设备IP>:APP_METRICS_PORT/metrics 返回性能报告的全部字段，可直接被 Prometheus 抓取。
+#define APP_METRICS_EXPORTER        1
+#define APP_METRICS_PORT            9464
+
 
 // RTMP 推流服务器地址
 #define APP_RTMP_URL   "rtmp://your-server.com/live/stream_key"
@@ -65,12 +121,19 @@ extern "C" {
 #define APP_RTSP_URL_1 "/live/1"
 
 // VENC 通道号与 流 ID (Stream ID)。
-#define APP_MAX_STREAMS         2
 #define APP_VENC_CHN_ID         0   // 主码流通道号
 #define APP_VENC1_CHN_ID        1   // 子码流通道号
 #define APP_STREAM_ID           0   // 主码流 ID
 #define APP_STREAM_ID_1         1   // 子码流 ID
 
+// 码流表容量：INI 中 [video.0] ~ [video.(APP_MAX_STREAMS-1)] 段各对应一路码流。
+#define APP_MAX_STREAMS         8
+// 可开启 RTMP 的码流 ID 上限 (video.0 ~ video.2)，与 common/rtmp/rtmp.c 的 RTMP_MAX_STREAMS 一致：
+// rkmuxer 的 0~2 号保留给录像，RTMP 只有 3~5 号。
+#define APP_RTMP_MAX_STREAMS    3
+// INI 中没有对应段时仍按默认参数启用的码流路数 (主码流 + 可选子码流)。
+#define APP_DEFAULT_STREAMS     (APP_ENABLE_SUB_STREAM ? 2 : 1)
+
 typedef struct {
     int vi_dev_id;
     int vi_pipe_id;
@@ -89,12 +152,53 @@ typedef struct {
     const char *output_path;
     const char *rtsp_url;   // RTSP 相对路径
     const char *rtmp_url;   // RTMP 完整 URL
+    int scale_from;         // >= 0 时不绑定 VI，从该码流的 VI 通道取帧经 RGA 缩放；-1 为硬件 Bind
+    int vi_capture;         // 1 时不绑定 VI，由采集线程取帧、经处理阶段后送入 VENC
+    int soft_encode;        // 1 时不创建 VENC 通道，由 libavcodec 软件编码 (隐含 vi_capture)
 } VideoConfig;
 
-const VideoConfig *app_video_config_get(void);
-#if APP_ENABLE_SUB_STREAM == 1
-const VideoConfig *app_video1_config_get(void);
-#endif
+/**
+ * @brief 从 INI 的 [video.N] 段加载码流表 (需在 rk_param_init 之后调用)
+ *
+ * [video.N] 段存在 (或 N < APP_DEFAULT_STREAMS) 且 enable 不为 0 时加载第 N 路，
+ * 未配置的键使用上面的编译期默认值；参数非法或 VENC 通道重复的码流会被跳过。
+ * stream_id 即段号 N，RTSP/RTMP 按该 ID 读取同一段的其余参数。
+ *
+ * @return 加载的码流路数
+ */
+int app_video_config_load(void);
+
+/**
+ * @brief 获取码流表中的码流路数
+ */
+int app_video_config_count(void);
+
+/**
+ * @brief 获取码流表中的第 index 路配置
+ *
+ * @param index 0 ~ app_video_config_count()-1 (不是 stream_id)
+ * @return 配置指针，越界返回 NULL
+ */
+const VideoConfig *app_video_config_at(int index);
+
+/**
+ * @brief 按码流 ID 查找配置
+ *
+ * @param stream_id 码流 ID
+ * @return 配置指针，不存在返回 NULL
+ */
+const VideoConfig *app_video_config_find(int stream_id);
+
+/**
+ * @brief 更新码流表中的码率控制参数 (运行时重配置后由编码线程调用)
+ *
+ * @param stream_id 码流 ID
+ * @param bitrate 码率 (bps)，<= 0 表示不变
+ * @param fps 帧率，<= 0 表示不变
+ * @param gop GOP 长度，<= 0 表示不变
+ * @return 0 成功，-1 码流不存在
+ */
+int app_video_config_set_rc(int stream_id, int bitrate, int fps, int gop);
 
 #ifdef __cplusplus
 }
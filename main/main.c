@@ -11,6 +11,12 @@
 #if APP_Test_PERF_MONITOR
 #include "perf_monitor.h"
 #endif
+#if APP_Test_PERF_MONITOR && APP_METRICS_EXPORTER
+#include "metrics_exporter.h"
+#endif
+#if APP_FRAME_TRACE
+#include "frame_trace.h"
+#endif
 
 #ifdef LOG_TAG
 #undef LOG_TAG
@@ -33,6 +39,16 @@ static void sig_proc(int signo) {
 	g_main_run_ = 0;
 }
 
+#if APP_FRAME_TRACE
+// 收到 SIGUSR1 时由主循环导出延迟跟踪 (信号处理函数中不做文件操作)。
+static volatile sig_atomic_t g_trace_dump_ = 0;
+
+static void sig_trace_dump(int signo) {
+	(void)signo;
+	g_trace_dump_ = 1;
+}
+#endif
+
 static const char short_options[] = "c:a:l:";
 static const struct option long_options[] = {{"config", required_argument, NULL, 'c'},
                                              {"aiq_file", no_argument, NULL, 'a'},
@@ -91,6 +107,9 @@ int main(int argc, char **argv) {
 	int camera_id;
 	signal(SIGINT, sig_proc);
 	signal(SIGTERM, sig_proc);
+#if APP_FRAME_TRACE
+	signal(SIGUSR1, sig_trace_dump);
+#endif
 
 	rkipc_get_opt(argc, argv);
 	LOG_INFO("rkipc_ini_path_ is %s, rkipc_iq_file_path_ is %s, rkipc_log_level "
@@ -110,15 +129,27 @@ int main(int argc, char **argv) {
 #if APP_Test_PERF_MONITOR
 	perf_monitor_init();
 	perf_monitor_start(10);  // 每 10 秒打印一次性能报告
+#endif
+#if APP_Test_PERF_MONITOR && APP_METRICS_EXPORTER
+	metrics_exporter_start(APP_METRICS_PORT);
 #endif
 	LOG_INFO("rkipc init finished.\n");
 
 	// 循环等待退出信号。
 	while (g_main_run_) {
 		usleep(1000 * 1000);
+#if APP_FRAME_TRACE
+		if (g_trace_dump_) {
+			g_trace_dump_ = 0;
+			frame_trace_dump(APP_FRAME_TRACE_DUMP_PATH);
+		}
+#endif
 	}
 
 	// 反初始化顺序：video -> mpi -> isp -> system -> param。
+#if APP_Test_PERF_MONITOR && APP_METRICS_EXPORTER
+	metrics_exporter_stop();
+#endif
 #if APP_Test_PERF_MONITOR
 	perf_monitor_deinit();
 #endif
@@ -0,0 +1,174 @@
+/**
+ * @file frame_trace.c
+ * @brief 帧级延迟跟踪实现
+ */
+
+#include "frame_trace.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "frame_trace"
+
+/** @brief 单段耗时上限 (微秒)，超过时认为起点与单调时钟不在同一时钟域 */
+#define TRACE_MAX_SPAN_US       (10u * 1000 * 1000)
+
+/**
+ * @brief 环中的一个事件 (32 字节)
+ *
+ * seq 为 0 表示正在写入，写完后置为 (写入序号 + 1)；
+ * 读者在拷贝前后各读一次 seq，不一致或与期望序号不符则跳过该事件。
+ */
+typedef struct {
+    uint32_t seq;            /**< 写入序号 + 1 (原子访问) */
+    uint16_t stream_id;      /**< 码流 ID */
+    uint16_t point;          /**< 跟踪点 */
+    uint32_t dur_us;         /**< 与上一个点之间的耗时 */
+    uint32_t reserved;
+    uint64_t start_us;       /**< 上一个点的时刻 (未知时等于本点时刻) */
+    uint64_t pts;            /**< 帧时间戳 */
+} TraceEvent;
+
+static TraceEvent g_ring[FRAME_TRACE_RING_SIZE];
+static uint32_t g_ring_head = 0;  /**< 下一个写入序号 (原子访问) */
+
+/** @brief 各路码流各跟踪点的耗时直方图 */
+static LatencyHist g_stage_hist[FRAME_TRACE_MAX_STREAMS][FRAME_TRACE_POINTS];
+static LatencyHist g_e2e_hist[FRAME_TRACE_MAX_STREAMS][FRAME_TRACE_POINTS];
+
+static const char *g_point_names[FRAME_TRACE_POINTS] = {
+    "encode", "push", "queue", "rtsp_tx", "rtmp_tx",
+};
+
+static uint64_t trace_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 计算 start 到 end 的耗时，起点未知或不在同一时钟域时返回 -1
+ */
+static int64_t trace_span(uint64_t start, uint64_t end) {
+    if (start == 0 || start > end || end - start > TRACE_MAX_SPAN_US) return -1;
+    return (int64_t)(end - start);
+}
+
+static int trace_is_tx(FrameTracePoint point) {
+    return point == FRAME_TRACE_RTSP_TX || point == FRAME_TRACE_RTMP_TX;
+}
+
+uint64_t frame_trace_mark(int stream_id, FrameTracePoint point, uint64_t pts, uint64_t since_us) {
+    uint64_t now = trace_now_us();
+    if (stream_id < 0 || stream_id >= FRAME_TRACE_MAX_STREAMS ||
+        point < 0 || point >= FRAME_TRACE_POINTS) {
+        return now;
+    }
+
+    int64_t span = trace_span(since_us, now);
+    if (span >= 0) {
+        latency_hist_record(&g_stage_hist[stream_id][point], (uint32_t)span);
+    }
+    if (trace_is_tx(point)) {
+        int64_t e2e = trace_span(pts, now);
+        if (e2e >= 0) {
+            latency_hist_record(&g_e2e_hist[stream_id][point], (uint32_t)e2e);
+        }
+    }
+
+    uint32_t idx = __atomic_fetch_add(&g_ring_head, 1, __ATOMIC_RELAXED);
+    TraceEvent *ev = &g_ring[idx & (FRAME_TRACE_RING_SIZE - 1)];
+    __atomic_store_n(&ev->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ev->stream_id = (uint16_t)stream_id;
+    ev->point = (uint16_t)point;
+    ev->dur_us = span >= 0 ? (uint32_t)span : 0;
+    ev->start_us = span >= 0 ? since_us : now;
+    ev->pts = pts;
+    __atomic_store_n(&ev->seq, idx + 1, __ATOMIC_RELEASE);
+
+    return now;
+}
+
+const char *frame_trace_point_name(FrameTracePoint point) {
+    if (point < 0 || point >= FRAME_TRACE_POINTS) return "unknown";
+    return g_point_names[point];
+}
+
+int frame_trace_get_stats(int stream_id, FrameTraceStats *stats) {
+    if (!stats || stream_id < 0 || stream_id >= FRAME_TRACE_MAX_STREAMS) {
+        return -1;
+    }
+
+    int found = 0;
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < FRAME_TRACE_POINTS; i++) {
+        latency_hist_summarize(&g_stage_hist[stream_id][i], &stats->stage[i]);
+        latency_hist_summarize(&g_e2e_hist[stream_id][i], &stats->e2e[i]);
+        if (stats->stage[i].count > 0) found = 1;
+    }
+    return found ? 0 : -1;
+}
+
+int frame_trace_dump(const char *path) {
+    char tmp_path[256];
+    if (!path) return -1;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s\n", tmp_path);
+        return -1;
+    }
+
+    uint32_t head = __atomic_load_n(&g_ring_head, __ATOMIC_ACQUIRE);
+    uint32_t count = head < FRAME_TRACE_RING_SIZE ? head : FRAME_TRACE_RING_SIZE;
+    uint32_t streams = 0;  // 出现过的码流位图, 用于输出进程/线程名
+    int written = 0;
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (uint32_t idx = head - count; idx != head; idx++) {
+        const TraceEvent *slot = &g_ring[idx & (FRAME_TRACE_RING_SIZE - 1)];
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq != idx + 1) continue;  // 正在写入或已被覆盖
+        TraceEvent ev = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) continue;
+
+        fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,"
+                "\"ts\":%llu,\"dur\":%u,\"args\":{\"pts\":%llu}}",
+                written ? ",\n" : "", g_point_names[ev.point], ev.stream_id, ev.point,
+                (unsigned long long)ev.start_us, ev.dur_us, (unsigned long long)ev.pts);
+        streams |= 1u << ev.stream_id;
+        written++;
+    }
+
+    // 元数据事件: 每路码流一个进程, 每个跟踪点一个线程
+    int sep = written;
+    for (int s = 0; s < FRAME_TRACE_MAX_STREAMS; s++) {
+        if (!(streams & (1u << s))) continue;
+        fprintf(fp, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                "\"args\":{\"name\":\"stream %d\"}}", sep ? ",\n" : "", s, s);
+        sep = 1;
+        for (int p = 0; p < FRAME_TRACE_POINTS; p++) {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                    "\"args\":{\"name\":\"%s\"}}", s, p, g_point_names[p]);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+        LOG_ERROR("Failed to write %s\n", path);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    LOG_INFO("Dumped %d trace events to %s\n", written, path);
+    return written;
+}
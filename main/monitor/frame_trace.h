@@ -0,0 +1,98 @@
+/**
+ * @file frame_trace.h
+ * @brief 帧级延迟跟踪 (传感器时间戳 -> 网络发送)
+ *
+ * 每帧编码码流在流水线的几个关键点打点：
+ *   VI 时间戳 (帧 pts, 起点) -> VENC GetStream 返回 -> 入队 -> 出队 -> RTSP/RTMP 写入返回
+ * 每个点记录与上一个点之间的耗时 (上一个点的时刻由调用者随帧携带，见 FrameData.trace_us)，
+ * 发送点另外记录自传感器时间戳起的端到端耗时。
+ *
+ * 事件写入全局无锁环 (多生产者，写入只做一次原子加法和两次原子存储)，
+ * 各阶段耗时同时计入直方图，供性能报告给出 p50/p95/p99；
+ * 环中最近的事件可按需导出为 Chrome trace-event JSON (chrome://tracing 或 Perfetto 打开)。
+ *
+ * 帧 pts 需与 CLOCK_MONOTONIC 同一时钟域 (Rockit VI 输出的 u64PTS 即是)，
+ * 否则以 pts 为起点的阶段不计入统计。
+ */
+
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+
+#include <stdint.h>
+
+#include "latency_hist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 支持跟踪的最大码流数量 */
+#define FRAME_TRACE_MAX_STREAMS 8
+
+/** @brief 事件环容量 (2 的幂)，覆盖最近约 APP_MAX_STREAMS 路 × 几秒的事件 */
+#define FRAME_TRACE_RING_SIZE   4096
+
+/**
+ * @brief 跟踪点
+ */
+typedef enum {
+    FRAME_TRACE_ENCODE = 0,  /**< VENC GetStream 返回 (起点为 VI 时间戳) */
+    FRAME_TRACE_PUSH,        /**< 码流进入队列/广播环 */
+    FRAME_TRACE_POP,         /**< 输出线程取出码流 */
+    FRAME_TRACE_RTSP_TX,     /**< RTSP 写入返回 */
+    FRAME_TRACE_RTMP_TX,     /**< RTMP 写入返回 */
+    FRAME_TRACE_POINTS,
+} FrameTracePoint;
+
+/**
+ * @brief 单路码流的跟踪统计
+ */
+typedef struct {
+    LatencyHistSummary stage[FRAME_TRACE_POINTS]; /**< 各点与上一个点之间的耗时 */
+    LatencyHistSummary e2e[FRAME_TRACE_POINTS];   /**< 发送点自传感器时间戳起的耗时 */
+} FrameTraceStats;
+
+/**
+ * @brief 记录一个跟踪点 (无锁，可在实时线程中调用)
+ *
+ * @param stream_id 码流 ID
+ * @param point 跟踪点
+ * @param pts 帧时间戳 (微秒，同时是 VI 时间戳)
+ * @param since_us 上一个跟踪点的时刻 (单调时钟微秒)，0 表示未知
+ * @return uint64_t 本跟踪点的时刻，调用者随帧保存供下一个点使用
+ */
+uint64_t frame_trace_mark(int stream_id, FrameTracePoint point, uint64_t pts, uint64_t since_us);
+
+/**
+ * @brief 跟踪点名称
+ *
+ * @param point 跟踪点
+ * @return const char* 名称 (如 "queue")
+ */
+const char *frame_trace_point_name(FrameTracePoint point);
+
+/**
+ * @brief 汇总一路码流的跟踪统计 (自启动以来)
+ *
+ * @param stream_id 码流 ID
+ * @param stats 输出参数
+ * @return 0 有数据，-1 该路没有跟踪点或参数无效
+ */
+int frame_trace_get_stats(int stream_id, FrameTraceStats *stats);
+
+/**
+ * @brief 把环中的事件导出为 Chrome trace-event JSON
+ *
+ * 每个事件是一个 "X" (complete) 事件：pid 为码流 ID，tid 为跟踪点，
+ * 时间跨度为上一个点到本点。先写临时文件再改名，读者不会看到半个文件。
+ *
+ * @param path 输出文件路径
+ * @return 导出的事件数，-1 失败
+ */
+int frame_trace_dump(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_TRACE_H
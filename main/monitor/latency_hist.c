@@ -0,0 +1,127 @@
+/**
+ * @file latency_hist.c
+ * @brief 耗时直方图实现
+ */
+
+#include "latency_hist.h"
+
+#include <string.h>
+
+/** @brief 每个 2 的幂区间的子桶数 (取 2 的幂) */
+#define SUB_BUCKET_BITS         2
+#define SUB_BUCKETS             (1u << SUB_BUCKET_BITS)
+
+/**
+ * @brief 样本值对应的桶
+ *
+ * 小于 SUB_BUCKETS 的值各占一个桶；更大的值按最高位所在的 2 的幂区间
+ * 和紧随其后的 SUB_BUCKET_BITS 位确定子桶。
+ */
+static int bucket_index(uint32_t us) {
+    if (us < SUB_BUCKETS) return (int)us;
+
+    int msb = 31 - __builtin_clz(us);
+    uint32_t sub = (us >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    int index = (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + (int)sub;
+    return index < LATENCY_HIST_BUCKETS ? index : LATENCY_HIST_BUCKETS - 1;
+}
+
+/**
+ * @brief 桶的下界 (微秒)
+ */
+static uint64_t bucket_lower(int index) {
+    if (index < (int)SUB_BUCKETS) return (uint64_t)index;
+
+    int msb = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t sub = (uint64_t)(index % SUB_BUCKETS);
+    return (SUB_BUCKETS + sub) << (msb - SUB_BUCKET_BITS);
+}
+
+/**
+ * @brief 在已拷贝的桶计数上计算分位数
+ */
+static uint32_t percentile_from(const uint32_t *buckets, uint32_t total, uint32_t max_us,
+                                double pct) {
+    if (total == 0) return 0;
+    if (pct < 0) pct = 0;
+    if (pct > 100) pct = 100;
+
+    double rank = pct / 100.0 * total;
+    uint32_t seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        if (buckets[i] == 0) continue;
+        if (seen + buckets[i] >= rank) {
+            // 最后一个桶没有上界, 超出范围的样本按最大值计
+            if (i == LATENCY_HIST_BUCKETS - 1) return max_us;
+            double lo = (double)bucket_lower(i);
+            double hi = (double)bucket_lower(i + 1);
+            double value = lo + (hi - lo) * (rank - seen) / buckets[i];
+            // 插值不超过实际最大值
+            return value > max_us ? max_us : (uint32_t)value;
+        }
+        seen += buckets[i];
+    }
+    return max_us;
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+void latency_hist_record(LatencyHist *hist, uint32_t us) {
+    if (!hist) return;
+
+    __atomic_add_fetch(&hist->buckets[bucket_index(us)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->sum_us, us, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->count, 1, __ATOMIC_RELAXED);
+
+    uint32_t max = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+    while (us > max && !__atomic_compare_exchange_n(&hist->max_us, &max, us, 1,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void latency_hist_summarize(const LatencyHist *hist, LatencyHistSummary *summary) {
+    if (!summary) return;
+    memset(summary, 0, sizeof(*summary));
+    if (!hist) return;
+
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+    uint32_t total = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        buckets[i] = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        total += buckets[i];
+    }
+    if (total == 0) return;
+
+    uint64_t sum = __atomic_load_n(&hist->sum_us, __ATOMIC_RELAXED);
+    summary->count = total;
+    summary->avg_us = (uint32_t)(sum / total);
+    summary->max_us = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+    summary->p50_us = percentile_from(buckets, total, summary->max_us, 50);
+    summary->p95_us = percentile_from(buckets, total, summary->max_us, 95);
+    summary->p99_us = percentile_from(buckets, total, summary->max_us, 99);
+}
+
+uint32_t latency_hist_percentile(const LatencyHist *hist, double pct) {
+    if (!hist) return 0;
+
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+    uint32_t total = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        buckets[i] = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        total += buckets[i];
+    }
+    return percentile_from(buckets, total, __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED), pct);
+}
+
+void latency_hist_reset(LatencyHist *hist) {
+    if (!hist) return;
+
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        __atomic_store_n(&hist->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&hist->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->sum_us, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->max_us, 0, __ATOMIC_RELAXED);
+}
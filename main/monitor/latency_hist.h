@@ -0,0 +1,83 @@
+/**
+ * @file latency_hist.h
+ * @brief 耗时直方图
+ *
+ * 以微秒为单位记录耗时分布，用于统计流水线各阶段的开销。
+ * 桶按对数划分：每个 2 的幂区间再均分 4 个子桶，相对误差不超过 25%，
+ * 96 个桶覆盖 0 ~ 约 16 秒。
+ *
+ * 记录只做几次原子加法，不加锁，可在实时线程中调用；
+ * 汇总在读取方计算，读取与写入并发时结果可能相差一两个样本。
+ */
+
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 桶数量 */
+#define LATENCY_HIST_BUCKETS    96
+
+/**
+ * @brief 直方图 (零初始化即可使用)
+ */
+typedef struct {
+    uint32_t buckets[LATENCY_HIST_BUCKETS]; /**< 各桶样本数 (原子访问) */
+    uint32_t count;          /**< 样本总数 (原子访问) */
+    uint32_t max_us;         /**< 最大值 (原子访问) */
+    uint64_t sum_us;         /**< 总和 (原子访问) */
+} LatencyHist;
+
+/**
+ * @brief 直方图汇总
+ */
+typedef struct {
+    uint32_t count;          /**< 样本数 */
+    uint32_t avg_us;         /**< 平均值 */
+    uint32_t p50_us;         /**< 50 分位 */
+    uint32_t p95_us;         /**< 95 分位 */
+    uint32_t p99_us;         /**< 99 分位 */
+    uint32_t max_us;         /**< 最大值 */
+} LatencyHistSummary;
+
+/**
+ * @brief 记录一个样本
+ *
+ * @param hist 直方图
+ * @param us 耗时 (微秒)
+ */
+void latency_hist_record(LatencyHist *hist, uint32_t us);
+
+/**
+ * @brief 计算汇总 (分位数在桶内线性插值)
+ *
+ * @param hist 直方图
+ * @param summary 输出汇总
+ */
+void latency_hist_summarize(const LatencyHist *hist, LatencyHistSummary *summary);
+
+/**
+ * @brief 计算任意分位数
+ *
+ * @param hist 直方图
+ * @param pct 分位 (0 ~ 100)
+ * @return 分位数 (微秒)，无样本时返回 0
+ */
+uint32_t latency_hist_percentile(const LatencyHist *hist, double pct);
+
+/**
+ * @brief 清空直方图
+ *
+ * @param hist 直方图
+ */
+void latency_hist_reset(LatencyHist *hist);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_HIST_H
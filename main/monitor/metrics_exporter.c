@@ -0,0 +1,616 @@
+/**
+ * @file metrics_exporter.c
+ * @brief OpenMetrics 指标导出实现
+ *
+ * 导出线程串行处理连接：读请求头 -> 取一份 PerfReport -> 渲染到静态缓冲区 -> 发送 -> 关闭。
+ * 指标命名沿用 Prometheus 习惯 (rv_ 前缀，耗时以秒、码率以 bit/s 为单位，计数器带 _total 后缀)。
+ *
+ * 抓取不能改变监控线程的采样基准：CPU 以累计秒数计数器导出 (使用率由抓取端 rate() 计算)，
+ * 其余部分用 perf_peek_report 读取。
+ */
+
+#include "metrics_exporter.h"
+#include "perf_monitor.h"
+#include "log.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "metrics"
+
+/* 渲染缓冲区大小 (4 路码流、每路 12 个处理阶段时约 60KB) */
+#define METRICS_BUF_SIZE        (128 * 1024)
+
+/* 请求头最大长度 */
+#define METRICS_REQ_MAX         1024
+
+/* 单个连接的收发超时 (毫秒)，慢客户端不会长期占住导出线程 */
+#define METRICS_IO_TIMEOUT_MS   1000
+
+/* 停止检查间隔 (毫秒) */
+#define METRICS_POLL_MS         500
+
+/* =========================================================================
+ *                              指标描述表
+ * ========================================================================= */
+
+typedef enum {
+    METRIC_GAUGE = 0,
+    METRIC_COUNTER,
+} MetricType;
+
+typedef enum {
+    FIELD_INT = 0,
+    FIELD_U32,
+    FIELD_FLOAT,
+} FieldType;
+
+/**
+ * @brief 每路码流统计结构体中的一个字段 (负值表示不可用，不输出)
+ */
+typedef struct {
+    const char *name;        /**< 指标名 (计数器不含 _total 后缀) */
+    MetricType type;         /**< 指标类型 */
+    FieldType field;         /**< 字段类型 */
+    size_t offset;           /**< 字段在结构体中的偏移 */
+    double scale;            /**< 输出值 = 字段值 × scale */
+    const char *help;        /**< 说明 */
+} MetricField;
+
+#define FIELD_DESC(st, member, ftype, mtype, name, scale, help) \
+    { name, mtype, ftype, offsetof(st, member), scale, help }
+
+static const MetricField k_video_fields[] = {
+    FIELD_DESC(VideoStats, vi_fps, FIELD_FLOAT, METRIC_GAUGE, "rv_vi_fps", 1,
+               "VI channel frame rate reported by the driver"),
+    FIELD_DESC(VideoStats, vi_lost, FIELD_U32, METRIC_COUNTER, "rv_vi_lost_frames", 1,
+               "Frames lost by the VI channel (input + output)"),
+    FIELD_DESC(VideoStats, vi_vb_fail, FIELD_U32, METRIC_COUNTER, "rv_vi_vb_fail", 1,
+               "VI buffer allocation failures"),
+    FIELD_DESC(VideoStats, venc_fps, FIELD_FLOAT, METRIC_GAUGE, "rv_venc_fps", 1,
+               "Encoded frames per second"),
+    FIELD_DESC(VideoStats, venc_bitrate_kbps, FIELD_U32, METRIC_GAUGE,
+               "rv_venc_bitrate_bits_per_second", 1000, "Encoded bitrate"),
+    FIELD_DESC(VideoStats, i_frames, FIELD_U32, METRIC_GAUGE, "rv_venc_i_frames", 1,
+               "I frames in the last report window"),
+    FIELD_DESC(VideoStats, p_frames, FIELD_U32, METRIC_GAUGE, "rv_venc_p_frames", 1,
+               "P frames in the last report window"),
+    FIELD_DESC(VideoStats, qp_avg, FIELD_INT, METRIC_GAUGE, "rv_venc_qp_avg", 1,
+               "Mean QP in the last report window"),
+    FIELD_DESC(VideoStats, qp_min, FIELD_INT, METRIC_GAUGE, "rv_venc_qp_min", 1,
+               "Minimum frame QP in the last report window"),
+    FIELD_DESC(VideoStats, qp_max, FIELD_INT, METRIC_GAUGE, "rv_venc_qp_max", 1,
+               "Maximum frame QP in the last report window"),
+    FIELD_DESC(VideoStats, size_avg, FIELD_U32, METRIC_GAUGE, "rv_venc_frame_size_avg_bytes", 1,
+               "Average encoded frame size since start"),
+    FIELD_DESC(VideoStats, size_p50, FIELD_U32, METRIC_GAUGE, "rv_venc_frame_size_p50_bytes", 1,
+               "Median encoded frame size since start"),
+    FIELD_DESC(VideoStats, size_p95, FIELD_U32, METRIC_GAUGE, "rv_venc_frame_size_p95_bytes", 1,
+               "95th percentile encoded frame size since start"),
+    FIELD_DESC(VideoStats, size_max, FIELD_U32, METRIC_GAUGE, "rv_venc_frame_size_max_bytes", 1,
+               "Largest encoded frame since start"),
+    FIELD_DESC(VideoStats, venc_pending, FIELD_INT, METRIC_GAUGE, "rv_venc_pending_frames", 1,
+               "Encoded frames waiting in the VENC channel"),
+    FIELD_DESC(VideoStats, queue_depth, FIELD_INT, METRIC_GAUGE, "rv_stream_queue_depth_frames", 1,
+               "Unread frames of the slowest output"),
+    FIELD_DESC(VideoStats, queue_capacity, FIELD_INT, METRIC_GAUGE,
+               "rv_stream_queue_capacity_frames", 1, "Stream queue capacity"),
+};
+
+static const MetricField k_pool_fields[] = {
+    FIELD_DESC(PoolStats, hits, FIELD_U32, METRIC_COUNTER, "rv_pool_hits", 1,
+               "Packet buffers served from the pool"),
+    FIELD_DESC(PoolStats, misses, FIELD_U32, METRIC_COUNTER, "rv_pool_misses", 1,
+               "Packet buffers that fell back to malloc"),
+    FIELD_DESC(PoolStats, in_use, FIELD_U32, METRIC_GAUGE, "rv_pool_in_use_blocks", 1,
+               "Pool blocks currently in use"),
+    FIELD_DESC(PoolStats, high_water, FIELD_U32, METRIC_GAUGE, "rv_pool_high_water_blocks", 1,
+               "Peak pool blocks in use"),
+    FIELD_DESC(PoolStats, capacity, FIELD_U32, METRIC_GAUGE, "rv_pool_capacity_blocks", 1,
+               "Total pool blocks"),
+    FIELD_DESC(PoolStats, budget_kb, FIELD_U32, METRIC_GAUGE, "rv_pool_budget_bytes", 1024,
+               "Preallocated pool memory"),
+};
+
+static const MetricField k_abr_fields[] = {
+    FIELD_DESC(AbrStats, target_kbps, FIELD_INT, METRIC_GAUGE,
+               "rv_abr_target_bitrate_bits_per_second", 1000, "Current ABR target bitrate"),
+    FIELD_DESC(AbrStats, max_kbps, FIELD_INT, METRIC_GAUGE,
+               "rv_abr_max_bitrate_bits_per_second", 1000, "Configured bitrate"),
+    FIELD_DESC(AbrStats, target_fps, FIELD_INT, METRIC_GAUGE, "rv_abr_target_fps", 1,
+               "Current ABR target frame rate"),
+    FIELD_DESC(AbrStats, max_fps, FIELD_INT, METRIC_GAUGE, "rv_abr_max_fps", 1,
+               "Configured frame rate"),
+    FIELD_DESC(AbrStats, backlog, FIELD_INT, METRIC_GAUGE, "rv_abr_backlog_frames", 1,
+               "Largest backlog of the watched outputs"),
+    FIELD_DESC(AbrStats, write_us, FIELD_U32, METRIC_GAUGE, "rv_abr_write_seconds", 1e-6,
+               "Smoothed per-frame write time of the watched outputs"),
+    FIELD_DESC(AbrStats, drops, FIELD_U32, METRIC_COUNTER, "rv_abr_dropped_frames", 1,
+               "Frames dropped by the watched outputs"),
+    FIELD_DESC(AbrStats, steps_down, FIELD_U32, METRIC_COUNTER, "rv_abr_steps_down", 1,
+               "ABR down steps"),
+    FIELD_DESC(AbrStats, steps_up, FIELD_U32, METRIC_COUNTER, "rv_abr_steps_up", 1,
+               "ABR up steps"),
+};
+
+static const MetricField k_pipeline_fields[] = {
+    FIELD_DESC(PipelineStats, captured, FIELD_U32, METRIC_COUNTER, "rv_pipeline_captured_frames", 1,
+               "Frames captured by the non-bind VI pipeline"),
+    FIELD_DESC(PipelineStats, dropped, FIELD_U32, METRIC_COUNTER, "rv_pipeline_dropped_frames", 1,
+               "Frames dropped for a full queue or no free slot"),
+    FIELD_DESC(PipelineStats, sent, FIELD_U32, METRIC_COUNTER, "rv_pipeline_sent_frames", 1,
+               "Frames sent to the encoder"),
+};
+
+#define ARRAY_COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+/* =========================================================================
+ *                              文本输出
+ * ========================================================================= */
+
+/**
+ * @brief 写入固定缓冲区的文本输出器 (溢出后只置标志)
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    int overflow;
+} MetricsWriter;
+
+static void mw_printf(MetricsWriter *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void mw_printf(MetricsWriter *w, const char *fmt, ...) {
+    if (w->overflow) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->len, w->size - w->len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= w->size - w->len) {
+        w->overflow = 1;
+        return;
+    }
+    w->len += (size_t)n;
+}
+
+static void mw_family(MetricsWriter *w, const char *name, const char *type, const char *help) {
+    mw_printf(w, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+/**
+ * @brief 拷贝标签值并转义引号、反斜杠和换行
+ */
+static void label_escape(char *dst, size_t size, const char *src) {
+    size_t n = 0;
+    for (; *src && n + 2 < size; src++) {
+        if (*src == '"' || *src == '\\') {
+            dst[n++] = '\\';
+            dst[n++] = *src;
+        } else if (*src == '\n') {
+            dst[n++] = '\\';
+            dst[n++] = 'n';
+        } else {
+            dst[n++] = *src;
+        }
+    }
+    dst[n] = '\0';
+}
+
+static double field_value(const char *base, const MetricField *f) {
+    const void *p = base + f->offset;
+    switch (f->field) {
+    case FIELD_U32:
+        return (double)*(const uint32_t *)p;
+    case FIELD_FLOAT:
+        return (double)*(const float *)p;
+    case FIELD_INT:
+    default:
+        return (double)*(const int *)p;
+    }
+}
+
+/**
+ * @brief 输出一组每路码流字段 (每个字段一个指标族，族内按码流输出样本)
+ *
+ * @param base 统计数组首地址 (每个元素首个成员为 int valid)
+ * @param stride 数组元素大小
+ */
+static void render_stream_fields(MetricsWriter *w, const MetricField *fields, int count,
+                                 const void *base, size_t stride) {
+    for (int f = 0; f < count; f++) {
+        const MetricField *field = &fields[f];
+        int header = 0;
+        for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+            const char *st = (const char *)base + stride * i;
+            if (!*(const int *)st) continue;
+            double value = field_value(st, field);
+            if (value < 0) continue;
+
+            if (!header) {
+                mw_family(w, field->name, field->type == METRIC_COUNTER ? "counter" : "gauge",
+                          field->help);
+                header = 1;
+            }
+            mw_printf(w, "%s%s{stream=\"%d\"} %.10g\n", field->name,
+                      field->type == METRIC_COUNTER ? "_total" : "", i, value * field->scale);
+        }
+    }
+}
+
+/**
+ * @brief 输出一个延迟汇总 (summary 样本：分位数、_count、_sum，单位秒)
+ */
+static void render_latency(MetricsWriter *w, const char *name, const char *labels,
+                           const LatencyHistSummary *lat) {
+    mw_printf(w, "%s{%s,quantile=\"0.5\"} %.6f\n", name, labels, lat->p50_us / 1e6);
+    mw_printf(w, "%s{%s,quantile=\"0.95\"} %.6f\n", name, labels, lat->p95_us / 1e6);
+    mw_printf(w, "%s{%s,quantile=\"0.99\"} %.6f\n", name, labels, lat->p99_us / 1e6);
+    mw_printf(w, "%s_count{%s} %u\n", name, labels, lat->count);
+    mw_printf(w, "%s_sum{%s} %.6f\n", name, labels, (double)lat->avg_us * lat->count / 1e6);
+}
+
+/**
+ * @brief 输出一组按模式划分的 CPU 累计时间样本
+ */
+static void render_cpu_times(MetricsWriter *w, const char *name, const char *labels,
+                             const CpuTimes *t) {
+    static const struct {
+        const char *mode;
+        size_t offset;
+    } modes[] = {
+        { "user", offsetof(CpuTimes, user) },       { "nice", offsetof(CpuTimes, nice) },
+        { "system", offsetof(CpuTimes, system) },   { "idle", offsetof(CpuTimes, idle) },
+        { "iowait", offsetof(CpuTimes, iowait) },   { "irq", offsetof(CpuTimes, irq) },
+        { "softirq", offsetof(CpuTimes, softirq) }, { "steal", offsetof(CpuTimes, steal) },
+    };
+    for (int i = 0; i < ARRAY_COUNT(modes); i++) {
+        double value = *(const double *)((const char *)t + modes[i].offset);
+        mw_printf(w, "%s_total{%s%smode=\"%s\"} %.2f\n", name, labels, labels[0] ? "," : "",
+                  modes[i].mode, value);
+    }
+}
+
+static void render_system(MetricsWriter *w, const PerfReport *r, const CpuCounters *cpu,
+                          const ThreadCpuStats *threads, int thread_count) {
+    char labels[32];
+    char name[40];
+
+    if (cpu) {
+        mw_family(w, "rv_cpu_cores", "gauge", "Number of CPU cores");
+        mw_printf(w, "rv_cpu_cores %d\n", cpu->core_count);
+        mw_family(w, "rv_cpu_seconds", "counter", "CPU time spent in each mode, all cores");
+        render_cpu_times(w, "rv_cpu_seconds", "", &cpu->total);
+        mw_family(w, "rv_cpu_core_seconds", "counter", "CPU time spent in each mode, per core");
+        for (int i = 0; i < PERF_MAX_CORES && i < cpu->core_count; i++) {
+            if (!cpu->core_valid[i]) continue;
+            snprintf(labels, sizeof(labels), "core=\"%d\"", i);
+            render_cpu_times(w, "rv_cpu_core_seconds", labels, &cpu->cores[i]);
+        }
+    }
+
+    if (thread_count > 0) {
+        mw_family(w, "rv_thread_cpu_seconds", "counter", "CPU time (user + system) of each thread");
+        for (int i = 0; i < thread_count; i++) {
+            const ThreadCpuStats *t = &threads[i];
+            label_escape(name, sizeof(name), t->name);
+            mw_printf(w, "rv_thread_cpu_seconds_total{tid=\"%d\",name=\"%s\"} %.2f\n",
+                      t->tid, name, t->cpu_seconds);
+        }
+    }
+
+    mw_family(w, "rv_memory_total_bytes", "gauge", "Total memory");
+    mw_printf(w, "rv_memory_total_bytes %llu\n", (unsigned long long)r->mem.total_kb * 1024);
+    mw_family(w, "rv_memory_free_bytes", "gauge", "Free memory");
+    mw_printf(w, "rv_memory_free_bytes %llu\n", (unsigned long long)r->mem.free_kb * 1024);
+    mw_family(w, "rv_memory_available_bytes", "gauge", "Available memory");
+    mw_printf(w, "rv_memory_available_bytes %llu\n", (unsigned long long)r->mem.available_kb * 1024);
+    mw_family(w, "rv_memory_used_bytes", "gauge", "Used memory (total - available)");
+    mw_printf(w, "rv_memory_used_bytes %llu\n", (unsigned long long)r->mem.used_kb * 1024);
+
+    if (r->temp.cpu_temp >= 0 || r->temp.gpu_temp >= 0) {
+        mw_family(w, "rv_temperature_celsius", "gauge", "Chip temperature");
+        if (r->temp.cpu_temp >= 0) {
+            mw_printf(w, "rv_temperature_celsius{sensor=\"cpu\"} %.1f\n", r->temp.cpu_temp);
+        }
+        if (r->temp.gpu_temp >= 0) {
+            mw_printf(w, "rv_temperature_celsius{sensor=\"gpu\"} %.1f\n", r->temp.gpu_temp);
+        }
+    }
+
+    mw_family(w, "rv_uptime_seconds", "gauge", "System uptime");
+    mw_printf(w, "rv_uptime_seconds %llu\n", (unsigned long long)r->uptime_sec);
+}
+
+static void render_abr_reason(MetricsWriter *w, const PerfReport *r) {
+    int header = 0;
+    char reason[64];
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        const AbrStats *abr = &r->abr[i];
+        if (!abr->valid) continue;
+        if (!header) {
+            mw_family(w, "rv_abr_last_reason", "info", "Reason of the latest ABR adjustment");
+            header = 1;
+        }
+        label_escape(reason, sizeof(reason), abr->last_reason ? abr->last_reason : "none");
+        mw_printf(w, "rv_abr_last_reason_info{stream=\"%d\",reason=\"%s\"} 1\n", i, reason);
+    }
+}
+
+static void render_pipeline_stages(MetricsWriter *w, const PerfReport *r) {
+    char labels[96];
+    char stage[40];
+    int header = 0;
+
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        const PipelineStats *pipe = &r->pipeline[i];
+        if (!pipe->valid) continue;
+        for (int j = 0; j < pipe->stage_count; j++) {
+            if (!header) {
+                mw_family(w, "rv_pipeline_stage_latency_seconds", "summary",
+                          "Per-stage latency of the non-bind VI pipeline since start");
+                header = 1;
+            }
+            label_escape(stage, sizeof(stage), pipe->stages[j].name);
+            snprintf(labels, sizeof(labels), "stream=\"%d\",stage=\"%s\"", i, stage);
+            render_latency(w, "rv_pipeline_stage_latency_seconds", labels, &pipe->stages[j].latency);
+        }
+    }
+
+    header = 0;
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        const PipelineStats *pipe = &r->pipeline[i];
+        if (!pipe->valid) continue;
+        for (int j = 0; j < pipe->stage_count; j++) {
+            if (!header) {
+                mw_family(w, "rv_pipeline_stage_dropped_frames", "counter",
+                          "Frames dropped by a pipeline stage");
+                header = 1;
+            }
+            label_escape(stage, sizeof(stage), pipe->stages[j].name);
+            mw_printf(w, "rv_pipeline_stage_dropped_frames_total{stream=\"%d\",stage=\"%s\"} %u\n",
+                      i, stage, pipe->stages[j].dropped);
+        }
+    }
+}
+
+static void render_trace(MetricsWriter *w, const PerfReport *r) {
+    char labels[64];
+    int header = 0;
+
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        if (!r->trace_valid[i]) continue;
+        for (int j = 0; j < FRAME_TRACE_POINTS; j++) {
+            const LatencyHistSummary *lat = &r->trace[i].stage[j];
+            if (lat->count == 0) continue;
+            if (!header) {
+                mw_family(w, "rv_frame_stage_latency_seconds", "summary",
+                          "Encoded frame latency from the previous trace point since start");
+                header = 1;
+            }
+            snprintf(labels, sizeof(labels), "stream=\"%d\",stage=\"%s\"", i,
+                     frame_trace_point_name((FrameTracePoint)j));
+            render_latency(w, "rv_frame_stage_latency_seconds", labels, lat);
+        }
+    }
+
+    header = 0;
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        if (!r->trace_valid[i]) continue;
+        for (int j = 0; j < FRAME_TRACE_POINTS; j++) {
+            const LatencyHistSummary *lat = &r->trace[i].e2e[j];
+            if (lat->count == 0) continue;
+            if (!header) {
+                mw_family(w, "rv_frame_e2e_latency_seconds", "summary",
+                          "Sensor timestamp to network write return since start");
+                header = 1;
+            }
+            snprintf(labels, sizeof(labels), "stream=\"%d\",output=\"%s\"", i,
+                     frame_trace_point_name((FrameTracePoint)j));
+            render_latency(w, "rv_frame_e2e_latency_seconds", labels, lat);
+        }
+    }
+}
+
+int metrics_render(char *buf, size_t size) {
+    PerfReport report;
+    CpuCounters cpu;
+    ThreadCpuStats threads[PERF_MAX_THREADS];
+    MetricsWriter w;
+
+    if (!buf || size == 0 || perf_peek_report(&report) != 0) {
+        return -1;
+    }
+    int have_cpu = perf_get_cpu_counters(&cpu) == 0;
+    int thread_count = perf_get_thread_counters(threads, PERF_MAX_THREADS);
+
+    w.buf = buf;
+    w.size = size;
+    w.len = 0;
+    w.overflow = 0;
+    buf[0] = '\0';
+
+    render_system(&w, &report, have_cpu ? &cpu : NULL, threads, thread_count);
+    render_stream_fields(&w, k_video_fields, ARRAY_COUNT(k_video_fields),
+                         report.video, sizeof(report.video[0]));
+    render_stream_fields(&w, k_pool_fields, ARRAY_COUNT(k_pool_fields),
+                         report.pool, sizeof(report.pool[0]));
+    render_stream_fields(&w, k_abr_fields, ARRAY_COUNT(k_abr_fields),
+                         report.abr, sizeof(report.abr[0]));
+    render_abr_reason(&w, &report);
+    render_stream_fields(&w, k_pipeline_fields, ARRAY_COUNT(k_pipeline_fields),
+                         report.pipeline, sizeof(report.pipeline[0]));
+    render_pipeline_stages(&w, &report);
+    render_trace(&w, &report);
+    mw_printf(&w, "# EOF\n");
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+/* =========================================================================
+ *                              HTTP 服务
+ * ========================================================================= */
+
+static int g_listen_fd = -1;
+static pthread_t g_thread;
+static volatile int g_running = 0;
+
+/** @brief 响应正文缓冲区 (只由导出线程使用) */
+static char g_body[METRICS_BUF_SIZE];
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void send_response(int fd, const char *status, const char *type, const char *body, size_t len) {
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %zu\r\n"
+                     "Connection: close\r\n\r\n",
+                     status, type, len);
+    if (send_all(fd, header, (size_t)n) == 0) {
+        send_all(fd, body, len);
+    }
+}
+
+/**
+ * @brief 处理一个连接 (只支持 GET /metrics)
+ */
+static void exporter_serve(int fd) {
+    char req[METRICS_REQ_MAX];
+    size_t len = 0;
+    struct timeval tv = { METRICS_IO_TIMEOUT_MS / 1000, (METRICS_IO_TIMEOUT_MS % 1000) * 1000 };
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // 读到请求头结束 (忽略请求体)
+    req[0] = '\0';
+    while (len < sizeof(req) - 1 && !strstr(req, "\r\n\r\n")) {
+        ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;  // 超时或对端关闭
+        len += (size_t)n;
+        req[len] = '\0';
+    }
+
+    static const char not_found[] = "not found\n";
+    if (strncmp(req, "GET ", 4) != 0) {
+        static const char not_allowed[] = "method not allowed\n";
+        send_response(fd, "405 Method Not Allowed", "text/plain", not_allowed, sizeof(not_allowed) - 1);
+        return;
+    }
+    const char *path = req + 4;
+    size_t path_len = strcspn(path, " ?");
+    if (path_len != 8 || strncmp(path, "/metrics", 8) != 0) {
+        send_response(fd, "404 Not Found", "text/plain", not_found, sizeof(not_found) - 1);
+        return;
+    }
+
+    int body_len = metrics_render(g_body, sizeof(g_body));
+    if (body_len < 0) {
+        static const char failed[] = "render failed\n";
+        LOG_WARN("Metrics exceed %d bytes or report unavailable\n", METRICS_BUF_SIZE);
+        send_response(fd, "500 Internal Server Error", "text/plain", failed, sizeof(failed) - 1);
+        return;
+    }
+    send_response(fd, "200 OK", "application/openmetrics-text; version=1.0.0; charset=utf-8",
+                  g_body, (size_t)body_len);
+}
+
+static void *exporter_thread(void *arg) {
+    (void)arg;
+    prctl(PR_SET_NAME, "metrics", 0, 0, 0);
+    LOG_INFO("Metrics exporter thread started\n");
+
+    while (g_running) {
+        struct pollfd pfd;
+        pfd.fd = g_listen_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, METRICS_POLL_MS) <= 0) continue;
+
+        int fd = accept(g_listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        exporter_serve(fd);
+        close(fd);
+    }
+
+    LOG_INFO("Metrics exporter thread stopped\n");
+    return NULL;
+}
+
+int metrics_exporter_start(int port) {
+    if (g_running) {
+        LOG_WARN("Metrics exporter already running\n");
+        return 0;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("socket failed: %s\n", strerror(errno));
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        LOG_ERROR("Failed to listen on port %d: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    g_listen_fd = fd;
+    g_running = 1;
+    int ret = pthread_create(&g_thread, NULL, exporter_thread, NULL);
+    if (ret != 0) {
+        LOG_ERROR("Failed to create exporter thread: %d\n", ret);
+        g_running = 0;
+        close(fd);
+        g_listen_fd = -1;
+        return -1;
+    }
+
+    LOG_INFO("Metrics exporter listening on http://0.0.0.0:%d/metrics\n", port);
+    return 0;
+}
+
+void metrics_exporter_stop(void) {
+    if (!g_running) {
+        return;
+    }
+
+    g_running = 0;
+    pthread_join(g_thread, NULL);
+    close(g_listen_fd);
+    g_listen_fd = -1;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file metrics_exporter.h
+ * @brief OpenMetrics 指标导出
+ *
+ * 内嵌一个极简 HTTP 服务，GET /metrics 返回 PerfReport 全部字段
+ * (系统资源、各路码流的视频/缓冲池/自适应码率/采集流水线统计、帧级延迟跟踪)，
+ * 格式为 OpenMetrics 文本 (Prometheus 可直接抓取)。
+ *
+ * 指标由静态描述表定义，渲染使用静态缓冲区，整个过程不分配内存；
+ * 抓取只在导出线程中执行，读取统计时持有的锁与 perf_print_report 相同 (只做一次拷贝)，
+ * 不会阻塞视频线程。
+ */
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 启动导出线程
+ *
+ * @param port 监听的 TCP 端口
+ * @return 0 成功，-1 失败 (端口被占用等)
+ */
+int metrics_exporter_start(int port);
+
+/**
+ * @brief 停止导出线程并关闭监听端口
+ */
+void metrics_exporter_stop(void);
+
+/**
+ * @brief 把当前性能报告渲染为 OpenMetrics 文本
+ *
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @return 文本长度 (不含结尾的 '\0')，缓冲区不足返回 -1
+ */
+int metrics_render(char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_EXPORTER_H
@@ -3,7 +3,8 @@
  * @brief 性能监控模块实现
  * 
  * 通过读取 Linux 系统文件获取各项性能指标：
- * - /proc/stat       : CPU 使用率
+ * - /proc/stat       : CPU 使用率 (总体与各核)
+ * - /proc/self/task/<tid>/stat : 各线程 CPU 占用
  * - /proc/meminfo    : 内存使用情况
  * - /sys/class/thermal/thermal_zone0/temp : 芯片温度
  * - /proc/uptime     : 系统运行时间
@@ -12,11 +13,17 @@
 #include "perf_monitor.h"
 #include "log.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/prctl.h>
 #include <sys/sysinfo.h> // for sysinfo()
 
 #ifdef LOG_TAG
@@ -31,10 +38,32 @@
 #define THERMAL_ZONE_PATH       "/sys/class/thermal/thermal_zone0/temp"
 #define THERMAL_ZONE1_PATH      "/sys/class/thermal/thermal_zone1/temp"
 
+/* /proc/stat 读取缓冲区 (只解析开头的 cpu 行，8KB 足够 100 核以上) */
+#define PROC_STAT_BUF_SIZE      8192
+
+/* /proc/meminfo 读取缓冲区 (只解析开头几行) */
+#define PROC_MEMINFO_BUF_SIZE   1024
+
+/* 性能报告中列出的线程数 (占用最高的前 N 个) */
+#define PERF_REPORT_TOP_THREADS 8
+
 /* =========================================================================
  *                              内部状态
  * ========================================================================= */
 
+/**
+ * @brief 保持打开的 /proc (sysfs) 文件
+ *
+ * 每次采样用 pread 从偏移 0 读取，内核会重新生成内容，省去每次 open/close 和 stdio 缓冲。
+ * 读失败时关闭，下次采样重新打开。
+ */
+typedef struct {
+    const char *path;
+    int fd;
+} ProcFile;
+
+#define PROC_FILE_INIT(p)       { (p), -1 }
+
 /* CPU 统计用于计算差值 */
 typedef struct {
     uint64_t user;
@@ -47,11 +76,44 @@ typedef struct {
     uint64_t steal;
 } CpuRawStats;
 
+/* 单个线程的采样状态 */
+typedef struct {
+    int tid;                    /* 0 表示空闲槽位 */
+    int fd;                     /* /proc/self/task/<tid>/stat */
+    int seen;                   /* 本轮采样是否仍存在 */
+    int fresh;                  /* 刚加入，本轮没有基准 */
+    uint64_t ticks;             /* 上次采样的 utime + stime */
+    float usage_percent;
+    char name[16];
+} ThreadSlot;
+
+/*
+ * 以下采样状态由 g_sample_mutex 保护 (监控线程与指标导出线程都会采样)。
+ * /proc/stat 较大 (含中断计数)，只需要开头的 cpu 行，读一个固定缓冲区即可。
+ */
+static pthread_mutex_t g_sample_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ProcFile g_proc_stat = PROC_FILE_INIT("/proc/stat");
+static ProcFile g_proc_meminfo = PROC_FILE_INIT("/proc/meminfo");
+static ProcFile g_thermal[2] = { PROC_FILE_INIT(THERMAL_ZONE_PATH), PROC_FILE_INIT(THERMAL_ZONE1_PATH) };
+static char g_stat_buf[PROC_STAT_BUF_SIZE];
+
 static CpuRawStats g_last_cpu_stats = {0};
+static CpuRawStats g_last_core_stats[PERF_MAX_CORES];
+static int g_last_core_valid[PERF_MAX_CORES];
 static int g_cpu_stats_initialized = 0;
+static int g_core_count = 0;    /* 首次采样时缓存 */
+static CpuStats g_cpu_usage;    /* 最近一次 perf_get_cpu_stats 的结果 */
+
+static DIR *g_task_dir = NULL;  /* /proc/self/task, 每轮 rewinddir 重新枚举 */
+static ThreadSlot g_threads[PERF_MAX_THREADS];
+static uint64_t g_thread_sample_us = 0;
+static long g_clk_tck = 0;
 
 /* 视频统计 (由外部更新) */
-static VideoStats g_video_stats = {0};
+static VideoStats g_video_stats[PERF_MAX_STREAMS];
+static PoolStats g_pool_stats[PERF_MAX_STREAMS];
+static AbrStats g_abr_stats[PERF_MAX_STREAMS];
+static PipelineStats g_pipeline_stats[PERF_MAX_STREAMS];
 static pthread_mutex_t g_video_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* 监控线程 */
@@ -60,38 +122,126 @@ static int g_monitor_running = 0;
 static int g_monitor_interval_sec = DEFAULT_INTERVAL_SEC;
 
 /* =========================================================================
- *                              内部函数
+ *                              /proc 读取与解析
  * ========================================================================= */
 
 /**
- * @brief 读取 /proc/stat 获取原始 CPU 统计
+ * @brief 读取整个文件 (最多 size - 1 字节) 并以 '\0' 结尾
+ *
+ * @return 读取的字节数，-1 失败
  */
-static int read_cpu_raw_stats(CpuRawStats *raw) {
-    FILE *fp = fopen("/proc/stat", "r");
-    if (!fp) {
+static int proc_file_read(ProcFile *f, char *buf, size_t size) {
+    if (f->fd < 0) {
+        f->fd = open(f->path, O_RDONLY | O_CLOEXEC);
+        if (f->fd < 0) {
+            return -1;
+        }
+    }
+
+    ssize_t n;
+    do {
+        n = pread(f->fd, buf, size - 1, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        close(f->fd);
+        f->fd = -1;
         return -1;
     }
-    
-    char line[256];
-    if (fgets(line, sizeof(line), fp)) {
-        /* cpu  user nice system idle iowait irq softirq steal ... */
-        /* RV1126 是 32 位系统，uint64_t 需要用 %llu 读取 */
-        unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-        if (sscanf(line, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
-               &user, &nice, &system, &idle,
-               &iowait, &irq, &softirq, &steal) == 8) {
-            
-            raw->user = user;
-            raw->nice = nice;
-            raw->system = system;
-            raw->idle = idle;
-            raw->iowait = iowait;
-            raw->irq = irq;
-            raw->softirq = softirq;
-            raw->steal = steal;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+static void proc_file_close(ProcFile *f) {
+    if (f->fd >= 0) {
+        close(f->fd);
+        f->fd = -1;
+    }
+}
+
+/**
+ * @brief 跳过空白后解析一个十进制无符号数
+ *
+ * @return 数字之后的位置，没有数字返回 NULL
+ */
+static const char *parse_u64(const char *p, uint64_t *value) {
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p < '0' || *p > '9') {
+        return NULL;
+    }
+    uint64_t v = 0;
+    while (*p >= '0' && *p <= '9') {
+        v = v * 10 + (uint64_t)(*p - '0');
+        p++;
+    }
+    *value = v;
+    return p;
+}
+
+/**
+ * @brief 跳过 n 个以空格分隔的字段
+ */
+static const char *skip_fields(const char *p, int n) {
+    while (n-- > 0) {
+        while (*p == ' ') p++;
+        while (*p && *p != ' ' && *p != '\n') p++;
+        if (!*p || *p == '\n') return NULL;
+    }
+    return p;
+}
+
+static const char *next_line(const char *p) {
+    const char *nl = strchr(p, '\n');
+    return nl ? nl + 1 : NULL;
+}
+
+/**
+ * @brief 解析一行 cpu 计数 (user nice system idle iowait irq softirq steal)
+ *
+ * 老内核没有 steal 等尾部字段时按 0 处理。
+ */
+static void parse_cpu_line(const char *p, CpuRawStats *raw) {
+    uint64_t *fields[] = { &raw->user, &raw->nice, &raw->system, &raw->idle,
+                           &raw->iowait, &raw->irq, &raw->softirq, &raw->steal };
+    memset(raw, 0, sizeof(*raw));
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]) && p; i++) {
+        p = parse_u64(p, fields[i]);
+    }
+}
+
+/**
+ * @brief 读取 /proc/stat 获取总体与各核原始 CPU 统计 (调用者持有 g_sample_mutex)
+ *
+ * @param core_valid 输出各核是否出现 (离线核心没有对应行)
+ * @param core_count 输出出现过的最大核心编号 + 1
+ */
+static int read_cpu_raw_stats(CpuRawStats *raw, CpuRawStats *cores, int *core_valid, int *core_count) {
+    int len = proc_file_read(&g_proc_stat, g_stat_buf, sizeof(g_stat_buf));
+    if (len <= 0) {
+        return -1;
+    }
+
+    memset(core_valid, 0, sizeof(int) * PERF_MAX_CORES);
+    *core_count = 0;
+
+    /* cpu  总计行在前，随后 cpuN 各核一行；遇到非 cpu 行或截断的行即停止 */
+    const char *line = g_stat_buf;
+    while (line && strncmp(line, "cpu", 3) == 0 && strchr(line, '\n')) {
+        const char *p = line + 3;
+        if (*p == ' ') {
+            parse_cpu_line(p, raw);
+        } else {
+            uint64_t idx;
+            p = parse_u64(p, &idx);
+            if (p) {
+                if ((int)idx + 1 > *core_count) *core_count = (int)idx + 1;
+                if (idx < PERF_MAX_CORES) {
+                    parse_cpu_line(p, &cores[idx]);
+                    core_valid[idx] = 1;
+                }
+            }
         }
+        line = next_line(line);
     }
-    fclose(fp);
     return 0;
 }
 
@@ -123,39 +273,157 @@ static float calc_cpu_usage(const CpuRawStats *prev, const CpuRawStats *curr) {
 }
 
 /**
- * @brief 读取单个整数值的文件
+ * @brief 读取单个整数值的文件 (sysfs 温度等)
  */
-static int read_int_file(const char *path, int *value) {
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
+static int read_int_file(ProcFile *f, int *value) {
+    char buf[32];
+    uint64_t v;
+    if (proc_file_read(f, buf, sizeof(buf)) <= 0) {
         return -1;
     }
-    if (fscanf(fp, "%d", value) != 1) {
-        fclose(fp);
+    const char *p = buf;
+    int neg = (*p == '-');
+    if (neg) p++;
+    if (!parse_u64(p, &v)) {
         return -1;
     }
-    fclose(fp);
+    *value = neg ? -(int)v : (int)v;
     return 0;
 }
 
 /**
- * @brief 获取 CPU 核心数
+ * @brief 解析 /proc/<pid>/task/<tid>/stat 中的线程名与 utime + stime
+ *
+ * 格式: tid (comm) state ppid ... utime(14) stime(15) ...
+ * comm 可能含空格和括号，以最后一个 ')' 为界。
  */
-static int get_cpu_core_count(void) {
-    int count = 0;
-    FILE *fp = fopen("/proc/cpuinfo", "r");
-    if (!fp) {
-        return 1;  /* 默认返回 1 */
+static int parse_task_stat(const char *buf, char *name, size_t name_size, uint64_t *ticks) {
+    const char *open_paren = strchr(buf, '(');
+    const char *close_paren = strrchr(buf, ')');
+    if (!open_paren || !close_paren || close_paren < open_paren) {
+        return -1;
     }
-    
-    char line[256];
-    while (fgets(line, sizeof(line), fp)) {
-        if (strncmp(line, "processor", 9) == 0) {
-            count++;
+
+    size_t len = (size_t)(close_paren - open_paren - 1);
+    if (len >= name_size) len = name_size - 1;
+    memcpy(name, open_paren + 1, len);
+    name[len] = '\0';
+
+    /* ')' 之后从 state (第 3 个字段) 开始，跳过 state..cutime 前的 11 个字段到 utime */
+    uint64_t utime, stime;
+    const char *p = skip_fields(close_paren + 1, 11);
+    if (!p || !(p = parse_u64(p, &utime)) || !parse_u64(p, &stime)) {
+        return -1;
+    }
+    *ticks = utime + stime;
+    return 0;
+}
+
+static ThreadSlot *thread_slot_get(int tid) {
+    ThreadSlot *free_slot = NULL;
+    for (int i = 0; i < PERF_MAX_THREADS; i++) {
+        if (g_threads[i].tid == tid) return &g_threads[i];
+        if (!free_slot && g_threads[i].tid == 0) free_slot = &g_threads[i];
+    }
+    if (!free_slot) {
+        return NULL;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->tid = tid;
+    free_slot->fd = fd;
+    free_slot->fresh = 1;
+    return free_slot;
+}
+
+static void thread_slot_release(ThreadSlot *slot) {
+    if (slot->fd >= 0) {
+        close(slot->fd);
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->fd = -1;
+}
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 打开 /proc/self/task 并缓存时钟频率 (调用者持有 g_sample_mutex)
+ */
+static int task_dir_open(void) {
+    if (!g_task_dir) {
+        g_task_dir = opendir("/proc/self/task");
+        if (!g_task_dir) {
+            return -1;
+        }
+        g_clk_tck = sysconf(_SC_CLK_TCK);
+        if (g_clk_tck <= 0) g_clk_tck = 100;
+    }
+    return 0;
+}
+
+/**
+ * @brief 采样本进程所有线程 (调用者持有 g_sample_mutex)
+ *
+ * 目录句柄与各线程 stat 的 fd 保持打开，只在线程出现/退出时打开/关闭。
+ */
+static int sample_threads(void) {
+    if (task_dir_open() != 0) {
+        return -1;
+    }
+
+    uint64_t now_us = monotonic_us();
+    uint64_t elapsed_us = g_thread_sample_us ? now_us - g_thread_sample_us : 0;
+    g_thread_sample_us = now_us;
+
+    for (int i = 0; i < PERF_MAX_THREADS; i++) {
+        g_threads[i].seen = 0;
+    }
+
+    rewinddir(g_task_dir);
+    struct dirent *de;
+    while ((de = readdir(g_task_dir)) != NULL) {
+        uint64_t tid;
+        const char *end = parse_u64(de->d_name, &tid);
+        if (!end || *end != '\0') continue;  // "." 与 ".."
+
+        ThreadSlot *slot = thread_slot_get((int)tid);
+        if (!slot) continue;
+
+        char buf[512];
+        ssize_t n = pread(slot->fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) continue;  // 线程已退出, 下面释放
+        buf[n] = '\0';
+
+        uint64_t ticks;
+        if (parse_task_stat(buf, slot->name, sizeof(slot->name), &ticks) != 0) continue;
+
+        if (slot->fresh || elapsed_us == 0 || ticks < slot->ticks) {
+            slot->usage_percent = 0.0f;
+        } else {
+            double busy_us = (double)(ticks - slot->ticks) * 1e6 / (double)g_clk_tck;
+            slot->usage_percent = (float)(100.0 * busy_us / (double)elapsed_us);
+        }
+        slot->ticks = ticks;
+        slot->fresh = 0;
+        slot->seen = 1;
+    }
+
+    for (int i = 0; i < PERF_MAX_THREADS; i++) {
+        if (g_threads[i].tid && !g_threads[i].seen) {
+            thread_slot_release(&g_threads[i]);
         }
     }
-    fclose(fp);
-    return count > 0 ? count : 1;
+    return 0;
 }
 
 /**
@@ -163,6 +431,7 @@ static int get_cpu_core_count(void) {
  */
 static void *monitor_thread_func(void *arg) {
     (void)arg;
+    prctl(PR_SET_NAME, "perf_monitor", 0, 0, 0);
     LOG_INFO("Performance monitor thread started\n");
     
     while (g_monitor_running) {
@@ -183,15 +452,38 @@ static void *monitor_thread_func(void *arg) {
 int perf_monitor_init(void) {
     LOG_INFO("Performance monitor initialized\n");
     
-    /* 初始化 CPU 基准统计 */
-    read_cpu_raw_stats(&g_last_cpu_stats);
-    g_cpu_stats_initialized = 1;
+    /* 初始化 CPU 基准统计并缓存核心数 */
+    pthread_mutex_lock(&g_sample_mutex);
+    for (int i = 0; i < PERF_MAX_THREADS; i++) {
+        g_threads[i].fd = -1;
+    }
+    if (read_cpu_raw_stats(&g_last_cpu_stats, g_last_core_stats, g_last_core_valid, &g_core_count) == 0) {
+        g_cpu_stats_initialized = 1;
+    }
+    sample_threads();
+    pthread_mutex_unlock(&g_sample_mutex);
     
     return 0;
 }
 
 void perf_monitor_deinit(void) {
     perf_monitor_stop();
+    
+    pthread_mutex_lock(&g_sample_mutex);
+    proc_file_close(&g_proc_stat);
+    proc_file_close(&g_proc_meminfo);
+    proc_file_close(&g_thermal[0]);
+    proc_file_close(&g_thermal[1]);
+    for (int i = 0; i < PERF_MAX_THREADS; i++) {
+        if (g_threads[i].tid) thread_slot_release(&g_threads[i]);
+    }
+    if (g_task_dir) {
+        closedir(g_task_dir);
+        g_task_dir = NULL;
+    }
+    g_thread_sample_us = 0;
+    g_cpu_stats_initialized = 0;
+    pthread_mutex_unlock(&g_sample_mutex);
     LOG_INFO("Performance monitor deinitialized\n");
 }
 
@@ -230,55 +522,212 @@ int perf_get_cpu_stats(CpuStats *stats) {
     }
     
     CpuRawStats curr;
-    if (read_cpu_raw_stats(&curr) != 0) {
+    CpuRawStats cores[PERF_MAX_CORES];
+    int core_valid[PERF_MAX_CORES];
+    int core_count;
+    
+    pthread_mutex_lock(&g_sample_mutex);
+    if (read_cpu_raw_stats(&curr, cores, core_valid, &core_count) != 0) {
+        pthread_mutex_unlock(&g_sample_mutex);
         return -1;
     }
+    if (g_core_count == 0) {
+        g_core_count = core_count > 0 ? core_count : 1;
+    }
     
-    if (g_cpu_stats_initialized) {
-        stats->usage_percent = calc_cpu_usage(&g_last_cpu_stats, &curr);
-    } else {
-        stats->usage_percent = 0.0f;
+    stats->usage_percent = g_cpu_stats_initialized ? calc_cpu_usage(&g_last_cpu_stats, &curr) : 0.0f;
+    stats->core_count = g_core_count;
+    for (int i = 0; i < PERF_MAX_CORES; i++) {
+        if (!core_valid[i]) {
+            stats->core_usage[i] = -1.0f;
+        } else if (g_cpu_stats_initialized && g_last_core_valid[i]) {
+            stats->core_usage[i] = calc_cpu_usage(&g_last_core_stats[i], &cores[i]);
+        } else {
+            stats->core_usage[i] = 0.0f;
+        }
     }
     
     /* 更新基准 */
     g_last_cpu_stats = curr;
+    memcpy(g_last_core_stats, cores, sizeof(g_last_core_stats));
+    memcpy(g_last_core_valid, core_valid, sizeof(g_last_core_valid));
     g_cpu_stats_initialized = 1;
+    g_cpu_usage = *stats;
+    pthread_mutex_unlock(&g_sample_mutex);
     
-    stats->core_count = get_cpu_core_count();
+    return 0;
+}
+
+static void cpu_times_from_raw(const CpuRawStats *raw, double tck, CpuTimes *times) {
+    times->user = (double)raw->user / tck;
+    times->nice = (double)raw->nice / tck;
+    times->system = (double)raw->system / tck;
+    times->idle = (double)raw->idle / tck;
+    times->iowait = (double)raw->iowait / tck;
+    times->irq = (double)raw->irq / tck;
+    times->softirq = (double)raw->softirq / tck;
+    times->steal = (double)raw->steal / tck;
+}
+
+int perf_get_cpu_counters(CpuCounters *counters) {
+    if (!counters) {
+        return -1;
+    }
+    
+    CpuRawStats total;
+    CpuRawStats cores[PERF_MAX_CORES];
     
+    memset(counters, 0, sizeof(*counters));
+    pthread_mutex_lock(&g_sample_mutex);
+    if (read_cpu_raw_stats(&total, cores, counters->core_valid, &counters->core_count) != 0) {
+        pthread_mutex_unlock(&g_sample_mutex);
+        return -1;
+    }
+    pthread_mutex_unlock(&g_sample_mutex);
+    
+    /* /proc/stat 以 USER_HZ 为单位 */
+    long tck = sysconf(_SC_CLK_TCK);
+    if (tck <= 0) tck = 100;
+    cpu_times_from_raw(&total, (double)tck, &counters->total);
+    for (int i = 0; i < PERF_MAX_CORES; i++) {
+        if (counters->core_valid[i]) {
+            cpu_times_from_raw(&cores[i], (double)tck, &counters->cores[i]);
+        }
+    }
     return 0;
 }
 
+static int thread_usage_cmp(const void *a, const void *b) {
+    float ua = ((const ThreadCpuStats *)a)->usage_percent;
+    float ub = ((const ThreadCpuStats *)b)->usage_percent;
+    return (ua < ub) - (ua > ub);
+}
+
+int perf_get_thread_stats(ThreadCpuStats *threads, int max) {
+    if (!threads || max <= 0) {
+        return -1;
+    }
+    
+    int count = 0;
+    pthread_mutex_lock(&g_sample_mutex);
+    if (sample_threads() != 0) {
+        pthread_mutex_unlock(&g_sample_mutex);
+        return -1;
+    }
+    for (int i = 0; i < PERF_MAX_THREADS && count < max; i++) {
+        const ThreadSlot *slot = &g_threads[i];
+        if (!slot->tid || !slot->seen) continue;
+        threads[count].tid = slot->tid;
+        memcpy(threads[count].name, slot->name, sizeof(threads[count].name));
+        threads[count].usage_percent = slot->usage_percent;
+        threads[count].cpu_seconds = (double)slot->ticks / (double)g_clk_tck;
+        count++;
+    }
+    pthread_mutex_unlock(&g_sample_mutex);
+    
+    qsort(threads, (size_t)count, sizeof(threads[0]), thread_usage_cmp);
+    return count;
+}
+
+static int thread_seconds_cmp(const void *a, const void *b) {
+    double sa = ((const ThreadCpuStats *)a)->cpu_seconds;
+    double sb = ((const ThreadCpuStats *)b)->cpu_seconds;
+    return (sa < sb) - (sa > sb);
+}
+
+int perf_get_thread_counters(ThreadCpuStats *threads, int max) {
+    if (!threads || max <= 0) {
+        return -1;
+    }
+    
+    int count = 0;
+    pthread_mutex_lock(&g_sample_mutex);
+    if (task_dir_open() != 0) {
+        pthread_mutex_unlock(&g_sample_mutex);
+        return -1;
+    }
+    
+    /* 只读: 已跟踪的线程复用其 fd，新线程临时打开，不增删槽位也不改基准 */
+    rewinddir(g_task_dir);
+    struct dirent *de;
+    while (count < max && (de = readdir(g_task_dir)) != NULL) {
+        uint64_t tid;
+        const char *end = parse_u64(de->d_name, &tid);
+        if (!end || *end != '\0') continue;
+        
+        const ThreadSlot *slot = NULL;
+        for (int i = 0; i < PERF_MAX_THREADS; i++) {
+            if (g_threads[i].tid == (int)tid) {
+                slot = &g_threads[i];
+                break;
+            }
+        }
+        int fd = slot ? slot->fd : -1;
+        if (fd < 0) {
+            char path[64];
+            snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)tid);
+            fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) continue;
+        }
+        
+        char buf[512];
+        ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+        if (!slot || fd != slot->fd) close(fd);
+        if (n <= 0) continue;
+        buf[n] = '\0';
+        
+        ThreadCpuStats *t = &threads[count];
+        uint64_t ticks;
+        if (parse_task_stat(buf, t->name, sizeof(t->name), &ticks) != 0) continue;
+        t->tid = (int)tid;
+        t->usage_percent = slot ? slot->usage_percent : 0.0f;
+        t->cpu_seconds = (double)ticks / (double)g_clk_tck;
+        count++;
+    }
+    pthread_mutex_unlock(&g_sample_mutex);
+    
+    qsort(threads, (size_t)count, sizeof(threads[0]), thread_seconds_cmp);
+    return count;
+}
+
 int perf_get_mem_stats(MemStats *stats) {
     if (!stats) {
         return -1;
     }
     
-    FILE *fp = fopen("/proc/meminfo", "r");
-    if (!fp) {
+    /* 需要的三项都在开头几行，截断无妨 */
+    char buf[PROC_MEMINFO_BUF_SIZE];
+    pthread_mutex_lock(&g_sample_mutex);
+    int len = proc_file_read(&g_proc_meminfo, buf, sizeof(buf));
+    pthread_mutex_unlock(&g_sample_mutex);
+    if (len <= 0) {
         return -1;
     }
     
     memset(stats, 0, sizeof(*stats));
     
-    char line[256];
-    char key[64];
-    unsigned long long val; // 使用 unsigned long long 匹配 %llu
-    
-    while (fgets(line, sizeof(line), fp)) {
-        /* 使用更通用的解析方式: Key: Value kB */
-        /* 使用 %llu 确保 32位/64位兼容性 */
-        if (sscanf(line, "%63s %llu", key, &val) == 2) {
-            if (strcmp(key, "MemTotal:") == 0) {
-                stats->total_kb = (uint64_t)val;
-            } else if (strcmp(key, "MemFree:") == 0) {
-                stats->free_kb = (uint64_t)val;
-            } else if (strcmp(key, "MemAvailable:") == 0) {
-                stats->available_kb = (uint64_t)val;
+    /* Key:   Value kB */
+    static const struct {
+        const char *key;
+        size_t len;
+        size_t offset;
+    } keys[] = {
+        { "MemTotal:", 9, offsetof(MemStats, total_kb) },
+        { "MemFree:", 8, offsetof(MemStats, free_kb) },
+        { "MemAvailable:", 13, offsetof(MemStats, available_kb) },
+    };
+    int found = 0;
+    for (const char *line = buf; line && found < 3; line = next_line(line)) {
+        for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+            uint64_t val;
+            if (strncmp(line, keys[i].key, keys[i].len) == 0 &&
+                parse_u64(line + keys[i].len, &val)) {
+                *(uint64_t *)((char *)stats + keys[i].offset) = val;
+                found++;
+                break;
             }
         }
     }
-    fclose(fp);
     
     stats->used_kb = stats->total_kb - stats->available_kb;
     if (stats->total_kb > 0) {
@@ -293,46 +742,86 @@ int perf_get_temp_stats(TempStats *stats) {
         return -1;
     }
     
-    int temp_raw;
+    int temp_raw[2];
+    int ok[2];
     
-    /* CPU 温度 (thermal_zone0) */
-    if (read_int_file(THERMAL_ZONE_PATH, &temp_raw) == 0) {
-        stats->cpu_temp = (float)temp_raw / 1000.0f;  /* 毫摄氏度转摄氏度 */
-    } else {
-        stats->cpu_temp = -1.0f;
-    }
+    pthread_mutex_lock(&g_sample_mutex);
+    ok[0] = read_int_file(&g_thermal[0], &temp_raw[0]) == 0;
+    ok[1] = read_int_file(&g_thermal[1], &temp_raw[1]) == 0;
+    pthread_mutex_unlock(&g_sample_mutex);
     
+    /* CPU 温度 (thermal_zone0), 毫摄氏度转摄氏度 */
+    stats->cpu_temp = ok[0] ? (float)temp_raw[0] / 1000.0f : -1.0f;
     /* GPU 温度 (thermal_zone1, 可能不存在) */
-    if (read_int_file(THERMAL_ZONE1_PATH, &temp_raw) == 0) {
-        stats->gpu_temp = (float)temp_raw / 1000.0f;
-    } else {
-        stats->gpu_temp = -1.0f;
-    }
+    stats->gpu_temp = ok[1] ? (float)temp_raw[1] / 1000.0f : -1.0f;
     
     return 0;
 }
 
-int perf_get_report(PerfReport *report) {
-    if (!report) {
-        return -1;
-    }
-    
-    memset(report, 0, sizeof(*report));
-    
-    perf_get_cpu_stats(&report->cpu);
+/**
+ * @brief 填充报告中 CPU 以外的部分
+ */
+static void report_fill_common(PerfReport *report) {
     perf_get_mem_stats(&report->mem);
     perf_get_temp_stats(&report->temp);
     
     /* 视频统计 */
     pthread_mutex_lock(&g_video_stats_mutex);
-    report->video = g_video_stats;
+    memcpy(report->video, g_video_stats, sizeof(report->video));
+    memcpy(report->pool, g_pool_stats, sizeof(report->pool));
+    memcpy(report->abr, g_abr_stats, sizeof(report->abr));
+    memcpy(report->pipeline, g_pipeline_stats, sizeof(report->pipeline));
     pthread_mutex_unlock(&g_video_stats_mutex);
     
+    /* 帧级延迟跟踪 (直方图无锁, 直接汇总) */
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        report->trace_valid[i] = frame_trace_get_stats(i, &report->trace[i]) == 0;
+    }
+    
     /* 系统运行时间 - 使用 sysinfo 更可靠 */
     struct sysinfo info;
     if (sysinfo(&info) == 0) {
         report->uptime_sec = (uint64_t)info.uptime;
     }
+}
+
+int perf_get_report(PerfReport *report) {
+    if (!report) {
+        return -1;
+    }
+    
+    memset(report, 0, sizeof(*report));
+    
+    perf_get_cpu_stats(&report->cpu);
+    int threads = perf_get_thread_stats(report->threads, PERF_MAX_THREADS);
+    report->thread_count = threads > 0 ? threads : 0;
+    report_fill_common(report);
+    
+    return 0;
+}
+
+int perf_peek_report(PerfReport *report) {
+    if (!report) {
+        return -1;
+    }
+    
+    memset(report, 0, sizeof(*report));
+    
+    pthread_mutex_lock(&g_sample_mutex);
+    report->cpu = g_cpu_usage;
+    for (int i = 0; i < PERF_MAX_THREADS; i++) {
+        const ThreadSlot *slot = &g_threads[i];
+        if (!slot->tid || !slot->seen) continue;
+        ThreadCpuStats *t = &report->threads[report->thread_count++];
+        t->tid = slot->tid;
+        memcpy(t->name, slot->name, sizeof(t->name));
+        t->usage_percent = slot->usage_percent;
+        t->cpu_seconds = (double)slot->ticks / (double)g_clk_tck;
+    }
+    pthread_mutex_unlock(&g_sample_mutex);
+    
+    qsort(report->threads, (size_t)report->thread_count, sizeof(report->threads[0]), thread_usage_cmp);
+    report_fill_common(report);
     
     return 0;
 }
@@ -345,7 +834,31 @@ void perf_print_report(void) {
     }
     
     LOG_INFO("==== Performance Report ====\n");
-    LOG_INFO("CPU: %.1f%% (%d cores)\n", report.cpu.usage_percent, report.cpu.core_count);
+    char core_str[128] = {0};
+    int core_len = 0;
+    for (int i = 0; i < PERF_MAX_CORES && i < report.cpu.core_count; i++) {
+        if (report.cpu.core_usage[i] < 0 || core_len >= (int)sizeof(core_str)) continue;
+        core_len += snprintf(core_str + core_len, sizeof(core_str) - core_len, "%scpu%d=%.0f%%",
+                             core_len ? ", " : " [", i, report.cpu.core_usage[i]);
+    }
+    if (core_len > 0 && core_len < (int)sizeof(core_str)) {
+        snprintf(core_str + core_len, sizeof(core_str) - core_len, "]");
+    }
+    LOG_INFO("CPU: %.1f%% (%d cores)%s\n", report.cpu.usage_percent, report.cpu.core_count, core_str);
+    
+    /* 占用最高的几个线程 (按占用降序) */
+    char thread_str[256] = {0};
+    int thread_len = 0;
+    for (int i = 0; i < report.thread_count && i < PERF_REPORT_TOP_THREADS; i++) {
+        const ThreadCpuStats *t = &report.threads[i];
+        if (t->usage_percent < 0.05f || thread_len >= (int)sizeof(thread_str)) break;
+        thread_len += snprintf(thread_str + thread_len, sizeof(thread_str) - thread_len,
+                               "%s%s(%d)=%.1f%%", thread_len ? ", " : "", t->name, t->tid,
+                               t->usage_percent);
+    }
+    if (thread_len > 0) {
+        LOG_INFO("THREADS: %s\n", thread_str);
+    }
     /* 使用 %llu 打印 uint64_t，强制转换为 unsigned long long 避免警告 */
     LOG_INFO("MEM: %.1f%% (%llu/%llu MB used)\n", 
              report.mem.usage_percent, 
@@ -361,9 +874,81 @@ void perf_print_report(void) {
         LOG_INFO("%s\n", temp_str);
     }
     
-    if (report.video.venc_fps > 0) {
-        LOG_INFO("VIDEO: VI=%.1ffps, VENC=%.1ffps, Bitrate=%uKbps\n",
-                 report.video.vi_fps, report.video.venc_fps, report.video.venc_bitrate_kbps);
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        const VideoStats *video = &report.video[i];
+        if (!video->valid) continue;
+        char vi_str[64];
+        char qp_str[32];
+        if (video->vi_fps >= 0) {
+            snprintf(vi_str, sizeof(vi_str), "VI=%.1ffps (lost=%u, vb_fail=%u)",
+                     video->vi_fps, video->vi_lost, video->vi_vb_fail);
+        } else {
+            snprintf(vi_str, sizeof(vi_str), "VI=n/a");
+        }
+        if (video->qp_avg >= 0) {
+            snprintf(qp_str, sizeof(qp_str), "%d [%d-%d]", video->qp_avg, video->qp_min, video->qp_max);
+        } else {
+            snprintf(qp_str, sizeof(qp_str), "n/a");
+        }
+        LOG_INFO("VIDEO[%d]: %s, VENC=%.1ffps, Bitrate=%uKbps, I/P=%u/%u, QP=%s\n",
+                 i, vi_str, video->venc_fps, video->venc_bitrate_kbps,
+                 video->i_frames, video->p_frames, qp_str);
+        LOG_INFO("VIDEO[%d]   size avg=%uB p50=%uB p95=%uB max=%uB, venc_pending=%d, queue=%d/%d\n",
+                 i, video->size_avg, video->size_p50, video->size_p95, video->size_max,
+                 video->venc_pending, video->queue_depth, video->queue_capacity);
+    }
+    
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        const PoolStats *pool = &report.pool[i];
+        if (!pool->valid) continue;
+        LOG_INFO("POOL[%d]: hit=%u, miss=%u, in_use=%u/%u, high_water=%u, budget=%uKB\n",
+                 i, pool->hits, pool->misses, pool->in_use, pool->capacity,
+                 pool->high_water, pool->budget_kb);
+    }
+    
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        const AbrStats *abr = &report.abr[i];
+        if (!abr->valid) continue;
+        LOG_INFO("ABR[%d]: %d/%dKbps, %d/%dfps, backlog=%d, write=%uus, drops=%u, "
+                 "down=%u, up=%u, last=%s\n",
+                 i, abr->target_kbps, abr->max_kbps, abr->target_fps, abr->max_fps,
+                 abr->backlog, abr->write_us, abr->drops, abr->steps_down, abr->steps_up,
+                 abr->last_reason ? abr->last_reason : "none");
+    }
+    
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        const PipelineStats *pipe = &report.pipeline[i];
+        if (!pipe->valid) continue;
+        LOG_INFO("PIPE[%d]: captured=%u, dropped=%u, sent=%u\n",
+                 i, pipe->captured, pipe->dropped, pipe->sent);
+        for (int j = 0; j < pipe->stage_count; j++) {
+            const StageStats *stage = &pipe->stages[j];
+            LOG_INFO("PIPE[%d]   %-12s n=%u avg=%uus p50=%uus p95=%uus p99=%uus max=%uus drop=%u\n",
+                     i, stage->name, stage->latency.count, stage->latency.avg_us,
+                     stage->latency.p50_us, stage->latency.p95_us, stage->latency.p99_us,
+                     stage->latency.max_us, stage->dropped);
+        }
+    }
+    
+    for (int i = 0; i < PERF_MAX_STREAMS; i++) {
+        if (!report.trace_valid[i]) continue;
+        const FrameTraceStats *trace = &report.trace[i];
+        LOG_INFO("TRACE[%d]: frames=%u\n", i, trace->stage[FRAME_TRACE_ENCODE].count);
+        for (int j = 0; j < FRAME_TRACE_POINTS; j++) {
+            const LatencyHistSummary *lat = &trace->stage[j];
+            if (lat->count == 0) continue;
+            LOG_INFO("TRACE[%d]   %-12s n=%u avg=%uus p50=%uus p95=%uus p99=%uus max=%uus\n",
+                     i, frame_trace_point_name((FrameTracePoint)j), lat->count, lat->avg_us,
+                     lat->p50_us, lat->p95_us, lat->p99_us, lat->max_us);
+        }
+        /* 端到端: 传感器时间戳 -> 写入网络返回 */
+        for (int j = 0; j < FRAME_TRACE_POINTS; j++) {
+            const LatencyHistSummary *lat = &trace->e2e[j];
+            if (lat->count == 0) continue;
+            LOG_INFO("TRACE[%d]   %-12s n=%u avg=%uus p50=%uus p95=%uus p99=%uus max=%uus (glass-to-wire)\n",
+                     i, frame_trace_point_name((FrameTracePoint)j), lat->count, lat->avg_us,
+                     lat->p50_us, lat->p95_us, lat->p99_us, lat->max_us);
+        }
     }
     
     /* 使用 %llu 打印 uptime */
@@ -374,10 +959,46 @@ void perf_print_report(void) {
     LOG_INFO("============================\n");
 }
 
-void perf_update_video_stats(float vi_fps, float venc_fps, uint32_t bitrate_kbps) {
+void perf_update_video_stats(int stream_id, const VideoStats *stats) {
+    if (!stats || stream_id < 0 || stream_id >= PERF_MAX_STREAMS) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_video_stats_mutex);
+    g_video_stats[stream_id] = *stats;
+    g_video_stats[stream_id].valid = 1;
+    pthread_mutex_unlock(&g_video_stats_mutex);
+}
+
+void perf_update_pool_stats(int stream_id, const PoolStats *stats) {
+    if (!stats || stream_id < 0 || stream_id >= PERF_MAX_STREAMS) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_video_stats_mutex);
+    g_pool_stats[stream_id] = *stats;
+    g_pool_stats[stream_id].valid = 1;
+    pthread_mutex_unlock(&g_video_stats_mutex);
+}
+
+void perf_update_abr_stats(int stream_id, const AbrStats *stats) {
+    if (!stats || stream_id < 0 || stream_id >= PERF_MAX_STREAMS) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_video_stats_mutex);
+    g_abr_stats[stream_id] = *stats;
+    g_abr_stats[stream_id].valid = 1;
+    pthread_mutex_unlock(&g_video_stats_mutex);
+}
+
+void perf_update_pipeline_stats(int stream_id, const PipelineStats *stats) {
+    if (!stats || stream_id < 0 || stream_id >= PERF_MAX_STREAMS) {
+        return;
+    }
+    
     pthread_mutex_lock(&g_video_stats_mutex);
-    g_video_stats.vi_fps = vi_fps;
-    g_video_stats.venc_fps = venc_fps;
-    g_video_stats.venc_bitrate_kbps = bitrate_kbps;
+    g_pipeline_stats[stream_id] = *stats;
+    g_pipeline_stats[stream_id].valid = 1;
     pthread_mutex_unlock(&g_video_stats_mutex);
 }
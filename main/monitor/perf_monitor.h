@@ -3,11 +3,15 @@
  * @brief 性能监控模块
  * 
  * 该模块提供系统资源和硬件性能的实时监控功能：
- * - CPU 使用率
+ * - CPU 使用率 (总体、各核、各线程)
  * - 内存使用率
  * - 芯片温度
- * - ISP 帧率
- * - VENC 编码帧率与码率
+ * - 各路码流的 VI 实际帧率与丢帧
+ * - 各路码流的编码帧率、码率、QP、帧大小分布、I/P 帧比例与队列占用
+ * - 码流缓冲池命中率与水位
+ * - 自适应码率控制决策
+ * - 非 Bind 模式各处理阶段的延迟分布
+ * - 编码码流从传感器时间戳到网络发送的各阶段延迟 (见 frame_trace.h)
  * 
  * 可选择后台线程持续监控并定期打印或手动查询。
  */
@@ -17,6 +21,9 @@
 
 #include <stdint.h>
 
+#include "latency_hist.h"
+#include "frame_trace.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -25,14 +32,61 @@ extern "C" {
  *                              数据结构
  * ========================================================================= */
 
+/** @brief 支持分路统计的最大码流数量 */
+#define PERF_MAX_STREAMS        4
+
+/** @brief 每路码流上报的最大阶段数量 */
+#define PERF_MAX_STAGES         12
+
+/** @brief 分核统计的最大 CPU 核心数 */
+#define PERF_MAX_CORES          8
+
+/** @brief 分线程统计的最大线程数 */
+#define PERF_MAX_THREADS        64
+
 /**
  * @brief CPU 统计信息
  */
 typedef struct {
     float usage_percent;        /**< 总体 CPU 使用率 (0-100%) */
     int core_count;             /**< CPU 核心数 */
+    float core_usage[PERF_MAX_CORES]; /**< 各核使用率 (0-100%)，-1 表示离线或超出统计范围 */
 } CpuStats;
 
+/**
+ * @brief 各模式累计 CPU 时间 (秒, 来自 /proc/stat)
+ */
+typedef struct {
+    double user;
+    double nice;
+    double system;
+    double idle;
+    double iowait;
+    double irq;
+    double softirq;
+    double steal;
+} CpuTimes;
+
+/**
+ * @brief CPU 累计计数 (开机以来，读取不影响使用率的采样基准)
+ */
+typedef struct {
+    int core_count;             /**< CPU 核心数 */
+    CpuTimes total;             /**< 全部核心合计 */
+    CpuTimes cores[PERF_MAX_CORES]; /**< 各核 */
+    int core_valid[PERF_MAX_CORES]; /**< 该核是否在线 */
+} CpuCounters;
+
+/**
+ * @brief 单个线程的 CPU 统计 (来自 /proc/self/task/<tid>/stat)
+ */
+typedef struct {
+    int tid;                    /**< 线程 ID */
+    char name[16];              /**< 线程名 (prctl PR_SET_NAME 设置) */
+    float usage_percent;        /**< 上次采样以来的 CPU 占用 (以单核为 100%，与 top -H 一致) */
+    double cpu_seconds;         /**< 线程创建以来累计 CPU 时间 (utime + stime, 秒) */
+} ThreadCpuStats;
+
 /**
  * @brief 内存统计信息
  */
@@ -53,14 +107,80 @@ typedef struct {
 } TempStats;
 
 /**
- * @brief 视频处理性能统计
+ * @brief 视频处理性能统计 (每路码流一个，帧率/码率/QP/帧类型按上报周期统计)
  */
 typedef struct {
-    float vi_fps;               /**< VI 采集帧率 */
-    float venc_fps;             /**< VENC 编码帧率 */
-    uint32_t venc_bitrate_kbps; /**< VENC 实际码率 (Kbps) */
+    int valid;                  /**< 是否已上报 */
+    float vi_fps;               /**< VI 通道实际帧率 (RK_MPI_VI_QueryChnStatus, 不可用时为 -1) */
+    uint32_t vi_lost;           /**< VI 累计丢帧 (输入 + 输出) */
+    uint32_t vi_vb_fail;        /**< VI 累计取缓冲失败次数 */
+    float venc_fps;             /**< 编码输出帧率 */
+    uint32_t venc_bitrate_kbps; /**< 实际码率 (Kbps) */
+    uint32_t i_frames;          /**< I 帧数 */
+    uint32_t p_frames;          /**< P 帧数 */
+    int qp_avg;                 /**< 平均 QP (编码器未提供时为 -1) */
+    int qp_min;                 /**< 最小 QP */
+    int qp_max;                 /**< 最大 QP */
+    uint32_t size_avg;          /**< 帧大小平均值 (字节, 自启动以来) */
+    uint32_t size_p50;          /**< 帧大小 50 分位 */
+    uint32_t size_p95;          /**< 帧大小 95 分位 */
+    uint32_t size_max;          /**< 帧大小最大值 */
+    int venc_pending;           /**< VENC 内待取的码流帧数 (软件编码为 0) */
+    int queue_depth;            /**< 码流队列/广播环中最慢输出的未读帧数 */
+    int queue_capacity;         /**< 码流队列/广播环容量 */
 } VideoStats;
 
+/**
+ * @brief 码流缓冲池统计 (每路码流一个)
+ */
+typedef struct {
+    int valid;                  /**< 是否已上报 */
+    uint32_t hits;              /**< 池内分配次数 */
+    uint32_t misses;            /**< 回退 malloc 次数 */
+    uint32_t in_use;            /**< 当前占用块数 */
+    uint32_t high_water;        /**< 占用块数峰值 */
+    uint32_t capacity;          /**< 块总数 */
+    uint32_t budget_kb;         /**< 预分配内存 (KB) */
+} PoolStats;
+
+/**
+ * @brief 自适应码率控制统计 (每路码流一个)
+ */
+typedef struct {
+    int valid;                  /**< 是否已上报 */
+    int target_kbps;            /**< 当前目标码率 (Kbps) */
+    int target_fps;             /**< 当前目标帧率 */
+    int max_kbps;               /**< 配置码率 (Kbps) */
+    int max_fps;                /**< 配置帧率 */
+    int backlog;                /**< 受控输出的最大积压帧数 */
+    uint32_t write_us;          /**< 受控输出的单帧写入耗时 (微秒) */
+    uint32_t drops;             /**< 受控输出的累计丢帧数 */
+    uint32_t steps_down;        /**< 下调次数 */
+    uint32_t steps_up;          /**< 上调次数 */
+    const char *last_reason;    /**< 最近一次调整的原因 */
+} AbrStats;
+
+/**
+ * @brief 单个处理阶段的延迟
+ */
+typedef struct {
+    char name[16];              /**< 阶段名称 */
+    LatencyHistSummary latency; /**< 延迟分布 (自启动以来) */
+    uint32_t dropped;           /**< 本阶段丢弃的帧数 */
+} StageStats;
+
+/**
+ * @brief 非 Bind 模式采集流水线统计 (每路码流一个)
+ */
+typedef struct {
+    int valid;                  /**< 是否已上报 */
+    uint32_t captured;          /**< 采集帧数 */
+    uint32_t dropped;           /**< 队列满或缓冲不足丢弃的帧数 */
+    uint32_t sent;              /**< 送入 VENC 的帧数 */
+    int stage_count;            /**< 阶段数量 */
+    StageStats stages[PERF_MAX_STAGES]; /**< 各阶段延迟 */
+} PipelineStats;
+
 /**
  * @brief 综合性能报告
  */
@@ -68,7 +188,14 @@ typedef struct {
     CpuStats cpu;
     MemStats mem;
     TempStats temp;
-    VideoStats video;
+    VideoStats video[PERF_MAX_STREAMS]; /**< 各路码流视频统计 */
+    PoolStats pool[PERF_MAX_STREAMS]; /**< 各路码流缓冲池统计 */
+    AbrStats abr[PERF_MAX_STREAMS];   /**< 各路码流自适应码率统计 */
+    PipelineStats pipeline[PERF_MAX_STREAMS]; /**< 各路码流采集流水线统计 */
+    FrameTraceStats trace[PERF_MAX_STREAMS];  /**< 各路码流帧级延迟跟踪 */
+    int trace_valid[PERF_MAX_STREAMS];        /**< 该路是否有跟踪数据 */
+    ThreadCpuStats threads[PERF_MAX_THREADS]; /**< 本进程各线程 CPU 占用 (按占用降序) */
+    int thread_count;                         /**< threads 有效个数 */
     uint64_t uptime_sec;        /**< 系统运行时间 (秒) */
 } PerfReport;
 
@@ -111,6 +238,39 @@ void perf_monitor_stop(void);
  */
 int perf_get_cpu_stats(CpuStats *stats);
 
+/**
+ * @brief 获取本进程各线程的 CPU 占用 (自上次调用以来)
+ * 
+ * 首次看到的线程本次占用为 0。
+ * 
+ * @param threads 输出数组，按占用降序
+ * @param max 数组容量
+ * @return 输出的线程数，-1 失败
+ */
+int perf_get_thread_stats(ThreadCpuStats *threads, int max);
+
+/**
+ * @brief 获取 CPU 累计计数 (总体与各核，按模式)
+ *
+ * 只读取 /proc/stat，不更新 perf_get_cpu_stats 的差值基准，可与监控线程并发调用。
+ *
+ * @param counters 输出累计计数
+ * @return 0 成功
+ */
+int perf_get_cpu_counters(CpuCounters *counters);
+
+/**
+ * @brief 获取本进程各线程的累计 CPU 时间
+ *
+ * 不更新 perf_get_thread_stats 的差值基准；usage_percent 为监控线程上次采样的结果
+ * (尚未采样过的线程为 0)。
+ *
+ * @param threads 输出数组，按累计 CPU 时间降序
+ * @param max 数组容量
+ * @return 输出的线程数，-1 失败
+ */
+int perf_get_thread_counters(ThreadCpuStats *threads, int max);
+
 /**
  * @brief 获取当前内存统计
  * 
@@ -135,6 +295,17 @@ int perf_get_temp_stats(TempStats *stats);
  */
 int perf_get_report(PerfReport *report);
 
+/**
+ * @brief 获取综合性能报告但不重新采样 CPU
+ *
+ * cpu 与 threads 为最近一次 perf_get_report (监控线程) 的结果，其余字段为当前值。
+ * 不改变任何采样基准，供指标导出等旁路读取使用。
+ *
+ * @param report 输出完整性能报告
+ * @return 0 成功
+ */
+int perf_peek_report(PerfReport *report);
+
 /**
  * @brief 打印性能报告到日志
  */
@@ -143,11 +314,34 @@ void perf_print_report(void);
 /**
  * @brief 更新视频性能统计 (由 video 模块调用)
  * 
- * @param vi_fps 当前 VI 帧率
- * @param venc_fps 当前 VENC 帧率
- * @param bitrate_kbps 当前码率 (Kbps)
+ * @param stream_id 码流 ID (0 ~ PERF_MAX_STREAMS-1)
+ * @param stats 视频统计
+ */
+void perf_update_video_stats(int stream_id, const VideoStats *stats);
+
+/**
+ * @brief 更新码流缓冲池统计 (由 video 模块调用)
+ * 
+ * @param stream_id 码流 ID (0 ~ PERF_MAX_STREAMS-1)
+ * @param stats 缓冲池统计
+ */
+void perf_update_pool_stats(int stream_id, const PoolStats *stats);
+
+/**
+ * @brief 更新自适应码率控制统计 (由 video 模块调用)
+ * 
+ * @param stream_id 码流 ID (0 ~ PERF_MAX_STREAMS-1)
+ * @param stats 控制统计
+ */
+void perf_update_abr_stats(int stream_id, const AbrStats *stats);
+
+/**
+ * @brief 更新非 Bind 模式采集流水线统计 (由 video 模块调用)
+ * 
+ * @param stream_id 码流 ID (0 ~ PERF_MAX_STREAMS-1)
+ * @param stats 流水线统计
  */
-void perf_update_video_stats(float vi_fps, float venc_fps, uint32_t bitrate_kbps);
+void perf_update_pipeline_stats(int stream_id, const PipelineStats *stats);
 
 #ifdef __cplusplus
 }
@@ -7,7 +7,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 /**
  * @brief 计算绝对超时时间点
@@ -25,13 +29,403 @@ static void calc_abstime(struct timespec *ts, int timeout_ms) {
     }
 }
 
+/* =========================================================================
+ *                              溢出策略
+ * ========================================================================= */
+
+static void drop_count(uint32_t *counter, uint32_t n) {
+    __atomic_add_fetch(counter, n, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 当前丢帧策略对应的计数器
+ */
+static uint32_t *policy_counter(FrameQueue *queue) {
+    return queue->overflow == FRAME_QUEUE_OVERFLOW_DROP_GOP ? &queue->drops.gop_dropped
+                                                           : &queue->drops.key_wait_dropped;
+}
+
+/**
+ * @brief 按自由递增位置取槽位 (两种模式的取模方式不同)
+ */
+static FrameData *slot_at(FrameQueue *queue, uint32_t pos) {
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) {
+        return &queue->buffer[pos & queue->mask];
+    }
+    return &queue->buffer[pos % (uint32_t)queue->capacity];
+}
+
+/**
+ * @brief 释放被丢弃的已入队帧 (只读槽位, 槽位内容保持不变)
+ */
+static void release_slot(FrameQueue *queue, uint32_t pos) {
+    FrameData tmp = *slot_at(queue, pos);
+    frame_data_release(&tmp);
+}
+
+/**
+ * @brief 计算最旧 GOP 的帧数
+ * 
+ * @param head 队头位置
+ * @param count 队列中的帧数
+ * @return 从队头到下一个关键帧之前的帧数；队列中没有后续关键帧时返回 count
+ */
+static uint32_t oldest_gop_length(FrameQueue *queue, uint32_t head, uint32_t count) {
+    for (uint32_t i = 1; i < count; i++) {
+        if (slot_at(queue, head + i)->is_keyframe) return i;
+    }
+    return count;
+}
+
+/**
+ * @brief 等待关键帧期间过滤新帧 (生产者端)
+ * 
+ * @return 1 丢弃该帧，0 可以入队
+ */
+static int overflow_skip_frame(FrameQueue *queue, const FrameData *frame) {
+    if (!queue->wait_keyframe) return 0;
+    
+    if (frame->is_keyframe) {
+        queue->wait_keyframe = 0;
+        return 0;
+    }
+    drop_count(policy_counter(queue), 1);
+    return 1;
+}
+
+/**
+ * @brief 整组丢弃后判断新帧是否还能解码
+ * 
+ * 队列中的帧被全部丢弃时，新帧所属的 GOP 已不完整，只能从下一个关键帧开始。
+ * 
+ * @param flushed 是否丢弃了队列中的全部帧
+ * @return 0 可以入队，-3 丢弃新帧
+ */
+static int overflow_after_gop_drop(FrameQueue *queue, const FrameData *frame, int flushed) {
+    if (flushed && !frame->is_keyframe) {
+        queue->wait_keyframe = 1;
+        drop_count(&queue->drops.gop_dropped, 1);
+        return -3;
+    }
+    return 0;
+}
+
+/**
+ * @brief 互斥锁模式下按溢出策略为新帧腾出空间 (持锁调用)
+ * 
+ * @return 0 可以入队，-3 丢弃新帧
+ */
+static int mutex_push_overflow(FrameQueue *queue, const FrameData *frame) {
+    if (overflow_skip_frame(queue, frame)) return -3;
+    if (queue->count < queue->capacity) return 0;
+    
+    drop_count(&queue->drops.overflows, 1);
+    
+    if (queue->overflow == FRAME_QUEUE_OVERFLOW_DROP_UNTIL_KEY) {
+        queue->wait_keyframe = 1;
+        drop_count(&queue->drops.key_wait_dropped, 1);
+        return -3;
+    }
+    
+    // 丢弃最旧的整个 GOP, 剩余帧从关键帧开始, 仍然可以解码
+    uint32_t n = oldest_gop_length(queue, (uint32_t)queue->head, (uint32_t)queue->count);
+    int flushed = (n == (uint32_t)queue->count);
+    for (uint32_t i = 0; i < n; i++) {
+        release_slot(queue, (uint32_t)queue->head + i);
+    }
+    queue->head = (int)(((uint32_t)queue->head + n) % (uint32_t)queue->capacity);
+    queue->count -= (int)n;
+    drop_count(&queue->drops.gop_dropped, n);
+    pthread_cond_broadcast(&queue->not_full);
+    
+    return overflow_after_gop_drop(queue, frame, flushed);
+}
+
+/* =========================================================================
+ *                              SPSC 无锁实现
+ * ========================================================================= */
+
+/**
+ * @brief futex 等待 *addr 不再等于 expected
+ * 
+ * @param timeout_ms 相对超时 (毫秒)，-1 表示无限等待
+ */
+static void futex_wait(uint32_t *addr, uint32_t expected, int timeout_ms) {
+    struct timespec ts;
+    struct timespec *pts = NULL;
+    
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+        pts = &ts;
+    }
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, pts, NULL, 0);
+}
+
+static void futex_wake(uint32_t *addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+static int64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief 唤醒可能在等待的对端
+ * 
+ * 必须在发布新的 index 之后调用。与等待方的 "置 waiting -> 复查 index" 构成
+ * Dekker 式配对 (均为 SEQ_CST)，保证不会丢失唤醒。
+ */
+static void spsc_notify(FrameQueueSpscEnd *peer) {
+    if (__atomic_load_n(&peer->waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&peer->wake_seq, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&peer->wake_seq, 1);
+    }
+}
+
+/**
+ * @brief 阻塞等待直到 ready(queue) 为真、队列关闭或超时
+ * 
+ * @param self 本端 (waiting/wake_seq 属于本端)
+ * @param ready 就绪判断函数
+ * @return 0 就绪，-1 超时，-2 已关闭
+ */
+static int spsc_wait(FrameQueue *queue, FrameQueueSpscEnd *self,
+                     int (*ready)(FrameQueue *queue), int timeout_ms) {
+    int64_t deadline = (timeout_ms > 0) ? monotonic_ms() + timeout_ms : 0;
+    
+    for (;;) {
+        if (ready(queue)) return 0;
+        if (__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) return -2;
+        if (timeout_ms == 0) return -1;
+        
+        int remain = -1;
+        if (timeout_ms > 0) {
+            int64_t left = deadline - monotonic_ms();
+            if (left <= 0) return -1;
+            remain = (int)left;
+        }
+        
+        uint32_t seq = __atomic_load_n(&self->wake_seq, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&self->waiting, 1, __ATOMIC_SEQ_CST);
+        
+        // 置位后复查, 防止对端在置位前已发布数据而错过唤醒
+        if (!ready(queue) && !__atomic_load_n(&queue->closed, __ATOMIC_SEQ_CST)) {
+            futex_wait(&self->wake_seq, seq, remain);
+        }
+        __atomic_store_n(&self->waiting, 0, __ATOMIC_RELAXED);
+    }
+}
+
+static int spsc_can_push(FrameQueue *queue) {
+    FrameQueueSpscEnd *prod = &queue->prod;
+    
+    if (prod->index - prod->peer_cache <= queue->mask) return 1;
+    prod->peer_cache = __atomic_load_n(&queue->cons.index, __ATOMIC_SEQ_CST);
+    return prod->index - prod->peer_cache <= queue->mask;
+}
+
+static int spsc_can_pop(FrameQueue *queue) {
+    FrameQueueSpscEnd *cons = &queue->cons;
+    // DROP_GOP 策略下生产者也会推进读位置, 可能越过本地缓存的写位置
+    uint32_t index = __atomic_load_n(&cons->index, __ATOMIC_RELAXED);
+    
+    if ((int32_t)(cons->peer_cache - index) > 0) return 1;
+    cons->peer_cache = __atomic_load_n(&queue->prod.index, __ATOMIC_SEQ_CST);
+    return (int32_t)(cons->peer_cache - index) > 0;
+}
+
+/**
+ * @brief SPSC 模式下按溢出策略为新帧腾出空间 (生产者端)
+ * 
+ * DROP_GOP 通过 CAS 与消费者竞争推进读位置，抢到的帧由生产者释放；
+ * 消费者同样以 CAS 取帧，因此同一帧不会被双方同时持有。
+ * 
+ * @return 0 可以入队，-3 丢弃新帧
+ */
+static int spsc_push_overflow(FrameQueue *queue, const FrameData *frame) {
+    if (overflow_skip_frame(queue, frame)) return -3;
+    if (spsc_can_push(queue)) return 0;
+    
+    drop_count(&queue->drops.overflows, 1);
+    
+    if (queue->overflow == FRAME_QUEUE_OVERFLOW_DROP_UNTIL_KEY) {
+        queue->wait_keyframe = 1;
+        drop_count(&queue->drops.key_wait_dropped, 1);
+        return -3;
+    }
+    
+    uint32_t tail = queue->prod.index;
+    uint32_t head = __atomic_load_n(&queue->cons.index, __ATOMIC_ACQUIRE);
+    uint32_t n;
+    do {
+        n = oldest_gop_length(queue, head, tail - head);
+        if (n == 0) return 0;  // 消费者已取空队列
+    } while (!__atomic_compare_exchange_n(&queue->cons.index, &head, head + n, 0,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE));
+    
+    for (uint32_t i = 0; i < n; i++) {
+        release_slot(queue, head + i);
+    }
+    queue->prod.peer_cache = head + n;
+    drop_count(&queue->drops.gop_dropped, n);
+    
+    return overflow_after_gop_drop(queue, frame, n == tail - head);
+}
+
+static int spsc_push(FrameQueue *queue, const FrameData *frame, int timeout_ms) {
+    if (__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) return -2;
+    
+    int resumed = queue->wait_keyframe;
+    int ret;
+    if (queue->overflow == FRAME_QUEUE_OVERFLOW_BLOCK) {
+        if (!spsc_can_push(queue)) drop_count(&queue->drops.overflows, 1);
+        ret = spsc_wait(queue, &queue->prod, spsc_can_push, timeout_ms);
+        if (ret == -1) drop_count(&queue->drops.block_timeouts, 1);
+    } else {
+        ret = spsc_push_overflow(queue, frame);
+    }
+    if (ret != 0) return ret;
+    
+    uint32_t index = queue->prod.index;
+    memcpy(&queue->buffer[index & queue->mask], frame, sizeof(FrameData));
+    if (resumed) {
+        queue->buffer[index & queue->mask].flags |= FRAME_FLAG_START;
+    }
+    __atomic_store_n(&queue->prod.index, index + 1, __ATOMIC_SEQ_CST);
+    
+    spsc_notify(&queue->cons);
+    return 0;
+}
+
+static int spsc_pop(FrameQueue *queue, FrameData *frame, int timeout_ms) {
+    for (;;) {
+        int ret = spsc_wait(queue, &queue->cons, spsc_can_pop, timeout_ms);
+        if (ret == -2) {
+            // 关闭后仍需取完剩余数据
+            if (!spsc_can_pop(queue)) return -2;
+        } else if (ret != 0) {
+            return ret;
+        }
+        
+        uint32_t index = __atomic_load_n(&queue->cons.index, __ATOMIC_ACQUIRE);
+        if ((int32_t)(queue->cons.peer_cache - index) <= 0) continue;
+        memcpy(frame, &queue->buffer[index & queue->mask], sizeof(FrameData));
+        
+        if (queue->overflow != FRAME_QUEUE_OVERFLOW_DROP_GOP) {
+            __atomic_store_n(&queue->cons.index, index + 1, __ATOMIC_SEQ_CST);
+            break;
+        }
+        // 抢占失败说明该帧已被生产者按 GOP 丢弃, 重新读取
+        if (__atomic_compare_exchange_n(&queue->cons.index, &index, index + 1, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    
+    spsc_notify(&queue->prod);
+    return 0;
+}
+
+static void spsc_close(FrameQueue *queue) {
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_SEQ_CST);
+    
+    __atomic_add_fetch(&queue->prod.wake_seq, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&queue->cons.wake_seq, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&queue->prod.wake_seq, 1);
+    futex_wake(&queue->cons.wake_seq, 1);
+}
+
+static int spsc_size(FrameQueue *queue) {
+    uint32_t tail = __atomic_load_n(&queue->prod.index, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&queue->cons.index, __ATOMIC_ACQUIRE);
+    return (int)(tail - head);
+}
+
+/* =========================================================================
+ *                              帧引用
+ * ========================================================================= */
+
+void frame_ref_init(FrameRef *ref, void (*release)(FrameRef *ref), void *opaque) {
+    if (!ref) return;
+    
+    ref->release = release;
+    ref->opaque = opaque;
+    __atomic_store_n(&ref->refcount, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 堆分配帧的引用归零回调 (FrameRef 位于内存块起始处)
+ */
+static void heap_frame_release(FrameRef *ref) {
+    free(ref);
+}
+
+int frame_data_alloc(FrameData *frame, size_t size) {
+    if (!frame) return -1;
+    
+    // 数据区按 8 字节对齐放在 FrameRef 之后
+    size_t header = (sizeof(FrameRef) + 7) & ~(size_t)7;
+    uint8_t *block = (uint8_t *)malloc(header + size);
+    if (!block) return -1;
+    
+    FrameRef *ref = (FrameRef *)block;
+    frame_ref_init(ref, heap_frame_release, NULL);
+    frame->data = block + header;
+    frame->extra = ref;
+    return 0;
+}
+
+void frame_data_retain(FrameData *frame) {
+    if (!frame || !frame->extra) return;
+    
+    FrameRef *ref = (FrameRef *)frame->extra;
+    __atomic_add_fetch(&ref->refcount, 1, __ATOMIC_RELAXED);
+}
+
+void frame_data_release(FrameData *frame) {
+    if (!frame) return;
+    
+    if (frame->extra) {
+        FrameRef *ref = (FrameRef *)frame->extra;
+        // 最后一个引用负责归还底层资源
+        if (__atomic_sub_fetch(&ref->refcount, 1, __ATOMIC_ACQ_REL) == 0 && ref->release) {
+            ref->release(ref);
+        }
+    } else if (frame->data) {
+        free(frame->data);
+    }
+    
+    frame->data = NULL;
+    frame->extra = NULL;
+}
+
+/* =========================================================================
+ *                              队列接口
+ * ========================================================================= */
+
 FrameQueue *frame_queue_create(int capacity) {
-    FrameQueue *queue = (FrameQueue *)malloc(sizeof(FrameQueue));
-    if (!queue) return NULL;
+    return frame_queue_create_ex(capacity, FRAME_QUEUE_MODE_MUTEX);
+}
+
+FrameQueue *frame_queue_create_ex(int capacity, FrameQueueMode mode) {
+    FrameQueue *queue = NULL;
+    // SPSC 的两端索引按缓存行对齐, 结构体本身也需要对齐分配
+    if (posix_memalign((void **)&queue, FRAME_QUEUE_CACHE_LINE, sizeof(FrameQueue)) != 0) {
+        return NULL;
+    }
+    memset(queue, 0, sizeof(FrameQueue));
     
     if (capacity <= 0) {
         capacity = FRAME_QUEUE_DEFAULT_CAPACITY;
     }
+    if (mode == FRAME_QUEUE_MODE_SPSC) {
+        int pow2 = 1;
+        while (pow2 < capacity) pow2 <<= 1;
+        capacity = pow2;
+    }
     
     queue->buffer = (FrameData *)calloc(capacity, sizeof(FrameData));
     if (!queue->buffer) {
@@ -40,6 +434,8 @@ FrameQueue *frame_queue_create(int capacity) {
     }
     
     queue->capacity = capacity;
+    queue->mode = mode;
+    queue->mask = (uint32_t)capacity - 1;
     queue->head = 0;
     queue->tail = 0;
     queue->count = 0;
@@ -52,9 +448,32 @@ FrameQueue *frame_queue_create(int capacity) {
     return queue;
 }
 
+void frame_queue_set_overflow_policy(FrameQueue *queue, FrameQueueOverflowPolicy policy) {
+    if (!queue) return;
+    
+    queue->overflow = policy;
+    queue->wait_keyframe = 0;
+}
+
+void frame_queue_get_drop_stats(FrameQueue *queue, FrameQueueDropStats *stats) {
+    if (!stats) return;
+    
+    memset(stats, 0, sizeof(*stats));
+    if (!queue) return;
+    
+    stats->overflows = __atomic_load_n(&queue->drops.overflows, __ATOMIC_RELAXED);
+    stats->block_timeouts = __atomic_load_n(&queue->drops.block_timeouts, __ATOMIC_RELAXED);
+    stats->gop_dropped = __atomic_load_n(&queue->drops.gop_dropped, __ATOMIC_RELAXED);
+    stats->key_wait_dropped = __atomic_load_n(&queue->drops.key_wait_dropped, __ATOMIC_RELAXED);
+}
+
 void frame_queue_destroy(FrameQueue *queue) {
     if (!queue) return;
     
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) {
+        spsc_close(queue);
+    }
+    
     pthread_mutex_lock(&queue->mutex);
     queue->closed = 1;
     pthread_cond_broadcast(&queue->not_empty);
@@ -73,14 +492,28 @@ void frame_queue_destroy(FrameQueue *queue) {
 
 int frame_queue_push(FrameQueue *queue, const FrameData *frame, int timeout_ms) {
     if (!queue || !frame) return -1;
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) return spsc_push(queue, frame, timeout_ms);
     
     pthread_mutex_lock(&queue->mutex);
     
+    // 丢帧策略: 不等待, 直接按策略腾出空间或丢弃新帧
+    int resumed = queue->wait_keyframe;
+    if (queue->overflow != FRAME_QUEUE_OVERFLOW_BLOCK && !queue->closed) {
+        int ret = mutex_push_overflow(queue, frame);
+        if (ret != 0) {
+            pthread_mutex_unlock(&queue->mutex);
+            return ret;
+        }
+    } else if (queue->count >= queue->capacity && !queue->closed) {
+        drop_count(&queue->drops.overflows, 1);
+    }
+    
     // 等待队列非满
     while (queue->count >= queue->capacity && !queue->closed) {
         if (timeout_ms < 0) {
             pthread_cond_wait(&queue->not_full, &queue->mutex);
         } else if (timeout_ms == 0) {
+            drop_count(&queue->drops.block_timeouts, 1);
             pthread_mutex_unlock(&queue->mutex);
             return -1;  // 立即返回
         } else {
@@ -88,6 +521,7 @@ int frame_queue_push(FrameQueue *queue, const FrameData *frame, int timeout_ms)
             calc_abstime(&abstime, timeout_ms);
             int ret = pthread_cond_timedwait(&queue->not_full, &queue->mutex, &abstime);
             if (ret == ETIMEDOUT) {
+                drop_count(&queue->drops.block_timeouts, 1);
                 pthread_mutex_unlock(&queue->mutex);
                 return -1;
             }
@@ -101,6 +535,9 @@ int frame_queue_push(FrameQueue *queue, const FrameData *frame, int timeout_ms)
     
     // 拷贝帧数据到队列
     memcpy(&queue->buffer[queue->tail], frame, sizeof(FrameData));
+    if (resumed) {
+        queue->buffer[queue->tail].flags |= FRAME_FLAG_START;
+    }
     queue->tail = (queue->tail + 1) % queue->capacity;
     queue->count++;
     
@@ -112,6 +549,7 @@ int frame_queue_push(FrameQueue *queue, const FrameData *frame, int timeout_ms)
 
 int frame_queue_pop(FrameQueue *queue, FrameData *frame, int timeout_ms) {
     if (!queue || !frame) return -1;
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) return spsc_pop(queue, frame, timeout_ms);
     
     pthread_mutex_lock(&queue->mutex);
     
@@ -153,25 +591,13 @@ int frame_queue_pop(FrameQueue *queue, FrameData *frame, int timeout_ms) {
 int frame_queue_try_push(FrameQueue *queue, const FrameData *frame) {
     if (!queue || !frame) return -1;
     
-    pthread_mutex_lock(&queue->mutex);
-    
-    if (queue->closed || queue->count >= queue->capacity) {
-        pthread_mutex_unlock(&queue->mutex);
-        return -1;
-    }
-    
-    memcpy(&queue->buffer[queue->tail], frame, sizeof(FrameData));
-    queue->tail = (queue->tail + 1) % queue->capacity;
-    queue->count++;
-    
-    pthread_cond_signal(&queue->not_empty);
-    pthread_mutex_unlock(&queue->mutex);
-    
-    return 0;
+    // 超时为 0 的推送即非阻塞推送, 同样遵循溢出策略
+    return frame_queue_push(queue, frame, 0) == 0 ? 0 : -1;
 }
 
 int frame_queue_try_pop(FrameQueue *queue, FrameData *frame) {
     if (!queue || !frame) return -1;
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) return spsc_pop(queue, frame, 0) == 0 ? 0 : -1;
     
     pthread_mutex_lock(&queue->mutex);
     
@@ -192,6 +618,10 @@ int frame_queue_try_pop(FrameQueue *queue, FrameData *frame) {
 
 void frame_queue_close(FrameQueue *queue) {
     if (!queue) return;
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) {
+        spsc_close(queue);
+        return;
+    }
     
     pthread_mutex_lock(&queue->mutex);
     queue->closed = 1;
@@ -202,6 +632,7 @@ void frame_queue_close(FrameQueue *queue) {
 
 int frame_queue_size(FrameQueue *queue) {
     if (!queue) return 0;
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) return spsc_size(queue);
     
     pthread_mutex_lock(&queue->mutex);
     int size = queue->count;
@@ -212,6 +643,7 @@ int frame_queue_size(FrameQueue *queue) {
 
 int frame_queue_is_empty(FrameQueue *queue) {
     if (!queue) return 1;
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) return spsc_size(queue) == 0;
     
     pthread_mutex_lock(&queue->mutex);
     int empty = (queue->count == 0);
@@ -222,6 +654,7 @@ int frame_queue_is_empty(FrameQueue *queue) {
 
 int frame_queue_is_closed(FrameQueue *queue) {
     if (!queue) return 1;
+    if (queue->mode == FRAME_QUEUE_MODE_SPSC) return __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE);
     
     pthread_mutex_lock(&queue->mutex);
     int closed = queue->closed;
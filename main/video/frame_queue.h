@@ -4,6 +4,15 @@
  * 
  * 用于在采集、编码、推流线程之间传递数据帧。
  * 基于环形缓冲区实现，支持阻塞式读写和超时机制。
+ * 
+ * 两种实现在创建时选择：
+ * - FRAME_QUEUE_MODE_MUTEX: 互斥锁 + 条件变量，支持任意数量的生产者/消费者。
+ * - FRAME_QUEUE_MODE_SPSC:  单生产者单消费者无锁环形缓冲区，仅在队列空/满
+ *                           需要阻塞时才进入 futex 等待。
+ * 
+ * 队列满时的行为由溢出策略决定 (默认阻塞)，码流队列可以按 GOP 丢帧，
+ * 保证消费者拿到的帧序列始终可以解码；丢帧后重新入队的第一个关键帧
+ * 带 FRAME_FLAG_START 标志。
  */
 
 #ifndef FRAME_QUEUE_H
@@ -20,6 +29,36 @@ extern "C" {
 /** @brief 队列默认容量 */
 #define FRAME_QUEUE_DEFAULT_CAPACITY 8
 
+/** @brief 缓存行大小 (Cortex-A7 为 64 字节)，用于隔离 SPSC 读写索引 */
+#define FRAME_QUEUE_CACHE_LINE 64
+
+/**
+ * @brief 队列实现模式
+ */
+typedef enum {
+    FRAME_QUEUE_MODE_MUTEX = 0,  /**< 互斥锁实现 (多生产者/多消费者) */
+    FRAME_QUEUE_MODE_SPSC,       /**< 无锁实现 (单生产者/单消费者, 容量取 2 的幂) */
+} FrameQueueMode;
+
+/**
+ * @brief 队列满时的溢出策略
+ */
+typedef enum {
+    FRAME_QUEUE_OVERFLOW_BLOCK = 0,      /**< 阻塞等待空位, 超时后由调用者丢弃 */
+    FRAME_QUEUE_OVERFLOW_DROP_GOP,       /**< 丢弃队列中最旧的整个 GOP, 为新帧腾出空间 */
+    FRAME_QUEUE_OVERFLOW_DROP_UNTIL_KEY, /**< 保留已入队的帧, 丢弃新帧直到下一个关键帧 */
+} FrameQueueOverflowPolicy;
+
+/**
+ * @brief 溢出丢帧统计 (按策略分别计数)
+ */
+typedef struct {
+    uint32_t overflows;          /**< 入队时队列已满的次数 */
+    uint32_t block_timeouts;     /**< BLOCK: 等待超时未入队的帧数 */
+    uint32_t gop_dropped;        /**< DROP_GOP: 整组丢弃的帧数 (含等待关键帧期间丢弃的新帧) */
+    uint32_t key_wait_dropped;   /**< DROP_UNTIL_KEY: 等待关键帧期间丢弃的新帧数 */
+} FrameQueueDropStats;
+
 /**
  * @brief 视频帧类型枚举
  */
@@ -28,6 +67,17 @@ typedef enum {
     FRAME_TYPE_ENCODED,      /**< 编码后码流帧 */
 } FrameType;
 
+/** @brief FrameData.flags: 帧内包含 VPS (H.265) */
+#define FRAME_FLAG_VPS           (1u << 0)
+/** @brief FrameData.flags: 帧内包含 SPS */
+#define FRAME_FLAG_SPS           (1u << 1)
+/** @brief FrameData.flags: 帧内包含 PPS */
+#define FRAME_FLAG_PPS           (1u << 2)
+/** @brief FrameData.flags: IDR 帧 (H.265 为 IRAP) */
+#define FRAME_FLAG_IDR           (1u << 3)
+/** @brief FrameData.flags: 消费者的解码起点 (首帧或丢帧后的第一个关键帧)，需要完整参数集 */
+#define FRAME_FLAG_START         (1u << 4)
+
 /**
  * @brief 帧数据结构
  * 
@@ -39,34 +89,144 @@ typedef struct {
     size_t size;             /**< 数据大小 (字节) */
     uint64_t pts;            /**< 时间戳 (微秒) */
     int is_keyframe;         /**< 是否为关键帧 */
+    uint32_t flags;          /**< FRAME_FLAG_* 组合 */
     int width;               /**< 图像宽度 (RAW 帧使用) */
     int height;              /**< 图像高度 (RAW 帧使用) */
-    void *extra;             /**< 扩展字段, 用于传递 MB_BLK 等句柄 */
+    void *extra;             /**< 扩展字段, 用于传递 MB_BLK 等句柄 (非 NULL 时为 FrameRef *) */
+    uint64_t trace_us;       /**< 最近一个延迟跟踪点的时刻 (单调时钟微秒, 见 frame_trace.h) */
 } FrameData;
 
+/**
+ * @brief 帧数据引用计数句柄
+ * 
+ * 挂在 FrameData.extra 上，表示 data 指向的内存不归队列使用者所有
+ * (例如直接引用 VENC 码流包 MB_BLK)。每个消费者处理完成后调用
+ * frame_data_release()，最后一个引用释放时回调 release 归还底层资源。
+ */
+typedef struct FrameRef {
+    int refcount;                            /**< 引用计数 (原子访问) */
+    void (*release)(struct FrameRef *ref);   /**< 引用归零时的释放回调 */
+    void *opaque;                            /**< 释放回调私有数据 */
+} FrameRef;
+
+/**
+ * @brief SPSC 模式下一端 (生产者或消费者) 独占的索引
+ * 
+ * 每端独占一个缓存行，避免生产者和消费者互相使对方的缓存行失效。
+ */
+typedef struct {
+    uint32_t index;          /**< 本端位置 (自由递增计数, 取模前) */
+    uint32_t peer_cache;     /**< 对端位置的本地缓存, 减少跨缓存行读取 */
+    uint32_t waiting;        /**< 本端是否准备进入 futex 等待 */
+    uint32_t wake_seq;       /**< 本端等待的 futex 字, 由对端递增后唤醒 */
+} __attribute__((aligned(FRAME_QUEUE_CACHE_LINE))) FrameQueueSpscEnd;
+
 /**
  * @brief 帧队列结构 (内部实现, 对外不透明)
  */
 typedef struct FrameQueue {
     FrameData *buffer;       /**< 环形缓冲区 */
     int capacity;            /**< 队列容量 */
+    FrameQueueMode mode;     /**< 实现模式 */
+    int closed;              /**< 队列是否已关闭 */
+    
+    /* FRAME_QUEUE_MODE_MUTEX */
     int head;                /**< 队头索引 (下一个读取位置) */
     int tail;                /**< 队尾索引 (下一个写入位置) */
     int count;               /**< 当前元素数量 */
-    int closed;              /**< 队列是否已关闭 */
     pthread_mutex_t mutex;   /**< 互斥锁 */
     pthread_cond_t not_empty;/**< 非空条件变量 */
     pthread_cond_t not_full; /**< 非满条件变量 */
+    
+    /* FRAME_QUEUE_MODE_SPSC */
+    uint32_t mask;           /**< capacity - 1 */
+    FrameQueueSpscEnd prod;  /**< 生产者端: index 为写位置, 等待 "非满" */
+    FrameQueueSpscEnd cons;  /**< 消费者端: index 为读位置, 等待 "非空" */
+    
+    /* 溢出策略 */
+    FrameQueueOverflowPolicy overflow; /**< 溢出策略 */
+    int wait_keyframe;       /**< 已丢帧, 新帧在下一个关键帧之前全部丢弃 (生产者端状态) */
+    FrameQueueDropStats drops; /**< 丢帧统计 (原子访问) */
 } FrameQueue;
 
 /**
- * @brief 创建帧队列
+ * @brief 初始化帧引用句柄 (引用计数置 1)
+ * 
+ * @param ref 引用句柄
+ * @param release 引用归零时的释放回调
+ * @param opaque 释放回调私有数据
+ */
+void frame_ref_init(FrameRef *ref, void (*release)(FrameRef *ref), void *opaque);
+
+/**
+ * @brief 从堆上分配带引用计数的帧数据
+ * 
+ * FrameRef 与数据放在同一块内存中，引用归零时整体 free。
+ * 
+ * @param frame 输出帧 (只修改 data/extra 字段)
+ * @param size 数据大小 (字节)
+ * @return 0 成功，-1 内存不足
+ */
+int frame_data_alloc(FrameData *frame, size_t size);
+
+/**
+ * @brief 为帧增加一个引用 (交给额外的消费者前调用)
+ * 
+ * 对于没有 FrameRef 的拷贝帧无效，拷贝帧只能有一个持有者。
+ * 
+ * @param frame 帧数据
+ */
+void frame_data_retain(FrameData *frame);
+
+/**
+ * @brief 释放帧数据
+ * 
+ * 引用帧 (extra 非 NULL) 递减引用计数，归零时回调 release；
+ * 拷贝帧直接 free(data)。调用后 frame 中的指针被清空。
+ * 
+ * @param frame 帧数据
+ */
+void frame_data_release(FrameData *frame);
+
+/**
+ * @brief 创建帧队列 (互斥锁模式)
  * 
  * @param capacity 队列容量，若为 0 则使用默认值
  * @return FrameQueue* 成功返回队列指针，失败返回 NULL
  */
 FrameQueue *frame_queue_create(int capacity);
 
+/**
+ * @brief 按指定模式创建帧队列
+ * 
+ * SPSC 模式下容量向上取整为 2 的幂，且调用者必须保证同一时刻只有一个线程
+ * 推送、一个线程弹出 (close/size 等查询接口可在任意线程调用)。
+ * 
+ * @param capacity 队列容量，若为 0 则使用默认值
+ * @param mode 实现模式
+ * @return FrameQueue* 成功返回队列指针，失败返回 NULL
+ */
+FrameQueue *frame_queue_create_ex(int capacity, FrameQueueMode mode);
+
+/**
+ * @brief 设置队列溢出策略
+ * 
+ * 必须在生产者/消费者线程启动前调用。丢帧策略依赖 FrameData.is_keyframe，
+ * 被队列丢弃的已入队帧通过 frame_data_release() 释放。
+ * 
+ * @param queue 队列指针
+ * @param policy 溢出策略
+ */
+void frame_queue_set_overflow_policy(FrameQueue *queue, FrameQueueOverflowPolicy policy);
+
+/**
+ * @brief 获取溢出丢帧统计
+ * 
+ * @param queue 队列指针
+ * @param stats 输出统计信息
+ */
+void frame_queue_get_drop_stats(FrameQueue *queue, FrameQueueDropStats *stats);
+
 /**
  * @brief 销毁帧队列
  * 
@@ -77,12 +237,14 @@ void frame_queue_destroy(FrameQueue *queue);
 /**
  * @brief 向队列推送帧 (阻塞式)
  * 
- * 若队列已满，将阻塞等待直到有空间或队列被关闭。
+ * 若队列已满，BLOCK 策略将阻塞等待直到有空间或队列被关闭；
+ * 丢帧策略不等待，按策略丢弃旧帧或新帧 (timeout_ms 被忽略)。
  * 
  * @param queue 队列指针
  * @param frame 帧数据 (会被拷贝到队列内部)
  * @param timeout_ms 超时时间 (毫秒)，-1 表示无限等待
- * @return 0 成功，-1 失败或超时，-2 队列已关闭
+ * @return 0 成功，-1 失败或超时，-2 队列已关闭，-3 按溢出策略丢弃
+ *         (非 0 时帧未入队，仍由调用者释放)
  */
 int frame_queue_push(FrameQueue *queue, const FrameData *frame, int timeout_ms);
 
@@ -103,7 +265,7 @@ int frame_queue_pop(FrameQueue *queue, FrameData *frame, int timeout_ms);
  * 
  * @param queue 队列指针
  * @param frame 帧数据
- * @return 0 成功，-1 队列已满或已关闭
+ * @return 0 成功，-1 队列已满、已关闭或按溢出策略丢弃
  */
 int frame_queue_try_push(FrameQueue *queue, const FrameData *frame);
 
@@ -0,0 +1,328 @@
+/**
+ * @file frame_stage.c
+ * @brief 原始帧处理阶段图实现
+ */
+
+#include "frame_stage.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/prctl.h>
+
+#include <rk_mpi_mb.h>
+#include <rk_mpi_sys.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "frame_stage"
+
+/** @brief 线程池队列容量 (任务槽位有上限, 队列满只在阶段数很多时出现) */
+#define STAGE_POOL_QUEUE_CAPACITY   32
+/** @brief 工作线程取任务超时 (毫秒) */
+#define STAGE_POOL_POP_TIMEOUT_MS   1000
+/** @brief 不可跳帧的旁路阶段最长等待空闲槽位的时间 (毫秒)，超时仍跳过本帧 */
+#define STAGE_TAP_WAIT_MS           1000
+
+/**
+ * @brief 旁路阶段工作线程池
+ */
+typedef struct {
+    FrameQueue *queue;               /**< 任务队列 (多消费者) */
+    pthread_t threads[FRAME_STAGE_MAX_WORKERS];
+    int count;                       /**< 已启动的线程数 */
+} FrameStagePool;
+
+static FrameStagePool g_stage_pool;
+
+/** @brief 串行化追加操作 (执行路径不加锁) */
+static pthread_mutex_t g_stage_add_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t stage_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 调用 process 并记录耗时
+ *
+ * @return process 的返回值
+ */
+static int stage_process(FrameStageNode *node, VideoRawFrame *view) {
+    uint64_t start = stage_now_us();
+    int ret = node->ops.process(view, node->state);
+    uint64_t cost = stage_now_us() - start;
+    latency_hist_record(&node->latency, cost > UINT32_MAX ? UINT32_MAX : (uint32_t)cost);
+    return ret;
+}
+
+/**
+ * @brief 执行一次旁路阶段 (工作线程或无线程池时的送帧线程)
+ *
+ * 旁路阶段只读，CPU 访问前失效缓存即可，不需要回写。
+ */
+static void stage_tap_execute(FrameStageNode *node, const VideoRawFrame *frame) {
+    VideoRawFrame view = *frame;
+
+    pthread_mutex_lock(&node->lock);
+    if (node->ops.access == VIDEO_STAGE_ACCESS_CPU) {
+        RK_MPI_SYS_MmzFlushCache((MB_BLK)view.mb, RK_TRUE);
+    } else {
+        view.vir_addr = NULL;
+    }
+    if (stage_process(node, &view) < 0) {
+        __atomic_add_fetch(&node->errors, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&node->lock);
+}
+
+/**
+ * @brief 旁路任务释放回调 (工作线程处理完或队列丢弃时调用)
+ */
+static void stage_job_release(FrameRef *ref) {
+    FrameStageJob *job = (FrameStageJob *)ref->opaque;
+    FrameStageNode *node = job->node;
+
+    frame_data_release(&job->frame);
+    __atomic_store_n(&job->in_use, 0, __ATOMIC_RELEASE);
+    sem_post(&node->free_jobs);
+}
+
+/**
+ * @brief 等待旁路阶段的空闲任务槽位
+ *
+ * @return 0 成功，-1 阶段忙 (可跳帧) 或等待超时
+ */
+static int stage_job_wait_slot(FrameStageNode *node) {
+    if (node->ops.may_drop) {
+        return sem_trywait(&node->free_jobs);
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += STAGE_TAP_WAIT_MS / 1000;
+    deadline.tv_nsec += (long)(STAGE_TAP_WAIT_MS % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    int ret;
+    while ((ret = sem_timedwait(&node->free_jobs, &deadline)) != 0 && errno == EINTR) {
+    }
+    return ret;
+}
+
+/**
+ * @brief 工作线程: 从任务队列取出旁路任务并执行
+ */
+static void *stage_pool_worker(void *arg) {
+    FrameQueue *queue = (FrameQueue *)arg;
+
+    prctl(PR_SET_NAME, "stage_pool", 0, 0, 0);
+    while (1) {
+        FrameData item;
+        int ret = frame_queue_pop(queue, &item, STAGE_POOL_POP_TIMEOUT_MS);
+        if (ret == -2) break;   // 队列已关闭
+        if (ret != 0) continue; // 超时
+
+        FrameStageJob *job = (FrameStageJob *)((FrameRef *)item.extra)->opaque;
+        stage_tap_execute(job->node, &job->view);
+        frame_data_release(&item);
+    }
+    return NULL;
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+int frame_stage_pool_start(int workers) {
+    if (workers <= 0 || g_stage_pool.queue) return 0;
+    if (workers > FRAME_STAGE_MAX_WORKERS) workers = FRAME_STAGE_MAX_WORKERS;
+
+    g_stage_pool.queue = frame_queue_create_ex(STAGE_POOL_QUEUE_CAPACITY, FRAME_QUEUE_MODE_MUTEX);
+    if (!g_stage_pool.queue) return -1;
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&g_stage_pool.threads[i], NULL, stage_pool_worker,
+                           g_stage_pool.queue) != 0) {
+            LOG_ERROR("Failed to create stage worker %d\n", i);
+            frame_stage_pool_stop();
+            return -1;
+        }
+        g_stage_pool.count++;
+    }
+    LOG_INFO("Stage worker pool started with %d threads\n", workers);
+    return 0;
+}
+
+void frame_stage_pool_stop(void) {
+    if (!g_stage_pool.queue) return;
+
+    frame_queue_close(g_stage_pool.queue);
+    for (int i = 0; i < g_stage_pool.count; i++) {
+        pthread_join(g_stage_pool.threads[i], NULL);
+    }
+    g_stage_pool.count = 0;
+
+    // 关闭时仍在队列中的任务直接释放
+    FrameData item;
+    while (frame_queue_try_pop(g_stage_pool.queue, &item) == 0) {
+        frame_data_release(&item);
+    }
+    frame_queue_destroy(g_stage_pool.queue);
+    g_stage_pool.queue = NULL;
+}
+
+int frame_stage_graph_add(FrameStageGraph *graph, const VideoStageOps *ops, void *arg,
+                          const VideoStageInfo *info) {
+    if (!graph || !ops || !ops->process) return -1;
+
+    pthread_mutex_lock(&g_stage_add_mutex);
+    int count = __atomic_load_n(&graph->count, __ATOMIC_RELAXED);
+    if (count >= FRAME_STAGE_MAX) {
+        pthread_mutex_unlock(&g_stage_add_mutex);
+        return -1;
+    }
+
+    FrameStageNode *node = &graph->nodes[count];
+    memset(node, 0, sizeof(*node));
+    snprintf(node->name, sizeof(node->name), "%s", ops->name ? ops->name : "stage");
+    node->ops = *ops;
+    node->ops.name = NULL;
+    node->state = arg;
+    if (ops->init && ops->init(info, arg, &node->state) != 0) {
+        pthread_mutex_unlock(&g_stage_add_mutex);
+        return -1;
+    }
+    pthread_mutex_init(&node->lock, NULL);
+    sem_init(&node->free_jobs, 0, FRAME_STAGE_TAP_DEPTH);
+    for (int i = 0; i < FRAME_STAGE_TAP_DEPTH; i++) {
+        node->jobs[i].node = node;
+    }
+
+    // 阶段内容写完后再发布, 送帧线程用 acquire 读取计数
+    __atomic_store_n(&graph->count, count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_stage_add_mutex);
+    return 0;
+}
+
+int frame_stage_graph_run(FrameStageGraph *graph, VideoRawFrame *frame) {
+    int count = __atomic_load_n(&graph->count, __ATOMIC_ACQUIRE);
+    int cpu_valid = 0;  // CPU 缓存已失效, 与 DMA 写入一致
+    int cpu_dirty = 0;  // CPU 阶段可能写过, 交给硬件前要回写
+    int ret = 0;
+
+    for (int i = 0; i < count; i++) {
+        FrameStageNode *node = &graph->nodes[i];
+        if (node->ops.mode != VIDEO_STAGE_INLINE) continue;
+
+        VideoRawFrame view = *frame;
+        if (node->ops.access == VIDEO_STAGE_ACCESS_CPU) {
+            if (!cpu_valid) {
+                RK_MPI_SYS_MmzFlushCache((MB_BLK)frame->mb, RK_TRUE);
+                cpu_valid = 1;
+            }
+            cpu_dirty = 1;
+        } else {
+            if (cpu_dirty) {
+                RK_MPI_SYS_MmzFlushCache((MB_BLK)frame->mb, RK_FALSE);
+                cpu_dirty = 0;
+            }
+            // 硬件可能改写了缓冲区, 下一个 CPU 阶段前重新失效缓存
+            cpu_valid = 0;
+            view.vir_addr = NULL;
+        }
+
+        if (stage_process(node, &view) < 0) {
+            if (node->ops.may_drop) {
+                __atomic_add_fetch(&node->dropped, 1, __ATOMIC_RELAXED);
+                ret = -1;
+                break;
+            }
+            __atomic_add_fetch(&node->errors, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (cpu_dirty && ret == 0) {
+        RK_MPI_SYS_MmzFlushCache((MB_BLK)frame->mb, RK_FALSE);
+    }
+    return ret;
+}
+
+void frame_stage_graph_dispatch(FrameStageGraph *graph, const FrameData *frame,
+                                const VideoRawFrame *view) {
+    int count = __atomic_load_n(&graph->count, __ATOMIC_ACQUIRE);
+
+    for (int i = 0; i < count; i++) {
+        FrameStageNode *node = &graph->nodes[i];
+        if (node->ops.mode != VIDEO_STAGE_TAP) continue;
+
+        if (!g_stage_pool.queue) {
+            stage_tap_execute(node, view);
+            continue;
+        }
+
+        if (stage_job_wait_slot(node) != 0) {
+            __atomic_add_fetch(&node->dropped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        // 槽位只由送帧线程分配, 信号量保证至少有一个空闲
+        FrameStageJob *job = NULL;
+        for (int j = 0; j < FRAME_STAGE_TAP_DEPTH; j++) {
+            if (!__atomic_load_n(&node->jobs[j].in_use, __ATOMIC_ACQUIRE)) {
+                job = &node->jobs[j];
+                break;
+            }
+        }
+        if (!job) {
+            sem_post(&node->free_jobs);
+            __atomic_add_fetch(&node->dropped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        job->frame = *frame;
+        frame_data_retain(&job->frame);
+        job->view = *view;
+        frame_ref_init(&job->ref, stage_job_release, job);
+        __atomic_store_n(&job->in_use, 1, __ATOMIC_RELAXED);
+
+        FrameData item = *frame;
+        item.extra = &job->ref;
+        if (frame_queue_try_push(g_stage_pool.queue, &item) != 0) {
+            frame_data_release(&item);
+            __atomic_add_fetch(&node->dropped, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void frame_stage_graph_deinit(FrameStageGraph *graph) {
+    if (!graph) return;
+
+    pthread_mutex_lock(&g_stage_add_mutex);
+    int count = __atomic_load_n(&graph->count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        FrameStageNode *node = &graph->nodes[i];
+
+        // 收回全部任务槽位, 即等待工作线程处理完该阶段的在途帧
+        for (int j = 0; j < FRAME_STAGE_TAP_DEPTH; j++) {
+            while (sem_wait(&node->free_jobs) != 0 && errno == EINTR) {
+            }
+        }
+        if (node->ops.deinit) {
+            node->ops.deinit(node->state);
+        }
+        sem_destroy(&node->free_jobs);
+        pthread_mutex_destroy(&node->lock);
+    }
+    __atomic_store_n(&graph->count, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_stage_add_mutex);
+}
+
+int frame_stage_graph_count(const FrameStageGraph *graph) {
+    return graph ? __atomic_load_n(&graph->count, __ATOMIC_ACQUIRE) : 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file frame_stage.h
+ * @brief 原始帧处理阶段图
+ *
+ * 非 Bind 模式下插在 VI 与 VENC 之间：
+ * - 串行阶段在送帧线程中按注册顺序执行，全部通过后才 RK_MPI_VENC_SendFrame；
+ * - 旁路阶段在帧送入 VENC 之后分支出去，由共享的工作线程池只读处理，
+ *   帧经 FrameQueue 交给线程池，每个旁路阶段持有一份 FrameRef 引用，处理完才归还 VI 缓冲区。
+ *
+ * 阶段声明 CPU 访问时由框架维护 CPU 缓存：首次 CPU 访问前失效缓存，
+ * CPU 阶段之后再交给硬件 (DMA-BUF 阶段或 VENC) 前回写缓存。
+ *
+ * 阶段只能追加：新阶段写好后才发布计数，运行中的送帧线程下一帧开始执行它。
+ */
+
+#ifndef FRAME_STAGE_H
+#define FRAME_STAGE_H
+
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "video.h"
+#include "frame_queue.h"
+#include "latency_hist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 每路码流最多的处理阶段数量 (串行 + 旁路) */
+#define FRAME_STAGE_MAX         8
+
+/** @brief 每个旁路阶段最多同时持有的帧数 (排队 + 处理中) */
+#define FRAME_STAGE_TAP_DEPTH   2
+
+/** @brief 工作线程池最大线程数 */
+#define FRAME_STAGE_MAX_WORKERS 4
+
+struct FrameStageNode;
+
+/**
+ * @brief 旁路任务 (一帧交给一个旁路阶段)
+ */
+typedef struct {
+    FrameRef ref;                   /**< 任务引用 (挂在线程池队列的 FrameData.extra 上) */
+    struct FrameStageNode *node;    /**< 所属阶段 */
+    FrameData frame;                /**< 持有的源帧引用，任务释放时一并释放 */
+    VideoRawFrame view;             /**< 交给阶段的帧描述 */
+    int in_use;                     /**< 槽位占用标志 (原子访问) */
+} FrameStageJob;
+
+/**
+ * @brief 单个处理阶段
+ */
+typedef struct FrameStageNode {
+    char name[16];                  /**< 阶段名称 */
+    VideoStageOps ops;              /**< 阶段描述 (name 不保留) */
+    void *state;                    /**< init 输出的私有状态 */
+    pthread_mutex_t lock;           /**< 串行化旁路阶段的 process */
+    sem_t free_jobs;                /**< 空闲任务槽位数 */
+    FrameStageJob jobs[FRAME_STAGE_TAP_DEPTH];
+    LatencyHist latency;            /**< process 耗时分布 */
+    uint32_t dropped;               /**< 串行: 丢弃的帧数；旁路: 忙时跳过的帧数 (原子访问) */
+    uint32_t errors;                /**< process 返回错误但未丢帧的次数 (原子访问) */
+} FrameStageNode;
+
+/**
+ * @brief 阶段图 (零初始化即可使用)
+ */
+typedef struct {
+    FrameStageNode nodes[FRAME_STAGE_MAX];
+    int count;                      /**< 已发布的阶段数 (原子访问) */
+} FrameStageGraph;
+
+/**
+ * @brief 启动旁路阶段的工作线程池 (所有码流共用)
+ *
+ * workers 为 0 时不启动线程，旁路阶段在送帧线程中同步执行。
+ *
+ * @param workers 线程数 (超过 FRAME_STAGE_MAX_WORKERS 时截断)
+ * @return 0 成功，-1 失败
+ */
+int frame_stage_pool_start(int workers);
+
+/**
+ * @brief 停止工作线程池 (所有阶段图 deinit 之后调用)
+ */
+void frame_stage_pool_stop(void);
+
+/**
+ * @brief 追加阶段 (任意线程可调用，内部调用 ops->init)
+ *
+ * @param graph 阶段图
+ * @param ops 阶段描述
+ * @param arg 传给 init 的私有数据
+ * @param info 码流信息
+ * @return 0 成功，-1 参数非法、阶段已满或 init 失败
+ */
+int frame_stage_graph_add(FrameStageGraph *graph, const VideoStageOps *ops, void *arg,
+                          const VideoStageInfo *info);
+
+/**
+ * @brief 依次执行串行阶段 (送帧线程调用)
+ *
+ * @param graph 阶段图
+ * @param frame 原始帧
+ * @return 0 可以送入编码器，-1 被某个阶段丢弃
+ */
+int frame_stage_graph_run(FrameStageGraph *graph, VideoRawFrame *frame);
+
+/**
+ * @brief 把已送入编码器的帧分发给旁路阶段 (送帧线程调用)
+ *
+ * 每个接收该帧的旁路阶段增加一个引用，调用者仍需释放自己的引用。
+ *
+ * @param graph 阶段图
+ * @param frame 帧数据 (extra 必须是 FrameRef)
+ * @param view 帧描述
+ */
+void frame_stage_graph_dispatch(FrameStageGraph *graph, const FrameData *frame,
+                                const VideoRawFrame *view);
+
+/**
+ * @brief 等待旁路任务完成并 deinit 所有阶段 (送帧线程退出后调用)
+ *
+ * @param graph 阶段图
+ */
+void frame_stage_graph_deinit(FrameStageGraph *graph);
+
+/**
+ * @brief 已发布的阶段数
+ */
+int frame_stage_graph_count(const FrameStageGraph *graph);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_STAGE_H
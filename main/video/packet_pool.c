@@ -0,0 +1,255 @@
+/**
+ * @file packet_pool.c
+ * @brief 编码码流包缓冲池实现
+ *
+ * 所有块的数据区来自一次性分配的连续内存 (arena)，块描述符单独存放。
+ * 每个级别的空闲链表是一个 Treiber 栈：栈顶为 64 位 {tag, index}，
+ * tag 每次修改递增以避免 ABA 问题 (ARMv7 使用 LDREXD/STREXD 实现 64 位 CAS)。
+ */
+
+#include "packet_pool.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "packet_pool"
+
+/** @brief 块大小对齐 (字节) */
+#define PACKET_POOL_ALIGN       4096
+
+/** @brief 空闲链表结束标记 */
+#define PACKET_POOL_NIL         0xFFFFFFFFu
+
+#define POOL_ALIGN_UP(x)        (((x) + PACKET_POOL_ALIGN - 1) & ~((size_t)PACKET_POOL_ALIGN - 1))
+
+struct PacketPoolLevel;
+
+/**
+ * @brief 块描述符
+ */
+typedef struct {
+    FrameRef ref;                    /**< 引用句柄 (挂在 FrameData.extra 上) */
+    struct PacketPoolLevel *level;   /**< 所属级别 */
+    uint8_t *data;                   /**< 块数据区 */
+    uint32_t next;                   /**< 空闲链表中下一个块的索引 */
+} PacketBlock;
+
+/**
+ * @brief 单个大小级别
+ */
+typedef struct PacketPoolLevel {
+    struct PacketPool *pool;         /**< 所属缓冲池 */
+    size_t block_size;               /**< 块大小 */
+    int block_count;                 /**< 块数量 */
+    PacketBlock *blocks;             /**< 块描述符数组 */
+    uint64_t free_head;              /**< 空闲栈顶 {高 32 位 tag, 低 32 位 index} */
+} PacketPoolLevel;
+
+struct PacketPool {
+    PacketPoolLevel levels[PACKET_POOL_MAX_CLASSES];
+    int level_count;
+    uint8_t *arena;                  /**< 连续数据区 */
+    size_t arena_size;
+
+    /* 统计 (原子访问) */
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t in_use;
+    uint32_t high_water;
+    uint32_t capacity;
+};
+
+/* =========================================================================
+ *                              无锁空闲链表
+ * ========================================================================= */
+
+static void level_push(PacketPoolLevel *level, uint32_t index) {
+    uint64_t old_head = __atomic_load_n(&level->free_head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+
+    do {
+        level->blocks[index].next = (uint32_t)old_head;
+        new_head = (((old_head >> 32) + 1) << 32) | index;
+    } while (!__atomic_compare_exchange_n(&level->free_head, &old_head, new_head, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+static PacketBlock *level_pop(PacketPoolLevel *level) {
+    uint64_t old_head = __atomic_load_n(&level->free_head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    uint32_t index;
+
+    do {
+        index = (uint32_t)old_head;
+        if (index == PACKET_POOL_NIL) {
+            return NULL;
+        }
+        uint32_t next = __atomic_load_n(&level->blocks[index].next, __ATOMIC_RELAXED);
+        new_head = (((old_head >> 32) + 1) << 32) | next;
+    } while (!__atomic_compare_exchange_n(&level->free_head, &old_head, new_head, 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return &level->blocks[index];
+}
+
+/**
+ * @brief 块引用归零时归还到空闲链表
+ */
+static void packet_block_release(FrameRef *ref) {
+    PacketBlock *block = (PacketBlock *)ref->opaque;
+    PacketPoolLevel *level = block->level;
+
+    level_push(level, (uint32_t)(block - level->blocks));
+    __atomic_sub_fetch(&level->pool->in_use, 1, __ATOMIC_RELAXED);
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+PacketPool *packet_pool_create(const PacketPoolClass *classes, int class_count) {
+    if (!classes || class_count <= 0 || class_count > PACKET_POOL_MAX_CLASSES) {
+        return NULL;
+    }
+
+    PacketPool *pool = (PacketPool *)calloc(1, sizeof(PacketPool));
+    if (!pool) return NULL;
+
+    for (int i = 0; i < class_count; i++) {
+        pool->arena_size += POOL_ALIGN_UP(classes[i].block_size) * (size_t)classes[i].block_count;
+    }
+
+    pool->arena = (uint8_t *)malloc(pool->arena_size);
+    if (!pool->arena) {
+        free(pool);
+        return NULL;
+    }
+
+    uint8_t *cursor = pool->arena;
+    for (int i = 0; i < class_count; i++) {
+        PacketPoolLevel *level = &pool->levels[i];
+        level->pool = pool;
+        level->block_size = POOL_ALIGN_UP(classes[i].block_size);
+        level->block_count = classes[i].block_count;
+        level->free_head = PACKET_POOL_NIL;
+        level->blocks = (PacketBlock *)calloc(level->block_count, sizeof(PacketBlock));
+        if (!level->blocks) {
+            pool->level_count = i;
+            packet_pool_destroy(pool);
+            return NULL;
+        }
+
+        for (int j = level->block_count - 1; j >= 0; j--) {
+            level->blocks[j].level = level;
+            level->blocks[j].data = cursor + (size_t)j * level->block_size;
+            level_push(level, (uint32_t)j);
+        }
+        cursor += (size_t)level->block_count * level->block_size;
+        pool->capacity += level->block_count;
+    }
+    pool->level_count = class_count;
+
+    return pool;
+}
+
+PacketPool *packet_pool_create_for_stream(int bitrate, int fps, int queue_capacity,
+                                          size_t budget_bytes) {
+    if (bitrate <= 0 || fps <= 0) return NULL;
+    if (queue_capacity <= 0) queue_capacity = FRAME_QUEUE_DEFAULT_CAPACITY;
+
+    size_t avg = (size_t)bitrate / 8 / (size_t)fps;
+    PacketPoolClass classes[3] = {
+        { avg,      queue_capacity     },   /* 普通 P 帧 */
+        { avg * 4,  queue_capacity / 2 },   /* 运动剧烈时的大 P 帧 */
+        { avg * 16, 2                  },   /* I 帧 */
+    };
+
+    if (budget_bytes > 0) {
+        size_t total = 0;
+        for (int i = 0; i < 3; i++) {
+            total += POOL_ALIGN_UP(classes[i].block_size) * (size_t)classes[i].block_count;
+        }
+        if (total > budget_bytes) {
+            for (int i = 0; i < 3; i++) {
+                int count = (int)((uint64_t)classes[i].block_count * budget_bytes / total);
+                classes[i].block_count = count > 0 ? count : 1;
+            }
+        }
+    }
+
+    PacketPool *pool = packet_pool_create(classes, 3);
+    if (pool) {
+        LOG_INFO("Packet pool created: %zuKx%d, %zuKx%d, %zuKx%d (%zu KB)\n",
+                 pool->levels[0].block_size / 1024, pool->levels[0].block_count,
+                 pool->levels[1].block_size / 1024, pool->levels[1].block_count,
+                 pool->levels[2].block_size / 1024, pool->levels[2].block_count,
+                 pool->arena_size / 1024);
+    }
+    return pool;
+}
+
+void packet_pool_destroy(PacketPool *pool) {
+    if (!pool) return;
+
+    uint32_t in_use = __atomic_load_n(&pool->in_use, __ATOMIC_ACQUIRE);
+    if (in_use > 0) {
+        LOG_WARN("Destroying packet pool with %u blocks still in use\n", in_use);
+    }
+
+    for (int i = 0; i < pool->level_count; i++) {
+        free(pool->levels[i].blocks);
+    }
+    free(pool->arena);
+    free(pool);
+}
+
+int packet_pool_alloc(PacketPool *pool, size_t size, FrameData *frame) {
+    if (!frame) return -1;
+
+    if (pool) {
+        // 从能容纳该大小的最小级别开始, 依次尝试更大的级别
+        for (int i = 0; i < pool->level_count; i++) {
+            PacketPoolLevel *level = &pool->levels[i];
+            if (level->block_size < size) continue;
+
+            PacketBlock *block = level_pop(level);
+            if (!block) continue;
+
+            frame_ref_init(&block->ref, packet_block_release, block);
+            frame->data = block->data;
+            frame->extra = &block->ref;
+
+            __atomic_add_fetch(&pool->hits, 1, __ATOMIC_RELAXED);
+            uint32_t used = __atomic_add_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+            uint32_t peak = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+            while (used > peak &&
+                   !__atomic_compare_exchange_n(&pool->high_water, &peak, used, 1,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            }
+            return 0;
+        }
+        __atomic_add_fetch(&pool->misses, 1, __ATOMIC_RELAXED);
+    }
+
+    // 回退: 带引用计数的堆内存
+    return frame_data_alloc(frame, size);
+}
+
+void packet_pool_get_stats(PacketPool *pool, PacketPoolStats *stats) {
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!pool) return;
+
+    stats->hits = __atomic_load_n(&pool->hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&pool->misses, __ATOMIC_RELAXED);
+    stats->in_use = __atomic_load_n(&pool->in_use, __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+    stats->capacity = pool->capacity;
+    stats->budget_kb = (uint32_t)(pool->arena_size / 1024);
+}
@@ -0,0 +1,110 @@
+/**
+ * @file packet_pool.h
+ * @brief 编码码流包缓冲池接口
+ *
+ * 按大小分级 (size class) 预分配码流缓冲区，替代每帧 malloc/free，
+ * 避免长时间运行后的堆碎片。每个级别维护一个无锁空闲链表，
+ * 可以由编码线程分配、由任意消费者线程归还。
+ *
+ * 分配出的缓冲区通过 FrameRef 挂在 FrameData.extra 上，
+ * 消费者统一调用 frame_data_release() 归还。
+ */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "frame_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 最大分级数量 */
+#define PACKET_POOL_MAX_CLASSES 4
+
+/**
+ * @brief 单个大小级别的配置
+ */
+typedef struct {
+    size_t block_size;       /**< 块大小 (字节) */
+    int block_count;         /**< 块数量 */
+} PacketPoolClass;
+
+/**
+ * @brief 缓冲池统计信息
+ */
+typedef struct {
+    uint32_t hits;           /**< 从池中分配成功次数 */
+    uint32_t misses;         /**< 池中无可用块, 回退 malloc 的次数 */
+    uint32_t in_use;         /**< 当前被占用的块数量 */
+    uint32_t high_water;     /**< 占用块数量历史峰值 */
+    uint32_t capacity;       /**< 块总数 */
+    uint32_t budget_kb;      /**< 预分配内存总量 (KB) */
+} PacketPoolStats;
+
+/** @brief 缓冲池 (内部实现, 对外不透明) */
+typedef struct PacketPool PacketPool;
+
+/**
+ * @brief 按给定分级创建缓冲池 (一次性预分配全部内存)
+ *
+ * @param classes 分级配置数组 (按 block_size 升序)
+ * @param class_count 分级数量 (不超过 PACKET_POOL_MAX_CLASSES)
+ * @return PacketPool* 成功返回缓冲池指针，失败返回 NULL
+ */
+PacketPool *packet_pool_create(const PacketPoolClass *classes, int class_count);
+
+/**
+ * @brief 按码流参数自动计算分级并创建缓冲池
+ *
+ * 以平均帧大小 (bitrate / 8 / fps) 为基准划分 P 帧、大 P 帧、I 帧三个级别，
+ * 块数量参考队列容量。budget_bytes 非 0 时按比例缩减块数量以满足预算。
+ *
+ * @param bitrate 目标码率 (bps)
+ * @param fps 帧率
+ * @param queue_capacity 码流队列容量
+ * @param budget_bytes 内存预算 (字节), 0 表示不限制
+ * @return PacketPool* 成功返回缓冲池指针，失败返回 NULL
+ */
+PacketPool *packet_pool_create_for_stream(int bitrate, int fps, int queue_capacity,
+                                          size_t budget_bytes);
+
+/**
+ * @brief 销毁缓冲池
+ *
+ * 调用前必须保证所有块都已归还。
+ *
+ * @param pool 缓冲池指针
+ */
+void packet_pool_destroy(PacketPool *pool);
+
+/**
+ * @brief 分配码流缓冲区并填充到帧
+ *
+ * 命中时 frame->data 指向池内块，frame->extra 为其 FrameRef；
+ * 未命中时回退为 frame_data_alloc() 堆分配。两种情况的帧都带引用计数，
+ * 可以交给多个消费者共享，并统一通过 frame_data_release() 释放。
+ *
+ * @param pool 缓冲池指针 (NULL 时直接堆分配)
+ * @param size 需要的字节数
+ * @param frame 输出帧 (只修改 data/extra 字段)
+ * @return 0 成功，-1 内存不足
+ */
+int packet_pool_alloc(PacketPool *pool, size_t size, FrameData *frame);
+
+/**
+ * @brief 获取缓冲池统计信息
+ *
+ * @param pool 缓冲池指针
+ * @param stats 输出统计信息
+ */
+void packet_pool_get_stats(PacketPool *pool, PacketPoolStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PACKET_POOL_H
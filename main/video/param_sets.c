@@ -0,0 +1,293 @@
+/**
+ * @file param_sets.c
+ * @brief H.264 / H.265 参数集解析与缓存实现
+ */
+
+#include "param_sets.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "param_sets"
+
+/* H.264 NAL 类型 */
+#define H264_NAL_IDR            5
+#define H264_NAL_SPS            7
+#define H264_NAL_PPS            8
+#define H264_NAL_AUD            9
+
+/* H.265 NAL 类型 */
+#define H265_NAL_VCL_MAX        31
+#define H265_NAL_IRAP_MIN       16
+#define H265_NAL_IRAP_MAX       23
+#define H265_NAL_VPS            32
+#define H265_NAL_SPS            33
+#define H265_NAL_PPS            34
+#define H265_NAL_AUD            35
+
+static const uint8_t k_start_code[4] = {0x00, 0x00, 0x00, 0x01};
+
+/**
+ * @brief 查找下一个起始码 (00 00 01 或 00 00 00 01)
+ *
+ * @param pos 起始查找位置
+ * @param payload 输出起始码之后第一个字节的位置
+ * @return 起始码第一个字节的位置，找不到返回 size
+ */
+static size_t find_start_code(const uint8_t *data, size_t size, size_t pos, size_t *payload) {
+    for (size_t i = pos; i + 2 < size; i++) {
+        if (data[i + 2] > 1) {
+            i += 2;  // 第三个字节不是 0/1, 可以直接跳过
+            continue;
+        }
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            *payload = i + 3;
+            return (i > pos && data[i - 1] == 0) ? i - 1 : i;
+        }
+    }
+    *payload = size;
+    return size;
+}
+
+/**
+ * @brief 保存参数集 (内容变化时返回 1)
+ */
+static int param_set_store(ParamSet *set, const uint8_t *nal, size_t len, const char *name) {
+    if (len + sizeof(k_start_code) > PARAM_SET_MAX_SIZE) {
+        LOG_WARN("%s too large (%zu bytes), not cached\n", name, len);
+        return 0;
+    }
+    if (set->size == len + sizeof(k_start_code) &&
+        memcmp(set->data + sizeof(k_start_code), nal, len) == 0) {
+        return 0;
+    }
+
+    memcpy(set->data, k_start_code, sizeof(k_start_code));
+    memcpy(set->data + sizeof(k_start_code), nal, len);
+    set->size = len + sizeof(k_start_code);
+    return 1;
+}
+
+/**
+ * @brief 处理一个 NAL 单元
+ *
+ * @param flags 累计的帧标志
+ * @param changed 参数集内容是否变化
+ * @return 1 遇到 slice (后续不再解析)，0 继续
+ */
+static int parse_nal(ParamSetCache *cache, const uint8_t *nal, size_t len,
+                     uint32_t *flags, int *changed) {
+    if (len == 0) return 0;
+
+    if (cache->codec == PARAM_SET_CODEC_H265) {
+        if (len < 2) return 0;
+        int type = (nal[0] >> 1) & 0x3F;
+        switch (type) {
+        case H265_NAL_VPS:
+            *changed |= param_set_store(&cache->vps, nal, len, "VPS");
+            *flags |= FRAME_FLAG_VPS;
+            return 0;
+        case H265_NAL_SPS:
+            *changed |= param_set_store(&cache->sps, nal, len, "SPS");
+            *flags |= FRAME_FLAG_SPS;
+            return 0;
+        case H265_NAL_PPS:
+            *changed |= param_set_store(&cache->pps, nal, len, "PPS");
+            *flags |= FRAME_FLAG_PPS;
+            return 0;
+        default:
+            if (type > H265_NAL_VCL_MAX) return 0;
+            if (type >= H265_NAL_IRAP_MIN && type <= H265_NAL_IRAP_MAX) {
+                *flags |= FRAME_FLAG_IDR;
+            }
+            return 1;
+        }
+    }
+
+    int type = nal[0] & 0x1F;
+    switch (type) {
+    case H264_NAL_SPS:
+        *changed |= param_set_store(&cache->sps, nal, len, "SPS");
+        *flags |= FRAME_FLAG_SPS;
+        return 0;
+    case H264_NAL_PPS:
+        *changed |= param_set_store(&cache->pps, nal, len, "PPS");
+        *flags |= FRAME_FLAG_PPS;
+        return 0;
+    default:
+        if (type < 1 || type > H264_NAL_IDR) return 0;
+        if (type == H264_NAL_IDR) {
+            *flags |= FRAME_FLAG_IDR;
+        }
+        return 1;
+    }
+}
+
+/**
+ * @brief 解码起点需要的参数集标志
+ */
+static uint32_t required_flags(const ParamSetCache *cache) {
+    uint32_t need = FRAME_FLAG_SPS | FRAME_FLAG_PPS;
+    if (cache->codec == PARAM_SET_CODEC_H265) need |= FRAME_FLAG_VPS;
+    return need;
+}
+
+/**
+ * @brief NAL 在帧开头的排序：0 VPS，1 SPS，2 PPS，3 其他 (SEI/slice)，-1 访问单元分隔符
+ */
+static int nal_param_rank(ParamSetCodec codec, const uint8_t *nal, size_t len) {
+    if (len == 0) return 3;
+    if (codec == PARAM_SET_CODEC_H265) {
+        int type = (nal[0] >> 1) & 0x3F;
+        if (type >= H265_NAL_VPS && type <= H265_NAL_PPS) return type - H265_NAL_VPS;
+        return type == H265_NAL_AUD ? -1 : 3;
+    }
+    int type = nal[0] & 0x1F;
+    if (type == H264_NAL_SPS || type == H264_NAL_PPS) return type - H264_NAL_SPS + 1;
+    return type == H264_NAL_AUD ? -1 : 3;
+}
+
+/**
+ * @brief 计算 VPS/SPS/PPS 在帧内的插入位置
+ *
+ * 每种参数集插在帧内第一个排序在其后的 NAL 之前 (访问单元分隔符之后)，
+ * 只补缺失的参数集时，补齐后的帧仍按 VPS/SPS/PPS 的顺序排列。
+ */
+static void find_insert_offsets(ParamSetCodec codec, const uint8_t *data, size_t size,
+                                size_t offsets[3]) {
+    size_t payload;
+    size_t start = find_start_code(data, size, 0, &payload);
+
+    for (int k = 0; k < 3; k++) offsets[k] = SIZE_MAX;
+    while (start < size) {
+        size_t next_payload;
+        size_t end = find_start_code(data, size, payload, &next_payload);
+        int rank = nal_param_rank(codec, data + payload, end - payload);
+        for (int k = 0; k < 3; k++) {
+            if (offsets[k] == SIZE_MAX && rank > k) offsets[k] = start;
+        }
+        if (rank > 2) break;
+        start = end;
+        payload = next_payload;
+    }
+    for (int k = 0; k < 3; k++) {
+        if (offsets[k] == SIZE_MAX) offsets[k] = start < size ? start : size;
+    }
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+void param_set_cache_init(ParamSetCache *cache, ParamSetCodec codec) {
+    if (!cache) return;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->codec = codec;
+    pthread_mutex_init(&cache->mutex, NULL);
+}
+
+void param_set_cache_deinit(ParamSetCache *cache) {
+    if (!cache) return;
+
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+uint32_t param_set_scan(ParamSetCache *cache, const uint8_t *data, size_t size) {
+    if (!cache || !data || size == 0) return 0;
+
+    uint32_t flags = 0;
+    int changed = 0;
+    size_t payload;
+
+    find_start_code(data, size, 0, &payload);
+
+    pthread_mutex_lock(&cache->mutex);
+    while (payload < size) {
+        size_t next_payload;
+        size_t end = find_start_code(data, size, payload, &next_payload);
+
+        // 去掉 trailing_zero_8bits (NAL 负载不会以 0 结尾)
+        while (end > payload && data[end - 1] == 0) end--;
+
+        if (parse_nal(cache, data + payload, end - payload, &flags, &changed)) {
+            break;
+        }
+        payload = next_payload;
+    }
+    if (changed) {
+        cache->version++;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (changed) {
+        LOG_INFO("Parameter sets updated (version %u)\n", cache->version);
+    }
+    return flags;
+}
+
+int param_set_cache_ready(ParamSetCache *cache) {
+    if (!cache) return 0;
+
+    pthread_mutex_lock(&cache->mutex);
+    int ready = cache->sps.size > 0 && cache->pps.size > 0 &&
+                (cache->codec != PARAM_SET_CODEC_H265 || cache->vps.size > 0);
+    pthread_mutex_unlock(&cache->mutex);
+
+    return ready;
+}
+
+int param_set_cache_prepend(ParamSetCache *cache, const FrameData *frame, PacketPool *pool,
+                            FrameData *out) {
+    if (!cache || !frame || !out) return -1;
+
+    uint32_t need = required_flags(cache);
+    if ((frame->flags & need) == need) return 1;
+
+    static const uint32_t set_flags[3] = { FRAME_FLAG_VPS, FRAME_FLAG_SPS, FRAME_FLAG_PPS };
+    const ParamSet *sets[3] = { &cache->vps, &cache->sps, &cache->pps };
+    const uint8_t *src = (const uint8_t *)frame->data;
+    size_t offsets[3];
+    size_t header = 0;
+
+    // 只补帧内缺少的参数集, 已有的不重复
+    find_insert_offsets(cache->codec, src, frame->size, offsets);
+
+    pthread_mutex_lock(&cache->mutex);
+    for (int i = 0; i < 3; i++) {
+        if (!(need & set_flags[i]) || (frame->flags & set_flags[i])) continue;
+        if (sets[i]->size == 0) {
+            pthread_mutex_unlock(&cache->mutex);
+            return -1;
+        }
+        header += sets[i]->size;
+    }
+
+    *out = *frame;
+    if (packet_pool_alloc(pool, header + frame->size, out) != 0) {
+        pthread_mutex_unlock(&cache->mutex);
+        return -1;
+    }
+
+    uint8_t *dst = (uint8_t *)out->data;
+    size_t pos = 0;
+    for (int i = 0; i < 3; i++) {
+        if (!(need & set_flags[i]) || (frame->flags & set_flags[i])) continue;
+        memcpy(dst, src + pos, offsets[i] - pos);
+        dst += offsets[i] - pos;
+        pos = offsets[i];
+        memcpy(dst, sets[i]->data, sets[i]->size);
+        dst += sets[i]->size;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    memcpy(dst, src + pos, frame->size - pos);
+    out->size = header + frame->size;
+    out->flags |= need;
+    return 0;
+}
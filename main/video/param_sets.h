@@ -0,0 +1,115 @@
+/**
+ * @file param_sets.h
+ * @brief H.264 / H.265 参数集 (VPS/SPS/PPS) 解析与缓存
+ *
+ * 编码线程解析每帧开头的 Annex-B NAL 单元，缓存最新的参数集，并在
+ * FrameData.flags 中标记帧内包含的参数集与 IDR。
+ *
+ * 消费者在解码起点 (FRAME_FLAG_START) 遇到不含参数集的关键帧时，
+ * 可以通过 param_set_cache_prepend() 得到一个补齐参数集的新帧，
+ * 无需等待编码器下一次输出参数集即可开始解码。
+ */
+
+#ifndef PARAM_SETS_H
+#define PARAM_SETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "frame_queue.h"
+#include "packet_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 单个参数集的最大长度 (含 4 字节起始码) */
+#define PARAM_SET_MAX_SIZE 256
+
+/**
+ * @brief 码流编码格式
+ */
+typedef enum {
+    PARAM_SET_CODEC_H264 = 0,
+    PARAM_SET_CODEC_H265,
+} ParamSetCodec;
+
+/**
+ * @brief 单个缓存的参数集 (Annex-B 格式, 含起始码)
+ */
+typedef struct {
+    uint8_t data[PARAM_SET_MAX_SIZE];
+    size_t size;             /**< 长度, 0 表示尚未收到 */
+} ParamSet;
+
+/**
+ * @brief 参数集缓存
+ *
+ * 由编码线程更新，任意消费者线程读取。
+ */
+typedef struct {
+    ParamSetCodec codec;     /**< 编码格式 */
+    ParamSet vps;            /**< VPS (仅 H.265) */
+    ParamSet sps;            /**< SPS */
+    ParamSet pps;            /**< PPS */
+    uint32_t version;        /**< 参数集内容变化次数 */
+    pthread_mutex_t mutex;   /**< 保护缓存内容 */
+} ParamSetCache;
+
+/**
+ * @brief 初始化参数集缓存
+ *
+ * @param cache 缓存
+ * @param codec 编码格式
+ */
+void param_set_cache_init(ParamSetCache *cache, ParamSetCodec codec);
+
+/**
+ * @brief 释放参数集缓存
+ *
+ * @param cache 缓存
+ */
+void param_set_cache_deinit(ParamSetCache *cache);
+
+/**
+ * @brief 解析一帧 Annex-B 码流，更新缓存并返回帧标志
+ *
+ * 只解析第一个 slice 之前的 NAL 单元 (参数集总在 slice 之前)，
+ * 不会遍历整帧数据。
+ *
+ * @param cache 缓存
+ * @param data 码流数据
+ * @param size 数据长度
+ * @return FRAME_FLAG_VPS / SPS / PPS / IDR 的组合
+ */
+uint32_t param_set_scan(ParamSetCache *cache, const uint8_t *data, size_t size);
+
+/**
+ * @brief 检查缓存中是否已有完整的参数集
+ *
+ * @param cache 缓存
+ * @return 1 完整，0 不完整
+ */
+int param_set_cache_ready(ParamSetCache *cache);
+
+/**
+ * @brief 为关键帧补齐缓存的参数集
+ *
+ * 帧内已包含全部参数集时无需处理。否则从码流缓冲池分配一个带引用计数的新帧，
+ * 只把帧内缺少的参数集按 VPS/SPS/PPS 的顺序插入原帧数据，其余字段与原帧相同。
+ *
+ * @param cache 缓存
+ * @param frame 原帧 (不修改, 不释放)
+ * @param pool 码流缓冲池 (NULL 时堆分配)
+ * @param out 输出新帧 (返回 0 时由调用者 frame_data_release)
+ * @return 0 已生成新帧，1 原帧已完整无需处理，-1 缓存缺少所需参数集或内存不足
+ */
+int param_set_cache_prepend(ParamSetCache *cache, const FrameData *frame, PacketPool *pool,
+                            FrameData *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PARAM_SETS_H
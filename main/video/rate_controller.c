@@ -0,0 +1,222 @@
+/**
+ * @file rate_controller.c
+ * @brief 自适应码率控制器实现
+ */
+
+#include "rate_controller.h"
+
+#include <string.h>
+
+/* 默认阈值 */
+#define RC_STEP_DOWN_PCT        25
+#define RC_STEP_UP_PCT          10
+#define RC_BACKLOG_HIGH_PCT     50
+#define RC_BACKLOG_LOW_PCT      10
+#define RC_LATENCY_HIGH_PCT     80
+#define RC_LATENCY_LOW_PCT      40
+#define RC_DOWN_HOLD_MS         1000
+#define RC_UP_HOLD_MS           10000
+
+static int clamp_int(int v, int lo, int hi) {
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+/**
+ * @brief 判断采样状态
+ *
+ * @return 1 拥塞，-1 空闲，0 介于两者之间
+ */
+static int classify_sample(RateController *rc, const RateSample *s, RateControlReason *reason) {
+    const RateControllerConfig *cfg = &rc->cfg;
+    uint32_t drops = 0;
+
+    if (rc->drops_valid) drops = s->drops - rc->last_drops;
+    rc->last_drops = s->drops;
+    rc->drops_valid = 1;
+
+    uint64_t interval_us = rc->fps > 0 ? 1000000u / (uint32_t)rc->fps : 0;
+    uint64_t latency = (uint64_t)s->write_us * 100;
+    int64_t backlog = (int64_t)s->backlog * 100;
+    int64_t capacity = s->capacity > 0 ? s->capacity : 1;
+
+    if (drops > 0) {
+        *reason = RATE_REASON_DROPS;
+        return 1;
+    }
+    if (backlog >= capacity * cfg->backlog_high_pct) {
+        *reason = RATE_REASON_BACKLOG;
+        return 1;
+    }
+    if (interval_us > 0 && latency >= interval_us * cfg->latency_high_pct) {
+        *reason = RATE_REASON_LATENCY;
+        return 1;
+    }
+    if (backlog <= capacity * cfg->backlog_low_pct &&
+        (interval_us == 0 || latency <= interval_us * cfg->latency_low_pct)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 下调一档：先降码率，码率到下限后再降帧率
+ *
+ * @return 1 已调整，0 已到下限
+ */
+static int step_down(RateController *rc) {
+    const RateControllerConfig *cfg = &rc->cfg;
+
+    if (rc->kbps > cfg->min_kbps) {
+        rc->kbps = clamp_int(rc->kbps * (100 - cfg->step_down_pct) / 100, cfg->min_kbps, cfg->max_kbps);
+        return 1;
+    }
+    if (rc->fps > cfg->min_fps) {
+        rc->fps = clamp_int(rc->fps * (100 - cfg->step_down_pct) / 100, cfg->min_fps, cfg->max_fps);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 上调一档：先恢复帧率，再按上限的固定比例提高码率
+ *
+ * @return 1 已调整，0 已到上限
+ */
+static int step_up(RateController *rc) {
+    const RateControllerConfig *cfg = &rc->cfg;
+
+    if (rc->fps < cfg->max_fps) {
+        // 帧率按下调比例对称恢复
+        int fps = rc->fps * 100 / (100 - cfg->step_down_pct);
+        rc->fps = clamp_int(fps > rc->fps ? fps : rc->fps + 1, cfg->min_fps, cfg->max_fps);
+        return 1;
+    }
+    if (rc->kbps < cfg->max_kbps) {
+        int step = cfg->max_kbps * cfg->step_up_pct / 100;
+        rc->kbps = clamp_int(rc->kbps + (step > 0 ? step : 1), cfg->min_kbps, cfg->max_kbps);
+        return 1;
+    }
+    return 0;
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+void rate_controller_default_config(RateControllerConfig *cfg, int max_kbps, int max_fps,
+                                    int min_bitrate_pct, int min_fps) {
+    if (!cfg) return;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->max_kbps = max_kbps;
+    cfg->min_kbps = clamp_int(max_kbps * min_bitrate_pct / 100, 1, max_kbps);
+    cfg->max_fps = max_fps;
+    cfg->min_fps = clamp_int(min_fps, 1, max_fps);
+    cfg->step_down_pct = RC_STEP_DOWN_PCT;
+    cfg->step_up_pct = RC_STEP_UP_PCT;
+    cfg->backlog_high_pct = RC_BACKLOG_HIGH_PCT;
+    cfg->backlog_low_pct = RC_BACKLOG_LOW_PCT;
+    cfg->latency_high_pct = RC_LATENCY_HIGH_PCT;
+    cfg->latency_low_pct = RC_LATENCY_LOW_PCT;
+    cfg->down_hold_ms = RC_DOWN_HOLD_MS;
+    cfg->up_hold_ms = RC_UP_HOLD_MS;
+}
+
+void rate_controller_init(RateController *rc, const RateControllerConfig *cfg) {
+    if (!rc || !cfg) return;
+
+    memset(rc, 0, sizeof(*rc));
+    rc->cfg = *cfg;
+    rc->kbps = cfg->max_kbps;
+    rc->fps = cfg->max_fps;
+}
+
+void rate_controller_set_limits(RateController *rc, int max_kbps, int max_fps) {
+    if (!rc || max_kbps <= 0 || max_fps <= 0) return;
+
+    RateControllerConfig *cfg = &rc->cfg;
+    int throttled = rc->kbps < cfg->max_kbps || rc->fps < cfg->max_fps;
+    int min_pct = cfg->max_kbps > 0 ? cfg->min_kbps * 100 / cfg->max_kbps : 100;
+
+    cfg->max_kbps = max_kbps;
+    cfg->min_kbps = clamp_int(max_kbps * min_pct / 100, 1, max_kbps);
+    cfg->max_fps = max_fps;
+    cfg->min_fps = clamp_int(cfg->min_fps, 1, max_fps);
+
+    if (throttled) {
+        rc->kbps = clamp_int(rc->kbps, cfg->min_kbps, cfg->max_kbps);
+        rc->fps = clamp_int(rc->fps, cfg->min_fps, cfg->max_fps);
+    } else {
+        rc->kbps = max_kbps;
+        rc->fps = max_fps;
+    }
+    rc->congested_since = 0;
+    rc->clear_since = 0;
+}
+
+RateControlAction rate_controller_update(RateController *rc, const RateSample *sample,
+                                         uint64_t now_ms) {
+    if (!rc || !sample) return RATE_CONTROL_HOLD;
+
+    const RateControllerConfig *cfg = &rc->cfg;
+    RateControlReason reason = RATE_REASON_NONE;
+    int state = classify_sample(rc, sample, &reason);
+
+    rc->stats.congested = state > 0;
+
+    if (state > 0) {
+        rc->clear_since = 0;
+        if (rc->congested_since == 0) rc->congested_since = now_ms;
+
+        // 丢帧说明已经超出承载能力, 不等待持续时间; 但两次下调之间仍留出生效时间
+        int sustained = reason == RATE_REASON_DROPS ||
+                        now_ms - rc->congested_since >= (uint64_t)cfg->down_hold_ms;
+        int cooled = rc->last_change_ms == 0 ||
+                     now_ms - rc->last_change_ms >= (uint64_t)cfg->down_hold_ms;
+        if (sustained && cooled && step_down(rc)) {
+            rc->last_change_ms = now_ms;
+            rc->congested_since = now_ms;
+            rc->stats.steps_down++;
+            rc->stats.last_reason = reason;
+            return RATE_CONTROL_DOWN;
+        }
+        return RATE_CONTROL_HOLD;
+    }
+
+    rc->congested_since = 0;
+    if (state < 0) {
+        if (rc->clear_since == 0) rc->clear_since = now_ms;
+        if (now_ms - rc->clear_since >= (uint64_t)cfg->up_hold_ms && step_up(rc)) {
+            rc->last_change_ms = now_ms;
+            rc->clear_since = now_ms;
+            rc->stats.steps_up++;
+            rc->stats.last_reason = RATE_REASON_RECOVERED;
+            return RATE_CONTROL_UP;
+        }
+    } else {
+        rc->clear_since = 0;
+    }
+    return RATE_CONTROL_HOLD;
+}
+
+void rate_controller_get_stats(const RateController *rc, RateControllerStats *stats) {
+    if (!rc || !stats) return;
+
+    *stats = rc->stats;
+    stats->kbps = rc->kbps;
+    stats->fps = rc->fps;
+    stats->max_kbps = rc->cfg.max_kbps;
+    stats->max_fps = rc->cfg.max_fps;
+}
+
+const char *rate_control_reason_name(RateControlReason reason) {
+    switch (reason) {
+    case RATE_REASON_DROPS:     return "drops";
+    case RATE_REASON_BACKLOG:   return "backlog";
+    case RATE_REASON_LATENCY:   return "latency";
+    case RATE_REASON_RECOVERED: return "recovered";
+    default:                    return "none";
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ * @file rate_controller.h
+ * @brief 自适应码率控制器
+ *
+ * 根据推流输出的积压帧数、丢帧数和单帧写入耗时，带迟滞地调整 VENC 目标码率与帧率：
+ * - 拥塞持续 down_hold_ms 后按比例降低码率 (乘性减)，码率到下限后再降帧率；
+ * - 空闲持续 up_hold_ms 后先按下调比例恢复帧率，再按上限的固定比例提高码率 (加性增)；
+ * - 介于两组阈值之间时保持不变，避免在临界点来回切换。
+ *
+ * 控制器只做决策，不调用 MPI；由编码线程定期采样并应用结果。
+ */
+
+#ifndef RATE_CONTROLLER_H
+#define RATE_CONTROLLER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 控制器参数
+ */
+typedef struct {
+    int max_kbps;            /**< 码率上限 (配置码率) */
+    int min_kbps;            /**< 码率下限 */
+    int max_fps;             /**< 帧率上限 (配置帧率) */
+    int min_fps;             /**< 帧率下限 */
+    int step_down_pct;       /**< 每次下调的比例 (%) */
+    int step_up_pct;         /**< 每次上调的幅度 (占上限的 %) */
+    int backlog_high_pct;    /**< 积压超过容量的该比例视为拥塞 */
+    int backlog_low_pct;     /**< 积压低于容量的该比例视为空闲 */
+    int latency_high_pct;    /**< 写入耗时超过帧间隔的该比例视为拥塞 */
+    int latency_low_pct;     /**< 写入耗时低于帧间隔的该比例视为空闲 */
+    int down_hold_ms;        /**< 拥塞持续多久才下调 (也是两次调整的最小间隔) */
+    int up_hold_ms;          /**< 空闲持续多久才上调 */
+} RateControllerConfig;
+
+/**
+ * @brief 一次采样 (只统计受控的输出)
+ */
+typedef struct {
+    int backlog;             /**< 最大积压帧数 */
+    int capacity;            /**< 积压容量 (队列/广播环大小) */
+    uint32_t drops;          /**< 累计丢帧数 (单调递增) */
+    uint32_t write_us;       /**< 单帧平均写入耗时 (微秒) */
+} RateSample;
+
+/**
+ * @brief 控制动作
+ */
+typedef enum {
+    RATE_CONTROL_HOLD = 0,   /**< 保持 */
+    RATE_CONTROL_DOWN,       /**< 已下调 */
+    RATE_CONTROL_UP,         /**< 已上调 */
+} RateControlAction;
+
+/**
+ * @brief 最近一次调整的原因
+ */
+typedef enum {
+    RATE_REASON_NONE = 0,
+    RATE_REASON_DROPS,       /**< 输出丢帧 */
+    RATE_REASON_BACKLOG,     /**< 积压过多 */
+    RATE_REASON_LATENCY,     /**< 写入过慢 */
+    RATE_REASON_RECOVERED,   /**< 持续空闲后恢复 */
+} RateControlReason;
+
+/**
+ * @brief 控制器统计
+ */
+typedef struct {
+    int kbps;                /**< 当前目标码率 */
+    int fps;                 /**< 当前目标帧率 */
+    int max_kbps;            /**< 码率上限 */
+    int max_fps;             /**< 帧率上限 */
+    uint32_t steps_down;     /**< 下调次数 */
+    uint32_t steps_up;       /**< 上调次数 */
+    int congested;           /**< 最近一次采样是否拥塞 */
+    RateControlReason last_reason; /**< 最近一次调整的原因 */
+} RateControllerStats;
+
+/**
+ * @brief 控制器状态
+ */
+typedef struct {
+    RateControllerConfig cfg;
+    int kbps;                /**< 当前目标码率 */
+    int fps;                 /**< 当前目标帧率 */
+    uint32_t last_drops;     /**< 上次采样的累计丢帧数 */
+    int drops_valid;         /**< last_drops 是否有效 */
+    uint64_t congested_since; /**< 拥塞开始时间 (0 表示当前不拥塞) */
+    uint64_t clear_since;    /**< 空闲开始时间 (0 表示当前不空闲) */
+    uint64_t last_change_ms; /**< 上次调整时间 */
+    RateControllerStats stats;
+} RateController;
+
+/**
+ * @brief 填写默认参数
+ *
+ * @param cfg 输出参数
+ * @param max_kbps 码率上限
+ * @param max_fps 帧率上限
+ * @param min_bitrate_pct 码率下限占上限的比例 (%)
+ * @param min_fps 帧率下限
+ */
+void rate_controller_default_config(RateControllerConfig *cfg, int max_kbps, int max_fps,
+                                    int min_bitrate_pct, int min_fps);
+
+/**
+ * @brief 初始化控制器 (目标码率/帧率从上限开始)
+ */
+void rate_controller_init(RateController *rc, const RateControllerConfig *cfg);
+
+/**
+ * @brief 修改上限 (用户重新配置码率/帧率时调用)
+ *
+ * 未降档时目标直接跟随新上限；已降档时目标不超过新上限，下限按原比例缩放。
+ */
+void rate_controller_set_limits(RateController *rc, int max_kbps, int max_fps);
+
+/**
+ * @brief 输入一次采样，必要时调整目标
+ *
+ * @param rc 控制器
+ * @param sample 采样
+ * @param now_ms 当前时间 (毫秒, 单调时钟)
+ * @return 控制动作，非 HOLD 时 rc->kbps / rc->fps 为新的目标
+ */
+RateControlAction rate_controller_update(RateController *rc, const RateSample *sample,
+                                         uint64_t now_ms);
+
+/**
+ * @brief 获取统计
+ */
+void rate_controller_get_stats(const RateController *rc, RateControllerStats *stats);
+
+/**
+ * @brief 原因的可读名称
+ */
+const char *rate_control_reason_name(RateControlReason reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RATE_CONTROLLER_H
@@ -0,0 +1,372 @@
+/**
+ * @file soft_encoder.c
+ * @brief libavcodec 软件编码器实现
+ *
+ * NV12 输入拆分为 YUV420P 后送入 libavcodec (libx264 与 mjpeg 都接受该格式)。
+ * 编码器按输出帧序号计时 (time_base = 1/fps)，输出包的时间戳从序号映射回输入帧的微秒时间戳；
+ * 不使用 B 帧，libx264 设为 zerolatency，一帧输入对应一帧输出，映射环只需覆盖少量在途帧。
+ */
+
+#include "soft_encoder.h"
+#include "rga_utils.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBAVCODEC
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/intreadwrite.h>
+#include <libavutil/opt.h>
+#endif
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "soft_encoder"
+
+#ifdef HAVE_LIBAVCODEC
+
+/** @brief 帧序号 -> 输入时间戳映射环容量 (须大于编码器内部缓存的帧数) */
+#define SOFT_ENCODER_PTS_RING   16
+
+struct SoftEncoder {
+    SoftEncoderConfig cfg;
+    SoftEncoderOutput output;
+    void *arg;
+    const AVCodec *codec;        /**< 选中的编码器 */
+    AVCodecContext *avctx;       /**< 当前编码上下文 (set_rc 时重建) */
+    AVFrame *frame;              /**< YUV420P 输入帧 */
+    AVPacket *pkt;               /**< 输出包 */
+    uint8_t *scaled;             /**< RGA 缩放输出 (NV12, 输入尺寸与输出不同时分配) */
+    int64_t next_pts;            /**< 下一帧的序号 */
+    uint64_t pts_ring[SOFT_ENCODER_PTS_RING];
+    int fps_acc;                 /**< 抽帧累加器 */
+    SoftEncoderStats stats;      /**< 统计 (原子访问) */
+};
+
+/**
+ * @brief 查找编码器: H.264 优先 libx264，其次任意可用的 H.264 编码器
+ */
+static const AVCodec *soft_encoder_find(SoftEncoderCodec codec) {
+    if (codec == SOFT_ENCODER_MJPEG) {
+        return avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    }
+    const AVCodec *c = avcodec_find_encoder_by_name("libx264");
+    return c ? c : avcodec_find_encoder(AV_CODEC_ID_H264);
+}
+
+/**
+ * @brief 按当前参数打开编码上下文
+ *
+ * @return AVCodecContext* 失败返回 NULL
+ */
+static AVCodecContext *soft_encoder_open(SoftEncoder *enc) {
+    const SoftEncoderConfig *cfg = &enc->cfg;
+    AVCodecContext *c = avcodec_alloc_context3(enc->codec);
+    if (!c) return NULL;
+
+    c->width = cfg->width;
+    c->height = cfg->height;
+    c->time_base = (AVRational){1, cfg->fps};
+    c->framerate = (AVRational){cfg->fps, 1};
+    c->bit_rate = cfg->bitrate;
+    c->thread_count = cfg->threads;
+    if (cfg->codec == SOFT_ENCODER_MJPEG) {
+        c->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        c->color_range = AVCOL_RANGE_JPEG;
+    } else {
+        c->pix_fmt = AV_PIX_FMT_YUV420P;
+        c->gop_size = cfg->gop;
+        c->max_b_frames = 0;
+        // 1 秒 VBV, 与 VENC CBR 的码率波动相近
+        c->rc_max_rate = cfg->bitrate;
+        c->rc_buffer_size = cfg->bitrate;
+        // 其他 H.264 编码器没有这些私有选项, 设置失败不影响打开
+        av_opt_set(c->priv_data, "preset", "ultrafast", 0);
+        av_opt_set(c->priv_data, "tune", "zerolatency", 0);
+        av_opt_set(c->priv_data, "forced-idr", "1", 0);
+    }
+
+    int ret = avcodec_open2(c, enc->codec, NULL);
+    if (ret < 0) {
+        LOG_ERROR("avcodec_open2 %s %dx%d failed: %d\n", enc->codec->name,
+                  cfg->width, cfg->height, ret);
+        avcodec_free_context(&c);
+        return NULL;
+    }
+    return c;
+}
+
+/**
+ * @brief 按目标帧率抽帧
+ *
+ * @return 1 本帧编码，0 跳过
+ */
+static int soft_encoder_accept_frame(SoftEncoder *enc) {
+    if (enc->cfg.fps >= enc->cfg.src_fps) return 1;
+
+    enc->fps_acc += enc->cfg.fps;
+    if (enc->fps_acc < enc->cfg.src_fps) return 0;
+    enc->fps_acc -= enc->cfg.src_fps;
+    return 1;
+}
+
+/**
+ * @brief NV12 拆分到 YUV420P 帧
+ */
+static void soft_encoder_fill_frame(AVFrame *f, const uint8_t *src, int width, int height,
+                                    int wstride, int hstride) {
+    const uint8_t *uv = src + (size_t)wstride * hstride;
+
+    for (int y = 0; y < height; y++) {
+        memcpy(f->data[0] + (size_t)y * f->linesize[0], src + (size_t)y * wstride, width);
+    }
+    for (int y = 0; y < height / 2; y++) {
+        const uint8_t *s = uv + (size_t)y * wstride;
+        uint8_t *u = f->data[1] + (size_t)y * f->linesize[1];
+        uint8_t *v = f->data[2] + (size_t)y * f->linesize[2];
+        for (int x = 0; x < width / 2; x++) {
+            u[x] = s[2 * x];
+            v[x] = s[2 * x + 1];
+        }
+    }
+}
+
+/**
+ * @brief 输出包的 QP (libx264/mjpeg 在 side data 中给出 lambda = QP * FF_QP2LAMBDA)
+ *
+ * @return QP，编码器未给出时为 -1
+ */
+static int soft_encoder_packet_qp(const AVPacket *pkt) {
+#if LIBAVCODEC_VERSION_MAJOR >= 59
+    size_t size = 0;
+#else
+    int size = 0;
+#endif
+    const uint8_t *sd = av_packet_get_side_data(pkt, AV_PKT_DATA_QUALITY_STATS, &size);
+    if (!sd || size < 4) return -1;
+    return (int)(AV_RL32(sd) / FF_QP2LAMBDA);
+}
+
+/**
+ * @brief 取出编码器中已就绪的输出包并交给回调
+ *
+ * @return 0 成功，-1 编码器错误
+ */
+static int soft_encoder_drain(SoftEncoder *enc) {
+    for (;;) {
+        int ret = avcodec_receive_packet(enc->avctx, enc->pkt);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return 0;
+        if (ret < 0) return -1;
+
+        SoftEncoderPacket out;
+        out.data = enc->pkt->data;
+        out.size = (size_t)enc->pkt->size;
+        // 编码器未给出时间戳时按最近一帧输入处理
+        int64_t n = enc->pkt->pts >= 0 ? enc->pkt->pts : enc->next_pts - 1;
+        out.pts = enc->pts_ring[n % SOFT_ENCODER_PTS_RING];
+        out.is_keyframe = (enc->pkt->flags & AV_PKT_FLAG_KEY) != 0;
+        out.qp = soft_encoder_packet_qp(enc->pkt);
+        __atomic_add_fetch(&enc->stats.frames_out, 1, __ATOMIC_RELAXED);
+        enc->output(&out, enc->arg);
+        av_packet_unref(enc->pkt);
+    }
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+int soft_encoder_available(SoftEncoderCodec codec) {
+    return soft_encoder_find(codec) != NULL;
+}
+
+SoftEncoder *soft_encoder_create(const SoftEncoderConfig *cfg, SoftEncoderOutput output, void *arg) {
+    if (!cfg || !output || cfg->width <= 0 || cfg->height <= 0 || cfg->fps <= 0 ||
+        cfg->bitrate <= 0 || (cfg->width % 2) != 0 || (cfg->height % 2) != 0) {
+        return NULL;
+    }
+
+    const AVCodec *codec = soft_encoder_find(cfg->codec);
+    if (!codec) {
+        LOG_ERROR("No %s encoder in libavcodec\n", cfg->codec == SOFT_ENCODER_MJPEG ? "MJPEG" : "H.264");
+        return NULL;
+    }
+
+    SoftEncoder *enc = (SoftEncoder *)calloc(1, sizeof(SoftEncoder));
+    if (!enc) return NULL;
+    enc->cfg = *cfg;
+    if (enc->cfg.src_fps <= 0) enc->cfg.src_fps = cfg->fps;
+    if (enc->cfg.fps > enc->cfg.src_fps) enc->cfg.fps = enc->cfg.src_fps;
+    enc->output = output;
+    enc->arg = arg;
+    enc->codec = codec;
+
+    enc->avctx = soft_encoder_open(enc);
+    enc->frame = av_frame_alloc();
+    enc->pkt = av_packet_alloc();
+    if (!enc->avctx || !enc->frame || !enc->pkt) {
+        soft_encoder_destroy(enc);
+        return NULL;
+    }
+    enc->frame->format = enc->avctx->pix_fmt;
+    enc->frame->width = cfg->width;
+    enc->frame->height = cfg->height;
+    if (av_frame_get_buffer(enc->frame, 0) < 0) {
+        soft_encoder_destroy(enc);
+        return NULL;
+    }
+
+    LOG_INFO("Soft encoder %s %dx%d@%d %d kbps gop %d\n", codec->name, cfg->width,
+             cfg->height, enc->cfg.fps, cfg->bitrate / 1024, cfg->gop);
+    return enc;
+}
+
+int soft_encoder_encode(SoftEncoder *enc, const VideoRawFrame *frame, int force_key) {
+    if (!enc || !frame || !frame->vir_addr) return -1;
+    const SoftEncoderConfig *cfg = &enc->cfg;
+
+    __atomic_add_fetch(&enc->stats.frames_in, 1, __ATOMIC_RELAXED);
+    if (!force_key && !soft_encoder_accept_frame(enc)) {
+        __atomic_add_fetch(&enc->stats.skipped, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    const uint8_t *src = (const uint8_t *)frame->vir_addr;
+    int wstride = frame->wstride;
+    int hstride = frame->hstride;
+    if (frame->width != cfg->width || frame->height != cfg->height) {
+        if (!enc->scaled) {
+            enc->scaled = (uint8_t *)malloc((size_t)cfg->width * cfg->height * 3 / 2);
+            if (!enc->scaled) goto fail;
+        }
+
+        RgaImageInfo src_img;
+        RgaImageInfo dst_img;
+        memset(&src_img, 0, sizeof(src_img));
+        memset(&dst_img, 0, sizeof(dst_img));
+        src_img.vir_addr = frame->vir_addr;
+        src_img.fd = frame->fd;
+        src_img.width = frame->width;
+        src_img.height = frame->height;
+        src_img.wstride = frame->wstride;
+        src_img.hstride = frame->hstride;
+        src_img.format = RGA_FMT_YUV420SP;
+        dst_img.vir_addr = enc->scaled;
+        dst_img.fd = -1;
+        dst_img.width = cfg->width;
+        dst_img.height = cfg->height;
+        dst_img.format = RGA_FMT_YUV420SP;
+        if (rga_utils_resize(&src_img, &dst_img) != 0) goto fail;
+
+        __atomic_add_fetch(&enc->stats.scaled, 1, __ATOMIC_RELAXED);
+        src = enc->scaled;
+        wstride = cfg->width;
+        hstride = cfg->height;
+    }
+
+    // 编码器可能仍引用上一帧的缓冲区
+    if (av_frame_make_writable(enc->frame) < 0) goto fail;
+    soft_encoder_fill_frame(enc->frame, src, cfg->width, cfg->height, wstride, hstride);
+    enc->frame->pts = enc->next_pts;
+    enc->frame->pict_type = force_key ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    enc->pts_ring[enc->next_pts % SOFT_ENCODER_PTS_RING] = frame->pts;
+    enc->next_pts++;
+
+    if (avcodec_send_frame(enc->avctx, enc->frame) < 0 || soft_encoder_drain(enc) != 0) {
+        goto fail;
+    }
+    return 0;
+
+fail:
+    __atomic_add_fetch(&enc->stats.errors, 1, __ATOMIC_RELAXED);
+    return -1;
+}
+
+int soft_encoder_set_rc(SoftEncoder *enc, int bitrate, int fps, int gop) {
+    if (!enc || bitrate <= 0 || fps <= 0 || gop <= 0) return -1;
+
+    SoftEncoderConfig old = enc->cfg;
+    enc->cfg.bitrate = bitrate;
+    enc->cfg.fps = fps > enc->cfg.src_fps ? enc->cfg.src_fps : fps;
+    enc->cfg.gop = gop;
+
+    AVCodecContext *c = soft_encoder_open(enc);
+    if (!c) {
+        enc->cfg = old;
+        return -1;
+    }
+    avcodec_free_context(&enc->avctx);
+    enc->avctx = c;
+    enc->next_pts = 0;
+    enc->fps_acc = 0;
+    return 0;
+}
+
+void soft_encoder_get_stats(SoftEncoder *enc, SoftEncoderStats *stats) {
+    if (!enc || !stats) return;
+
+    stats->frames_in = __atomic_load_n(&enc->stats.frames_in, __ATOMIC_RELAXED);
+    stats->frames_out = __atomic_load_n(&enc->stats.frames_out, __ATOMIC_RELAXED);
+    stats->skipped = __atomic_load_n(&enc->stats.skipped, __ATOMIC_RELAXED);
+    stats->scaled = __atomic_load_n(&enc->stats.scaled, __ATOMIC_RELAXED);
+    stats->errors = __atomic_load_n(&enc->stats.errors, __ATOMIC_RELAXED);
+}
+
+void soft_encoder_destroy(SoftEncoder *enc) {
+    if (!enc) return;
+
+    avcodec_free_context(&enc->avctx);
+    av_frame_free(&enc->frame);
+    av_packet_free(&enc->pkt);
+    free(enc->scaled);
+    free(enc);
+}
+
+#else
+
+/* =========================================================================
+ *                     未链接 libavcodec: 软件编码不可用
+ * ========================================================================= */
+
+int soft_encoder_available(SoftEncoderCodec codec) {
+    (void)codec;
+    return 0;
+}
+
+SoftEncoder *soft_encoder_create(const SoftEncoderConfig *cfg, SoftEncoderOutput output, void *arg) {
+    (void)cfg;
+    (void)output;
+    (void)arg;
+    LOG_ERROR("Soft encoder not available: built without libavcodec\n");
+    return NULL;
+}
+
+int soft_encoder_encode(SoftEncoder *enc, const VideoRawFrame *frame, int force_key) {
+    (void)enc;
+    (void)frame;
+    (void)force_key;
+    return -1;
+}
+
+int soft_encoder_set_rc(SoftEncoder *enc, int bitrate, int fps, int gop) {
+    (void)enc;
+    (void)bitrate;
+    (void)fps;
+    (void)gop;
+    return -1;
+}
+
+void soft_encoder_get_stats(SoftEncoder *enc, SoftEncoderStats *stats) {
+    (void)enc;
+    if (stats) memset(stats, 0, sizeof(*stats));
+}
+
+void soft_encoder_destroy(SoftEncoder *enc) {
+    (void)enc;
+}
+
+#endif
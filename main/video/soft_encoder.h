@@ -0,0 +1,140 @@
+/**
+ * @file soft_encoder.h
+ * @brief libavcodec 软件编码器
+ *
+ * 不占用 VENC 通道，在 CPU 上把 NV12 原始帧编码为 H.264 (libx264 等) 或 MJPEG。
+ * 用于 VENC 通道用尽时追加低分辨率码流或定时抓图，以及在没有 VPU 的主机上跑通整条流水线。
+ *
+ * 输入帧尺寸与输出尺寸不同时先经 RGA 缩放到 CPU 缓冲区；
+ * 低于源帧率时按比例抽帧。编码结果通过回调同步交给调用者。
+ *
+ * 编译时未找到 libavcodec (定义 HAVE_LIBAVCODEC) 时 soft_encoder_create 始终失败。
+ */
+
+#ifndef SOFT_ENCODER_H
+#define SOFT_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "video.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 编码格式
+ */
+typedef enum {
+    SOFT_ENCODER_H264 = 0,   /**< H.264 Annex-B，优先使用 libx264 */
+    SOFT_ENCODER_MJPEG,      /**< MJPEG，每帧一张完整的 JPEG */
+} SoftEncoderCodec;
+
+/**
+ * @brief 编码参数
+ */
+typedef struct {
+    SoftEncoderCodec codec;  /**< 编码格式 */
+    int width;               /**< 输出宽度 (2 对齐) */
+    int height;              /**< 输出高度 (2 对齐) */
+    int src_fps;             /**< 输入帧率 */
+    int fps;                 /**< 输出帧率 (低于输入帧率时按比例抽帧) */
+    int bitrate;             /**< 码率 (bps) */
+    int gop;                 /**< GOP 长度 (MJPEG 忽略) */
+    int threads;             /**< 编码线程数，0 为 libavcodec 自动选择 */
+} SoftEncoderConfig;
+
+/**
+ * @brief 编码输出的一帧
+ */
+typedef struct {
+    const uint8_t *data;     /**< 码流数据 (回调返回后失效) */
+    size_t size;             /**< 码流长度 */
+    uint64_t pts;            /**< 时间戳 (微秒，与输入帧一致) */
+    int is_keyframe;         /**< 是否为关键帧 */
+    int qp;                  /**< 本帧 QP (编码器未给出时为 -1) */
+} SoftEncoderPacket;
+
+/**
+ * @brief 编码输出回调 (在 soft_encoder_encode 的调用线程中执行)
+ */
+typedef void (*SoftEncoderOutput)(const SoftEncoderPacket *pkt, void *arg);
+
+/**
+ * @brief 运行统计
+ */
+typedef struct {
+    uint32_t frames_in;      /**< 输入帧数 */
+    uint32_t frames_out;     /**< 输出码流帧数 */
+    uint32_t skipped;        /**< 抽帧跳过的帧数 */
+    uint32_t scaled;         /**< 经 RGA 缩放的帧数 */
+    uint32_t errors;         /**< 缩放或编码失败次数 */
+} SoftEncoderStats;
+
+/** @brief 软件编码器 (内部实现, 对外不透明) */
+typedef struct SoftEncoder SoftEncoder;
+
+/**
+ * @brief 当前构建是否支持该编码格式 (已链接 libavcodec 且存在对应编码器)
+ *
+ * @param codec 编码格式
+ * @return 1 支持，0 不支持
+ */
+int soft_encoder_available(SoftEncoderCodec codec);
+
+/**
+ * @brief 创建编码器
+ *
+ * @param cfg 编码参数
+ * @param output 输出回调
+ * @param arg 回调私有数据
+ * @return SoftEncoder* 成功返回指针，失败返回 NULL
+ */
+SoftEncoder *soft_encoder_create(const SoftEncoderConfig *cfg, SoftEncoderOutput output, void *arg);
+
+/**
+ * @brief 编码一帧 (同一编码器不能并发调用)
+ *
+ * 帧需要 CPU 可读的 vir_addr；尺寸与输出不同时还需要 fd (供 RGA 缩放)。
+ *
+ * @param enc 编码器
+ * @param frame NV12 原始帧
+ * @param force_key 1 时本帧编码为 IDR
+ * @return 0 已编码，1 按帧率跳过，-1 失败
+ */
+int soft_encoder_encode(SoftEncoder *enc, const VideoRawFrame *frame, int force_key);
+
+/**
+ * @brief 修改码率/帧率/GOP (与 soft_encoder_encode 在同一线程调用)
+ *
+ * 重新打开编码器，下一帧从 IDR 开始。
+ *
+ * @param enc 编码器
+ * @param bitrate 码率 (bps)
+ * @param fps 输出帧率 (不超过输入帧率)
+ * @param gop GOP 长度
+ * @return 0 成功，-1 失败 (保持原参数)
+ */
+int soft_encoder_set_rc(SoftEncoder *enc, int bitrate, int fps, int gop);
+
+/**
+ * @brief 获取运行统计
+ *
+ * @param enc 编码器
+ * @param stats 输出参数
+ */
+void soft_encoder_get_stats(SoftEncoder *enc, SoftEncoderStats *stats);
+
+/**
+ * @brief 销毁编码器 (未输出的延迟帧被丢弃)
+ *
+ * @param enc 编码器
+ */
+void soft_encoder_destroy(SoftEncoder *enc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOFT_ENCODER_H
@@ -0,0 +1,336 @@
+/**
+ * @file stream_broadcast.c
+ * @brief 编码码流广播环实现
+ *
+ * 每个槽位记录一个 pending 位图，表示哪些消费者还没有取走该帧。
+ * 发布时帧的引用计数等于当前消费者数量，每个消费者取走一个引用；
+ * 槽位被覆盖时，仍未取走的消费者视为落后：归还其引用并标记为等待关键帧。
+ *
+ * 临界区只包含游标和位图操作，写入方不会因为任何消费者而等待。
+ */
+
+#include "stream_broadcast.h"
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "stream_broadcast"
+
+/**
+ * @brief 环形槽位
+ */
+typedef struct {
+    FrameData frame;         /**< 帧数据 */
+    uint32_t pending;        /**< 尚未取走该帧的消费者位图 */
+} BroadcastSlot;
+
+struct StreamConsumer {
+    StreamBroadcast *bc;     /**< 所属广播环 */
+    int id;                  /**< 位图中的序号 */
+    int active;              /**< 是否已注册 */
+    char name[16];           /**< 名称 */
+    uint64_t cursor;         /**< 下一个要读取的序号 */
+    int need_keyframe;       /**< 是否需要跳到下一个关键帧 */
+    StreamConsumerStats stats;
+};
+
+struct StreamBroadcast {
+    BroadcastSlot *slots;
+    uint32_t capacity;
+    uint32_t mask;
+    uint64_t write_seq;      /**< 下一个写入序号 */
+    uint32_t active_mask;    /**< 已注册消费者位图 */
+    int closed;
+    StreamResyncCallback resync_cb; /**< 消费者开始等待关键帧时的回调 */
+    void *resync_arg;
+    StreamConsumer consumers[STREAM_BROADCAST_MAX_CONSUMERS];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+/**
+ * @brief 释放槽位中帧的一个引用 (槽位本身保持不变)
+ */
+static void slot_release_one(BroadcastSlot *slot) {
+    FrameData tmp = slot->frame;
+    frame_data_release(&tmp);
+}
+
+/**
+ * @brief 通知消费者需要关键帧 (持锁调用)
+ */
+static void notify_resync(StreamBroadcast *bc, StreamConsumer *c) {
+    if (bc->resync_cb) {
+        bc->resync_cb(bc->resync_arg, c);
+    }
+}
+
+static void calc_abstime(struct timespec *ts, int timeout_ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+StreamBroadcast *stream_broadcast_create(int capacity) {
+    StreamBroadcast *bc = (StreamBroadcast *)calloc(1, sizeof(StreamBroadcast));
+    if (!bc) return NULL;
+
+    uint32_t pow2 = 1;
+    while (pow2 < (uint32_t)(capacity > 0 ? capacity : FRAME_QUEUE_DEFAULT_CAPACITY)) pow2 <<= 1;
+
+    bc->slots = (BroadcastSlot *)calloc(pow2, sizeof(BroadcastSlot));
+    if (!bc->slots) {
+        free(bc);
+        return NULL;
+    }
+    bc->capacity = pow2;
+    bc->mask = pow2 - 1;
+
+    pthread_mutex_init(&bc->mutex, NULL);
+    pthread_cond_init(&bc->cond, NULL);
+    return bc;
+}
+
+void stream_broadcast_destroy(StreamBroadcast *bc) {
+    if (!bc) return;
+
+    for (uint32_t i = 0; i < bc->capacity; i++) {
+        BroadcastSlot *slot = &bc->slots[i];
+        while (slot->pending) {
+            slot->pending &= slot->pending - 1;
+            slot_release_one(slot);
+        }
+    }
+
+    pthread_mutex_destroy(&bc->mutex);
+    pthread_cond_destroy(&bc->cond);
+    free(bc->slots);
+    free(bc);
+}
+
+void stream_broadcast_close(StreamBroadcast *bc) {
+    if (!bc) return;
+
+    pthread_mutex_lock(&bc->mutex);
+    bc->closed = 1;
+    pthread_cond_broadcast(&bc->cond);
+    pthread_mutex_unlock(&bc->mutex);
+}
+
+void stream_broadcast_set_resync_callback(StreamBroadcast *bc, StreamResyncCallback cb, void *arg) {
+    if (!bc) return;
+
+    pthread_mutex_lock(&bc->mutex);
+    bc->resync_cb = cb;
+    bc->resync_arg = arg;
+    pthread_mutex_unlock(&bc->mutex);
+}
+
+int stream_broadcast_publish(StreamBroadcast *bc, FrameData *frame) {
+    if (!bc || !frame) return -1;
+
+    // 共享依赖引用计数, 普通拷贝帧先转换为引用帧
+    if (!frame->extra && frame->data) {
+        FrameData shared = *frame;
+        if (frame_data_alloc(&shared, frame->size) != 0) {
+            frame_data_release(frame);
+            return -1;
+        }
+        memcpy(shared.data, frame->data, frame->size);
+        frame_data_release(frame);
+        *frame = shared;
+    }
+
+    pthread_mutex_lock(&bc->mutex);
+
+    int receivers = __builtin_popcount(bc->active_mask);
+    if (bc->closed || receivers == 0) {
+        pthread_mutex_unlock(&bc->mutex);
+        frame_data_release(frame);
+        return 0;
+    }
+
+    BroadcastSlot *slot = &bc->slots[bc->write_seq & bc->mask];
+
+    // 覆盖最旧的槽位: 尚未取走的消费者已经落后一整圈
+    while (slot->pending) {
+        int id = __builtin_ctz(slot->pending);
+        StreamConsumer *c = &bc->consumers[id];
+        slot->pending &= ~(1u << id);
+        slot_release_one(slot);
+
+        c->stats.dropped++;
+        if (!c->need_keyframe) {
+            c->need_keyframe = 1;
+            c->stats.resyncs++;
+            LOG_WARN("Consumer %s overrun, resync to next keyframe\n", c->name);
+            notify_resync(bc, c);
+        }
+    }
+
+    slot->frame = *frame;
+    slot->pending = bc->active_mask;
+    for (int i = 1; i < receivers; i++) {
+        frame_data_retain(&slot->frame);
+    }
+    bc->write_seq++;
+
+    pthread_cond_broadcast(&bc->cond);
+    pthread_mutex_unlock(&bc->mutex);
+
+    frame->data = NULL;
+    frame->extra = NULL;
+    return receivers;
+}
+
+StreamConsumer *stream_broadcast_attach(StreamBroadcast *bc, const char *name) {
+    if (!bc) return NULL;
+
+    pthread_mutex_lock(&bc->mutex);
+    for (int i = 0; i < STREAM_BROADCAST_MAX_CONSUMERS; i++) {
+        StreamConsumer *c = &bc->consumers[i];
+        if (c->active) continue;
+
+        memset(c, 0, sizeof(*c));
+        c->bc = bc;
+        c->id = i;
+        c->active = 1;
+        c->cursor = bc->write_seq;
+        c->need_keyframe = 1;
+        snprintf(c->name, sizeof(c->name), "%s", name ? name : "consumer");
+        bc->active_mask |= 1u << i;
+        notify_resync(bc, c);
+
+        pthread_mutex_unlock(&bc->mutex);
+        return c;
+    }
+    pthread_mutex_unlock(&bc->mutex);
+
+    LOG_ERROR("No free consumer slot for %s\n", name ? name : "consumer");
+    return NULL;
+}
+
+void stream_broadcast_detach(StreamConsumer *consumer) {
+    if (!consumer || !consumer->bc) return;
+
+    StreamBroadcast *bc = consumer->bc;
+    uint32_t bit = 1u << consumer->id;
+
+    pthread_mutex_lock(&bc->mutex);
+    for (uint32_t i = 0; i < bc->capacity; i++) {
+        BroadcastSlot *slot = &bc->slots[i];
+        if (slot->pending & bit) {
+            slot->pending &= ~bit;
+            slot_release_one(slot);
+        }
+    }
+    bc->active_mask &= ~bit;
+    consumer->active = 0;
+    pthread_cond_broadcast(&bc->cond);
+    pthread_mutex_unlock(&bc->mutex);
+}
+
+int stream_consumer_read(StreamConsumer *consumer, FrameData *frame, int timeout_ms) {
+    if (!consumer || !consumer->bc || !frame) return -1;
+
+    StreamBroadcast *bc = consumer->bc;
+    uint32_t bit = 1u << consumer->id;
+    int ret = -1;
+
+    pthread_mutex_lock(&bc->mutex);
+    for (;;) {
+        if (!consumer->active) {
+            ret = -2;
+            break;
+        }
+
+        // 游标已被覆盖: 跳到最旧的可用帧 (被覆盖的帧在发布时已计入丢帧)
+        uint64_t oldest = bc->write_seq > bc->capacity ? bc->write_seq - bc->capacity : 0;
+        if (consumer->cursor < oldest) {
+            consumer->cursor = oldest;
+        }
+
+        if (consumer->cursor < bc->write_seq) {
+            BroadcastSlot *slot = &bc->slots[consumer->cursor & bc->mask];
+            consumer->cursor++;
+            if (!(slot->pending & bit)) continue;
+            slot->pending &= ~bit;
+
+            // 等待关键帧期间跳过非关键帧
+            if (consumer->need_keyframe && !slot->frame.is_keyframe) {
+                consumer->stats.dropped++;
+                slot_release_one(slot);
+                continue;
+            }
+
+            consumer->stats.frames++;
+            *frame = slot->frame;
+            if (consumer->need_keyframe) {
+                frame->flags |= FRAME_FLAG_START;
+                consumer->need_keyframe = 0;
+            }
+            ret = 0;
+            break;
+        }
+
+        if (bc->closed) {
+            ret = -2;
+            break;
+        }
+
+        if (timeout_ms == 0) {
+            ret = -1;
+            break;
+        } else if (timeout_ms < 0) {
+            pthread_cond_wait(&bc->cond, &bc->mutex);
+        } else {
+            struct timespec abstime;
+            calc_abstime(&abstime, timeout_ms);
+            if (pthread_cond_timedwait(&bc->cond, &bc->mutex, &abstime) == ETIMEDOUT) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&bc->mutex);
+
+    return ret;
+}
+
+void stream_consumer_request_start(StreamConsumer *consumer) {
+    if (!consumer || !consumer->bc) return;
+
+    StreamBroadcast *bc = consumer->bc;
+    pthread_mutex_lock(&bc->mutex);
+    if (consumer->active && !consumer->need_keyframe) {
+        consumer->need_keyframe = 1;
+        notify_resync(bc, consumer);
+    }
+    pthread_mutex_unlock(&bc->mutex);
+}
+
+void stream_consumer_get_stats(StreamConsumer *consumer, StreamConsumerStats *stats) {
+    if (!consumer || !consumer->bc || !stats) return;
+
+    StreamBroadcast *bc = consumer->bc;
+    pthread_mutex_lock(&bc->mutex);
+    *stats = consumer->stats;
+    stats->lag = (int)(bc->write_seq - consumer->cursor);
+    pthread_mutex_unlock(&bc->mutex);
+}
+
+const char *stream_consumer_name(const StreamConsumer *consumer) {
+    return consumer ? consumer->name : "";
+}
@@ -0,0 +1,156 @@
+/**
+ * @file stream_broadcast.h
+ * @brief 编码码流广播环 (一写多读)
+ *
+ * 编码线程只写一次，每个消费者 (RTSP、RTMP、录像等) 拥有独立的读游标和线程。
+ * 写入永不阻塞：慢消费者被新帧覆盖后单独丢帧并重新同步到下一个关键帧，
+ * 不会反压编码器，也不会拖慢其他消费者。
+ *
+ * 帧通过 FrameRef 引用计数共享：发布时按当前消费者数量持有引用，
+ * 消费者读出的帧处理完后调用 frame_data_release() 归还。
+ */
+
+#ifndef STREAM_BROADCAST_H
+#define STREAM_BROADCAST_H
+
+#include <stdint.h>
+
+#include "frame_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 最大消费者数量 */
+#define STREAM_BROADCAST_MAX_CONSUMERS 8
+
+/**
+ * @brief 消费者统计信息
+ */
+typedef struct {
+    uint32_t frames;         /**< 已交付帧数 */
+    uint32_t dropped;        /**< 因落后被丢弃的帧数 (含等待关键帧期间跳过的帧) */
+    uint32_t resyncs;        /**< 被覆盖后重新同步到关键帧的次数 */
+    int lag;                 /**< 当前未读帧数 */
+} StreamConsumerStats;
+
+/** @brief 广播环 (内部实现, 对外不透明) */
+typedef struct StreamBroadcast StreamBroadcast;
+
+/** @brief 消费者句柄 */
+typedef struct StreamConsumer StreamConsumer;
+
+/**
+ * @brief 消费者开始等待关键帧时的回调 (新注册或落后被覆盖)
+ * 
+ * 在广播环内部锁中调用，只能做置位等轻量操作，不得阻塞或再调用广播环接口。
+ */
+typedef void (*StreamResyncCallback)(void *arg, const StreamConsumer *consumer);
+
+/**
+ * @brief 创建广播环
+ *
+ * @param capacity 环容量 (帧), 向上取整为 2 的幂
+ * @return StreamBroadcast* 成功返回指针，失败返回 NULL
+ */
+StreamBroadcast *stream_broadcast_create(int capacity);
+
+/**
+ * @brief 销毁广播环 (释放环内所有未读帧)
+ *
+ * 调用前所有消费者线程必须已经退出。
+ *
+ * @param bc 广播环
+ */
+void stream_broadcast_destroy(StreamBroadcast *bc);
+
+/**
+ * @brief 关闭广播环，唤醒所有等待中的消费者
+ *
+ * @param bc 广播环
+ */
+void stream_broadcast_close(StreamBroadcast *bc);
+
+/**
+ * @brief 设置消费者重新同步回调 (通常用于向编码器请求 IDR)
+ * 
+ * 必须在注册消费者之前调用。
+ * 
+ * @param bc 广播环
+ * @param cb 回调函数 (NULL 取消)
+ * @param arg 回调私有数据
+ */
+void stream_broadcast_set_resync_callback(StreamBroadcast *bc, StreamResyncCallback cb, void *arg);
+
+/**
+ * @brief 发布一帧 (永不阻塞)
+ *
+ * 调用者持有的引用被转交给广播环；没有消费者时帧被直接释放。
+ * 没有 FrameRef 的帧会先被拷贝为带引用计数的帧。
+ *
+ * @param bc 广播环
+ * @param frame 帧数据 (调用后不可再使用)
+ * @return 交付的消费者数量，-1 失败
+ */
+int stream_broadcast_publish(StreamBroadcast *bc, FrameData *frame);
+
+/**
+ * @brief 注册消费者
+ *
+ * 新消费者从下一帧开始读取，并在第一个关键帧之前跳过非关键帧。
+ * 读出的第一个关键帧 (以及落后重新同步后的第一个关键帧) 带 FRAME_FLAG_START 标志。
+ *
+ * @param bc 广播环
+ * @param name 消费者名称 (用于日志)
+ * @return StreamConsumer* 成功返回句柄，消费者已满返回 NULL
+ */
+StreamConsumer *stream_broadcast_attach(StreamBroadcast *bc, const char *name);
+
+/**
+ * @brief 注销消费者，释放其所有未读帧的引用
+ *
+ * @param consumer 消费者句柄
+ */
+void stream_broadcast_detach(StreamConsumer *consumer);
+
+/**
+ * @brief 读取下一帧
+ *
+ * @param consumer 消费者句柄
+ * @param frame 输出帧 (调用者处理完后必须 frame_data_release)
+ * @param timeout_ms 超时时间 (毫秒)，-1 表示无限等待
+ * @return 0 成功，-1 超时，-2 广播环已关闭或消费者已注销
+ */
+int stream_consumer_read(StreamConsumer *consumer, FrameData *frame, int timeout_ms);
+
+/**
+ * @brief 请求新的解码起点 (如录像开始新的分段)
+ *
+ * 消费者跳过后续非关键帧，下一个读出的关键帧带 FRAME_FLAG_START 标志，
+ * 同时触发重新同步回调 (请求 IDR)。
+ *
+ * @param consumer 消费者句柄
+ */
+void stream_consumer_request_start(StreamConsumer *consumer);
+
+/**
+ * @brief 获取消费者统计信息
+ *
+ * @param consumer 消费者句柄
+ * @param stats 输出统计信息
+ */
+void stream_consumer_get_stats(StreamConsumer *consumer, StreamConsumerStats *stats);
+
+/**
+ * @brief 获取消费者名称
+ *
+ * @param consumer 消费者句柄
+ * @return 名称字符串
+ */
+const char *stream_consumer_name(const StreamConsumer *consumer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_BROADCAST_H
@@ -0,0 +1,198 @@
+/**
+ * @file venc_harvester.c
+ * @brief 多通道 VENC 码流收割线程实现
+ *
+ * epoll 中除各通道 fd 外还注册了一个 eventfd，用于停止时立即唤醒线程，
+ * 因此 epoll_wait 可以无限等待，空闲时没有周期性唤醒。
+ */
+
+#include "venc_harvester.h"
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+
+#include <rk_mpi_venc.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "venc_harvester"
+
+/** @brief epoll 事件中标识 eventfd 的索引 */
+#define HARVESTER_WAKE_INDEX    0xFFFFFFFFu
+
+/**
+ * @brief 已注册的通道
+ */
+typedef struct {
+    int venc_chn;                /**< VENC 通道号 */
+    int fd;                      /**< RK_MPI_VENC_GetFd 返回的 fd */
+    VencDrainCallback drain;     /**< 可读回调 */
+    void *arg;                   /**< 回调私有数据 */
+    uint32_t wakeups;            /**< 唤醒次数 (原子访问) */
+} HarvesterChannel;
+
+struct VencHarvester {
+    int epfd;                    /**< epoll fd */
+    int wake_fd;                 /**< 停止唤醒用 eventfd */
+    HarvesterChannel channels[VENC_HARVESTER_MAX_CHANNELS];
+    int channel_count;
+    pthread_t thread;
+    int thread_valid;
+    volatile int running;
+};
+
+static void *venc_harvester_thread(void *arg) {
+    VencHarvester *h = (VencHarvester *)arg;
+    struct epoll_event events[VENC_HARVESTER_MAX_CHANNELS + 1];
+
+    prctl(PR_SET_NAME, "venc_harvest", 0, 0, 0);
+    LOG_INFO("VENC harvester started (%d channels)\n", h->channel_count);
+
+    while (h->running) {
+        int n = epoll_wait(h->epfd, events, VENC_HARVESTER_MAX_CHANNELS + 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n && h->running; i++) {
+            uint32_t index = events[i].data.u32;
+            if (index == HARVESTER_WAKE_INDEX) {
+                uint64_t value;
+                ssize_t ret = read(h->wake_fd, &value, sizeof(value));
+                (void)ret;
+                continue;
+            }
+
+            HarvesterChannel *ch = &h->channels[index];
+            __atomic_add_fetch(&ch->wakeups, 1, __ATOMIC_RELAXED);
+            ch->drain(ch->arg);
+        }
+    }
+
+    LOG_INFO("VENC harvester exiting\n");
+    return NULL;
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+VencHarvester *venc_harvester_create(void) {
+    VencHarvester *h = (VencHarvester *)calloc(1, sizeof(VencHarvester));
+    if (!h) return NULL;
+
+    h->epfd = epoll_create1(EPOLL_CLOEXEC);
+    h->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (h->epfd < 0 || h->wake_fd < 0) {
+        LOG_ERROR("Failed to create epoll/eventfd: %s\n", strerror(errno));
+        if (h->epfd >= 0) close(h->epfd);
+        if (h->wake_fd >= 0) close(h->wake_fd);
+        free(h);
+        return NULL;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = HARVESTER_WAKE_INDEX;
+    epoll_ctl(h->epfd, EPOLL_CTL_ADD, h->wake_fd, &ev);
+
+    return h;
+}
+
+int venc_harvester_add(VencHarvester *h, int venc_chn, VencDrainCallback drain, void *arg) {
+    if (!h || !drain || h->thread_valid) return -1;
+    if (h->channel_count >= VENC_HARVESTER_MAX_CHANNELS) {
+        LOG_ERROR("Too many VENC channels (max %d)\n", VENC_HARVESTER_MAX_CHANNELS);
+        return -1;
+    }
+
+    int fd = RK_MPI_VENC_GetFd(venc_chn);
+    if (fd < 0) {
+        LOG_ERROR("RK_MPI_VENC_GetFd(%d) failed: %d\n", venc_chn, fd);
+        return -1;
+    }
+
+    HarvesterChannel *ch = &h->channels[h->channel_count];
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;  // 水平触发, 未取完的码流会再次触发
+    ev.data.u32 = (uint32_t)h->channel_count;
+    if (epoll_ctl(h->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        LOG_ERROR("epoll_ctl add VENC[%d] failed: %s\n", venc_chn, strerror(errno));
+        RK_MPI_VENC_CloseFd(venc_chn);
+        return -1;
+    }
+
+    ch->venc_chn = venc_chn;
+    ch->fd = fd;
+    ch->drain = drain;
+    ch->arg = arg;
+    ch->wakeups = 0;
+    h->channel_count++;
+
+    LOG_INFO("VENC[%d] registered to harvester (fd=%d)\n", venc_chn, fd);
+    return 0;
+}
+
+int venc_harvester_start(VencHarvester *h) {
+    if (!h || h->thread_valid) return -1;
+
+    h->running = 1;
+    if (pthread_create(&h->thread, NULL, venc_harvester_thread, h) != 0) {
+        LOG_ERROR("Failed to create VENC harvester thread\n");
+        h->running = 0;
+        return -1;
+    }
+    h->thread_valid = 1;
+    return 0;
+}
+
+void venc_harvester_stop(VencHarvester *h) {
+    if (!h || !h->thread_valid) return;
+
+    h->running = 0;
+    uint64_t one = 1;
+    if (write(h->wake_fd, &one, sizeof(one)) < 0) {
+        LOG_WARN("Failed to wake VENC harvester: %s\n", strerror(errno));
+    }
+
+    pthread_join(h->thread, NULL);
+    h->thread_valid = 0;
+}
+
+void venc_harvester_destroy(VencHarvester *h) {
+    if (!h) return;
+
+    venc_harvester_stop(h);
+
+    for (int i = 0; i < h->channel_count; i++) {
+        HarvesterChannel *ch = &h->channels[i];
+        epoll_ctl(h->epfd, EPOLL_CTL_DEL, ch->fd, NULL);
+        RK_MPI_VENC_CloseFd(ch->venc_chn);
+    }
+    close(h->wake_fd);
+    close(h->epfd);
+    free(h);
+}
+
+int venc_harvester_get_stats(VencHarvester *h, VencHarvesterChannelStats *stats) {
+    if (!h || !stats) return 0;
+
+    for (int i = 0; i < h->channel_count; i++) {
+        stats[i].venc_chn = h->channels[i].venc_chn;
+        stats[i].wakeups = __atomic_load_n(&h->channels[i].wakeups, __ATOMIC_RELAXED);
+    }
+    return h->channel_count;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file venc_harvester.h
+ * @brief 多通道 VENC 码流收割线程
+ *
+ * 用一个线程通过 epoll 等待所有 VENC 通道的 fd (RK_MPI_VENC_GetFd)，
+ * 哪个通道有码流就回调该通道的 drain 函数取走码流，替代每个通道一个
+ * 阻塞在 RK_MPI_VENC_GetStream 上的编码线程。通道增多 (JPEG 抓拍、第三路码流)
+ * 时线程数和唤醒次数不再随之线性增长。
+ *
+ * 码流的封装与交付仍由各通道自己的 drain 回调完成，各通道的队列相互独立。
+ */
+
+#ifndef VENC_HARVESTER_H
+#define VENC_HARVESTER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 最大通道数量 */
+#define VENC_HARVESTER_MAX_CHANNELS 8
+
+/**
+ * @brief 通道可读时的回调 (在收割线程中调用)
+ *
+ * 回调应以非阻塞方式 (超时 0) 取走当前已就绪的码流。
+ * epoll 为水平触发，未取完的码流会在下一轮再次触发回调。
+ */
+typedef void (*VencDrainCallback)(void *arg);
+
+/**
+ * @brief 单个通道的统计信息
+ */
+typedef struct {
+    int venc_chn;            /**< VENC 通道号 */
+    uint32_t wakeups;        /**< 被唤醒处理的次数 */
+} VencHarvesterChannelStats;
+
+/** @brief 收割器 (内部实现, 对外不透明) */
+typedef struct VencHarvester VencHarvester;
+
+/**
+ * @brief 创建收割器
+ *
+ * @return VencHarvester* 成功返回指针，失败返回 NULL
+ */
+VencHarvester *venc_harvester_create(void);
+
+/**
+ * @brief 注册 VENC 通道 (必须在 venc_harvester_start 之前调用)
+ *
+ * @param h 收割器
+ * @param venc_chn VENC 通道号 (通道必须已创建)
+ * @param drain 通道可读时的回调
+ * @param arg 回调私有数据
+ * @return 0 成功，-1 失败
+ */
+int venc_harvester_add(VencHarvester *h, int venc_chn, VencDrainCallback drain, void *arg);
+
+/**
+ * @brief 启动收割线程
+ *
+ * @param h 收割器
+ * @return 0 成功，-1 失败
+ */
+int venc_harvester_start(VencHarvester *h);
+
+/**
+ * @brief 停止收割线程并等待其退出
+ *
+ * @param h 收割器
+ */
+void venc_harvester_stop(VencHarvester *h);
+
+/**
+ * @brief 销毁收割器 (关闭所有通道 fd)
+ *
+ * 必须在销毁 VENC 通道之前调用。
+ *
+ * @param h 收割器
+ */
+void venc_harvester_destroy(VencHarvester *h);
+
+/**
+ * @brief 获取通道统计信息
+ *
+ * @param h 收割器
+ * @param stats 输出数组 (至少 VENC_HARVESTER_MAX_CHANNELS 个元素)
+ * @return 已注册的通道数量
+ */
+int venc_harvester_get_stats(VencHarvester *h, VencHarvesterChannelStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VENC_HARVESTER_H
@@ -15,7 +15,7 @@
  *                       获取编码码流
  * 
  * 线程间通信使用线程安全的帧队列 (FrameQueue)：
- * - raw_queue:     采集线程 -> 编码线程 (传递 YUV 帧)
+ * - raw_queue:     采集线程 -> 送帧线程 (非 Bind 模式, 传递 VI 帧引用, 不拷贝像素)
  * - stream_queue:  编码线程 -> 推流线程 (传递编码码流)
  * 
  * 优势：
@@ -31,7 +31,17 @@
 #include "log.h"
 #include "param.h"
 #include "frame_queue.h"
+#include "packet_pool.h"
 #include "rga_utils.h"
+#include "stream_broadcast.h"
+#include "param_sets.h"
+#include "venc_harvester.h"
+#include "rate_controller.h"
+#include "video_scaler.h"
+#include "soft_encoder.h"
+#include "frame_stage.h"
+#include "latency_hist.h"
+#include "frame_trace.h"
 #if APP_Test_RTSP
 #include "rtsp.h"
 #endif
@@ -43,14 +53,17 @@
 #endif
 #if APP_Test_PERF_MONITOR
 #include "perf_monitor.h"
-#include "common.h" // rkipc_get_curren_time_ms
 #endif
+#include "common.h" // rkipc_get_curren_time_ms
 
 #include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/prctl.h>
 #include <sys/time.h>
 
 #include <rk_mpi_mb.h>
@@ -68,203 +81,1608 @@
 /** @brief 编码码流队列容量 (编码 -> 推流) */
 #define STREAM_QUEUE_CAPACITY   8
 
+/** @brief 码流广播环容量 (编码 -> 各输出线程), 约 0.5 秒缓冲 */
+#define STREAM_BROADCAST_CAPACITY 16
+
+/** @brief 每路码流最多的输出数量 (RTSP / RTMP / 录像) */
+#define STREAM_MAX_OUTPUTS      3
+
+/** @brief 帧队列实现 (每个队列都只有一个生产者和一个消费者) */
+#if APP_FRAME_QUEUE_LOCKFREE
+#define STREAM_FRAME_QUEUE_MODE FRAME_QUEUE_MODE_SPSC
+#else
+#define STREAM_FRAME_QUEUE_MODE FRAME_QUEUE_MODE_MUTEX
+#endif
+
 /** @brief 线程等待超时时间 (毫秒) */
 #define THREAD_TIMEOUT_MS       1000
 
+/** @brief 非 Bind 模式同时在途的 VI 帧数量 (队列中 + 送帧线程处理中 + 旁路阶段持有)，超出时丢弃新帧 */
+#define VI_CAPTURE_MAX_INFLIGHT 4
+
+/** @brief 非 Bind 模式的 VI 缓冲区数量 (在途帧和 VENC 持有的帧之外仍留给 ISP 轮转) */
+#define VI_CAPTURE_BUF_COUNT    7
+
 /* =========================================================================
  *                              全局变量与结构定义
  * ========================================================================= */
 
+/** @brief 零拷贝模式下最多同时在途 (被消费者持有) 的码流包数量 */
+#define VENC_ZERO_COPY_MAX_INFLIGHT \
+    (APP_VENC_STREAM_BUF_CNT - APP_VENC_ZERO_COPY_RESERVE)
+
+struct VideoStreamContext;
+
+/**
+ * @brief VENC 码流包引用 (零拷贝模式)
+ * 
+ * GetStream 得到的码流描述原样保存在槽位中，FrameData.data 直接指向 MB_BLK 虚拟地址，
+ * 最后一个消费者释放引用时才调用 RK_MPI_VENC_ReleaseStream 归还给编码器。
+ */
+typedef struct {
+    FrameRef ref;                       /**< 引用计数句柄 (挂在 FrameData.extra 上) */
+    struct VideoStreamContext *ctx;     /**< 所属流上下文 */
+    VENC_STREAM_S stream;               /**< GetStream 返回的码流描述 */
+    VENC_PACK_S pack;                   /**< 码流包 (stream.pstPack 指向此处) */
+    int in_use;                         /**< 槽位占用标志 (原子访问) */
+} VencStreamRef;
+
+/**
+ * @brief VI 帧引用 (非 Bind 模式)
+ * 
+ * GetChnFrame 得到的帧描述保存在槽位中，经 raw_queue 传递的只是引用，
+ * 最后一个持有者释放时才调用 RK_MPI_VI_ReleaseChnFrame 归还给 VI。
+ */
+typedef struct {
+    FrameRef ref;                       /**< 引用计数句柄 (挂在 FrameData.extra 上) */
+    struct VideoStreamContext *ctx;     /**< 所属流上下文 */
+    VIDEO_FRAME_INFO_S frame;           /**< GetChnFrame 返回的帧 */
+    uint64_t capture_us;                /**< 取到帧的时刻 (单调时钟) */
+    int in_use;                         /**< 槽位占用标志 (原子访问) */
+} ViFrameRef;
+
+/**
+ * @brief 码流输出 (消费者)
+ * 
+ * APP_STREAM_FANOUT=1 时每个输出独占一个线程和一个广播环读游标；
+ * 否则所有输出在推流线程中依次执行。
+ */
+typedef struct StreamOutput {
+    const char *name;                   /**< 输出名称 */
+    struct VideoStreamContext *ctx;     /**< 所属流上下文 */
+    void (*write)(struct StreamOutput *out, const FrameData *frame); /**< 写一帧 */
+    void (*reopen)(struct StreamOutput *out); /**< 重建会话 (码率/帧率变化时, 可为 NULL) */
+    /** 输出内部队列的积压/容量/累计丢帧 (write 只入队不阻塞的输出提供, 可为 NULL) */
+    int (*queue_stats)(struct StreamOutput *out, int *depth, int *capacity, uint32_t *drops);
+    int reopen_pending;                 /**< 待重建标志 (原子访问) */
+    int wait_keyframe;                  /**< 重建后等待关键帧 (APP_STREAM_FANOUT=0) */
+    int adaptive;                       /**< 是否参与自适应码率控制 */
+    uint32_t write_us;                  /**< 单帧写入耗时的滑动平均 (微秒, 原子访问) */
+    StreamConsumer *consumer;           /**< 广播环读游标 */
+    pthread_t thread;                   /**< 输出线程 */
+    int thread_valid;
+    FILE *fp;                           /**< 录像文件 (仅 file 输出使用) */
+} StreamOutput;
+
 /**
  * @brief 单路视频流处理的上下文结构
  * 
  * 封装了一路视频流处理所需的所有资源，包括线程句柄、队列、配置等。
  */
-typedef struct {
+typedef struct VideoStreamContext {
     const VideoConfig *cfg;      /**< 配置信息 */
     
     /* 线程句柄 */
     pthread_t vi_thread;         /**< 采集线程 */
     pthread_t venc_thread;       /**< 编码线程 */
     pthread_t rtsp_thread;       /**< 推流线程 */
+    pthread_t feed_thread;       /**< 送帧线程 (非 Bind 模式) */
     
     /* 线程有效标志 */
     int vi_thread_valid;
+    int feed_thread_valid;
     int venc_thread_valid;
     int rtsp_thread_valid;
     
     /* 帧队列 */
     FrameQueue *raw_queue;       /**< 原始 YUV 帧队列 */
-    FrameQueue *stream_queue;    /**< 编码码流队列 */
+    FrameQueue *stream_queue;    /**< 编码码流队列 (APP_STREAM_FANOUT=0) */
+    StreamBroadcast *broadcast;  /**< 码流广播环 (APP_STREAM_FANOUT=1) */
+    PacketPool *packet_pool;     /**< 码流拷贝缓冲池 (NULL 时使用 malloc) */
+    VideoScaler *scaler;         /**< RGA 缩放 (cfg->scale_from >= 0 时代替 VI→VENC Bind) */
+    SoftEncoder *soft_enc;       /**< 软件编码器 (cfg->soft_encode 时代替 VENC 通道) */
+    int soft_idr;                /**< 下一帧强制 IDR (只由软件编码阶段访问) */
+    ParamSetCache param_sets;    /**< 最新的 VPS/SPS/PPS, 用于消费者的解码起点 */
+    
+    /* 码流输出 */
+    StreamOutput outputs[STREAM_MAX_OUTPUTS];
+    int output_count;
     
     /* RTSP 时间戳基准 */
     int64_t rtsp_base_time_us;
     int64_t rtsp_base_pts;
     
+    /* GetStream 输出 (只由编码线程或收割线程使用) */
+    VENC_STREAM_S venc_stream;
+    VENC_PACK_S venc_pack;
+    
+#if APP_Test_PERF_MONITOR
+    /* 帧率/码率统计窗口 (只由编码输出线程访问) */
+    uint64_t stat_last_ms;
+    uint32_t stat_frames;
+    uint64_t stat_bytes;
+    uint32_t stat_iframes;       /**< 窗口内 I 帧数 */
+    uint32_t stat_qp_frames;     /**< 窗口内带 QP 的帧数 */
+    uint64_t stat_qp_sum;
+    int stat_qp_min;
+    int stat_qp_max;
+    LatencyHist frame_size;      /**< 帧大小分布 (字节, 自启动以来) */
+#endif
+    
+    /* 零拷贝码流引用槽位 (只由编码线程分配, 由最后一个消费者归还) */
+    VencStreamRef zc_refs[APP_VENC_STREAM_BUF_CNT];
+    int zc_inflight;             /**< 在途零拷贝码流包数量 (原子访问) */
+    uint32_t zc_frames;          /**< 零拷贝交付帧数 */
+    uint32_t copy_frames;        /**< 回退拷贝交付帧数 */
+    
+    /* IDR 请求 (任意线程置位, 由编码线程限频后下发) */
+    int idr_pending;             /**< 是否有待下发的 IDR 请求 (原子访问) */
+    uint32_t idr_requests;       /**< 收到的请求次数 (原子访问) */
+    uint32_t idr_sent;           /**< 实际下发的次数 */
+    uint64_t idr_last_ms;        /**< 上次输出关键帧的时间 */
+    
+    /* 运行时重配置 (任意线程置位, 由编码线程在帧间应用) */
+    int reconfig_pending;        /**< 是否有待应用的码率/帧率/GOP (原子访问) */
+    int param_batch;             /**< 正在批量写入编码参数, 参数监听不触发重配置 (原子访问) */
+    int venc_src_fps;            /**< 创建通道时的源帧率, 目标帧率不能超过它 */
+    
+    /* 非 Bind 模式采集流水线 (cfg->vi_capture) */
+    ViFrameRef vi_refs[VI_CAPTURE_MAX_INFLIGHT];
+    FrameStageGraph stages;      /**< 串行/旁路处理阶段 */
+    LatencyHist lat_queue;       /**< 取到帧 -> 送帧线程取出 */
+    LatencyHist lat_send;        /**< RK_MPI_VENC_SendFrame 耗时 */
+    LatencyHist lat_total;       /**< 取到帧 -> 送入 VENC */
+    uint32_t vi_captured;        /**< 采集帧数 (原子访问) */
+    uint32_t vi_dropped;         /**< 丢弃帧数 (原子访问) */
+    uint32_t vi_sent;            /**< 送入 VENC 的帧数 (原子访问) */
+#if APP_Test_PERF_MONITOR
+    uint64_t pipe_stat_last_ms;  /**< 上次上报流水线统计的时间 */
+#endif
+    
+#if APP_ABR_ENABLE
+    /* 自适应码率 (只由编码线程访问) */
+    RateController abr;
+    uint64_t abr_last_ms;        /**< 上次采样时间 */
+#endif
+    
     /* 运行控制 */
     volatile int running;        /**< 线程运行标志 */
 } VideoStreamContext;
 
-/** @brief 视频流上下文 (支持两路) */
+/** @brief 视频流上下文 (与码流表一一对应) */
 static VideoStreamContext g_stream_ctx[APP_MAX_STREAMS];
 
 /** @brief 全局运行标志 */
 static volatile int g_video_run = 0;
 
-/** @brief VI 源通道句柄 */
-static MPP_CHN_S g_vi_chn;
+#if APP_VENC_HARVESTER
+/** @brief 所有 VENC 通道共用的码流收割线程 */
+static VencHarvester *g_venc_harvester = NULL;
+#endif
+
+/**
+ * @brief VI 源通道
+ * 
+ * 多路码流可以绑定同一个 VI 通道，分辨率由第一个使用它的码流决定。
+ */
+typedef struct {
+    const VideoConfig *cfg;      /**< 第一个使用该通道的码流配置 */
+    MPP_CHN_S chn;               /**< 绑定源句柄 */
+} ViSource;
+
+/** @brief 已初始化的 VI 源通道 */
+static ViSource g_vi_sources[APP_MAX_STREAMS];
+static int g_vi_source_count = 0;
 
 /* =========================================================================
  *                              内部辅助函数
  * ========================================================================= */
 
-#if APP_Test_RTSP
+#if APP_Test_RTSP
+/**
+ * @brief 获取当前系统微秒级时间戳
+ * 
+ * @return int64_t 当前时间的微秒数 (Unix Epoch)
+ */
+static int64_t get_realtime_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+#endif
+
+/**
+ * @brief 获取单调时钟微秒数 (用于计算耗时)
+ */
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 设置当前线程名 (最长 15 字符)，性能报告按线程统计 CPU 占用时据此区分线程
+ */
+static void video_set_thread_name(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void video_set_thread_name(const char *fmt, ...) {
+    char name[16];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(name, sizeof(name), fmt, ap);
+    va_end(ap);
+    prctl(PR_SET_NAME, name, 0, 0, 0);
+}
+
+/**
+ * @brief 码流是否有输出 (RTSP / RTMP，或 MJPEG 抓图文件)，没有输出的码流不启动
+ */
+static int stream_has_output(const VideoConfig *cfg) {
+    if (cfg->codec == APP_VIDEO_CODEC_MJPEG) {
+        return cfg->output_path && cfg->output_path[0] != '\0';
+    }
+    return cfg->enable_rtsp || cfg->enable_rtmp;
+}
+
+/**
+ * @brief 记录一个帧级延迟跟踪点
+ * 
+ * @param ctx 流上下文
+ * @param point 跟踪点
+ * @param frame 编码帧 (trace_us 为上一个跟踪点的时刻)
+ * @return uint64_t 本跟踪点的时刻 (APP_FRAME_TRACE=0 时为 0)
+ */
+static uint64_t stream_trace(const VideoStreamContext *ctx, FrameTracePoint point,
+                             const FrameData *frame) {
+#if APP_FRAME_TRACE
+    return frame_trace_mark(ctx->cfg->stream_id, point, frame->pts, frame->trace_us);
+#else
+    (void)ctx;
+    (void)point;
+    (void)frame;
+    return 0;
+#endif
+}
+
+#if APP_VENC_ZERO_COPY
+/**
+ * @brief 零拷贝码流包释放回调 (最后一个消费者处理完后调用)
+ * 
+ * @param ref 码流包引用
+ */
+static void venc_stream_ref_release(FrameRef *ref) {
+    VencStreamRef *zc = (VencStreamRef *)ref->opaque;
+    VideoStreamContext *ctx = zc->ctx;
+    
+    RK_MPI_VENC_ReleaseStream(ctx->cfg->venc_chn_id, &zc->stream);
+    
+    __atomic_store_n(&zc->in_use, 0, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&ctx->zc_inflight, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 为刚取到的码流分配零拷贝引用槽位
+ * 
+ * 在途引用数达到上限时返回 NULL，调用者回退为拷贝模式，
+ * 保证编码器始终有 APP_VENC_ZERO_COPY_RESERVE 个空闲码流缓冲区可用。
+ * 
+ * @param ctx 流上下文
+ * @param stream GetStream 返回的码流 (结构体被拷贝, 码流数据不拷贝)
+ * @return VencStreamRef* 成功返回槽位 (引用计数为 1)，失败返回 NULL
+ */
+static VencStreamRef *venc_stream_ref_acquire(VideoStreamContext *ctx,
+                                              const VENC_STREAM_S *stream) {
+    if (__atomic_load_n(&ctx->zc_inflight, __ATOMIC_ACQUIRE) >= VENC_ZERO_COPY_MAX_INFLIGHT) {
+        return NULL;
+    }
+    
+    for (int i = 0; i < APP_VENC_STREAM_BUF_CNT; i++) {
+        VencStreamRef *zc = &ctx->zc_refs[i];
+        if (__atomic_load_n(&zc->in_use, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        
+        zc->ctx = ctx;
+        zc->stream = *stream;
+        zc->pack = *stream->pstPack;
+        zc->stream.pstPack = &zc->pack;
+        frame_ref_init(&zc->ref, venc_stream_ref_release, zc);
+        
+        __atomic_store_n(&zc->in_use, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&ctx->zc_inflight, 1, __ATOMIC_ACQ_REL);
+        return zc;
+    }
+    
+    return NULL;
+}
+#endif
+
+/**
+ * @brief 请求编码器尽快输出 IDR 帧 (任意线程可调用)
+ * 
+ * 只置位请求标志，由编码线程限频后调用 RK_MPI_VENC_RequestIDR；
+ * 下发前的多个请求合并为一次，期间自然产生的关键帧也会满足请求。
+ * 
+ * @param ctx 流上下文
+ * @param reason 请求原因 (用于日志)
+ */
+static void stream_request_idr(VideoStreamContext *ctx, const char *reason) {
+    __atomic_add_fetch(&ctx->idr_requests, 1, __ATOMIC_RELAXED);
+    if (!__atomic_exchange_n(&ctx->idr_pending, 1, __ATOMIC_ACQ_REL)) {
+        LOG_DEBUG("[VENC-%d] IDR requested by %s\n", ctx->cfg->venc_chn_id, reason);
+    }
+}
+
+/**
+ * @brief 让编码器下一帧输出 IDR (VENC 通道或软件编码器)
+ * 
+ * @return 0 成功，-1 失败
+ */
+static int venc_force_idr(VideoStreamContext *ctx) {
+    if (ctx->soft_enc) {
+        ctx->soft_idr = 1;
+        return 0;
+    }
+    return RK_MPI_VENC_RequestIDR(ctx->cfg->venc_chn_id, RK_TRUE) == RK_SUCCESS ? 0 : -1;
+}
+
+/**
+ * @brief 下发挂起的 IDR 请求 (编码线程调用)
+ * 
+ * 距上一个关键帧不足 APP_VENC_IDR_MIN_INTERVAL_MS 时保留请求，等窗口打开后再下发，
+ * 避免频繁丢帧或客户端反复重连时 I 帧挤占码率。
+ * 
+ * @param ctx 流上下文
+ * @param now_ms 当前时间 (毫秒)
+ */
+static void venc_service_idr(VideoStreamContext *ctx, uint64_t now_ms) {
+    if (!__atomic_load_n(&ctx->idr_pending, __ATOMIC_ACQUIRE)) return;
+    if (now_ms - ctx->idr_last_ms < APP_VENC_IDR_MIN_INTERVAL_MS) return;
+    
+    __atomic_store_n(&ctx->idr_pending, 0, __ATOMIC_RELEASE);
+    if (venc_force_idr(ctx) == 0) {
+        ctx->idr_last_ms = now_ms;
+        ctx->idr_sent++;
+    } else {
+        LOG_WARN("[VENC-%d] RequestIDR failed\n", ctx->cfg->venc_chn_id);
+    }
+}
+
+/**
+ * @brief 填写 CBR 码率控制参数
+ * 
+ * @param src_fps VI 输入帧率
+ * @param dst_fps 编码输出帧率 (不大于 src_fps, 编码器按比例丢帧)
+ */
+static void venc_fill_rc_attr(VENC_RC_ATTR_S *rc, int codec, int bitrate,
+                              int src_fps, int dst_fps, int gop) {
+    if (codec == APP_VIDEO_CODEC_H265) {
+        rc->enRcMode = VENC_RC_MODE_H265CBR;
+        rc->stH265Cbr.u32Gop = gop;
+        rc->stH265Cbr.u32BitRate = bitrate;
+        rc->stH265Cbr.fr32DstFrameRateNum = dst_fps;
+        rc->stH265Cbr.fr32DstFrameRateDen = 1;
+        rc->stH265Cbr.u32SrcFrameRateNum = src_fps;
+        rc->stH265Cbr.u32SrcFrameRateDen = 1;
+    } else {
+        rc->enRcMode = VENC_RC_MODE_H264CBR;
+        rc->stH264Cbr.u32Gop = gop;
+        rc->stH264Cbr.u32BitRate = bitrate;
+        rc->stH264Cbr.fr32DstFrameRateNum = dst_fps;
+        rc->stH264Cbr.fr32DstFrameRateDen = 1;
+        rc->stH264Cbr.u32SrcFrameRateNum = src_fps;
+        rc->stH264Cbr.u32SrcFrameRateDen = 1;
+    }
+}
+
+/**
+ * @brief 修改 VENC 通道的码率控制参数 (不重建通道；软件编码器重新打开)
+ * 
+ * @param ctx 流上下文
+ * @param bitrate 码率 (bps)
+ * @param fps 输出帧率
+ * @param gop GOP 长度
+ * @return 0 成功，-1 失败
+ */
+static int venc_set_rc(VideoStreamContext *ctx, int bitrate, int fps, int gop) {
+    const VideoConfig *cfg = ctx->cfg;
+    VENC_CHN_ATTR_S attr;
+    
+    if (ctx->soft_enc) {
+        return soft_encoder_set_rc(ctx->soft_enc, bitrate, fps, gop);
+    }
+    
+    memset(&attr, 0, sizeof(attr));
+    if (RK_MPI_VENC_GetChnAttr(cfg->venc_chn_id, &attr) != RK_SUCCESS) {
+        LOG_WARN("[VENC-%d] GetChnAttr failed\n", cfg->venc_chn_id);
+        return -1;
+    }
+    venc_fill_rc_attr(&attr.stRcAttr, cfg->codec, bitrate, ctx->venc_src_fps, fps, gop);
+    if (RK_MPI_VENC_SetChnAttr(cfg->venc_chn_id, &attr) != RK_SUCCESS) {
+        LOG_WARN("[VENC-%d] SetChnAttr failed\n", cfg->venc_chn_id);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 应用待处理的码率/帧率/GOP 变更 (编码线程调用)
+ * 
+ * 新参数从 INI 的 video.N:max_rate / dst_frame_rate_num / gop 读取，
+ * 通过 RK_MPI_VENC_SetChnAttr 原地生效，不重建通道也不断开 RTSP 客户端。
+ * 切换点立即强制 IDR (不受限频约束)；码率或帧率变化时通知带元数据的输出 (RTMP) 重建会话。
+ * 
+ * @param ctx 流上下文
+ * @param now_ms 当前时间 (毫秒)
+ */
+static void venc_service_reconfig(VideoStreamContext *ctx, uint64_t now_ms) {
+    if (!__atomic_exchange_n(&ctx->reconfig_pending, 0, __ATOMIC_ACQ_REL)) return;
+    
+    const VideoConfig *cfg = ctx->cfg;
+    char entry[64];
+    
+    snprintf(entry, sizeof(entry), "video.%d:max_rate", cfg->stream_id);
+    int max_rate = rk_param_get_int(entry, -1);
+    int bitrate = max_rate > 0 ? max_rate * 1024 : cfg->bitrate;
+    snprintf(entry, sizeof(entry), "video.%d:dst_frame_rate_num", cfg->stream_id);
+    int fps = rk_param_get_int(entry, cfg->fps);
+    snprintf(entry, sizeof(entry), "video.%d:gop", cfg->stream_id);
+    int gop = rk_param_get_int(entry, cfg->gop);
+    
+    if (fps <= 0 || gop <= 0) {
+        LOG_WARN("[VENC-%d] Invalid reconfig fps=%d gop=%d, ignored\n", cfg->venc_chn_id, fps, gop);
+        return;
+    }
+    if (fps > ctx->venc_src_fps) {
+        LOG_WARN("[VENC-%d] fps %d above source %d, clamped\n", cfg->venc_chn_id, fps, ctx->venc_src_fps);
+        fps = ctx->venc_src_fps;
+    }
+    if (bitrate == cfg->bitrate && fps == cfg->fps && gop == cfg->gop) return;
+    
+#if APP_ABR_ENABLE
+    // 新配置作为自适应码率的上限, 已降档时继续保持较低的目标
+    rate_controller_set_limits(&ctx->abr, bitrate / 1024, fps);
+    int venc_bitrate = ctx->abr.kbps < bitrate / 1024 ? ctx->abr.kbps * 1024 : bitrate;
+    int venc_fps = ctx->abr.fps;
+#else
+    int venc_bitrate = bitrate;
+    int venc_fps = fps;
+#endif
+    if (venc_set_rc(ctx, venc_bitrate, venc_fps, gop) != 0) {
+        LOG_WARN("[VENC-%d] Reconfig skipped\n", cfg->venc_chn_id);
+        return;
+    }
+    
+    int rate_changed = bitrate != cfg->bitrate || fps != cfg->fps;
+    LOG_INFO("[VENC-%d] Reconfigured: %d -> %d kbps, %d -> %d fps, gop %d -> %d\n",
+             cfg->venc_chn_id, cfg->bitrate / 1024, bitrate / 1024, cfg->fps, fps, cfg->gop, gop);
+    app_video_config_set_rc(cfg->stream_id, bitrate, fps, gop);
+    
+    // 新参数从 IDR 开始生效
+    __atomic_store_n(&ctx->idr_pending, 0, __ATOMIC_RELEASE);
+    if (venc_force_idr(ctx) == 0) {
+        ctx->idr_last_ms = now_ms;
+        ctx->idr_sent++;
+    } else {
+        LOG_WARN("[VENC-%d] RequestIDR failed\n", cfg->venc_chn_id);
+    }
+    
+    if (rate_changed) {
+        for (int i = 0; i < ctx->output_count; i++) {
+            if (ctx->outputs[i].reopen) {
+                __atomic_store_n(&ctx->outputs[i].reopen_pending, 1, __ATOMIC_RELEASE);
+            }
+        }
+    }
+}
+
+#if APP_ABR_ENABLE
+/**
+ * @brief 自适应码率采样与调整 (编码线程调用, 每 APP_ABR_INTERVAL_MS 一次)
+ * 
+ * 只统计 adaptive 输出 (RTMP 等上行输出) 的积压、丢帧和写入耗时，
+ * 局域网 RTSP 客户端慢时各自丢帧，不拉低共用编码器的码率。
+ * RTSP 写入只是入队，参与控制时 (APP_ABR_WATCH_RTSP) 另外采样其入队队列的积压与丢帧。
+ * 码率的小幅调整对 CBR 即时生效，不强制 IDR，也不重建输出会话。
+ * 
+ * @param ctx 流上下文
+ * @param now_ms 当前时间 (毫秒)
+ */
+static void venc_service_abr(VideoStreamContext *ctx, uint64_t now_ms) {
+    if (now_ms - ctx->abr_last_ms < APP_ABR_INTERVAL_MS) return;
+    ctx->abr_last_ms = now_ms;
+    
+    const VideoConfig *cfg = ctx->cfg;
+    RateSample sample;
+    int watched = 0;
+    int queue_pct = 0;
+    uint32_t queue_drops = 0;
+    
+    memset(&sample, 0, sizeof(sample));
+    for (int i = 0; i < ctx->output_count; i++) {
+        StreamOutput *out = &ctx->outputs[i];
+        if (!out->adaptive) continue;
+        watched++;
+        
+        uint32_t write_us = __atomic_load_n(&out->write_us, __ATOMIC_RELAXED);
+        if (write_us > sample.write_us) sample.write_us = write_us;
+#if APP_STREAM_FANOUT
+        StreamConsumerStats stats;
+        memset(&stats, 0, sizeof(stats));
+        stream_consumer_get_stats(out->consumer, &stats);
+        if (stats.lag > sample.backlog) sample.backlog = stats.lag;
+        sample.drops += stats.dropped;
+#endif
+        int depth, capacity;
+        uint32_t drops;
+        if (out->queue_stats && out->queue_stats(out, &depth, &capacity, &drops) == 0 &&
+            capacity > 0) {
+            if (depth * 100 / capacity > queue_pct) queue_pct = depth * 100 / capacity;
+            queue_drops += drops;
+        }
+    }
+    if (watched == 0) return;
+    
+#if APP_STREAM_FANOUT
+    sample.capacity = STREAM_BROADCAST_CAPACITY;
+#else
+    // 所有输出共用一个队列和推流线程
+    FrameQueueDropStats drops;
+    frame_queue_get_drop_stats(ctx->stream_queue, &drops);
+    sample.backlog = frame_queue_size(ctx->stream_queue);
+    sample.capacity = STREAM_QUEUE_CAPACITY;
+    sample.drops = drops.overflows;
+#endif
+    // 输出内部队列按占用比例折算到同一容量, 丢帧累加 (各自单调递增)
+    if (queue_pct * sample.capacity / 100 > sample.backlog) {
+        sample.backlog = queue_pct * sample.capacity / 100;
+    }
+    sample.drops += queue_drops;
+    
+    int old_kbps = ctx->abr.kbps;
+    int old_fps = ctx->abr.fps;
+    RateControlAction action = rate_controller_update(&ctx->abr, &sample, now_ms);
+    RateControllerStats rc_stats;
+    rate_controller_get_stats(&ctx->abr, &rc_stats);
+    
+    if (action != RATE_CONTROL_HOLD) {
+        int bitrate = ctx->abr.kbps < cfg->bitrate / 1024 ? ctx->abr.kbps * 1024 : cfg->bitrate;
+        if (venc_set_rc(ctx, bitrate, ctx->abr.fps, cfg->gop) == 0) {
+            LOG_INFO("[VENC-%d] ABR %s (%s): %d -> %d kbps, %d -> %d fps "
+                     "(backlog=%d/%d, write=%uus)\n",
+                     cfg->venc_chn_id, action == RATE_CONTROL_DOWN ? "down" : "up",
+                     rate_control_reason_name(rc_stats.last_reason), old_kbps, ctx->abr.kbps,
+                     old_fps, ctx->abr.fps, sample.backlog, sample.capacity, sample.write_us);
+        } else {
+            // 未生效, 恢复控制器目标, 下个周期重试
+            ctx->abr.kbps = old_kbps;
+            ctx->abr.fps = old_fps;
+        }
+    }
+    
+#if APP_Test_PERF_MONITOR
+    AbrStats abr_stats;
+    memset(&abr_stats, 0, sizeof(abr_stats));
+    abr_stats.target_kbps = ctx->abr.kbps;
+    abr_stats.target_fps = ctx->abr.fps;
+    abr_stats.max_kbps = rc_stats.max_kbps;
+    abr_stats.max_fps = rc_stats.max_fps;
+    abr_stats.backlog = sample.backlog;
+    abr_stats.write_us = sample.write_us;
+    abr_stats.drops = sample.drops;
+    abr_stats.steps_down = rc_stats.steps_down;
+    abr_stats.steps_up = rc_stats.steps_up;
+    abr_stats.last_reason = rate_control_reason_name(rc_stats.last_reason);
+    perf_update_abr_stats(cfg->stream_id, &abr_stats);
+#endif
+}
+#endif
+
+#if APP_STREAM_FANOUT
+/**
+ * @brief 广播环消费者等待关键帧时请求 IDR (新输出接入或输出落后丢帧)
+ */
+static void stream_on_consumer_resync(void *arg, const StreamConsumer *consumer) {
+    stream_request_idr((VideoStreamContext *)arg, stream_consumer_name(consumer));
+}
+#endif
+
+/**
+ * @brief 为解码起点补齐参数集
+ * 
+ * 带 FRAME_FLAG_START 的关键帧缺少 VPS/SPS/PPS 时，用缓存的参数集生成新帧替换原帧
+ * (原帧引用被释放)，消费者无需等待编码器再次输出参数集。
+ * 
+ * @param ctx 流上下文
+ * @param frame 帧数据 (可能被替换)
+ */
+static void stream_frame_prepare_start(VideoStreamContext *ctx, FrameData *frame) {
+    if (!(frame->flags & FRAME_FLAG_START) || !frame->is_keyframe) return;
+    if (ctx->cfg->codec == APP_VIDEO_CODEC_MJPEG) return;  // 每帧独立解码
+    
+    FrameData full;
+    int ret = param_set_cache_prepend(&ctx->param_sets, frame, ctx->packet_pool, &full);
+    if (ret == 0) {
+        frame_data_release(frame);
+        *frame = full;
+    } else if (ret < 0) {
+        LOG_WARN("[STREAM-%d] No cached parameter sets for decodable start\n", ctx->cfg->stream_id);
+    }
+}
+
+/**
+ * @brief 释放流队列中残留的帧
+ * 
+ * @param queue 帧队列
+ */
+static void stream_queue_drain(FrameQueue *queue) {
+    FrameData frame;
+    while (frame_queue_try_pop(queue, &frame) == 0) {
+        frame_data_release(&frame);
+    }
+}
+
+/**
+ * @brief 把编码帧交给输出 (广播环或推流队列)，失败时释放帧
+ * 
+ * @param ctx 流上下文
+ * @param frame 编码帧 (调用后所有权转移)
+ */
+static void stream_deliver(VideoStreamContext *ctx, FrameData *frame) {
+    frame->trace_us = stream_trace(ctx, FRAME_TRACE_PUSH, frame);
+#if APP_STREAM_FANOUT
+    // 广播环写入永不阻塞, 慢消费者各自丢帧
+    stream_broadcast_publish(ctx->broadcast, frame);
+#else
+    // 丢帧策略下队列满时不等待, 按 GOP 丢弃 (返回 -3), 计入队列丢帧统计
+    int ret = frame_queue_push(ctx->stream_queue, frame, THREAD_TIMEOUT_MS);
+    if (ret != 0) {
+        if (ret != -3) {
+            LOG_WARN("[VENC-%d] Stream queue push failed\n", ctx->cfg->venc_chn_id);
+        }
+        frame_data_release(frame);
+        // 新帧被丢弃后推流端要等到下一个关键帧才能恢复
+        if (ret != -2) {
+            stream_request_idr(ctx, "queue drop");
+        }
+    }
+#endif
+}
+
+/* =========================================================================
+ *                              采集流水线 (非 Bind 模式)
+ * ========================================================================= */
+
+/**
+ * @brief VI 帧释放回调 (最后一个持有者处理完后调用)
+ * 
+ * @param ref 帧引用
+ */
+static void vi_frame_ref_release(FrameRef *ref) {
+    ViFrameRef *vf = (ViFrameRef *)ref->opaque;
+    const VideoConfig *cfg = vf->ctx->cfg;
+    
+    RK_MPI_VI_ReleaseChnFrame(cfg->vi_pipe_id, cfg->vi_chn_id, &vf->frame);
+    __atomic_store_n(&vf->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 为刚取到的 VI 帧分配引用槽位
+ * 
+ * @param ctx 流上下文
+ * @param frame GetChnFrame 返回的帧 (结构体被拷贝)
+ * @return ViFrameRef* 成功返回槽位 (引用计数为 1)，槽位用尽返回 NULL
+ */
+static ViFrameRef *vi_frame_ref_acquire(VideoStreamContext *ctx, const VIDEO_FRAME_INFO_S *frame) {
+    for (int i = 0; i < VI_CAPTURE_MAX_INFLIGHT; i++) {
+        ViFrameRef *vf = &ctx->vi_refs[i];
+        if (__atomic_load_n(&vf->in_use, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        
+        vf->ctx = ctx;
+        vf->frame = *frame;
+        frame_ref_init(&vf->ref, vi_frame_ref_release, vf);
+        __atomic_store_n(&vf->in_use, 1, __ATOMIC_RELAXED);
+        return vf;
+    }
+    return NULL;
+}
+
+static uint32_t elapsed_us(uint64_t start, uint64_t end) {
+    uint64_t d = end > start ? end - start : 0;
+    return d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+}
+
+/**
+ * @brief 采集线程 (非 Bind 模式)
+ * 
+ * 从 VI 取帧，把帧引用放入 raw_queue。队列满或槽位用尽时立即归还新帧，
+ * 不阻塞 VI，也不让 ISP 缓冲区被长时间占用。
+ * 
+ * @param arg VideoStreamContext 指针
+ */
+static void *vi_capture_thread(void *arg) {
+    VideoStreamContext *ctx = (VideoStreamContext *)arg;
+    const VideoConfig *cfg = ctx->cfg;
+    
+    video_set_thread_name("vi_cap%d", cfg->stream_id);
+    LOG_INFO("[VI-%d] Capture thread started for VENC %d\n", cfg->vi_chn_id, cfg->venc_chn_id);
+    
+    while (ctx->running && g_video_run) {
+        VIDEO_FRAME_INFO_S frame;
+        memset(&frame, 0, sizeof(frame));
+        if (RK_MPI_VI_GetChnFrame(cfg->vi_pipe_id, cfg->vi_chn_id, &frame,
+                                  THREAD_TIMEOUT_MS) != RK_SUCCESS) {
+            continue;
+        }
+        uint64_t now = monotonic_us();
+        __atomic_add_fetch(&ctx->vi_captured, 1, __ATOMIC_RELAXED);
+        
+        ViFrameRef *vf = vi_frame_ref_acquire(ctx, &frame);
+        if (!vf) {
+            RK_MPI_VI_ReleaseChnFrame(cfg->vi_pipe_id, cfg->vi_chn_id, &frame);
+            __atomic_add_fetch(&ctx->vi_dropped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        vf->capture_us = now;
+        
+        const VIDEO_FRAME_S *vframe = &vf->frame.stVFrame;
+        FrameData raw;
+        memset(&raw, 0, sizeof(raw));
+        raw.type = FRAME_TYPE_RAW_YUV;
+        raw.data = RK_MPI_MB_Handle2VirAddr(vframe->pMbBlk);
+        raw.size = (size_t)vframe->u32VirWidth * vframe->u32VirHeight * 3 / 2;
+        raw.pts = vframe->u64PTS;
+        raw.width = (int)vframe->u32Width;
+        raw.height = (int)vframe->u32Height;
+        raw.extra = &vf->ref;
+        
+        if (frame_queue_try_push(ctx->raw_queue, &raw) != 0) {
+            frame_data_release(&raw);
+            __atomic_add_fetch(&ctx->vi_dropped, 1, __ATOMIC_RELAXED);
+        }
+    }
+    
+    LOG_INFO("[VI-%d] Capture thread exiting\n", cfg->vi_chn_id);
+    return NULL;
+}
+
+#if APP_Test_PERF_MONITOR
+/**
+ * @brief 上报采集流水线统计 (送帧线程每秒调用一次)
+ * 
+ * @param ctx 流上下文
+ */
+static void vi_capture_report(VideoStreamContext *ctx) {
+    PipelineStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.captured = __atomic_load_n(&ctx->vi_captured, __ATOMIC_RELAXED);
+    stats.dropped = __atomic_load_n(&ctx->vi_dropped, __ATOMIC_RELAXED);
+    stats.sent = __atomic_load_n(&ctx->vi_sent, __ATOMIC_RELAXED);
+    
+    StageStats *st = &stats.stages[stats.stage_count++];
+    snprintf(st->name, sizeof(st->name), "queue");
+    latency_hist_summarize(&ctx->lat_queue, &st->latency);
+    
+    int count = frame_stage_graph_count(&ctx->stages);
+    for (int i = 0; i < count && stats.stage_count < PERF_MAX_STAGES - 2; i++) {
+        const FrameStageNode *stage = &ctx->stages.nodes[i];
+        st = &stats.stages[stats.stage_count++];
+        snprintf(st->name, sizeof(st->name), "%s", stage->name);
+        latency_hist_summarize(&stage->latency, &st->latency);
+        st->dropped = __atomic_load_n(&stage->dropped, __ATOMIC_RELAXED);
+    }
+    
+    st = &stats.stages[stats.stage_count++];
+    snprintf(st->name, sizeof(st->name), "send");
+    latency_hist_summarize(&ctx->lat_send, &st->latency);
+    st = &stats.stages[stats.stage_count++];
+    snprintf(st->name, sizeof(st->name), "total");
+    latency_hist_summarize(&ctx->lat_total, &st->latency);
+    
+    perf_update_pipeline_stats(ctx->cfg->stream_id, &stats);
+}
+#endif
+
+/**
+ * @brief 送帧线程 (非 Bind 模式)
+ * 
+ * 从 raw_queue 取出帧引用，依次执行串行阶段后 SendFrame 给 VENC，
+ * 再把帧分发给旁路阶段。VENC 自己持有 MB 引用直到编码完成，
+ * 这里随即释放自己的 VI 帧引用，旁路阶段处理完后最后一个引用归还 VI。
+ * 软件编码的码流不经过 VENC，串行阶段之后直接分发给旁路阶段 (其中包括编码器)。
+ * 
+ * @param arg VideoStreamContext 指针
+ */
+static void *vi_feed_thread(void *arg) {
+    VideoStreamContext *ctx = (VideoStreamContext *)arg;
+    const VideoConfig *cfg = ctx->cfg;
+    
+    video_set_thread_name("vi_feed%d", cfg->stream_id);
+    LOG_INFO("[VENC-%d] Feed thread started\n", cfg->venc_chn_id);
+    
+    while (ctx->running && g_video_run) {
+        FrameData raw;
+        int ret = frame_queue_pop(ctx->raw_queue, &raw, THREAD_TIMEOUT_MS);
+        if (ret == -2) break;   // 队列已关闭
+        if (ret != 0) continue; // 超时
+        
+        ViFrameRef *vf = (ViFrameRef *)((FrameRef *)raw.extra)->opaque;
+        const VIDEO_FRAME_S *vframe = &vf->frame.stVFrame;
+        latency_hist_record(&ctx->lat_queue, elapsed_us(vf->capture_us, monotonic_us()));
+        
+        VideoRawFrame view;
+        view.stream_id = cfg->stream_id;
+        view.mb = vframe->pMbBlk;
+        view.fd = RK_MPI_MB_Handle2Fd(vframe->pMbBlk);
+        view.vir_addr = raw.data;
+        view.width = raw.width;
+        view.height = raw.height;
+        view.wstride = (int)vframe->u32VirWidth;
+        view.hstride = (int)vframe->u32VirHeight;
+        view.pts = raw.pts;
+        
+        if (frame_stage_graph_run(&ctx->stages, &view) == 0) {
+            uint64_t send_start = monotonic_us();
+            // 软件编码没有 VENC 通道, 编码器本身是旁路阶段
+            if (ctx->soft_enc ||
+                RK_MPI_VENC_SendFrame(cfg->venc_chn_id, &vf->frame, THREAD_TIMEOUT_MS) == RK_SUCCESS) {
+                uint64_t send_end = monotonic_us();
+                latency_hist_record(&ctx->lat_send, elapsed_us(send_start, send_end));
+                latency_hist_record(&ctx->lat_total, elapsed_us(vf->capture_us, send_end));
+                __atomic_add_fetch(&ctx->vi_sent, 1, __ATOMIC_RELAXED);
+                frame_stage_graph_dispatch(&ctx->stages, &raw, &view);
+            } else {
+                __atomic_add_fetch(&ctx->vi_dropped, 1, __ATOMIC_RELAXED);
+            }
+        }
+        frame_data_release(&raw);
+        
+#if APP_Test_PERF_MONITOR
+        uint64_t now_ms = (uint64_t)rkipc_get_curren_time_ms();
+        if (now_ms - ctx->pipe_stat_last_ms >= 1000) {
+            ctx->pipe_stat_last_ms = now_ms;
+            vi_capture_report(ctx);
+        }
+#endif
+    }
+    
+    LOG_INFO("[VENC-%d] Feed thread exiting\n", cfg->venc_chn_id);
+    return NULL;
+}
+
+/**
+ * @brief 打印一个延迟直方图的汇总
+ */
+static void vi_capture_log_latency(const VideoStreamContext *ctx, const char *name,
+                                   const LatencyHist *hist) {
+    LatencyHistSummary sum;
+    latency_hist_summarize(hist, &sum);
+    if (sum.count == 0) return;
+    LOG_INFO("[VENC-%d] %-12s n=%u avg=%uus p50=%uus p95=%uus p99=%uus max=%uus\n",
+             ctx->cfg->venc_chn_id, name, sum.count, sum.avg_us, sum.p50_us, sum.p95_us,
+             sum.p99_us, sum.max_us);
+}
+
+/**
+ * @brief 打印采集流水线的累计统计 (线程退出后调用)
+ * 
+ * @param ctx 流上下文
+ */
+static void vi_capture_log_stats(const VideoStreamContext *ctx) {
+    LOG_INFO("[VENC-%d] Capture pipeline captured=%u dropped=%u sent=%u\n",
+             ctx->cfg->venc_chn_id, ctx->vi_captured, ctx->vi_dropped, ctx->vi_sent);
+    vi_capture_log_latency(ctx, "queue", &ctx->lat_queue);
+    for (int i = 0; i < frame_stage_graph_count(&ctx->stages); i++) {
+        const FrameStageNode *stage = &ctx->stages.nodes[i];
+        vi_capture_log_latency(ctx, stage->name, &stage->latency);
+        if (stage->dropped || stage->errors) {
+            LOG_INFO("[VENC-%d] %-12s dropped=%u errors=%u\n", ctx->cfg->venc_chn_id,
+                     stage->name, stage->dropped, stage->errors);
+        }
+    }
+    vi_capture_log_latency(ctx, "send", &ctx->lat_send);
+    vi_capture_log_latency(ctx, "total", &ctx->lat_total);
+}
+
+/* =========================================================================
+ *                              编码线程
+ * ========================================================================= */
+
+#if APP_Test_PERF_MONITOR
+/**
+ * @brief 码流队列占用 (广播环取最慢输出的未读帧数)
+ * 
+ * @param ctx 流上下文
+ * @param capacity 输出队列容量
+ * @return 未读帧数
+ */
+static int stream_queue_depth(VideoStreamContext *ctx, int *capacity) {
+#if APP_STREAM_FANOUT
+    int depth = 0;
+    for (int i = 0; i < ctx->output_count; i++) {
+        StreamConsumerStats stats;
+        if (!ctx->outputs[i].consumer) continue;
+        stream_consumer_get_stats(ctx->outputs[i].consumer, &stats);
+        if (stats.lag > depth) depth = stats.lag;
+    }
+    *capacity = STREAM_BROADCAST_CAPACITY;
+    return depth;
+#else
+    *capacity = STREAM_QUEUE_CAPACITY;
+    return frame_queue_size(ctx->stream_queue);
+#endif
+}
+
+/**
+ * @brief 上报本路码流一个统计窗口的视频统计
+ * 
+ * VI 帧率和丢帧取自 VI 通道状态 (缩放码流为源码流的 VI 通道)，
+ * 编码帧率、码率、帧类型和 QP 按本窗口实际输出的码流计算。
+ * 
+ * @param ctx 流上下文
+ * @param now_ms 当前时间
+ */
+static void stream_report_video_stats(VideoStreamContext *ctx, uint64_t now_ms) {
+    const VideoConfig *cfg = ctx->cfg;
+    uint64_t window_ms = now_ms - ctx->stat_last_ms;
+    VideoStats stats;
+    memset(&stats, 0, sizeof(stats));
+    
+    VI_CHN_STATUS_S vi_status;
+    memset(&vi_status, 0, sizeof(vi_status));
+    if (RK_MPI_VI_QueryChnStatus(cfg->vi_pipe_id, cfg->vi_chn_id, &vi_status) == RK_SUCCESS) {
+        stats.vi_fps = (float)vi_status.u32FrameRate;
+        stats.vi_lost = vi_status.u32InputLostFrame + vi_status.u32OutputLostFrame;
+        stats.vi_vb_fail = vi_status.u32VbFail;
+    } else {
+        stats.vi_fps = -1.0f;
+    }
+    
+    stats.venc_fps = (float)ctx->stat_frames * 1000.0f / (float)window_ms;
+    stats.venc_bitrate_kbps = (uint32_t)(ctx->stat_bytes * 8 / window_ms);
+    stats.i_frames = ctx->stat_iframes;
+    stats.p_frames = ctx->stat_frames - ctx->stat_iframes;
+    if (ctx->stat_qp_frames > 0) {
+        stats.qp_avg = (int)(ctx->stat_qp_sum / ctx->stat_qp_frames);
+        stats.qp_min = ctx->stat_qp_min;
+        stats.qp_max = ctx->stat_qp_max;
+    } else {
+        stats.qp_avg = stats.qp_min = stats.qp_max = -1;
+    }
+    
+    LatencyHistSummary size;
+    latency_hist_summarize(&ctx->frame_size, &size);
+    stats.size_avg = size.avg_us;
+    stats.size_p50 = size.p50_us;
+    stats.size_p95 = size.p95_us;
+    stats.size_max = size.max_us;
+    
+    if (!ctx->soft_enc) {
+        VENC_CHN_STATUS_S venc_status;
+        memset(&venc_status, 0, sizeof(venc_status));
+        if (RK_MPI_VENC_QueryStatus(cfg->venc_chn_id, &venc_status) == RK_SUCCESS) {
+            stats.venc_pending = (int)venc_status.u32LeftStreamFrames;
+        }
+    }
+    stats.queue_depth = stream_queue_depth(ctx, &stats.queue_capacity);
+    
+    perf_update_video_stats(cfg->stream_id, &stats);
+}
+#endif
+
+/**
+ * @brief 统计一帧编码输出 (每秒上报视频统计和缓冲池状态)
+ * 
+ * @param ctx 流上下文
+ * @param len 码流长度
+ * @param is_keyframe 是否为关键帧
+ * @param qp 本帧平均 QP (编码器未提供时为 -1)
+ */
+static void stream_account_frame(VideoStreamContext *ctx, size_t len, int is_keyframe, int qp) {
+#if APP_Test_PERF_MONITOR
+    const VideoConfig *cfg = ctx->cfg;
+    uint64_t now = (uint64_t)rkipc_get_curren_time_ms();
+    if (ctx->stat_last_ms == 0) ctx->stat_last_ms = now;
+    
+    ctx->stat_frames++;
+    ctx->stat_bytes += len;
+    if (is_keyframe) ctx->stat_iframes++;
+    if (qp >= 0) {
+        if (ctx->stat_qp_frames == 0 || qp < ctx->stat_qp_min) ctx->stat_qp_min = qp;
+        if (ctx->stat_qp_frames == 0 || qp > ctx->stat_qp_max) ctx->stat_qp_max = qp;
+        ctx->stat_qp_sum += (uint64_t)qp;
+        ctx->stat_qp_frames++;
+    }
+    latency_hist_record(&ctx->frame_size, len > UINT32_MAX ? UINT32_MAX : (uint32_t)len);
+    
+    if (now - ctx->stat_last_ms >= 1000) {
+        stream_report_video_stats(ctx, now);
+        
+        if (ctx->packet_pool) {
+            PacketPoolStats pool_stats;
+            PoolStats stats;
+            packet_pool_get_stats(ctx->packet_pool, &pool_stats);
+            memset(&stats, 0, sizeof(stats));
+            stats.hits = pool_stats.hits;
+            stats.misses = pool_stats.misses;
+            stats.in_use = pool_stats.in_use;
+            stats.high_water = pool_stats.high_water;
+            stats.capacity = pool_stats.capacity;
+            stats.budget_kb = pool_stats.budget_kb;
+            perf_update_pool_stats(cfg->stream_id, &stats);
+        }
+        
+        ctx->stat_last_ms = now;
+        ctx->stat_frames = 0;
+        ctx->stat_bytes = 0;
+        ctx->stat_iframes = 0;
+        ctx->stat_qp_frames = 0;
+        ctx->stat_qp_sum = 0;
+    }
+#else
+    (void)ctx;
+    (void)len;
+    (void)is_keyframe;
+    (void)qp;
+#endif
+}
+
+/**
+ * @brief 填写编码帧的描述 (不含数据指针)，关键帧清除挂起的 IDR 请求
+ * 
+ * @param ctx 流上下文
+ * @param frame 输出参数
+ * @param data 码流数据 (用于解析参数集)
+ * @param len 码流长度
+ * @param pts 时间戳
+ * @param is_keyframe 是否为关键帧
+ */
+static void stream_encoded_frame_init(VideoStreamContext *ctx, FrameData *frame, const void *data,
+                                      size_t len, uint64_t pts, int is_keyframe) {
+    memset(frame, 0, sizeof(*frame));
+    frame->type = FRAME_TYPE_ENCODED;
+    frame->pts = pts;
+    frame->size = len;
+    frame->is_keyframe = is_keyframe;
+    // 延迟跟踪以 VI 时间戳为起点, 第一个跟踪点是编码输出
+    frame->trace_us = pts;
+    frame->trace_us = stream_trace(ctx, FRAME_TRACE_ENCODE, frame);
+    // 解析帧头的参数集并缓存 (只读到第一个 slice 为止)
+    if (ctx->cfg->codec != APP_VIDEO_CODEC_MJPEG) {
+        frame->flags = param_set_scan(&ctx->param_sets, (const uint8_t *)data, len);
+    }
+    
+    // 关键帧满足此前所有 IDR 请求 (必须在交付前清除, 交付中产生的请求需要下一个关键帧)
+    if (is_keyframe) {
+        __atomic_store_n(&ctx->idr_pending, 0, __ATOMIC_RELEASE);
+        ctx->idr_last_ms = (uint64_t)rkipc_get_curren_time_ms();
+    }
+}
+
+/**
+ * @brief 处理一次 GetStream 得到的码流 (封装、交付，按需归还码流包)
+ * 
+ * 编码线程与收割线程共用。
+ * 
+ * @param ctx 流上下文
+ * @param stream GetStream 返回的码流
+ */
+static void venc_process_stream(VideoStreamContext *ctx, VENC_STREAM_S *stream) {
+    const VideoConfig *cfg = ctx->cfg;
+    
+    void *data = RK_MPI_MB_Handle2VirAddr(stream->pstPack->pMbBlk);
+    size_t len = stream->pstPack->u32Len;
+    int is_keyframe = (stream->pstPack->DataType.enH264EType == H264E_NALU_ISLICE ||
+                       stream->pstPack->DataType.enH264EType == H264E_NALU_IDRSLICE ||
+                       stream->pstPack->DataType.enH265EType == H265E_NALU_ISLICE ||
+                       stream->pstPack->DataType.enH265EType == H265E_NALU_IDRSLICE);
+    // 编码器未统计 QP 时为 0
+    RK_U32 mean_qp = cfg->codec == APP_VIDEO_CODEC_H265 ? stream->stH265Info.u32MeanQp
+                                                        : stream->stH264Info.u32MeanQp;
+    
+    stream_account_frame(ctx, len, is_keyframe, mean_qp > 0 ? (int)mean_qp : -1);
+    
+    int handed_off = 0;  // 码流包所有权是否已转交给引用
+    
+    if (data && len > 0) {
+        // 封装编码帧
+        FrameData stream_frame;
+        stream_encoded_frame_init(ctx, &stream_frame, data, len, stream->pstPack->u64PTS,
+                                  is_keyframe);
+        
+#if APP_VENC_ZERO_COPY
+        // 优先直接引用码流包, 在途数量达到上限时回退为拷贝
+        VencStreamRef *zc = venc_stream_ref_acquire(ctx, stream);
+        if (zc) {
+            stream_frame.data = data;
+            stream_frame.extra = &zc->ref;
+            handed_off = 1;
+            ctx->zc_frames++;
+        } else
+#endif
+        {
+            // 从缓冲池分配内存并拷贝数据 (因为码流缓冲区会被复用)
+            if (packet_pool_alloc(ctx->packet_pool, len, &stream_frame) == 0) {
+                memcpy(stream_frame.data, data, len);
+                ctx->copy_frames++;
+            }
+        }
+        
+        if (stream_frame.data) {
+            stream_deliver(ctx, &stream_frame);
+        }
+    }
+    
+    // 释放码流资源 (零拷贝时由最后一个消费者释放)
+    if (!handed_off) {
+        RK_MPI_VENC_ReleaseStream(cfg->venc_chn_id, stream);
+    }
+}
+
+#if !APP_VENC_HARVESTER
+/**
+ * @brief 视频编码线程函数
+ * 
+ * 从 raw_queue 获取原始帧，送入 VENC 编码器，获取编码后码流并推送到 stream_queue。
+ * 
+ * 注意：由于使用了 Bind 模式，这里改为直接从 VENC 获取码流。
+ * Non-Bind 模式需要手动调用 RK_MPI_VENC_SendFrame。
+ * 
+ * @param arg VideoStreamContext 指针
+ */
+static void *venc_encode_thread(void *arg) {
+    VideoStreamContext *ctx = (VideoStreamContext *)arg;
+    const VideoConfig *cfg = ctx->cfg;
+    
+    video_set_thread_name("venc%d", cfg->stream_id);
+    LOG_INFO("[VENC-%d] Encode thread started\n", cfg->venc_chn_id);
+    
+    while (ctx->running && g_video_run) {
+        uint64_t now_ms = (uint64_t)rkipc_get_curren_time_ms();
+        venc_service_reconfig(ctx, now_ms);
+#if APP_ABR_ENABLE
+        venc_service_abr(ctx, now_ms);
+#endif
+        venc_service_idr(ctx, now_ms);
+        
+        // 从 VENC 获取编码后的码流
+        int ret = RK_MPI_VENC_GetStream(cfg->venc_chn_id, &ctx->venc_stream, THREAD_TIMEOUT_MS);
+        if (ret != RK_SUCCESS) {
+            // 超时或缓冲区空时不打印警告日志
+            if (ret != RK_ERR_VENC_BUF_EMPTY) {
+                /* LOG_WARN("[VENC-%d] GetStream ret: 0x%x\n", cfg->venc_chn_id, ret); */
+            }
+            continue;
+        }
+        
+        venc_process_stream(ctx, &ctx->venc_stream);
+    }
+    
+    LOG_INFO("[VENC-%d] Encode thread exiting\n", cfg->venc_chn_id);
+    return NULL;
+}
+#else
+/**
+ * @brief 收割线程回调: 取走本通道当前已就绪的码流
+ * 
+ * 每次最多处理 APP_VENC_STREAM_BUF_CNT 个码流包，避免单个通道占住收割线程；
+ * 剩余的码流由水平触发的 epoll 在下一轮继续处理。
+ * 
+ * @param arg VideoStreamContext 指针
+ */
+static void venc_drain_channel(void *arg) {
+    VideoStreamContext *ctx = (VideoStreamContext *)arg;
+    
+    if (!ctx->running) return;
+    uint64_t now_ms = (uint64_t)rkipc_get_curren_time_ms();
+    venc_service_reconfig(ctx, now_ms);
+#if APP_ABR_ENABLE
+    venc_service_abr(ctx, now_ms);
+#endif
+    venc_service_idr(ctx, now_ms);
+    
+    for (int i = 0; i < APP_VENC_STREAM_BUF_CNT && ctx->running; i++) {
+        if (RK_MPI_VENC_GetStream(ctx->cfg->venc_chn_id, &ctx->venc_stream, 0) != RK_SUCCESS) {
+            break;
+        }
+        venc_process_stream(ctx, &ctx->venc_stream);
+    }
+}
+#endif
+
+/* =========================================================================
+ *                              软件编码
+ * ========================================================================= */
+
+/**
+ * @brief 软件编码器输出回调: 拷贝到缓冲池后交给输出
+ * 
+ * @param pkt 编码输出
+ * @param arg VideoStreamContext 指针
+ */
+static void soft_encoder_on_packet(const SoftEncoderPacket *pkt, void *arg) {
+    VideoStreamContext *ctx = (VideoStreamContext *)arg;
+    
+    stream_account_frame(ctx, pkt->size, pkt->is_keyframe, pkt->qp);
+    if (pkt->size == 0) return;
+    
+    FrameData stream_frame;
+    stream_encoded_frame_init(ctx, &stream_frame, pkt->data, pkt->size, pkt->pts,
+                              pkt->is_keyframe);
+    if (packet_pool_alloc(ctx->packet_pool, pkt->size, &stream_frame) == 0) {
+        memcpy(stream_frame.data, pkt->data, pkt->size);
+        ctx->copy_frames++;
+        stream_deliver(ctx, &stream_frame);
+    }
+}
+
+/**
+ * @brief 软件编码旁路阶段: 代替编码线程处理重配置/自适应码率/IDR 后编码一帧
+ * 
+ * 由阶段图串行调用 (同一时刻只在一个工作线程中执行)，编码器状态无需加锁。
+ * 
+ * @param frame 原始帧 (只读)
+ * @param arg VideoStreamContext 指针
+ * @return 0 成功，-1 编码失败 (计入阶段错误)
+ */
+static int soft_encode_stage(VideoRawFrame *frame, void *arg) {
+    VideoStreamContext *ctx = (VideoStreamContext *)arg;
+    
+    uint64_t now_ms = (uint64_t)rkipc_get_curren_time_ms();
+    venc_service_reconfig(ctx, now_ms);
+#if APP_ABR_ENABLE
+    venc_service_abr(ctx, now_ms);
+#endif
+    venc_service_idr(ctx, now_ms);
+    
+    int force_key = ctx->soft_idr;
+    ctx->soft_idr = 0;
+    return soft_encoder_encode(ctx->soft_enc, frame, force_key) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief 创建软件编码器并注册为旁路阶段 (代替 venc_init)
+ * 
+ * 编码跟不上时旁路阶段跳过新帧，不阻塞采集流水线。
+ * 
+ * @param ctx 流上下文
+ * @return 0 成功，-1 失败
+ */
+static int soft_encoder_setup(VideoStreamContext *ctx) {
+    const VideoConfig *cfg = ctx->cfg;
+    const VideoConfig *src = cfg->scale_from >= 0 ? app_video_config_find(cfg->scale_from) : cfg;
+    
+    SoftEncoderConfig enc_cfg;
+    memset(&enc_cfg, 0, sizeof(enc_cfg));
+    enc_cfg.codec = cfg->codec == APP_VIDEO_CODEC_MJPEG ? SOFT_ENCODER_MJPEG : SOFT_ENCODER_H264;
+    enc_cfg.width = cfg->width;
+    enc_cfg.height = cfg->height;
+    enc_cfg.src_fps = src ? src->fps : cfg->fps;
+    enc_cfg.fps = cfg->fps;
+    enc_cfg.bitrate = cfg->bitrate;
+    enc_cfg.gop = cfg->gop;
+    enc_cfg.threads = APP_SOFT_ENCODER_THREADS;
+    ctx->soft_enc = soft_encoder_create(&enc_cfg, soft_encoder_on_packet, ctx);
+    if (!ctx->soft_enc) {
+        LOG_ERROR("[STREAM-%d] Failed to create soft encoder\n", cfg->stream_id);
+        return -1;
+    }
+    ctx->venc_src_fps = enc_cfg.src_fps;
+    
+    VideoStageOps ops;
+    VideoStageInfo info;
+    memset(&ops, 0, sizeof(ops));
+    ops.name = "soft_enc";
+    ops.mode = VIDEO_STAGE_TAP;
+    ops.access = VIDEO_STAGE_ACCESS_CPU;
+    ops.may_drop = 1;
+    ops.process = soft_encode_stage;
+    info.stream_id = cfg->stream_id;
+    info.width = cfg->width;
+    info.height = cfg->height;
+    info.fps = cfg->fps;
+    return frame_stage_graph_add(&ctx->stages, &ops, ctx, &info);
+}
+
+/* =========================================================================
+ *                              码流输出
+ * ========================================================================= */
+
+#if APP_Test_RTSP
+/**
+ * @brief RTSP 发送线程发完引用帧后归还引用
+ */
+static void output_rtsp_release(void *opaque) {
+    FrameData frame = {0};
+    frame.extra = opaque;
+    frame_data_release(&frame);
+}
+
+/**
+ * @brief RTSP 入队队列统计 (供自适应码率采样)
+ */
+static int output_rtsp_queue_stats(StreamOutput *out, int *depth, int *capacity, uint32_t *drops) {
+    rkipc_rtsp_stats stats;
+    if (rkipc_rtsp_get_stats(out->ctx->cfg->stream_id, &stats) != 0) return -1;
+    
+    *depth = (int)stats.depth;
+    *capacity = (int)stats.capacity;
+    *drops = stats.dropped;
+    return 0;
+}
+
+/**
+ * @brief RTSP 输出: 将 VENC 时间戳换算为系统时间后推送
+ *
+ * 引用帧 (VENC 零拷贝包或缓冲池帧) 增加引用后直接入队，RTP 负载从该缓冲区发出，
+ * 码流在编码线程与 socket 之间不拷贝；没有引用的帧退回拷贝入队。
+ */
+static void output_rtsp_write(StreamOutput *out, const FrameData *frame) {
+    VideoStreamContext *ctx = out->ctx;
+    
+    // 初始化 RTSP 时间戳基准（首帧逻辑）
+    if (ctx->rtsp_base_time_us < 0) {
+        ctx->rtsp_base_time_us = get_realtime_us();
+        ctx->rtsp_base_pts = (int64_t)frame->pts;
+    }
+    
+    // 计算当前帧相对于首帧的时间偏移，转换成绝对系统时间推送给 RTSP
+    int64_t pts_offset = (int64_t)frame->pts - ctx->rtsp_base_pts;
+    int64_t rtsp_pts = ctx->rtsp_base_time_us + pts_offset;
+    
+    if (frame->extra) {
+        FrameData ref = *frame;
+        frame_data_retain(&ref);
+        rkipc_rtsp_write_video_frame_ref(ctx->cfg->stream_id, frame->data, frame->size, rtsp_pts,
+                                         output_rtsp_release, ref.extra);
+    } else {
+        rkipc_rtsp_write_video_frame(ctx->cfg->stream_id, frame->data, frame->size, rtsp_pts);
+    }
+    stream_trace(ctx, FRAME_TRACE_RTSP_TX, frame);
+}
+#endif
+
+#if APP_Test_RTMP
+/**
+ * @brief RTMP 输出
+ */
+static void output_rtmp_write(StreamOutput *out, const FrameData *frame) {
+    rk_rtmp_write_video_frame(out->ctx->cfg->stream_id, frame->data, frame->size,
+                              frame->pts, frame->is_keyframe);
+    stream_trace(out->ctx, FRAME_TRACE_RTMP_TX, frame);
+}
+
+/**
+ * @brief 重建 RTMP 会话 (FLV 元数据中的码率/帧率随之更新)
+ */
+static void output_rtmp_reopen(StreamOutput *out) {
+    const VideoConfig *cfg = out->ctx->cfg;
+    
+    rk_rtmp_deinit(cfg->stream_id);
+    if (rk_rtmp_init(cfg->stream_id, cfg->rtmp_url) != 0) {
+        LOG_WARN("[STREAM-%d] Failed to reopen RTMP session\n", cfg->stream_id);
+    }
+}
+#endif
+
+#if APP_Test_SAVE_FILE == 1
+/**
+ * @brief 录像输出: 保存裸码流文件
+ */
+static void output_file_write(StreamOutput *out, const FrameData *frame) {
+    if (out->fp) {
+        fwrite(frame->data, 1, frame->size, out->fp);
+        fflush(out->fp);
+    }
+}
+#endif
+
+/**
+ * @brief 抓图输出: 每帧 JPEG 写入临时文件后改名覆盖 output_path，读者总能拿到完整的一张
+ */
+static void output_snapshot_write(StreamOutput *out, const FrameData *frame) {
+    const char *path = out->ctx->cfg->output_path;
+    char tmp_path[160];
+    
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) return;
+    size_t written = fwrite(frame->data, 1, frame->size, fp);
+    if (fclose(fp) == 0 && written == frame->size) {
+        rename(tmp_path, path);
+    } else {
+        unlink(tmp_path);
+    }
+}
+
+/**
+ * @brief 按配置注册本路码流的输出
+ * 
+ * @param ctx 流上下文
+ */
+static void stream_outputs_setup(VideoStreamContext *ctx) {
+    const VideoConfig *cfg = ctx->cfg;
+    StreamOutput *out = NULL;
+    
+    ctx->output_count = 0;
+    
+    // MJPEG 码流只有抓图输出
+    if (cfg->codec == APP_VIDEO_CODEC_MJPEG) {
+        out = &ctx->outputs[ctx->output_count++];
+        out->name = "snapshot";
+        out->write = output_snapshot_write;
+        out->ctx = ctx;
+        return;
+    }
+    
+#if APP_Test_RTSP
+    if (cfg->enable_rtsp) {
+        out = &ctx->outputs[ctx->output_count++];
+        out->name = "rtsp";
+        out->write = output_rtsp_write;
+        out->queue_stats = output_rtsp_queue_stats;
+        out->adaptive = APP_ABR_WATCH_RTSP;
+    }
+#endif
+
+#if APP_Test_RTMP
+    if (cfg->enable_rtmp) {
+        out = &ctx->outputs[ctx->output_count++];
+        out->name = "rtmp";
+        out->write = output_rtmp_write;
+        out->reopen = output_rtmp_reopen;
+        out->adaptive = 1;
+    }
+#endif
+
+#if APP_Test_SAVE_FILE == 1
+    if (cfg->output_path && cfg->output_path[0] != '\0') {
+        out = &ctx->outputs[ctx->output_count++];
+        out->name = "file";
+        out->write = output_file_write;
+        out->fp = fopen(cfg->output_path, "wb");
+        if (!out->fp) {
+            LOG_ERROR("[STREAM-%d] Failed to open output file %s\n", cfg->stream_id, cfg->output_path);
+        }
+    }
+#endif
+
+    for (int i = 0; i < ctx->output_count; i++) {
+        ctx->outputs[i].ctx = ctx;
+    }
+    (void)out;
+    (void)cfg;
+}
+
 /**
- * @brief 获取当前系统微秒级时间戳
+ * @brief 关闭本路码流的输出资源
  * 
- * @return int64_t 当前时间的微秒数 (Unix Epoch)
+ * @param ctx 流上下文
  */
-static int64_t get_realtime_us(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+static void stream_outputs_teardown(VideoStreamContext *ctx) {
+    for (int i = 0; i < ctx->output_count; i++) {
+        StreamOutput *out = &ctx->outputs[i];
+        if (out->consumer) {
+            stream_broadcast_detach(out->consumer);
+            out->consumer = NULL;
+        }
+        if (out->fp) {
+            fclose(out->fp);
+            out->fp = NULL;
+        }
+    }
+    ctx->output_count = 0;
 }
-#endif
 
-/* =========================================================================
- *                              编码线程
- * ========================================================================= */
+/**
+ * @brief 写入一帧并统计写入耗时 (供自适应码率采样)
+ * 
+ * @param out 输出
+ * @param frame 码流帧
+ */
+static void stream_output_write(StreamOutput *out, const FrameData *frame) {
+    if (!out->adaptive) {
+        out->write(out, frame);
+        return;
+    }
+    
+    uint64_t start = monotonic_us();
+    out->write(out, frame);
+    uint64_t cost = monotonic_us() - start;
+    if (cost > UINT32_MAX) cost = UINT32_MAX;
+    
+    // 1/8 权重的滑动平均, 只由本输出的写线程更新
+    uint32_t avg = __atomic_load_n(&out->write_us, __ATOMIC_RELAXED);
+    avg = (uint32_t)(((uint64_t)avg * 7 + cost) / 8);
+    __atomic_store_n(&out->write_us, avg, __ATOMIC_RELAXED);
+}
 
 /**
- * @brief 视频编码线程函数
+ * @brief 处理输出的会话重建请求
  * 
- * 从 raw_queue 获取原始帧，送入 VENC 编码器，获取编码后码流并推送到 stream_queue。
+ * @param out 输出
+ * @return 1 已重建 (调用者需从下一个关键帧重新开始输出)，0 无需处理
+ */
+static int stream_output_service_reopen(StreamOutput *out) {
+    if (!out->reopen || !__atomic_exchange_n(&out->reopen_pending, 0, __ATOMIC_ACQ_REL)) {
+        return 0;
+    }
+    LOG_INFO("[STREAM-%d] Reopening %s output\n", out->ctx->cfg->stream_id, out->name);
+    out->reopen(out);
+    return 1;
+}
+
+#if APP_STREAM_FANOUT
+/**
+ * @brief 输出线程函数 (每个输出一个)
  * 
- * 注意：由于使用了 Bind 模式，这里改为直接从 VENC 获取码流。
- * Non-Bind 模式需要手动调用 RK_MPI_VENC_SendFrame。
+ * 从广播环读取码流并写入该输出。写入阻塞 (如 RTMP 上行拥塞) 只会让本输出落后，
+ * 落后超过广播环容量后本输出丢帧并从下一个关键帧继续，不影响其他输出。
  * 
- * @param arg VideoStreamContext 指针
+ * @param arg StreamOutput 指针
  */
-static void *venc_encode_thread(void *arg) {
-    VideoStreamContext *ctx = (VideoStreamContext *)arg;
+static void *stream_output_thread(void *arg) {
+    StreamOutput *out = (StreamOutput *)arg;
+    VideoStreamContext *ctx = out->ctx;
     const VideoConfig *cfg = ctx->cfg;
     
-#if APP_Test_PERF_MONITOR
-    // 性能监控变量
-    uint64_t last_stat_time = 0;
-    int frame_count = 0;
-    uint64_t total_bytes = 0;
-#endif
-
-    LOG_INFO("[VENC-%d] Encode thread started\n", cfg->venc_chn_id);
-    
-    VENC_STREAM_S stStream;
-    memset(&stStream, 0, sizeof(stStream));
-    stStream.pstPack = malloc(sizeof(VENC_PACK_S));
-    if (!stStream.pstPack) {
-        LOG_ERROR("[VENC-%d] Failed to allocate VENC pack memory\n", cfg->venc_chn_id);
-        return NULL;
-    }
+    video_set_thread_name("out%d_%s", cfg->stream_id, out->name);
+    LOG_INFO("[STREAM-%d] Output thread %s started\n", cfg->stream_id, out->name);
     
     while (ctx->running && g_video_run) {
-        // 从 VENC 获取编码后的码流
-        int ret = RK_MPI_VENC_GetStream(cfg->venc_chn_id, &stStream, THREAD_TIMEOUT_MS);
-        if (ret != RK_SUCCESS) {
-            // 超时或缓冲区空时不打印警告日志
-            if (ret != RK_ERR_VENC_BUF_EMPTY) {
-                /* LOG_WARN("[VENC-%d] GetStream ret: 0x%x\n", cfg->venc_chn_id, ret); */
-            }
-            continue;
-        }
-        
-        void *data = RK_MPI_MB_Handle2VirAddr(stStream.pstPack->pMbBlk);
-        size_t len = stStream.pstPack->u32Len;
+        FrameData stream_frame;
         
-#if APP_Test_PERF_MONITOR
-        // 仅在主码流 (chn 0) 进行统计
-        if (cfg->venc_chn_id == 0) {
-            uint64_t now = (uint64_t)rkipc_get_curren_time_ms();
-            if (last_stat_time == 0) last_stat_time = now;
-            
-            frame_count++;
-            total_bytes += len;
-            
-            if (now - last_stat_time >= 1000) {
-                float fps = (float)frame_count * 1000.0f / (float)(now - last_stat_time);
-                uint32_t bitrate_kbps = (uint32_t)(total_bytes * 8 / 1000);
-                
-                // 暂时假设 VI 帧率与 FPS 相近 (实际应从 VI 线程获取)
-                perf_update_video_stats(fps, fps, bitrate_kbps);
-                
-                last_stat_time = now;
-                frame_count = 0;
-                total_bytes = 0;
-            }
+        if (stream_output_service_reopen(out)) {
+            stream_consumer_request_start(out->consumer);
         }
-#endif
         
-        if (data && len > 0) {
-            // 封装编码帧
-            FrameData stream_frame;
-            memset(&stream_frame, 0, sizeof(stream_frame));
-            stream_frame.type = FRAME_TYPE_ENCODED;
-            stream_frame.pts = stStream.pstPack->u64PTS;
-            stream_frame.size = len;
-            stream_frame.is_keyframe = (stStream.pstPack->DataType.enH264EType == H264E_NALU_ISLICE ||
-                                        stStream.pstPack->DataType.enH264EType == H264E_NALU_IDRSLICE ||
-                                        stStream.pstPack->DataType.enH265EType == H265E_NALU_ISLICE ||
-                                        stStream.pstPack->DataType.enH265EType == H265E_NALU_IDRSLICE);
-            
-            // 分配内存并拷贝数据 (因为码流缓冲区会被复用)
-            stream_frame.data = malloc(len);
-            if (stream_frame.data) {
-                memcpy(stream_frame.data, data, len);
-                
-                // 推送到流队列
-                if (frame_queue_push(ctx->stream_queue, &stream_frame, THREAD_TIMEOUT_MS) != 0) {
-                    LOG_WARN("[VENC-%d] Stream queue push failed\n", cfg->venc_chn_id);
-                    free(stream_frame.data);
-                }
-            }
-        }
+        int ret = stream_consumer_read(out->consumer, &stream_frame, THREAD_TIMEOUT_MS);
+        if (ret == -2) break;   // 广播环已关闭
+        if (ret != 0) continue; // 超时
+        stream_frame.trace_us = stream_trace(ctx, FRAME_TRACE_POP, &stream_frame);
         
-        // 释放码流资源
-        RK_MPI_VENC_ReleaseStream(cfg->venc_chn_id, &stStream);
+        stream_frame_prepare_start(ctx, &stream_frame);
+        if (stream_frame.data && stream_frame.size > 0) {
+            stream_output_write(out, &stream_frame);
+        }
+        frame_data_release(&stream_frame);
     }
     
-    if (stStream.pstPack) free(stStream.pstPack);
-    
-    LOG_INFO("[VENC-%d] Encode thread exiting\n", cfg->venc_chn_id);
+    StreamConsumerStats stats;
+    stream_consumer_get_stats(out->consumer, &stats);
+    LOG_INFO("[STREAM-%d] Output thread %s exiting (frames=%u, dropped=%u, resyncs=%u)\n",
+             cfg->stream_id, out->name, stats.frames, stats.dropped, stats.resyncs);
     return NULL;
 }
-
-/* =========================================================================
- *                              推流线程
- * ========================================================================= */
-
+#else
 /**
- * @brief RTSP 推流线程函数
+ * @brief 推流线程函数
  * 
- * 从 stream_queue 获取编码后码流，推送到 RTSP 服务器。
+ * 从 stream_queue 获取编码后码流，依次写入所有输出 (RTSP / RTMP / 录像)。
  * 
  * @param arg VideoStreamContext 指针
  */
 static void *rtsp_push_thread(void *arg) {
     VideoStreamContext *ctx = (VideoStreamContext *)arg;
     const VideoConfig *cfg = ctx->cfg;
-    FILE *fp = NULL;
     
+    video_set_thread_name("push%d", cfg->stream_id);
     LOG_INFO("[STREAM-%d] Push thread started (RTSP=%d, RTMP=%d)\n", 
              cfg->stream_id, cfg->enable_rtsp, cfg->enable_rtmp);
     
-#if APP_Test_SAVE_FILE == 1
-    if (cfg->output_path && cfg->output_path[0] != '\0') {
-        fp = fopen(cfg->output_path, "wb");
-        if (!fp) {
-            LOG_ERROR("[STREAM-%d] Failed to open output file %s\n", cfg->stream_id, cfg->output_path);
-        }
-    }
-#endif
+    int started = 0;  // 是否已输出过关键帧
     
     while (ctx->running && g_video_run) {
         FrameData stream_frame;
@@ -274,60 +1692,40 @@ static void *rtsp_push_thread(void *arg) {
         if (ret != 0) {
             continue;  // 超时或队列关闭
         }
+        stream_frame.trace_us = stream_trace(ctx, FRAME_TRACE_POP, &stream_frame);
         
-#if APP_Test_RTSP
-        if (cfg->enable_rtsp && stream_frame.data && stream_frame.size > 0) {
-            // 初始化 RTSP 时间戳基准（首帧逻辑）
-            if (ctx->rtsp_base_time_us < 0) {
-                ctx->rtsp_base_time_us = get_realtime_us();
-                ctx->rtsp_base_pts = (int64_t)stream_frame.pts;
-            }
-            
-            // 计算当前帧相对于首帧的时间偏移，转换成绝对系统时间推送给 RTSP
-            int64_t pts_offset = (int64_t)stream_frame.pts - ctx->rtsp_base_pts;
-            int64_t rtsp_pts = ctx->rtsp_base_time_us + pts_offset;
-            
-            rkipc_rtsp_write_video_frame(cfg->stream_id, stream_frame.data, 
-                                          stream_frame.size, rtsp_pts);
-        }
-#endif
-
-#if APP_Test_RTMP
-        // RTMP 推流
-        if (cfg->enable_rtmp && stream_frame.data && stream_frame.size > 0) {
-            rk_rtmp_write_video_frame(cfg->stream_id, stream_frame.data, 
-                                      stream_frame.size,
-                                      stream_frame.pts,
-                                      stream_frame.is_keyframe);
+        // 第一个关键帧同样是解码起点 (丢帧后的起点由队列标记)
+        if (stream_frame.is_keyframe) {
+            if (!started) stream_frame.flags |= FRAME_FLAG_START;
+            started = 1;
         }
-#endif
+        stream_frame_prepare_start(ctx, &stream_frame);
         
-#if APP_Test_SAVE_FILE == 1
-        if (fp && stream_frame.data && stream_frame.size > 0) {
-            fwrite(stream_frame.data, 1, stream_frame.size, fp);
-            fflush(fp);
+        if (stream_frame.data && stream_frame.size > 0) {
+            for (int i = 0; i < ctx->output_count; i++) {
+                StreamOutput *out = &ctx->outputs[i];
+                if (stream_output_service_reopen(out)) {
+                    out->wait_keyframe = 1;
+                }
+                if (out->wait_keyframe) {
+                    if (!stream_frame.is_keyframe) continue;
+                    out->wait_keyframe = 0;
+                }
+                stream_output_write(out, &stream_frame);
+            }
         }
-#endif
         
-        // 释放帧数据内存
-        if (stream_frame.data) {
-            free(stream_frame.data);
-        }
+        // 所有消费者处理完毕, 释放帧 (拷贝帧 free, 零拷贝帧归还码流包)
+        frame_data_release(&stream_frame);
     }
     
     // 处理队列中剩余的帧
-    FrameData stream_frame;
-    while (frame_queue_try_pop(ctx->stream_queue, &stream_frame) == 0) {
-        if (stream_frame.data) {
-            free(stream_frame.data);
-        }
-    }
-    
-    if (fp) fclose(fp);
+    stream_queue_drain(ctx->stream_queue);
     
     LOG_INFO("[STREAM-%d] Push thread exiting\n", cfg->stream_id);
     return NULL;
 }
+#endif
 
 /* =========================================================================
  *                              硬件初始化相关
@@ -388,7 +1786,8 @@ static int vi_chn_init(const VideoConfig *cfg) {
 
     memset(&chn_attr, 0, sizeof(chn_attr));
     
-    chn_attr.stIspOpt.u32BufCount = 4;
+    // 非 Bind 模式下应用层和 VENC 都会持有 VI 帧, 需要更多缓冲区轮转
+    chn_attr.stIspOpt.u32BufCount = cfg->vi_capture ? VI_CAPTURE_BUF_COUNT : 4;
     chn_attr.stIspOpt.enMemoryType = VI_V4L2_MEMORY_TYPE_DMABUF;
     
     chn_attr.stSize.u32Width = cfg->width;
@@ -429,25 +1828,9 @@ static int venc_init(const VideoConfig *cfg) {
 
     memset(&venc_attr, 0, sizeof(venc_attr));
 
-    if (cfg->codec == APP_VIDEO_CODEC_H265) {
-        venc_attr.stVencAttr.enType = RK_VIDEO_ID_HEVC;
-        venc_attr.stRcAttr.enRcMode = VENC_RC_MODE_H265CBR;
-        venc_attr.stRcAttr.stH265Cbr.u32Gop = cfg->gop;
-        venc_attr.stRcAttr.stH265Cbr.u32BitRate = cfg->bitrate;
-        venc_attr.stRcAttr.stH265Cbr.fr32DstFrameRateNum = cfg->fps;
-        venc_attr.stRcAttr.stH265Cbr.fr32DstFrameRateDen = 1;
-        venc_attr.stRcAttr.stH265Cbr.u32SrcFrameRateNum = cfg->fps;
-        venc_attr.stRcAttr.stH265Cbr.u32SrcFrameRateDen = 1;
-    } else {
-        venc_attr.stVencAttr.enType = RK_VIDEO_ID_AVC;
-        venc_attr.stRcAttr.enRcMode = VENC_RC_MODE_H264CBR;
-        venc_attr.stRcAttr.stH264Cbr.u32Gop = cfg->gop;
-        venc_attr.stRcAttr.stH264Cbr.u32BitRate = cfg->bitrate;
-        venc_attr.stRcAttr.stH264Cbr.fr32DstFrameRateNum = cfg->fps;
-        venc_attr.stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
-        venc_attr.stRcAttr.stH264Cbr.u32SrcFrameRateNum = cfg->fps;
-        venc_attr.stRcAttr.stH264Cbr.u32SrcFrameRateDen = 1;
-    }
+    venc_attr.stVencAttr.enType = cfg->codec == APP_VIDEO_CODEC_H265 ?
+                                  RK_VIDEO_ID_HEVC : RK_VIDEO_ID_AVC;
+    venc_fill_rc_attr(&venc_attr.stRcAttr, cfg->codec, cfg->bitrate, cfg->fps, cfg->fps, cfg->gop);
 
     venc_attr.stVencAttr.enPixelFormat = RK_FMT_YUV420SP;
     venc_attr.stVencAttr.u32PicWidth = cfg->width;
@@ -455,7 +1838,7 @@ static int venc_init(const VideoConfig *cfg) {
     venc_attr.stVencAttr.u32VirWidth = cfg->width;
     venc_attr.stVencAttr.u32VirHeight = cfg->height;
     
-    venc_attr.stVencAttr.u32StreamBufCnt = 5;
+    venc_attr.stVencAttr.u32StreamBufCnt = APP_VENC_STREAM_BUF_CNT;
     venc_attr.stVencAttr.u32BufSize = cfg->width * cfg->height * 3 / 2;
 
     if (RK_MPI_VENC_CreateChn(cfg->venc_chn_id, &venc_attr) != RK_SUCCESS) {
@@ -473,6 +1856,77 @@ static int venc_init(const VideoConfig *cfg) {
     return 0;
 }
 
+/**
+ * @brief 查找码流使用的 VI 源通道
+ * 
+ * @param cfg 码流配置
+ * @return ViSource* 未初始化时返回 NULL
+ */
+static ViSource *vi_source_find(const VideoConfig *cfg) {
+    for (int i = 0; i < g_vi_source_count; i++) {
+        const VideoConfig *src = g_vi_sources[i].cfg;
+        if (src->vi_dev_id == cfg->vi_dev_id && src->vi_pipe_id == cfg->vi_pipe_id &&
+            src->vi_chn_id == cfg->vi_chn_id) {
+            return &g_vi_sources[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 获取码流使用的 VI 源通道 (首次使用时初始化设备和通道)
+ * 
+ * VI→VENC 为硬件 Bind，VENC 不做缩放，共用 VI 通道的码流分辨率必须一致。
+ * 
+ * @param cfg 码流配置
+ * @return ViSource* 失败返回 NULL
+ */
+static ViSource *vi_source_get(const VideoConfig *cfg) {
+    ViSource *src = vi_source_find(cfg);
+    if (src) {
+        if (src->cfg->width != cfg->width || src->cfg->height != cfg->height) {
+            LOG_ERROR("Stream %d (%dx%d) cannot share VI chn %d with stream %d (%dx%d)\n",
+                      cfg->stream_id, cfg->width, cfg->height, cfg->vi_chn_id,
+                      src->cfg->stream_id, src->cfg->width, src->cfg->height);
+            return NULL;
+        }
+        return src;
+    }
+    
+    if (g_vi_source_count >= APP_MAX_STREAMS) return NULL;
+    if (vi_dev_init(cfg) != 0 || vi_chn_init(cfg) != 0) {
+        return NULL;
+    }
+    
+    src = &g_vi_sources[g_vi_source_count++];
+    src->cfg = cfg;
+    src->chn.enModId = RK_ID_VI;
+    src->chn.s32DevId = cfg->vi_dev_id;
+    src->chn.s32ChnId = cfg->vi_chn_id;
+    LOG_INFO("VI pipe %d chn %d enabled (%dx%d, %s)\n", cfg->vi_pipe_id, cfg->vi_chn_id,
+             cfg->width, cfg->height, cfg->vi_entity_name ? cfg->vi_entity_name : "default");
+    return src;
+}
+
+/**
+ * @brief 关闭所有 VI 源通道及其设备
+ */
+static void vi_sources_deinit(void) {
+    for (int i = g_vi_source_count - 1; i >= 0; i--) {
+        const VideoConfig *cfg = g_vi_sources[i].cfg;
+        RK_MPI_VI_DisableChn(cfg->vi_pipe_id, cfg->vi_chn_id);
+    }
+    for (int i = 0; i < g_vi_source_count; i++) {
+        int dev = g_vi_sources[i].cfg->vi_dev_id;
+        int first = 1;
+        for (int j = 0; j < i; j++) {
+            if (g_vi_sources[j].cfg->vi_dev_id == dev) first = 0;
+        }
+        if (first) RK_MPI_VI_DisableDev(dev);
+    }
+    g_vi_source_count = 0;
+}
+
 /**
  * @brief 初始化单路视频流处理上下文
  * 
@@ -489,40 +1943,156 @@ static int stream_context_init(VideoStreamContext *ctx, const VideoConfig *cfg,
     ctx->cfg = cfg;
     ctx->rtsp_base_time_us = -1;
     ctx->rtsp_base_pts = 0;
+    param_set_cache_init(&ctx->param_sets, cfg->codec == APP_VIDEO_CODEC_H265 ?
+                                           PARAM_SET_CODEC_H265 : PARAM_SET_CODEC_H264);
+    ctx->venc_stream.pstPack = &ctx->venc_pack;
+    ctx->venc_src_fps = cfg->fps;
+#if APP_ABR_ENABLE
+    RateControllerConfig rc_cfg;
+    rate_controller_default_config(&rc_cfg, cfg->bitrate / 1024, cfg->fps,
+                                   APP_ABR_MIN_BITRATE_PCT, APP_ABR_MIN_FPS);
+    rate_controller_init(&ctx->abr, &rc_cfg);
+#endif
     
     // 创建帧队列
-    ctx->raw_queue = frame_queue_create(RAW_QUEUE_CAPACITY);
-    ctx->stream_queue = frame_queue_create(STREAM_QUEUE_CAPACITY);
+    ctx->raw_queue = frame_queue_create_ex(RAW_QUEUE_CAPACITY, STREAM_FRAME_QUEUE_MODE);
+    ctx->stream_queue = frame_queue_create_ex(STREAM_QUEUE_CAPACITY, STREAM_FRAME_QUEUE_MODE);
     if (!ctx->raw_queue || !ctx->stream_queue) {
         LOG_ERROR("Failed to create frame queues for chn %d\n", cfg->venc_chn_id);
         return -1;
     }
+    frame_queue_set_overflow_policy(ctx->stream_queue,
+                                    (FrameQueueOverflowPolicy)APP_STREAM_QUEUE_OVERFLOW);
     
-    // 初始化 VENC
-    if (venc_init(cfg) != 0) {
+#if APP_STREAM_FANOUT
+    ctx->broadcast = stream_broadcast_create(STREAM_BROADCAST_CAPACITY);
+    if (!ctx->broadcast) {
+        LOG_ERROR("Failed to create stream broadcast for chn %d\n", cfg->venc_chn_id);
         return -1;
     }
+    stream_broadcast_set_resync_callback(ctx->broadcast, stream_on_consumer_resync, ctx);
+#endif
     
-    // 建立 VI -> VENC 绑定 (仍使用硬件 Bind 提高效率)
-    venc_chn.enModId = RK_ID_VENC;
-    venc_chn.s32DevId = 0;
-    venc_chn.s32ChnId = cfg->venc_chn_id;
+#if APP_PACKET_POOL_ENABLE
+    // 创建码流拷贝缓冲池 (失败时回退为 malloc, 不影响推流)
+#if APP_STREAM_FANOUT
+    int pool_depth = STREAM_BROADCAST_CAPACITY;
+#else
+    int pool_depth = STREAM_QUEUE_CAPACITY;
+#endif
+    ctx->packet_pool = packet_pool_create_for_stream(cfg->bitrate, cfg->fps, pool_depth,
+                                                     (size_t)APP_PACKET_POOL_BUDGET_KB * 1024);
+    if (!ctx->packet_pool) {
+        LOG_WARN("Failed to create packet pool for chn %d, using malloc\n", cfg->venc_chn_id);
+    }
+#endif
     
-    if (RK_MPI_SYS_Bind(vi_chn, &venc_chn) != RK_SUCCESS) {
-        LOG_ERROR("RK_MPI_SYS_Bind VI->VENC[%d] failed\n", cfg->venc_chn_id);
+    // 初始化 VENC (软件编码器注册为采集流水线的旁路阶段)
+    if (cfg->soft_encode) {
+        if (soft_encoder_setup(ctx) != 0) {
+            return -1;
+        }
+    } else if (venc_init(cfg) != 0) {
         return -1;
     }
     
+    if (cfg->soft_encode) {
+        // 采集线程和送帧线程在下方启动, 没有编码线程
+    } else if (cfg->scale_from >= 0) {
+        // 从源码流的 VI 通道取帧, RGA 缩放后送入 VENC
+        const VideoConfig *src = app_video_config_find(cfg->scale_from);
+        VideoScalerConfig scaler_cfg;
+        memset(&scaler_cfg, 0, sizeof(scaler_cfg));
+        scaler_cfg.src_pipe = cfg->vi_pipe_id;
+        scaler_cfg.src_chn = cfg->vi_chn_id;
+        scaler_cfg.src_fps = src ? src->fps : cfg->fps;
+        scaler_cfg.dst_width = cfg->width;
+        scaler_cfg.dst_height = cfg->height;
+        scaler_cfg.dst_fps = cfg->fps;
+        scaler_cfg.venc_chn = cfg->venc_chn_id;
+        ctx->scaler = video_scaler_create(&scaler_cfg);
+        if (!ctx->scaler) {
+            return -1;
+        }
+    } else if (cfg->vi_capture) {
+        // 非 Bind: 采集线程和送帧线程在下方启动
+    } else {
+        // 建立 VI -> VENC 绑定 (仍使用硬件 Bind 提高效率)
+        venc_chn.enModId = RK_ID_VENC;
+        venc_chn.s32DevId = 0;
+        venc_chn.s32ChnId = cfg->venc_chn_id;
+        
+        if (RK_MPI_SYS_Bind(vi_chn, &venc_chn) != RK_SUCCESS) {
+            LOG_ERROR("RK_MPI_SYS_Bind VI->VENC[%d] failed\n", cfg->venc_chn_id);
+            return -1;
+        }
+    }
+    
     ctx->running = 1;
     
-    // 启动编码线程 (从 VENC 获取码流)
-    if (pthread_create(&ctx->venc_thread, NULL, venc_encode_thread, ctx) != 0) {
-        LOG_ERROR("Failed to create VENC thread for chn %d\n", cfg->venc_chn_id);
+    stream_outputs_setup(ctx);
+    
+#if APP_STREAM_FANOUT
+    // 在编码线程启动前注册读游标, 保证各输出都能收到第一个 IDR
+    for (int i = 0; i < ctx->output_count; i++) {
+        StreamOutput *out = &ctx->outputs[i];
+        out->consumer = stream_broadcast_attach(ctx->broadcast, out->name);
+        if (!out->consumer) {
+            ctx->running = 0;
+            return -1;
+        }
+    }
+#endif
+    
+    if (cfg->vi_capture) {
+        if (pthread_create(&ctx->feed_thread, NULL, vi_feed_thread, ctx) != 0) {
+            LOG_ERROR("Failed to create feed thread for chn %d\n", cfg->venc_chn_id);
+            ctx->running = 0;
+            return -1;
+        }
+        ctx->feed_thread_valid = 1;
+        if (pthread_create(&ctx->vi_thread, NULL, vi_capture_thread, ctx) != 0) {
+            LOG_ERROR("Failed to create capture thread for chn %d\n", cfg->venc_chn_id);
+            ctx->running = 0;
+            return -1;
+        }
+        ctx->vi_thread_valid = 1;
+    }
+    
+#if APP_VENC_HARVESTER
+    // 由收割线程统一获取码流 (所有通道初始化完成后启动)
+    if (!cfg->soft_encode &&
+        venc_harvester_add(g_venc_harvester, cfg->venc_chn_id, venc_drain_channel, ctx) != 0) {
         ctx->running = 0;
         return -1;
     }
-    ctx->venc_thread_valid = 1;
+#else
+    // 启动编码线程 (从 VENC 获取码流)
+    if (!cfg->soft_encode) {
+        if (pthread_create(&ctx->venc_thread, NULL, venc_encode_thread, ctx) != 0) {
+            LOG_ERROR("Failed to create VENC thread for chn %d\n", cfg->venc_chn_id);
+            ctx->running = 0;
+            return -1;
+        }
+        ctx->venc_thread_valid = 1;
+    }
+#endif
+    
+#if APP_STREAM_FANOUT
+    // 每个输出一个线程, 各自从广播环读取
+    for (int i = 0; i < ctx->output_count; i++) {
+        StreamOutput *out = &ctx->outputs[i];
+        if (pthread_create(&out->thread, NULL, stream_output_thread, out) != 0) {
+            LOG_ERROR("Failed to create %s output thread for chn %d\n", out->name, cfg->venc_chn_id);
+            ctx->running = 0;
+            return -1;
+        }
+        out->thread_valid = 1;
+    }
     
+    LOG_INFO("Stream context for chn %d initialized (%d output threads)\n", 
+             cfg->venc_chn_id, ctx->output_count);
+#else
     // 启动推流线程
     if (pthread_create(&ctx->rtsp_thread, NULL, rtsp_push_thread, ctx) != 0) {
         LOG_ERROR("Failed to create RTSP thread for chn %d\n", cfg->venc_chn_id);
@@ -531,8 +2101,9 @@ static int stream_context_init(VideoStreamContext *ctx, const VideoConfig *cfg,
     }
     ctx->rtsp_thread_valid = 1;
     
-    LOG_INFO("Stream context for chn %d initialized (VENC thread + RTSP thread)\n", 
+    LOG_INFO("Stream context for chn %d initialized (RTSP thread)\n", 
              cfg->venc_chn_id);
+#endif
     
 #if APP_Test_RTMP
     // 初始化 RTMP 推流 (根据配置开关)
@@ -569,12 +2140,17 @@ static void stream_context_deinit(VideoStreamContext *ctx, MPP_CHN_S *vi_chn) {
     // 关闭队列，唤醒阻塞的线程
     if (ctx->raw_queue) frame_queue_close(ctx->raw_queue);
     if (ctx->stream_queue) frame_queue_close(ctx->stream_queue);
+    if (ctx->broadcast) stream_broadcast_close(ctx->broadcast);
     
     // 等待线程结束
     if (ctx->vi_thread_valid) {
         pthread_join(ctx->vi_thread, NULL);
         ctx->vi_thread_valid = 0;
     }
+    if (ctx->feed_thread_valid) {
+        pthread_join(ctx->feed_thread, NULL);
+        ctx->feed_thread_valid = 0;
+    }
     if (ctx->venc_thread_valid) {
         pthread_join(ctx->venc_thread, NULL);
         ctx->venc_thread_valid = 0;
@@ -583,13 +2159,65 @@ static void stream_context_deinit(VideoStreamContext *ctx, MPP_CHN_S *vi_chn) {
         pthread_join(ctx->rtsp_thread, NULL);
         ctx->rtsp_thread_valid = 0;
     }
+    for (int i = 0; i < ctx->output_count; i++) {
+        if (ctx->outputs[i].thread_valid) {
+            pthread_join(ctx->outputs[i].thread, NULL);
+            ctx->outputs[i].thread_valid = 0;
+        }
+    }
+    stream_outputs_teardown(ctx);
+#if APP_Test_RTSP
+    // RTSP 入队队列中的引用帧指向 VENC 码流包或缓冲池, 同样要在销毁前归还
+    if (ctx->cfg->enable_rtsp) rkipc_rtsp_stop_session(ctx->cfg->stream_id);
+#endif
+    
+    LOG_INFO("[VENC-%d] zero-copy=%u, copied=%u, idr=%u/%u\n",
+             ctx->cfg->venc_chn_id, ctx->zc_frames, ctx->copy_frames, ctx->idr_sent,
+             __atomic_load_n(&ctx->idr_requests, __ATOMIC_RELAXED));
+    
+    // 线程退出后可能仍有帧留在队列中, 必须在销毁 VENC 通道前归还码流包 (RTSP 入队的引用已在上面归还)
+    if (ctx->stream_queue) stream_queue_drain(ctx->stream_queue);
+    if (ctx->broadcast) {
+        stream_broadcast_destroy(ctx->broadcast);
+        ctx->broadcast = NULL;
+    }
     
-    // 解除绑定
-    RK_MPI_SYS_UnBind(vi_chn, &venc_chn);
+    // 停止送帧: 解除绑定, 停止 RGA 缩放线程, 或归还采集队列中剩余的 VI 帧
+    if (ctx->scaler) {
+        video_scaler_stop(ctx->scaler);
+    } else if (ctx->cfg->vi_capture) {
+        if (ctx->raw_queue) stream_queue_drain(ctx->raw_queue);
+        vi_capture_log_stats(ctx);
+        // 等待旁路阶段归还 VI 帧, 必须在禁用 VI 通道之前
+        frame_stage_graph_deinit(&ctx->stages);
+    } else {
+        RK_MPI_SYS_UnBind(vi_chn, &venc_chn);
+    }
+    
+    // 销毁 VENC 通道 (软件编码器的旁路阶段已全部结束)
+    if (ctx->soft_enc) {
+        SoftEncoderStats stats;
+        soft_encoder_get_stats(ctx->soft_enc, &stats);
+        LOG_INFO("[STREAM-%d] Soft encoder in=%u out=%u skipped=%u scaled=%u errors=%u\n",
+                 ctx->cfg->stream_id, stats.frames_in, stats.frames_out, stats.skipped,
+                 stats.scaled, stats.errors);
+        soft_encoder_destroy(ctx->soft_enc);
+        ctx->soft_enc = NULL;
+    } else {
+        RK_MPI_VENC_StopRecvFrame(ctx->cfg->venc_chn_id);
+        RK_MPI_VENC_DestroyChn(ctx->cfg->venc_chn_id);
+    }
     
-    // 销毁 VENC 通道
-    RK_MPI_VENC_StopRecvFrame(ctx->cfg->venc_chn_id);
-    RK_MPI_VENC_DestroyChn(ctx->cfg->venc_chn_id);
+    // VENC 已归还所有缩放缓冲区
+    if (ctx->scaler) {
+        VideoScalerStats stats;
+        video_scaler_get_stats(ctx->scaler, &stats);
+        LOG_INFO("[VENC-%d] RGA scaler in=%u out=%u skipped=%u errors=%u\n",
+                 ctx->cfg->venc_chn_id, stats.frames_in, stats.frames_out,
+                 stats.skipped, stats.errors);
+        video_scaler_destroy(ctx->scaler);
+        ctx->scaler = NULL;
+    }
     
     // 销毁队列
     if (ctx->raw_queue) {
@@ -597,9 +2225,21 @@ static void stream_context_deinit(VideoStreamContext *ctx, MPP_CHN_S *vi_chn) {
         ctx->raw_queue = NULL;
     }
     if (ctx->stream_queue) {
+        FrameQueueDropStats drops;
+        frame_queue_get_drop_stats(ctx->stream_queue, &drops);
+        if (drops.overflows > 0) {
+            LOG_INFO("[VENC-%d] Stream queue overflows=%u timeout=%u gop=%u key_wait=%u\n",
+                     ctx->cfg->venc_chn_id, drops.overflows, drops.block_timeouts,
+                     drops.gop_dropped, drops.key_wait_dropped);
+        }
         frame_queue_destroy(ctx->stream_queue);
         ctx->stream_queue = NULL;
     }
+    if (ctx->packet_pool) {
+        packet_pool_destroy(ctx->packet_pool);
+        ctx->packet_pool = NULL;
+    }
+    param_set_cache_deinit(&ctx->param_sets);
     
 #if APP_Test_RTMP
     // 销毁 RTMP
@@ -611,6 +2251,41 @@ static void stream_context_deinit(VideoStreamContext *ctx, MPP_CHN_S *vi_chn) {
     LOG_INFO("Stream context for chn %d deinitialized\n", ctx->cfg->venc_chn_id);
 }
 
+/**
+ * @brief 按码流 ID 查找运行中的流上下文
+ * 
+ * @param stream_id 码流 ID
+ * @return VideoStreamContext* 未运行返回 NULL
+ */
+static VideoStreamContext *stream_context_find(int stream_id) {
+    for (int i = 0; i < APP_MAX_STREAMS; i++) {
+        VideoStreamContext *ctx = &g_stream_ctx[i];
+        if (ctx->cfg && ctx->running && ctx->cfg->stream_id == stream_id) {
+            return ctx;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief INI 参数变更回调: video.N 的码率/帧率/GOP 变化时触发重配置
+ */
+static void video_param_changed(const char *entry, void *arg) {
+    int stream_id;
+    char key[32];
+    
+    (void)arg;
+    if (sscanf(entry, "video.%d:%31s", &stream_id, key) != 2) return;
+    if (strcasecmp(key, "max_rate") != 0 && strcasecmp(key, "dst_frame_rate_num") != 0 &&
+        strcasecmp(key, "gop") != 0) {
+        return;
+    }
+    // 批量写入结束后统一触发一次 (重配置读取 INI 当前值, 期间其他来源的修改也会包含在内)
+    VideoStreamContext *ctx = stream_context_find(stream_id);
+    if (ctx && __atomic_load_n(&ctx->param_batch, __ATOMIC_ACQUIRE)) return;
+    rk_video_reconfigure(stream_id);
+}
+
 /* =========================================================================
  *                              外部接口实现
  * ========================================================================= */
@@ -624,49 +2299,73 @@ int rk_video_init(void) {
     int ret;
     LOG_INFO("=== Initializing video subsystem (Multi-threaded) ===\n");
 
-    const VideoConfig *cfgs[APP_MAX_STREAMS];
-    cfgs[0] = app_video_config_get();
-#if APP_ENABLE_SUB_STREAM == 1
-    cfgs[1] = app_video1_config_get();
-#else
-    cfgs[1] = NULL;
-#endif
+    // 1. 从 INI 加载码流表
+    int stream_count = app_video_config_load();
+    if (stream_count <= 0) {
+        LOG_ERROR("No video stream configured\n");
+        return -1;
+    }
 
-    // 1. 初始化 RGA 硬件加速
+    // 2. 初始化 RGA 硬件加速
     rga_utils_init();
 
-    // 2. 初始化 VI 硬件 (以主流参数为准)
-    g_vi_chn.enModId = RK_ID_VI;
-    g_vi_chn.s32DevId = cfgs[0]->vi_dev_id;
-    g_vi_chn.s32ChnId = cfgs[0]->vi_chn_id;
-    
-    ret = vi_dev_init(cfgs[0]);
-    if (ret) return ret;
-    ret = vi_chn_init(cfgs[0]);
-    if (ret) return ret;
+    // 3. 按码流表初始化 VI 源通道 (RGA 缩放码流使用源码流的 VI 通道)
+    for (int i = 0; i < stream_count; i++) {
+        const VideoConfig *cfg = app_video_config_at(i);
+        if (!stream_has_output(cfg)) continue;
+        if (cfg->scale_from >= 0) cfg = app_video_config_find(cfg->scale_from);
+        if (!cfg || !vi_source_get(cfg)) {
+            return -1;
+        }
+    }
 
 #if APP_Test_RTSP
-    // 3. 初始化 RTSP Server
-    const char *url0 = (cfgs[0] && cfgs[0]->enable_rtsp) ? cfgs[0]->rtsp_url : NULL;
-    const char *url1 = (APP_MAX_STREAMS > 1 && cfgs[1] && cfgs[1]->enable_rtsp) ? cfgs[1]->rtsp_url : NULL;
-    
-    ret = rkipc_rtsp_init(url0, url1, NULL);
+    // 4. 初始化 RTSP Server, 每路开启 RTSP 的码流一个会话
+    ret = rkipc_rtsp_init();
     if (ret) {
         LOG_ERROR("rkipc_rtsp_init failed\n");
         return ret;
     }
+    rkipc_rtsp_set_keyframe_request(rk_video_request_idr);
+    for (int i = 0; i < stream_count; i++) {
+        const VideoConfig *cfg = app_video_config_at(i);
+        if (!cfg->enable_rtsp) continue;
+        ret = rkipc_rtsp_add_session(cfg->stream_id, cfg->rtsp_url,
+                                     cfg->codec == APP_VIDEO_CODEC_H265 ? "H.265" : "H.264");
+        if (ret) return ret;
+    }
 #endif
 
     g_video_run = 1;
     memset(g_stream_ctx, 0, sizeof(g_stream_ctx));
 
-    // 4. 动态初始化各路流
-    for (int i = 0; i < APP_MAX_STREAMS; i++) {
-        if (!cfgs[i]) continue;
+#if APP_VENC_HARVESTER
+    g_venc_harvester = venc_harvester_create();
+    if (!g_venc_harvester) {
+        g_video_run = 0;
+        return -1;
+    }
+#endif
+
+    // 非 Bind 模式的旁路处理阶段共用工作线程池
+    for (int i = 0; i < stream_count; i++) {
+        const VideoConfig *cfg = app_video_config_at(i);
+        if (cfg->vi_capture && stream_has_output(cfg)) {
+            if (frame_stage_pool_start(APP_FRAME_STAGE_WORKERS) != 0) {
+                g_video_run = 0;
+                return -1;
+            }
+            break;
+        }
+    }
+
+    // 5. 按码流表初始化各路流
+    for (int i = 0; i < stream_count; i++) {
+        const VideoConfig *cfg = app_video_config_at(i);
         
-        // 只要 RTSP 或 RTMP 有一个开启，就初始化该路流
-        if (cfgs[i]->enable_rtsp || cfgs[i]->enable_rtmp) {
-            ret = stream_context_init(&g_stream_ctx[i], cfgs[i], &g_vi_chn);
+        // 只要 RTSP / RTMP / 抓图有一个开启，就初始化该路流
+        if (stream_has_output(cfg)) {
+            ret = stream_context_init(&g_stream_ctx[i], cfg, &vi_source_find(cfg)->chn);
             if (ret) {
                 LOG_ERROR("Failed to init stream context %d\n", i);
                 // 简单起见，失败则停止已开启的
@@ -676,15 +2375,29 @@ int rk_video_init(void) {
         }
     }
 
+#if APP_VENC_HARVESTER
+    // 所有通道注册完成后启动收割线程
+    ret = venc_harvester_start(g_venc_harvester);
+    if (ret) {
+        g_video_run = 0;
+        return ret;
+    }
+#endif
+
 #if APP_Test_OSD
-    // 5. 初始化 OSD 时间戳叠加 (绑定到所有活跃的 VENC 通道)
+    // 6. 初始化 OSD 时间戳叠加 (绑定到活跃的 VENC 通道, 最多 VIDEO_OSD_MAX_CHN 个)
     {
-        int osd_chns[APP_MAX_STREAMS];
+        int osd_chns[VIDEO_OSD_MAX_CHN];
         int osd_chn_count = 0;
-        for (int i = 0; i < APP_MAX_STREAMS; i++) {
-            if (g_stream_ctx[i].cfg) {
-                osd_chns[osd_chn_count++] = g_stream_ctx[i].cfg->venc_chn_id;
+        for (int i = 0; i < stream_count; i++) {
+            // 软件编码的码流没有 VENC 通道可以叠加区域
+            if (!g_stream_ctx[i].cfg || g_stream_ctx[i].cfg->soft_encode) continue;
+            if (osd_chn_count >= VIDEO_OSD_MAX_CHN) {
+                LOG_WARN("OSD supports %d VENC channels, chn %d skipped\n",
+                         VIDEO_OSD_MAX_CHN, g_stream_ctx[i].cfg->venc_chn_id);
+                continue;
             }
+            osd_chns[osd_chn_count++] = g_stream_ctx[i].cfg->venc_chn_id;
         }
         if (osd_chn_count > 0) {
             video_osd_init(osd_chns, osd_chn_count);
@@ -692,6 +2405,9 @@ int rk_video_init(void) {
     }
 #endif
 
+    // 7. 监听 video.N 参数变更, 运行时调整码率/帧率/GOP
+    rk_param_add_listener("video.", video_param_changed, NULL);
+
     LOG_INFO("=== Video subsystem initialized successfully ===\n");
     return 0;
 }
@@ -702,19 +2418,33 @@ int rk_video_init(void) {
  * @return 0 成功
  */
 int rk_video_deinit(void) {
-    const VideoConfig *cfg = app_video_config_get();
-
     LOG_INFO("=== Deinitializing video subsystem ===\n");
 
-    // 1. 停止全局运行标志
+    // 1. 停止参数监听和全局运行标志
+    rk_param_remove_listener(video_param_changed, NULL);
     g_video_run = 0;
 
+#if APP_VENC_HARVESTER
+    // 收割线程必须在销毁 VENC 通道之前停止并关闭通道 fd
+    if (g_venc_harvester) {
+        VencHarvesterChannelStats stats[VENC_HARVESTER_MAX_CHANNELS];
+        int count = venc_harvester_get_stats(g_venc_harvester, stats);
+        for (int i = 0; i < count; i++) {
+            LOG_INFO("[VENC-%d] harvester wakeups=%u\n", stats[i].venc_chn, stats[i].wakeups);
+        }
+        venc_harvester_destroy(g_venc_harvester);
+        g_venc_harvester = NULL;
+    }
+#endif
+
     // 2. 销毁已开启的流上下文
     for (int i = APP_MAX_STREAMS - 1; i >= 0; i--) { // 倒序销毁
         if (g_stream_ctx[i].cfg) {
-            stream_context_deinit(&g_stream_ctx[i], &g_vi_chn);
+            stream_context_deinit(&g_stream_ctx[i], &vi_source_find(g_stream_ctx[i].cfg)->chn);
         }
     }
+    // 各码流的旁路阶段已归还所有帧
+    frame_stage_pool_stop();
 
 #if APP_Test_OSD
     // 3. 关闭 OSD 时间戳叠加
@@ -727,8 +2457,7 @@ int rk_video_deinit(void) {
 #endif
 
     // 5. 禁用并关闭 VI 通道与设备
-    RK_MPI_VI_DisableChn(cfg->vi_pipe_id, cfg->vi_chn_id);
-    RK_MPI_VI_DisableDev(cfg->vi_dev_id);
+    vi_sources_deinit();
 
     // 6. 释放 RGA 资源
     rga_utils_deinit();
@@ -736,3 +2465,115 @@ int rk_video_deinit(void) {
     LOG_INFO("=== Video subsystem deinitialized ===\n");
     return 0;
 }
+
+/**
+ * @brief 为非 Bind 模式的码流注册一个处理阶段
+ * 
+ * @param stream_id 码流 ID
+ * @param ops 阶段描述
+ * @param arg 传给 init 的私有数据
+ * @return 0 成功，-1 失败
+ */
+int rk_video_add_stage(int stream_id, const VideoStageOps *ops, void *arg) {
+    VideoStreamContext *ctx = stream_context_find(stream_id);
+    if (!ctx || !ctx->cfg->vi_capture || !ops) return -1;
+    
+    const char *name = ops->name ? ops->name : "";
+    VideoStageInfo info;
+    info.stream_id = ctx->cfg->stream_id;
+    info.width = ctx->cfg->width;
+    info.height = ctx->cfg->height;
+    info.fps = ctx->cfg->fps;
+    if (frame_stage_graph_add(&ctx->stages, ops, arg, &info) != 0) {
+        LOG_WARN("[VENC-%d] Frame stage %s not added\n", ctx->cfg->venc_chn_id, name);
+        return -1;
+    }
+    LOG_INFO("[VENC-%d] Frame stage %s added (%s, %s%s)\n", ctx->cfg->venc_chn_id, name,
+             ops->mode == VIDEO_STAGE_TAP ? "tap" : "inline",
+             ops->access == VIDEO_STAGE_ACCESS_CPU ? "cpu" : "dmabuf",
+             ops->may_drop ? ", may drop" : "");
+    return 0;
+}
+
+/**
+ * @brief 为非 Bind 模式的码流追加一个 CPU 访问的串行阶段
+ * 
+ * @param stream_id 码流 ID
+ * @param name 阶段名称
+ * @param stage 回调
+ * @param arg 回调私有数据
+ * @return 0 成功，-1 失败
+ */
+int rk_video_add_frame_stage(int stream_id, const char *name, VideoFrameStage stage, void *arg) {
+    VideoStageOps ops;
+    memset(&ops, 0, sizeof(ops));
+    ops.name = name;
+    ops.mode = VIDEO_STAGE_INLINE;
+    ops.access = VIDEO_STAGE_ACCESS_CPU;
+    ops.may_drop = 1;
+    ops.process = stage;
+    return rk_video_add_stage(stream_id, &ops, arg);
+}
+
+/**
+ * @brief 请求指定码流尽快输出 IDR 帧
+ * 
+ * @param stream_id 码流 ID
+ * @return 0 成功，-1 码流未运行
+ */
+int rk_video_request_idr(int stream_id) {
+    VideoStreamContext *ctx = stream_context_find(stream_id);
+    if (!ctx) return -1;
+    
+    stream_request_idr(ctx, "api");
+    return 0;
+}
+
+/**
+ * @brief 按 INI 中的当前值重新配置码率/帧率/GOP
+ * 
+ * @param stream_id 码流 ID
+ * @return 0 成功，-1 码流未运行
+ */
+int rk_video_reconfigure(int stream_id) {
+    VideoStreamContext *ctx = stream_context_find(stream_id);
+    if (!ctx) return -1;
+    
+    __atomic_store_n(&ctx->reconfig_pending, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief 修改码流的码率/帧率/GOP 并立即生效
+ * 
+ * @param stream_id 码流 ID
+ * @param bitrate_kbps 码率 (kbps)，<= 0 表示不变
+ * @param fps 帧率，<= 0 表示不变
+ * @param gop GOP 长度，<= 0 表示不变
+ * @return 0 成功，-1 码流未运行
+ */
+int rk_video_set_encode_param(int stream_id, int bitrate_kbps, int fps, int gop) {
+    VideoStreamContext *ctx = stream_context_find(stream_id);
+    char entry[64];
+    
+    if (!ctx) return -1;
+    
+    // 写入期间屏蔽参数监听, 全部写完后只置一次 reconfig_pending,
+    // 编码线程不会先应用新码率再应用新帧率 (两次 SetChnAttr / IDR / RTMP 重建)
+    __atomic_add_fetch(&ctx->param_batch, 1, __ATOMIC_ACQ_REL);
+    if (bitrate_kbps > 0) {
+        snprintf(entry, sizeof(entry), "video.%d:max_rate", stream_id);
+        rk_param_set_int(entry, bitrate_kbps);
+    }
+    if (fps > 0) {
+        snprintf(entry, sizeof(entry), "video.%d:dst_frame_rate_num", stream_id);
+        rk_param_set_int(entry, fps);
+    }
+    if (gop > 0) {
+        snprintf(entry, sizeof(entry), "video.%d:gop", stream_id);
+        rk_param_set_int(entry, gop);
+    }
+    __atomic_sub_fetch(&ctx->param_batch, 1, __ATOMIC_ACQ_REL);
+    if (bitrate_kbps > 0 || fps > 0 || gop > 0) rk_video_reconfigure(stream_id);
+    return 0;
+}
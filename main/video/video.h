@@ -15,10 +15,87 @@
  */
 #pragma once
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief 非 Bind 模式下交给处理阶段的原始帧 (NV12)
+ * 
+ * 指向 VI 缓冲区本身，阶段可以原地读写 (例如 RGA 叠加) 但不能持有到回调返回之后。
+ * 声明 VIDEO_STAGE_ACCESS_DMABUF 的阶段拿到的 vir_addr 为 NULL，只能经 fd 访问。
+ */
+typedef struct {
+    int stream_id;           /**< 码流 ID */
+    void *mb;                /**< MB_BLK 句柄 */
+    int fd;                  /**< DMA-BUF fd (供 RGA 使用) */
+    void *vir_addr;          /**< 虚拟地址 (仅 CPU 访问的阶段有效) */
+    int width;               /**< 宽度 */
+    int height;              /**< 高度 */
+    int wstride;             /**< 行跨度 (像素) */
+    int hstride;             /**< 列跨度 (像素) */
+    uint64_t pts;            /**< 采集时间戳 (微秒) */
+} VideoRawFrame;
+
+/**
+ * @brief 帧处理回调
+ * 
+ * @param frame 原始帧
+ * @param arg 阶段私有数据 (init 输出的 state，未提供 init 时为注册时的 arg)
+ * @return 0 继续，< 0 丢弃本帧 (仅 may_drop 的串行阶段生效)
+ */
+typedef int (*VideoFrameStage)(VideoRawFrame *frame, void *arg);
+
+/**
+ * @brief 阶段访问帧数据的方式
+ */
+typedef enum {
+    VIDEO_STAGE_ACCESS_DMABUF = 0,   /**< 只经 fd 交给 RGA/NPU 等硬件，不做缓存维护 */
+    VIDEO_STAGE_ACCESS_CPU,          /**< CPU 读写 vir_addr，调用前后由框架同步 CPU 缓存 */
+} VideoStageAccess;
+
+/**
+ * @brief 阶段在流水线中的位置
+ */
+typedef enum {
+    /** 串行阶段: 在送帧线程中按注册顺序执行，可原地修改帧，结束后才送入 VENC */
+    VIDEO_STAGE_INLINE = 0,
+    /** 旁路阶段: 帧送入 VENC 后交给工作线程池只读处理 (移动侦测等分析)，不阻塞编码 */
+    VIDEO_STAGE_TAP,
+} VideoStageMode;
+
+/**
+ * @brief 阶段初始化时可见的码流信息
+ */
+typedef struct {
+    int stream_id;           /**< 码流 ID */
+    int width;               /**< 宽度 */
+    int height;              /**< 高度 */
+    int fps;                 /**< 帧率 */
+} VideoStageInfo;
+
+/**
+ * @brief 处理阶段描述 (注册时拷贝，调用者无需保留)
+ */
+typedef struct {
+    const char *name;        /**< 阶段名称 (用于统计) */
+    VideoStageMode mode;     /**< 串行或旁路 */
+    VideoStageAccess access; /**< 访问方式 */
+    /**
+     * 串行阶段: process 返回 < 0 时丢弃本帧，否则返回值只计为错误；
+     * 旁路阶段: 忙时跳过新帧，否则送帧线程等待该阶段空闲 (会拖慢编码)。
+     */
+    int may_drop;
+    /** 可选: 创建私有状态，返回 0 成功 */
+    int (*init)(const VideoStageInfo *info, void *arg, void **state);
+    /** 必填: 处理一帧 (同一阶段不会被并发调用) */
+    VideoFrameStage process;
+    /** 可选: 码流停止时释放私有状态 */
+    void (*deinit)(void *state);
+} VideoStageOps;
+
 /**
  * @brief 初始化视频采集与编码子系统
  * 
@@ -46,6 +123,68 @@ int rk_video_init(void);
  */
 int rk_video_deinit(void);
 
+/**
+ * @brief 请求指定码流尽快输出 IDR 帧
+ * 
+ * 用于新客户端接入或推流端丢帧后缩短首帧等待时间。
+ * 请求由编码线程合并并限频 (APP_VENC_IDR_MIN_INTERVAL_MS) 后下发，可在任意线程调用。
+ * 
+ * @param stream_id 码流 ID
+ * @return 0 成功，-1 码流未运行
+ */
+int rk_video_request_idr(int stream_id);
+
+/**
+ * @brief 按 INI 中 video.N 的当前值重新配置码率/帧率/GOP
+ * 
+ * 读取 max_rate (kbps) / dst_frame_rate_num / gop，由编码线程在帧间通过
+ * RK_MPI_VENC_SetChnAttr 原地生效并强制 IDR，不重建通道，RTSP 客户端不断开；
+ * 码率或帧率变化时 RTMP 会话随之重建以更新元数据。
+ * 通过 rk_param_set_int 修改上述键时会自动调用，可在任意线程调用。
+ * 
+ * @param stream_id 码流 ID
+ * @return 0 成功，-1 码流未运行
+ */
+int rk_video_reconfigure(int stream_id);
+
+/**
+ * @brief 修改码流的码率/帧率/GOP (写入 INI 并触发 rk_video_reconfigure)
+ * 
+ * 帧率不能超过创建通道时的帧率 (VI 输入帧率)，超出时按输入帧率处理。
+ * 
+ * @param stream_id 码流 ID
+ * @param bitrate_kbps 码率 (kbps)，<= 0 表示不变
+ * @param fps 帧率，<= 0 表示不变
+ * @param gop GOP 长度，<= 0 表示不变
+ * @return 0 成功，-1 码流未运行
+ */
+int rk_video_set_encode_param(int stream_id, int bitrate_kbps, int fps, int gop);
+
+/**
+ * @brief 为非 Bind 模式的码流注册一个处理阶段 (ROI 裁剪、旋转、移动侦测等)
+ * 
+ * 只对 vi_capture = 1 的码流有效。串行阶段按注册顺序执行，旁路阶段由
+ * APP_FRAME_STAGE_WORKERS 个工作线程处理；每个阶段的耗时单独计入延迟直方图。
+ * 可在码流运行期间调用，不支持移除，码流停止时调用 deinit。
+ * 
+ * @param stream_id 码流 ID
+ * @param ops 阶段描述
+ * @param arg 传给 init 的私有数据
+ * @return 0 成功，-1 码流未运行、不是非 Bind 模式、阶段已满或 init 失败
+ */
+int rk_video_add_stage(int stream_id, const VideoStageOps *ops, void *arg);
+
+/**
+ * @brief 追加一个 CPU 访问、可丢帧的串行阶段 (rk_video_add_stage 的简化形式)
+ * 
+ * @param stream_id 码流 ID
+ * @param name 阶段名称 (用于统计)
+ * @param stage 回调
+ * @param arg 回调私有数据
+ * @return 0 成功，-1 码流未运行、不是非 Bind 模式或阶段已满
+ */
+int rk_video_add_frame_stage(int stream_id, const char *name, VideoFrameStage stage, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,207 @@
+/**
+ * @file video_scaler.c
+ * @brief RGA 缩放子码流实现
+ *
+ * 源帧与缩放结果都以 DMA-BUF fd 交给 RGA，CPU 不接触像素数据。
+ * 输出缓冲区来自专用 MB 池，SendFrame 后由 VENC 持有引用，
+ * 本线程立即 ReleaseMB，编码完成后缓冲区自动回到池中。
+ */
+
+#include "video_scaler.h"
+#include "rga_utils.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+
+#include <rk_mpi_mb.h>
+#include <rk_mpi_venc.h>
+#include <rk_mpi_vi.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "video_scaler"
+
+/** @brief 输出缓冲区数量 (VENC 编码中 1 个 + 排队 1 个 + RGA 写入 1 个) */
+#define SCALER_BUF_COUNT        3
+/** @brief 取帧超时 (毫秒)，决定停止时的最长等待 */
+#define SCALER_FRAME_TIMEOUT_MS 200
+
+struct VideoScaler {
+    VideoScalerConfig cfg;
+    MB_POOL pool;                /**< 输出缓冲池 */
+    uint32_t frame_size;         /**< 单帧 NV12 大小 */
+    int fps_acc;                 /**< 抽帧累加器 */
+    VideoScalerStats stats;      /**< 统计 (原子访问) */
+    pthread_t thread;
+    int thread_valid;
+    volatile int running;
+};
+
+/**
+ * @brief 按目标帧率抽帧
+ *
+ * @return 1 本帧输出，0 跳过
+ */
+static int scaler_accept_frame(VideoScaler *s) {
+    if (s->cfg.dst_fps <= 0 || s->cfg.dst_fps >= s->cfg.src_fps) return 1;
+
+    s->fps_acc += s->cfg.dst_fps;
+    if (s->fps_acc < s->cfg.src_fps) return 0;
+    s->fps_acc -= s->cfg.src_fps;
+    return 1;
+}
+
+/**
+ * @brief 缩放一帧并送入 VENC
+ *
+ * @return 0 成功，-1 失败
+ */
+static int scaler_process_frame(VideoScaler *s, const VIDEO_FRAME_INFO_S *src_frame) {
+    const VIDEO_FRAME_S *src = &src_frame->stVFrame;
+    const VideoScalerConfig *cfg = &s->cfg;
+
+    // 非阻塞获取: 缓冲区都在 VENC 中说明编码跟不上, 丢弃本帧
+    MB_BLK mb = RK_MPI_MB_GetMB(s->pool, s->frame_size, RK_FALSE);
+    if (mb == MB_INVALID_HANDLE) return -1;
+
+    RgaImageInfo src_img;
+    RgaImageInfo dst_img;
+    memset(&src_img, 0, sizeof(src_img));
+    memset(&dst_img, 0, sizeof(dst_img));
+    src_img.fd = RK_MPI_MB_Handle2Fd(src->pMbBlk);
+    src_img.width = (int)src->u32Width;
+    src_img.height = (int)src->u32Height;
+    src_img.wstride = (int)src->u32VirWidth;
+    src_img.hstride = (int)src->u32VirHeight;
+    src_img.format = RGA_FMT_YUV420SP;
+    dst_img.fd = RK_MPI_MB_Handle2Fd(mb);
+    dst_img.width = cfg->dst_width;
+    dst_img.height = cfg->dst_height;
+    dst_img.format = RGA_FMT_YUV420SP;
+
+    int ret = -1;
+    if (rga_utils_resize(&src_img, &dst_img) == 0) {
+        VIDEO_FRAME_INFO_S dst_frame;
+        memset(&dst_frame, 0, sizeof(dst_frame));
+        dst_frame.stVFrame.pMbBlk = mb;
+        dst_frame.stVFrame.u32Width = cfg->dst_width;
+        dst_frame.stVFrame.u32Height = cfg->dst_height;
+        dst_frame.stVFrame.u32VirWidth = cfg->dst_width;
+        dst_frame.stVFrame.u32VirHeight = cfg->dst_height;
+        dst_frame.stVFrame.enPixelFormat = RK_FMT_YUV420SP;
+        dst_frame.stVFrame.enCompressMode = COMPRESS_MODE_NONE;
+        dst_frame.stVFrame.u64PTS = src->u64PTS;
+        if (RK_MPI_VENC_SendFrame(cfg->venc_chn, &dst_frame, 0) == RK_SUCCESS) {
+            ret = 0;
+        }
+    }
+
+    // VENC 已持有自己的引用, 这里释放本线程的引用
+    RK_MPI_MB_ReleaseMB(mb);
+    return ret;
+}
+
+static void *video_scaler_thread(void *arg) {
+    VideoScaler *s = (VideoScaler *)arg;
+    const VideoScalerConfig *cfg = &s->cfg;
+    char name[16];
+
+    snprintf(name, sizeof(name), "scaler%d", cfg->venc_chn);
+    prctl(PR_SET_NAME, name, 0, 0, 0);
+    LOG_INFO("[VENC-%d] RGA scaler started (VI %d/%d -> %dx%d@%d)\n", cfg->venc_chn,
+             cfg->src_pipe, cfg->src_chn, cfg->dst_width, cfg->dst_height, cfg->dst_fps);
+
+    while (s->running) {
+        VIDEO_FRAME_INFO_S frame;
+        memset(&frame, 0, sizeof(frame));
+        if (RK_MPI_VI_GetChnFrame(cfg->src_pipe, cfg->src_chn, &frame,
+                                  SCALER_FRAME_TIMEOUT_MS) != RK_SUCCESS) {
+            continue;
+        }
+        __atomic_add_fetch(&s->stats.frames_in, 1, __ATOMIC_RELAXED);
+
+        if (!scaler_accept_frame(s)) {
+            __atomic_add_fetch(&s->stats.skipped, 1, __ATOMIC_RELAXED);
+        } else if (scaler_process_frame(s, &frame) == 0) {
+            __atomic_add_fetch(&s->stats.frames_out, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_add_fetch(&s->stats.errors, 1, __ATOMIC_RELAXED);
+        }
+
+        RK_MPI_VI_ReleaseChnFrame(cfg->src_pipe, cfg->src_chn, &frame);
+    }
+
+    LOG_INFO("[VENC-%d] RGA scaler exiting\n", cfg->venc_chn);
+    return NULL;
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+VideoScaler *video_scaler_create(const VideoScalerConfig *cfg) {
+    if (!cfg || cfg->dst_width <= 0 || cfg->dst_height <= 0) return NULL;
+    if ((cfg->dst_width % 16) != 0 || (cfg->dst_height % 2) != 0) {
+        LOG_ERROR("Scaled size %dx%d must be 16x2 aligned\n", cfg->dst_width, cfg->dst_height);
+        return NULL;
+    }
+
+    VideoScaler *s = (VideoScaler *)calloc(1, sizeof(VideoScaler));
+    if (!s) return NULL;
+
+    s->cfg = *cfg;
+    s->frame_size = (uint32_t)cfg->dst_width * cfg->dst_height * 3 / 2;
+
+    MB_POOL_CONFIG_S pool_cfg;
+    memset(&pool_cfg, 0, sizeof(pool_cfg));
+    pool_cfg.u64MBSize = s->frame_size;
+    pool_cfg.u32MBCnt = SCALER_BUF_COUNT;
+    pool_cfg.enAllocType = MB_ALLOC_TYPE_DMA;
+    pool_cfg.bPreAlloc = RK_TRUE;
+    s->pool = RK_MPI_MB_CreatePool(&pool_cfg);
+    if (s->pool == MB_INVALID_POOLID) {
+        LOG_ERROR("[VENC-%d] Failed to create scaler MB pool\n", cfg->venc_chn);
+        free(s);
+        return NULL;
+    }
+
+    s->running = 1;
+    if (pthread_create(&s->thread, NULL, video_scaler_thread, s) != 0) {
+        LOG_ERROR("[VENC-%d] Failed to create scaler thread\n", cfg->venc_chn);
+        RK_MPI_MB_DestroyPool(s->pool);
+        free(s);
+        return NULL;
+    }
+    s->thread_valid = 1;
+    return s;
+}
+
+void video_scaler_stop(VideoScaler *scaler) {
+    if (!scaler || !scaler->thread_valid) return;
+
+    scaler->running = 0;
+    pthread_join(scaler->thread, NULL);
+    scaler->thread_valid = 0;
+}
+
+void video_scaler_destroy(VideoScaler *scaler) {
+    if (!scaler) return;
+
+    video_scaler_stop(scaler);
+    RK_MPI_MB_DestroyPool(scaler->pool);
+    free(scaler);
+}
+
+void video_scaler_get_stats(VideoScaler *scaler, VideoScalerStats *stats) {
+    if (!scaler || !stats) return;
+
+    stats->frames_in = __atomic_load_n(&scaler->stats.frames_in, __ATOMIC_RELAXED);
+    stats->frames_out = __atomic_load_n(&scaler->stats.frames_out, __ATOMIC_RELAXED);
+    stats->skipped = __atomic_load_n(&scaler->stats.skipped, __ATOMIC_RELAXED);
+    stats->errors = __atomic_load_n(&scaler->stats.errors, __ATOMIC_RELAXED);
+}
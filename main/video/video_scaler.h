@@ -0,0 +1,85 @@
+/**
+ * @file video_scaler.h
+ * @brief RGA 缩放子码流
+ *
+ * 从已开启的 VI 通道取帧 (RK_MPI_VI_GetChnFrame，与该通道的 VI→VENC 硬件 Bind 并存)，
+ * 经 RGA 缩放到 MB 池中的小尺寸 NV12 缓冲区后送入目标 VENC 通道 (RK_MPI_VENC_SendFrame)。
+ *
+ * 用于 ISPP 没有空闲缩放通道 (rkispp_scale1/2) 可用时生成低分辨率子码流，
+ * 编码器负载和 DDR 带宽按缩放后的尺寸计算，而不是再编码一路全分辨率码流。
+ */
+
+#ifndef VIDEO_SCALER_H
+#define VIDEO_SCALER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 缩放参数
+ */
+typedef struct {
+    int src_pipe;            /**< 源 VI 管线 */
+    int src_chn;             /**< 源 VI 通道 (必须已启用) */
+    int src_fps;             /**< 源帧率 */
+    int dst_width;           /**< 输出宽度 (16 对齐) */
+    int dst_height;          /**< 输出高度 (2 对齐) */
+    int dst_fps;             /**< 输出帧率 (低于源帧率时按比例抽帧) */
+    int venc_chn;            /**< 目标 VENC 通道 (必须已创建且未绑定) */
+} VideoScalerConfig;
+
+/**
+ * @brief 运行统计
+ */
+typedef struct {
+    uint32_t frames_in;      /**< 从 VI 取到的帧数 */
+    uint32_t frames_out;     /**< 送入 VENC 的帧数 */
+    uint32_t skipped;        /**< 抽帧跳过的帧数 */
+    uint32_t errors;         /**< 缓冲区不足、RGA 或 SendFrame 失败次数 */
+} VideoScalerStats;
+
+/** @brief 缩放器 (内部实现, 对外不透明) */
+typedef struct VideoScaler VideoScaler;
+
+/**
+ * @brief 创建缩放器并启动缩放线程
+ *
+ * @param cfg 缩放参数
+ * @return VideoScaler* 成功返回指针，失败返回 NULL
+ */
+VideoScaler *video_scaler_create(const VideoScalerConfig *cfg);
+
+/**
+ * @brief 停止缩放线程并等待其退出
+ *
+ * 必须在销毁目标 VENC 通道和禁用源 VI 通道之前调用。
+ *
+ * @param scaler 缩放器
+ */
+void video_scaler_stop(VideoScaler *scaler);
+
+/**
+ * @brief 销毁缩放器并释放缓冲池
+ *
+ * 应在销毁目标 VENC 通道之后调用，此时 VENC 已归还所有输出缓冲区。
+ *
+ * @param scaler 缩放器
+ */
+void video_scaler_destroy(VideoScaler *scaler);
+
+/**
+ * @brief 获取运行统计
+ *
+ * @param scaler 缩放器
+ * @param stats 输出参数
+ */
+void video_scaler_get_stats(VideoScaler *scaler, VideoScalerStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VIDEO_SCALER_H
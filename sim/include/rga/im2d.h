@@ -0,0 +1,106 @@
+/**
+ * @file im2d.h
+ * @brief RGA im2d 接口 (主机仿真子集)
+ *
+ * 由 CPU 实现：缩放为最近邻采样，颜色转换为 BT.601 有限范围，
+ * 结果用于验证流水线逻辑和时序，不追求与硬件逐像素一致。
+ * fd 必须来自仿真 MB (RK_MPI_MB_Handle2Fd)。
+ */
+
+#ifndef SIM_IM2D_H
+#define SIM_IM2D_H
+
+#include "rga.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    IM_STATUS_NOERROR = 2,
+    IM_STATUS_SUCCESS = 1,
+    IM_STATUS_NOT_SUPPORTED = -1,
+    IM_STATUS_OUT_OF_MEMORY = -2,
+    IM_STATUS_INVALID_PARAM = -3,
+    IM_STATUS_ILLEGAL_PARAM = -4,
+    IM_STATUS_FAILED = 0,
+} IM_STATUS;
+
+typedef enum {
+    RGA_VENDOR = 0,
+    RGA_VERSION,
+    RGA_MAX_INPUT,
+    RGA_MAX_OUTPUT,
+    RGA_SCALE_LIMIT,
+    RGA_INPUT_FORMAT,
+    RGA_OUTPUT_FORMAT,
+    RGA_FEATURE,
+    RGA_EXPECTED,
+    RGA_ALL,
+} IM_INFORMATION;
+
+/* usage 标志 (improcess) */
+#define IM_HAL_TRANSFORM_ROT_90     (1 << 0)
+#define IM_HAL_TRANSFORM_ROT_180    (1 << 1)
+#define IM_HAL_TRANSFORM_ROT_270    (1 << 2)
+#define IM_HAL_TRANSFORM_FLIP_H     (1 << 3)
+#define IM_HAL_TRANSFORM_FLIP_V     (1 << 4)
+
+/* 混合模式 */
+#define IM_ALPHA_BLEND_SRC_OVER     (1 << 6)
+
+/* 颜色空间 */
+#define IM_COLOR_SPACE_DEFAULT      0
+
+/* 插值方式 */
+#define INTER_NEAREST               0
+#define INTER_LINEAR                1
+#define INTER_CUBIC                 2
+
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} im_rect;
+
+typedef struct {
+    void *vir_addr;
+    void *phy_addr;
+    int fd;
+    int width;
+    int height;
+    int wstride;
+    int hstride;
+    int format;
+    int color_space_mode;
+    int global_alpha;        /**< 全局透明度 (0 ~ 255，0 按不透明处理) */
+    int rd_mode;
+    int color;
+} rga_buffer_t;
+
+rga_buffer_t wrapbuffer_virtualaddr_t(void *vir_addr, int width, int height, int wstride,
+                                      int hstride, int format);
+rga_buffer_t wrapbuffer_fd_t(int fd, int width, int height, int wstride, int hstride, int format);
+
+const char *querystring(int name);
+const char *imStrError_t(IM_STATUS status);
+
+IM_STATUS imcopy_t(const rga_buffer_t src, rga_buffer_t dst, int sync);
+IM_STATUS imresize_t(const rga_buffer_t src, rga_buffer_t dst, double fx, double fy,
+                     int interpolation, int sync);
+IM_STATUS imcrop_t(const rga_buffer_t src, rga_buffer_t dst, im_rect rect, int sync);
+IM_STATUS imrotate_t(const rga_buffer_t src, rga_buffer_t dst, int rotation, int sync);
+IM_STATUS imflip_t(const rga_buffer_t src, rga_buffer_t dst, int mode, int sync);
+IM_STATUS imcvtcolor_t(rga_buffer_t src, rga_buffer_t dst, int sfmt, int dfmt, int mode, int sync);
+IM_STATUS imfill_t(rga_buffer_t dst, im_rect rect, int color, int sync);
+IM_STATUS imblend_t(const rga_buffer_t srcA, const rga_buffer_t srcB, rga_buffer_t dst,
+                    int mode, int sync);
+IM_STATUS improcess(rga_buffer_t src, rga_buffer_t dst, rga_buffer_t pat, im_rect srect,
+                    im_rect drect, im_rect prect, int usage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_IM2D_H
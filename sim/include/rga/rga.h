@@ -0,0 +1,31 @@
+/**
+ * @file rga.h
+ * @brief RGA 像素格式 (主机仿真子集)
+ */
+
+#ifndef SIM_RGA_H
+#define SIM_RGA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    RK_FORMAT_RGBA_8888 = 0x0 << 8,
+    RK_FORMAT_RGBX_8888 = 0x1 << 8,
+    RK_FORMAT_RGB_888 = 0x2 << 8,
+    RK_FORMAT_BGRA_8888 = 0x3 << 8,
+    RK_FORMAT_RGB_565 = 0x4 << 8,
+    RK_FORMAT_BGR_888 = 0x7 << 8,
+    RK_FORMAT_YCbCr_422_SP = 0x8 << 8,
+    RK_FORMAT_YCbCr_420_SP = 0xa << 8,
+    RK_FORMAT_YCbCr_420_P = 0xb << 8,
+    RK_FORMAT_YCrCb_420_SP = 0xe << 8,
+    RK_FORMAT_UNKNOWN = 0x100 << 8,
+} RgaSURF_FORMAT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RGA_H
@@ -0,0 +1,48 @@
+/**
+ * @file rk_mpi_mb.h
+ * @brief 媒体缓冲区 (MB) 接口 (主机仿真子集)
+ *
+ * 缓冲区由 memfd 分配并映射，Handle2Fd 返回的 fd 可以像 DMA-BUF 一样交给仿真 RGA。
+ */
+
+#ifndef SIM_RK_MPI_MB_H
+#define SIM_RK_MPI_MB_H
+
+#include "rk_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MB_ALLOC_TYPE_DMA = 0,
+    MB_ALLOC_TYPE_MALLOC,
+} MB_ALLOC_TYPE_E;
+
+typedef enum {
+    MB_REMAP_MODE_NONE = 0,
+    MB_REMAP_MODE_NOCACHE,
+    MB_REMAP_MODE_CACHED,
+} MB_REMAP_MODE_E;
+
+typedef struct {
+    RK_U64 u64MBSize;        /**< 单个缓冲区大小 */
+    RK_U32 u32MBCnt;         /**< 缓冲区数量 */
+    MB_REMAP_MODE_E enRemapMode;
+    MB_ALLOC_TYPE_E enAllocType;
+    RK_BOOL bPreAlloc;
+} MB_POOL_CONFIG_S;
+
+MB_POOL RK_MPI_MB_CreatePool(MB_POOL_CONFIG_S *pstMbPoolCfg);
+RK_S32 RK_MPI_MB_DestroyPool(MB_POOL pool);
+MB_BLK RK_MPI_MB_GetMB(MB_POOL pool, RK_U64 u64Size, RK_BOOL bBlock);
+RK_S32 RK_MPI_MB_ReleaseMB(MB_BLK mb);
+void *RK_MPI_MB_Handle2VirAddr(MB_BLK mb);
+RK_S32 RK_MPI_MB_Handle2Fd(MB_BLK mb);
+RK_U64 RK_MPI_MB_GetSize(MB_BLK mb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RK_MPI_MB_H
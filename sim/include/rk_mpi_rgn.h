@@ -0,0 +1,100 @@
+/**
+ * @file rk_mpi_rgn.h
+ * @brief 区域叠加 (RGN) 接口 (主机仿真子集)
+ *
+ * 仿真只记录区域与通道的挂载关系并做参数检查，不把叠加内容写进码流。
+ */
+
+#ifndef SIM_RK_MPI_RGN_H
+#define SIM_RK_MPI_RGN_H
+
+#include "rk_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RK_ERR_RGN_INVALID_CHNID    RK_SIM_ERR(RK_ID_RGN, RK_ERR_INVALID_CHNID)
+#define RK_ERR_RGN_ILLEGAL_PARAM    RK_SIM_ERR(RK_ID_RGN, RK_ERR_ILLEGAL_PARAM)
+#define RK_ERR_RGN_EXIST            RK_SIM_ERR(RK_ID_RGN, RK_ERR_EXIST)
+#define RK_ERR_RGN_UNEXIST          RK_SIM_ERR(RK_ID_RGN, RK_ERR_UNEXIST)
+#define RK_ERR_RGN_NULL_PTR         RK_SIM_ERR(RK_ID_RGN, RK_ERR_NULL_PTR)
+#define RK_ERR_RGN_NOT_PERM         RK_SIM_ERR(RK_ID_RGN, RK_ERR_NOT_PERM)
+
+#define RGN_HANDLE_MAX              128
+
+typedef enum {
+    OVERLAY_RGN = 0,
+    COVER_RGN,
+    MOSAIC_RGN,
+    RGN_BUTT,
+} RGN_TYPE_E;
+
+typedef enum {
+    MOSAIC_BLK_SIZE_8 = 0,
+    MOSAIC_BLK_SIZE_16,
+    MOSAIC_BLK_SIZE_32,
+    MOSAIC_BLK_SIZE_64,
+} MOSAIC_BLK_SIZE_E;
+
+typedef struct {
+    PIXEL_FORMAT_E enPixelFmt;
+    SIZE_S stSize;
+    RK_U32 u32BgColor;
+} OVERLAY_ATTR_S;
+
+typedef struct {
+    RGN_TYPE_E enType;
+    union {
+        OVERLAY_ATTR_S stOverlay;
+    } unAttr;
+} RGN_ATTR_S;
+
+typedef struct {
+    POINT_S stPoint;
+    RK_U32 u32FgAlpha;
+    RK_U32 u32BgAlpha;
+    RK_U32 u32Layer;
+} OVERLAY_CHN_ATTR_S;
+
+typedef struct {
+    RECT_S stRect;
+    RK_U32 u32Color;
+    RK_U32 u32Layer;
+} COVER_CHN_ATTR_S;
+
+typedef struct {
+    RECT_S stRect;
+    MOSAIC_BLK_SIZE_E enBlkSize;
+    RK_U32 u32Layer;
+} MOSAIC_CHN_ATTR_S;
+
+typedef struct {
+    RK_BOOL bShow;
+    RGN_TYPE_E enType;
+    union {
+        OVERLAY_CHN_ATTR_S stOverlayChn;
+        COVER_CHN_ATTR_S stCoverChn;
+        MOSAIC_CHN_ATTR_S stMosaicChn;
+    } unChnAttr;
+} RGN_CHN_ATTR_S;
+
+typedef struct {
+    PIXEL_FORMAT_E enPixelFormat;
+    RK_U32 u32Width;
+    RK_U32 u32Height;
+    RK_VOID *pData;
+} BITMAP_S;
+
+RK_S32 RK_MPI_RGN_Create(RGN_HANDLE Handle, const RGN_ATTR_S *pstRegion);
+RK_S32 RK_MPI_RGN_Destroy(RGN_HANDLE Handle);
+RK_S32 RK_MPI_RGN_SetBitMap(RGN_HANDLE Handle, const BITMAP_S *pstBitmap);
+RK_S32 RK_MPI_RGN_AttachToChn(RGN_HANDLE Handle, const MPP_CHN_S *pstChn,
+                              const RGN_CHN_ATTR_S *pstChnAttr);
+RK_S32 RK_MPI_RGN_DetachFromChn(RGN_HANDLE Handle, const MPP_CHN_S *pstChn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RK_MPI_RGN_H
@@ -0,0 +1,33 @@
+/**
+ * @file rk_mpi_sys.h
+ * @brief 系统控制与绑定接口 (主机仿真子集)
+ */
+
+#ifndef SIM_RK_MPI_SYS_H
+#define SIM_RK_MPI_SYS_H
+
+#include "rk_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+RK_S32 RK_MPI_SYS_Init(void);
+RK_S32 RK_MPI_SYS_Exit(void);
+
+/**
+ * @brief 绑定两个通道 (仿真只支持 VI -> VENC)
+ *
+ * 绑定后 VI 每产生一帧都直接交给 VENC，VENC 输入已满时丢弃，与硬件 Bind 一致。
+ */
+RK_S32 RK_MPI_SYS_Bind(const MPP_CHN_S *pstSrcChn, const MPP_CHN_S *pstDestChn);
+RK_S32 RK_MPI_SYS_UnBind(const MPP_CHN_S *pstSrcChn, const MPP_CHN_S *pstDestChn);
+
+/** @brief CPU 缓存维护 (主机上 memfd 映射与 CPU 一致，只做参数检查) */
+RK_S32 RK_MPI_SYS_MmzFlushCache(MB_BLK mb, RK_BOOL bReadOnly);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RK_MPI_SYS_H
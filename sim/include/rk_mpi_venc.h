@@ -0,0 +1,175 @@
+/**
+ * @file rk_mpi_venc.h
+ * @brief 视频编码 (VENC) 接口 (主机仿真子集)
+ *
+ * 仿真编码器不做真正的压缩：按码控参数计算每帧的码流大小，输出带 SPS/PPS (H.265 另有 VPS)
+ * 和关键帧/P 帧 NAL 头的 Annex-B 码流，载荷取自输入图像的采样，
+ * 码率、GOP、帧率抽帧、IDR 请求和码流缓冲区数量的行为与硬件一致。
+ *
+ * 码率字段沿用本项目的填写方式 (bps)。
+ */
+
+#ifndef SIM_RK_MPI_VENC_H
+#define SIM_RK_MPI_VENC_H
+
+#include "rk_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RK_ERR_VENC_INVALID_CHNID   RK_SIM_ERR(RK_ID_VENC, RK_ERR_INVALID_CHNID)
+#define RK_ERR_VENC_ILLEGAL_PARAM   RK_SIM_ERR(RK_ID_VENC, RK_ERR_ILLEGAL_PARAM)
+#define RK_ERR_VENC_EXIST           RK_SIM_ERR(RK_ID_VENC, RK_ERR_EXIST)
+#define RK_ERR_VENC_UNEXIST         RK_SIM_ERR(RK_ID_VENC, RK_ERR_UNEXIST)
+#define RK_ERR_VENC_NULL_PTR        RK_SIM_ERR(RK_ID_VENC, RK_ERR_NULL_PTR)
+#define RK_ERR_VENC_NOT_PERM        RK_SIM_ERR(RK_ID_VENC, RK_ERR_NOT_PERM)
+#define RK_ERR_VENC_NOMEM           RK_SIM_ERR(RK_ID_VENC, RK_ERR_NOMEM)
+#define RK_ERR_VENC_BUF_EMPTY       RK_SIM_ERR(RK_ID_VENC, RK_ERR_BUF_EMPTY)
+#define RK_ERR_VENC_BUF_FULL        RK_SIM_ERR(RK_ID_VENC, RK_ERR_BUF_FULL)
+
+#define VENC_MAX_CHN_NUM            16
+
+typedef enum {
+    H264E_NALU_BSLICE = 0,
+    H264E_NALU_PSLICE = 1,
+    H264E_NALU_ISLICE = 2,
+    H264E_NALU_IDRSLICE = 5,
+    H264E_NALU_SEI = 6,
+    H264E_NALU_SPS = 7,
+    H264E_NALU_PPS = 8,
+} H264E_NALU_TYPE_E;
+
+typedef enum {
+    H265E_NALU_BSLICE = 0,
+    H265E_NALU_PSLICE = 1,
+    H265E_NALU_ISLICE = 2,
+    H265E_NALU_IDRSLICE = 19,
+    H265E_NALU_VPS = 32,
+    H265E_NALU_SPS = 33,
+    H265E_NALU_PPS = 34,
+    H265E_NALU_SEI = 39,
+} H265E_NALU_TYPE_E;
+
+typedef union {
+    H264E_NALU_TYPE_E enH264EType;
+    H265E_NALU_TYPE_E enH265EType;
+} VENC_DATA_TYPE_U;
+
+typedef struct {
+    MB_BLK pMbBlk;
+    RK_U32 u32Len;
+    RK_U64 u64PTS;
+    RK_BOOL bFrameEnd;
+    RK_BOOL bStreamEnd;
+    VENC_DATA_TYPE_U DataType;
+    RK_U32 u32Offset;
+} VENC_PACK_S;
+
+/** @brief 码流帧信息 (子集，仿真只填写帧大小和 QP) */
+typedef struct {
+    RK_U32 u32PicBytesNum;
+    RK_U32 u32StartQp;
+    RK_U32 u32MeanQp;
+} VENC_STREAM_INFO_H264_S;
+
+typedef VENC_STREAM_INFO_H264_S VENC_STREAM_INFO_H265_S;
+
+typedef struct {
+    VENC_PACK_S *pstPack;    /**< 调用者提供的码流包数组 */
+    RK_U32 u32PackCount;
+    RK_U32 u32Seq;
+    union {
+        VENC_STREAM_INFO_H264_S stH264Info;
+        VENC_STREAM_INFO_H265_S stH265Info;
+    };
+} VENC_STREAM_S;
+
+typedef enum {
+    VENC_RC_MODE_H264CBR = 1,
+    VENC_RC_MODE_H264VBR,
+    VENC_RC_MODE_H265CBR,
+    VENC_RC_MODE_H265VBR,
+    VENC_RC_MODE_MJPEGCBR,
+} VENC_RC_MODE_E;
+
+typedef struct {
+    RK_U32 u32Gop;
+    RK_U32 u32SrcFrameRateNum;
+    RK_U32 u32SrcFrameRateDen;
+    RK_U32 fr32DstFrameRateNum;
+    RK_U32 fr32DstFrameRateDen;
+    RK_U32 u32BitRate;
+    RK_U32 u32StatTime;
+} VENC_H264_CBR_S;
+
+typedef VENC_H264_CBR_S VENC_H265_CBR_S;
+
+typedef struct {
+    VENC_RC_MODE_E enRcMode;
+    union {
+        VENC_H264_CBR_S stH264Cbr;
+        VENC_H265_CBR_S stH265Cbr;
+    };
+} VENC_RC_ATTR_S;
+
+typedef struct {
+    RK_CODEC_ID_E enType;
+    PIXEL_FORMAT_E enPixelFormat;
+    RK_U32 u32Profile;
+    RK_U32 u32PicWidth;
+    RK_U32 u32PicHeight;
+    RK_U32 u32VirWidth;
+    RK_U32 u32VirHeight;
+    RK_U32 u32StreamBufCnt;  /**< 码流缓冲区数量 (被 GetStream 取走未归还的也计入) */
+    RK_U32 u32BufSize;       /**< 单个码流缓冲区大小 */
+} VENC_ATTR_S;
+
+typedef struct {
+    RK_U32 u32Reserved;
+} VENC_GOP_ATTR_S;
+
+typedef struct {
+    VENC_ATTR_S stVencAttr;
+    VENC_RC_ATTR_S stRcAttr;
+    VENC_GOP_ATTR_S stGopAttr;
+} VENC_CHN_ATTR_S;
+
+typedef struct {
+    RK_S32 s32RecvPicNum;    /**< -1 表示不限 */
+} VENC_RECV_PIC_PARAM_S;
+
+typedef struct {
+    RK_U32 u32LeftPics;
+    RK_U32 u32LeftStreamBytes;
+    RK_U32 u32LeftStreamFrames;
+    RK_U32 u32CurPacks;
+    RK_U32 u32LeftRecvPics;
+    RK_U32 u32LeftEncPics;
+} VENC_CHN_STATUS_S;
+
+RK_S32 RK_MPI_VENC_CreateChn(VENC_CHN VeChn, const VENC_CHN_ATTR_S *pstAttr);
+RK_S32 RK_MPI_VENC_DestroyChn(VENC_CHN VeChn);
+RK_S32 RK_MPI_VENC_GetChnAttr(VENC_CHN VeChn, VENC_CHN_ATTR_S *pstChnAttr);
+RK_S32 RK_MPI_VENC_SetChnAttr(VENC_CHN VeChn, const VENC_CHN_ATTR_S *pstChnAttr);
+RK_S32 RK_MPI_VENC_StartRecvFrame(VENC_CHN VeChn, const VENC_RECV_PIC_PARAM_S *pstRecvParam);
+RK_S32 RK_MPI_VENC_StopRecvFrame(VENC_CHN VeChn);
+RK_S32 RK_MPI_VENC_SendFrame(VENC_CHN VeChn, const VIDEO_FRAME_INFO_S *pstFrame, RK_S32 s32MilliSec);
+RK_S32 RK_MPI_VENC_GetStream(VENC_CHN VeChn, VENC_STREAM_S *pstStream, RK_S32 s32MilliSec);
+RK_S32 RK_MPI_VENC_ReleaseStream(VENC_CHN VeChn, VENC_STREAM_S *pstStream);
+RK_S32 RK_MPI_VENC_RequestIDR(VENC_CHN VeChn, RK_BOOL bInstant);
+RK_S32 RK_MPI_VENC_QueryStatus(VENC_CHN VeChn, VENC_CHN_STATUS_S *pstStatus);
+
+/**
+ * @brief 获取通道的可等待 fd (有待取码流时可读)
+ *
+ * 仿真用 eventfd 实现，可直接放进 epoll。
+ */
+RK_S32 RK_MPI_VENC_GetFd(VENC_CHN VeChn);
+RK_S32 RK_MPI_VENC_CloseFd(VENC_CHN VeChn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RK_MPI_VENC_H
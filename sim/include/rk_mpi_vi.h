@@ -0,0 +1,86 @@
+/**
+ * @file rk_mpi_vi.h
+ * @brief 视频输入 (VI) 接口 (主机仿真子集)
+ *
+ * 每个启用的通道由一个线程按传感器帧率产生 NV12 帧：
+ * 默认是移动的测试图案，设置 RV_SIM_VI_FILE 时循环读取原始 NV12 文件。
+ */
+
+#ifndef SIM_RK_MPI_VI_H
+#define SIM_RK_MPI_VI_H
+
+#include "rk_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RK_ERR_VI_INVALID_CHNID     RK_SIM_ERR(RK_ID_VI, RK_ERR_INVALID_CHNID)
+#define RK_ERR_VI_ILLEGAL_PARAM     RK_SIM_ERR(RK_ID_VI, RK_ERR_ILLEGAL_PARAM)
+#define RK_ERR_VI_NOT_CONFIG        RK_SIM_ERR(RK_ID_VI, RK_ERR_NOT_CONFIG)
+#define RK_ERR_VI_NOT_PERM          RK_SIM_ERR(RK_ID_VI, RK_ERR_NOT_PERM)
+#define RK_ERR_VI_BUF_EMPTY         RK_SIM_ERR(RK_ID_VI, RK_ERR_BUF_EMPTY)
+
+#define VI_MAX_PIPE_NUM             4
+#define VI_MAX_CHN_NUM              6
+
+typedef struct {
+    RK_U32 u32Reserved;
+} VI_DEV_ATTR_S;
+
+typedef struct {
+    RK_U32 u32Num;
+    VI_PIPE PipeId[VI_MAX_PIPE_NUM];
+} VI_DEV_BIND_PIPE_S;
+
+typedef enum {
+    VI_V4L2_MEMORY_TYPE_MMAP = 1,
+    VI_V4L2_MEMORY_TYPE_USERPTR = 2,
+    VI_V4L2_MEMORY_TYPE_OVERLAY = 3,
+    VI_V4L2_MEMORY_TYPE_DMABUF = 4,
+} VI_V4L2_MEMORY_TYPE;
+
+typedef struct {
+    RK_U32 u32BufCount;
+    RK_U32 u32BufSize;
+    VI_V4L2_MEMORY_TYPE enMemoryType;
+    RK_CHAR aEntityName[32];
+} VI_ISP_OPT_S;
+
+typedef struct {
+    SIZE_S stSize;
+    PIXEL_FORMAT_E enPixelFormat;
+    COMPRESS_MODE_E enCompressMode;
+    VI_ISP_OPT_S stIspOpt;
+    RK_U32 u32Depth;         /**< 供 GetChnFrame 保留的最新帧数, 0 表示不保留 */
+} VI_CHN_ATTR_S;
+
+typedef struct {
+    RK_BOOL bEnable;
+    SIZE_S stSize;
+    RK_U32 u32FrameRate;
+    RK_U32 u32CurFrameID;
+    RK_U32 u32InputLostFrame;
+    RK_U32 u32OutputLostFrame;
+    RK_U32 u32VbFail;
+} VI_CHN_STATUS_S;
+
+RK_S32 RK_MPI_VI_GetDevAttr(VI_DEV ViDev, VI_DEV_ATTR_S *pstDevAttr);
+RK_S32 RK_MPI_VI_SetDevAttr(VI_DEV ViDev, const VI_DEV_ATTR_S *pstDevAttr);
+RK_S32 RK_MPI_VI_GetDevIsEnable(VI_DEV ViDev);
+RK_S32 RK_MPI_VI_EnableDev(VI_DEV ViDev);
+RK_S32 RK_MPI_VI_DisableDev(VI_DEV ViDev);
+RK_S32 RK_MPI_VI_SetDevBindPipe(VI_DEV ViDev, const VI_DEV_BIND_PIPE_S *pstDevBindPipe);
+RK_S32 RK_MPI_VI_SetChnAttr(VI_PIPE ViPipe, VI_CHN ViChn, const VI_CHN_ATTR_S *pstChnAttr);
+RK_S32 RK_MPI_VI_EnableChn(VI_PIPE ViPipe, VI_CHN ViChn);
+RK_S32 RK_MPI_VI_DisableChn(VI_PIPE ViPipe, VI_CHN ViChn);
+RK_S32 RK_MPI_VI_GetChnFrame(VI_PIPE ViPipe, VI_CHN ViChn, VIDEO_FRAME_INFO_S *pstFrameInfo,
+                             RK_S32 s32MilliSec);
+RK_S32 RK_MPI_VI_ReleaseChnFrame(VI_PIPE ViPipe, VI_CHN ViChn, const VIDEO_FRAME_INFO_S *pstFrameInfo);
+RK_S32 RK_MPI_VI_QueryChnStatus(VI_PIPE ViPipe, VI_CHN ViChn, VI_CHN_STATUS_S *pstChnStatus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RK_MPI_VI_H
@@ -0,0 +1,147 @@
+/**
+ * @file rk_type.h
+ * @brief Rockit 基础类型 (主机仿真子集)
+ *
+ * 只包含本项目用到的类型与字段，名称与板端 SDK 保持一致，
+ * 使 main/ 与 common/ 的代码不加修改即可在主机上编译。
+ */
+
+#ifndef SIM_RK_TYPE_H
+#define SIM_RK_TYPE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int8_t   RK_S8;
+typedef uint8_t  RK_U8;
+typedef int16_t  RK_S16;
+typedef uint16_t RK_U16;
+typedef int32_t  RK_S32;
+typedef uint32_t RK_U32;
+typedef int64_t  RK_S64;
+typedef uint64_t RK_U64;
+typedef float    RK_FLOAT;
+typedef double   RK_DOUBLE;
+typedef void     RK_VOID;
+typedef char     RK_CHAR;
+
+typedef enum {
+    RK_FALSE = 0,
+    RK_TRUE  = 1,
+} RK_BOOL;
+
+#define RK_SUCCESS              0
+#define RK_FAILURE              (-1)
+
+/* 错误码: 0xA0 | 模块 ID | 错误号, 与板端一样可按模块区分 */
+#define RK_SIM_ERR(mod, code)   ((RK_S32)(0xA0000000u | ((RK_U32)(mod) << 16) | 0x2000u | (code)))
+#define RK_ERR_INVALID_CHNID    2
+#define RK_ERR_ILLEGAL_PARAM    3
+#define RK_ERR_EXIST            4
+#define RK_ERR_UNEXIST          5
+#define RK_ERR_NULL_PTR         6
+#define RK_ERR_NOT_CONFIG       7
+#define RK_ERR_NOT_PERM         9
+#define RK_ERR_NOMEM            12
+#define RK_ERR_BUF_EMPTY        14
+#define RK_ERR_BUF_FULL         15
+#define RK_ERR_BUSY             18
+
+/* 缓冲区句柄 */
+typedef void *MB_BLK;
+typedef RK_U32 MB_POOL;
+#define MB_INVALID_POOLID       ((MB_POOL)-1)
+#define MB_INVALID_HANDLE       NULL
+
+typedef RK_S32 VI_DEV;
+typedef RK_S32 VI_PIPE;
+typedef RK_S32 VI_CHN;
+typedef RK_S32 VENC_CHN;
+typedef RK_S32 RGN_HANDLE;
+
+/** @brief 模块 ID */
+typedef enum {
+    RK_ID_SYS  = 0,
+    RK_ID_MB   = 1,
+    RK_ID_RGN  = 2,
+    RK_ID_VI   = 3,
+    RK_ID_VENC = 4,
+    RK_ID_VPSS = 5,
+} MOD_ID_E;
+
+/** @brief 通道描述 (Bind/RGN 使用) */
+typedef struct {
+    MOD_ID_E enModId;
+    RK_S32 s32DevId;
+    RK_S32 s32ChnId;
+} MPP_CHN_S;
+
+typedef enum {
+    RK_FMT_YUV420SP = 0,     /**< NV12 */
+    RK_FMT_YUV420SP_VU,      /**< NV21 */
+    RK_FMT_RGB888,
+    RK_FMT_BGR888,
+    RK_FMT_ARGB8888,
+    RK_FMT_ABGR8888,
+    RK_FMT_BGRA8888,
+    RK_FMT_RGBA8888,
+    RK_FMT_BUTT,
+} PIXEL_FORMAT_E;
+
+typedef enum {
+    COMPRESS_MODE_NONE = 0,
+    COMPRESS_AFBC_16x16,
+} COMPRESS_MODE_E;
+
+typedef enum {
+    RK_VIDEO_ID_Unused = 0,
+    RK_VIDEO_ID_AVC    = 8,
+    RK_VIDEO_ID_MJPEG  = 9,
+    RK_VIDEO_ID_JPEG   = 10,
+    RK_VIDEO_ID_HEVC   = 16777220,
+} RK_CODEC_ID_E;
+
+typedef struct {
+    RK_U32 u32Width;
+    RK_U32 u32Height;
+} SIZE_S;
+
+typedef struct {
+    RK_S32 s32X;
+    RK_S32 s32Y;
+} POINT_S;
+
+typedef struct {
+    RK_S32 s32X;
+    RK_S32 s32Y;
+    RK_U32 u32Width;
+    RK_U32 u32Height;
+} RECT_S;
+
+/** @brief 视频帧 */
+typedef struct {
+    MB_BLK pMbBlk;
+    RK_U32 u32Width;
+    RK_U32 u32Height;
+    RK_U32 u32VirWidth;
+    RK_U32 u32VirHeight;
+    PIXEL_FORMAT_E enPixelFormat;
+    COMPRESS_MODE_E enCompressMode;
+    RK_U32 u32TimeRef;
+    RK_U64 u64PTS;
+    RK_U64 u64PrivateData;
+    RK_U32 u32FrameFlag;
+} VIDEO_FRAME_S;
+
+typedef struct {
+    VIDEO_FRAME_S stVFrame;
+} VIDEO_FRAME_INFO_S;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RK_TYPE_H
@@ -0,0 +1,53 @@
+/**
+ * @file rkmuxer.h
+ * @brief rkmuxer 接口 (主机仿真子集)
+ *
+ * 仿真不连接 RTMP 服务器。设置 RV_SIM_UPLINK_KBPS 时按该带宽阻塞写入，
+ * 用于复现弱网下推流线程变慢、队列积压的情况；
+ * 设置 RV_SIM_DUMP_DIR 时把每路视频写成 Annex-B 文件。
+ */
+
+#ifndef SIM_RKMUXER_H
+#define SIM_RKMUXER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int width;
+    int height;
+    int vir_width;
+    int vir_height;
+    int bit_rate;
+    int frame_rate_den;
+    int frame_rate_num;
+    int profile;
+    int level;
+    char format[32];
+    char codec[32];
+} VideoParam;
+
+typedef struct {
+    int channels;
+    int sample_rate;
+    int frame_size;
+    char format[32];
+    char codec[32];
+} AudioParam;
+
+int rkmuxer_init(int id, char *format, const char *file_path, VideoParam *video_param,
+                 AudioParam *audio_param);
+int rkmuxer_deinit(int id);
+int rkmuxer_write_video_frame(int id, unsigned char *buffer, unsigned int buffer_size,
+                              int64_t present_time, int key_frame);
+int rkmuxer_write_audio_frame(int id, unsigned char *buffer, unsigned int buffer_size,
+                              int64_t present_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RKMUXER_H
@@ -0,0 +1,54 @@
+/**
+ * @file rtsp_demo.h
+ * @brief librtsp 接口 (主机仿真子集)
+ *
+ * 仿真不监听网络端口，只统计每个会话收到的音视频帧和字节数，
+ * 退出时打印；用于在主机上跑通推流路径的时序。
+ */
+
+#ifndef SIM_RTSP_DEMO_H
+#define SIM_RTSP_DEMO_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *rtsp_demo_handle;
+typedef void *rtsp_session_handle;
+
+enum {
+    RTSP_CODEC_ID_NONE = 0,
+    RTSP_CODEC_ID_VIDEO_H264 = 0x0001,
+    RTSP_CODEC_ID_VIDEO_H265,
+    RTSP_CODEC_ID_VIDEO_MPEG4,
+    RTSP_CODEC_ID_AUDIO_G711A = 0x4001,
+    RTSP_CODEC_ID_AUDIO_G711U,
+    RTSP_CODEC_ID_AUDIO_G726,
+    RTSP_CODEC_ID_AUDIO_AAC,
+};
+
+rtsp_demo_handle create_rtsp_demo(int port);
+rtsp_session_handle rtsp_new_session(rtsp_demo_handle demo, const char *path);
+int rtsp_set_video(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len);
+int rtsp_set_audio(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len);
+int rtsp_set_audio_sample_rate(rtsp_session_handle session, int sample_rate);
+int rtsp_set_audio_channels(rtsp_session_handle session, int channels);
+int rtsp_tx_video(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts);
+int rtsp_tx_audio(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts);
+int rtsp_sync_video_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime);
+int rtsp_sync_audio_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime);
+void rtsp_del_session(rtsp_session_handle session);
+void rtsp_del_demo(rtsp_demo_handle demo);
+int rtsp_do_event(rtsp_demo_handle demo);
+uint64_t rtsp_get_reltime(void);
+uint64_t rtsp_get_ntptime(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_RTSP_DEMO_H
@@ -0,0 +1,91 @@
+/**
+ * @file sim_internal.h
+ * @brief 主机仿真后端的内部接口 (各仿真模块之间共享)
+ *
+ * 运行参数通过环境变量设置：
+ * - RV_SIM_FPS:               传感器帧率，默认取 rk_isp_set_frame_rate 的值 (30)
+ * - RV_SIM_VI_FILE:           原始 NV12 文件，尺寸与通道一致时循环播放，否则使用测试图案
+ * - RV_SIM_VENC_US_PER_MPIX:  编码每百万像素的耗时 (微秒)，默认 4000，0 表示不模拟
+ * - RV_SIM_UPLINK_KBPS:       rkmuxer 写入带宽上限 (kbps)，0 表示不限
+ * - RV_SIM_DUMP_DIR:          rkmuxer 把视频写成 Annex-B 文件的目录
+ */
+
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rk_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 单调时钟 (微秒)，与 VI 帧 PTS 同一时基 */
+uint64_t sim_now_us(void);
+
+/**
+ * @brief 读取整数环境变量
+ *
+ * @param name 变量名
+ * @param def 未设置或非法时的默认值
+ */
+int sim_env_int(const char *name, int def);
+
+/**
+ * @brief 初始化使用单调时钟的条件变量
+ */
+void sim_cond_init(pthread_cond_t *cond);
+
+/**
+ * @brief 在条件变量上等待 (调用者持有 mutex)
+ *
+ * @param timeout_ms < 0 一直等待，0 不等待，> 0 最长等待时间
+ * @return 0 被唤醒，-1 超时
+ */
+int sim_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, int timeout_ms);
+
+/* ----------------------------- MB ----------------------------- */
+
+/**
+ * @brief 为 MB 增加一个引用 (VENC 收下输入帧时调用)
+ */
+void sim_mb_retain(MB_BLK mb);
+
+/**
+ * @brief 由 fd 查找仿真 MB 的映射地址 (供仿真 RGA 使用)
+ *
+ * @param fd RK_MPI_MB_Handle2Fd 返回的 fd
+ * @param size 输出缓冲区大小，可为 NULL
+ * @return 映射地址，fd 不属于仿真 MB 时返回 NULL
+ */
+void *sim_mb_fd_to_vir(int fd, size_t *size);
+
+/* ----------------------------- VI ----------------------------- */
+
+/**
+ * @brief 把 VI 通道的输出接到 VENC 通道 (RK_MPI_SYS_Bind)
+ *
+ * @return RK_SUCCESS 或错误码
+ */
+RK_S32 sim_vi_bind(VI_PIPE pipe, VI_CHN chn, VENC_CHN venc_chn);
+
+/**
+ * @brief 解除 VI 通道到 VENC 通道的绑定
+ */
+RK_S32 sim_vi_unbind(VI_PIPE pipe, VI_CHN chn, VENC_CHN venc_chn);
+
+/* ----------------------------- ISP ---------------------------- */
+
+/**
+ * @brief 当前传感器帧率 (VI 线程按此节拍出帧)
+ */
+int sim_sensor_fps(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_INTERNAL_H
@@ -0,0 +1,64 @@
+/**
+ * @file sim_isp.c
+ * @brief ISP 控制接口仿真 (替代 common/isp/rv1126/isp.c)
+ *
+ * 主机上没有 rkaiq 与传感器，只保存帧率供 VI 出帧线程使用，
+ * 图像调节类接口不参与仿真构建。
+ */
+
+#include "sim_internal.h"
+#include "isp.h"
+#include "log.h"
+
+#include <stdio.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_isp"
+
+/** @brief 最大传感器数量 */
+#define SIM_ISP_MAX_CAMS        2
+
+static int g_isp_fps[SIM_ISP_MAX_CAMS] = { 30, 30 };
+
+int sim_sensor_fps(void) {
+    int fps = sim_env_int("RV_SIM_FPS", 0);
+    if (fps > 0) return fps;
+    return __atomic_load_n(&g_isp_fps[0], __ATOMIC_RELAXED);
+}
+
+int rk_isp_init(int cam_id, char *iqfile_path) {
+    if (cam_id < 0 || cam_id >= SIM_ISP_MAX_CAMS) return -1;
+    LOG_INFO("Simulated sensor %d (iq files %s ignored)\n", cam_id,
+             iqfile_path ? iqfile_path : "none");
+    return 0;
+}
+
+int rk_isp_deinit(int cam_id) {
+    return cam_id >= 0 && cam_id < SIM_ISP_MAX_CAMS ? 0 : -1;
+}
+
+int rk_isp_group_init(int cam_group_id, char *iqfile_path) {
+    return rk_isp_init(cam_group_id, iqfile_path);
+}
+
+int rk_isp_group_deinit(int cam_group_id) {
+    return rk_isp_deinit(cam_group_id);
+}
+
+int rk_isp_get_frame_rate(int cam_id, int *value) {
+    if (cam_id < 0 || cam_id >= SIM_ISP_MAX_CAMS || !value) return -1;
+    *value = __atomic_load_n(&g_isp_fps[cam_id], __ATOMIC_RELAXED);
+    return 0;
+}
+
+int rk_isp_set_frame_rate(int cam_id, int value) {
+    if (cam_id < 0 || cam_id >= SIM_ISP_MAX_CAMS || value <= 0) return -1;
+    __atomic_store_n(&g_isp_fps[cam_id], value, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int rk_isp_set_frame_rate_without_ini(int cam_id, int value) {
+    return rk_isp_set_frame_rate(cam_id, value);
+}
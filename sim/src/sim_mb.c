@@ -0,0 +1,371 @@
+/**
+ * @file sim_mb.c
+ * @brief 媒体缓冲区 (MB) 与系统控制仿真
+ *
+ * 每个 MB 是一块 memfd 共享内存：Handle2VirAddr 返回其映射地址，
+ * Handle2Fd 返回 memfd，仿真 RGA 通过 fd 反查映射，效果与 DMA-BUF 相同。
+ *
+ * 引用计数规则与板端一致：GetMB 得到一个引用，VENC 收下输入帧时再加一个，
+ * 最后一个 ReleaseMB 时归还缓冲池；池在仍有缓冲区被持有时销毁，
+ * 会推迟到最后一个缓冲区归还后再释放内存。
+ */
+
+#define _GNU_SOURCE
+#include "sim_internal.h"
+#include "rk_mpi_mb.h"
+#include "rk_mpi_sys.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_mb"
+
+/** @brief 同时存在的缓冲池上限 */
+#define SIM_MB_MAX_POOLS        64
+
+struct SimMbPool;
+
+/**
+ * @brief 单个缓冲区 (MB_BLK 指向此结构)
+ */
+typedef struct SimMb {
+    int refcount;                /**< 引用计数 (原子访问) */
+    int fd;                      /**< memfd，分配失败回退到 malloc 时为 -1 */
+    void *vir;                   /**< 映射地址 */
+    size_t size;                 /**< 大小 */
+    struct SimMbPool *pool;      /**< 所属缓冲池，独立分配时为 NULL */
+    struct SimMb *next_free;     /**< 池内空闲链表 */
+    struct SimMb *next_all;      /**< 全局登记链表 (fd 反查) */
+} SimMb;
+
+/**
+ * @brief 缓冲池
+ */
+typedef struct SimMbPool {
+    MB_POOL id;
+    size_t mb_size;              /**< 单个缓冲区大小 */
+    int count;                   /**< 缓冲区数量 */
+    SimMb **blocks;              /**< 全部缓冲区 */
+    SimMb *free_list;            /**< 空闲缓冲区 */
+    int outstanding;             /**< 被持有的缓冲区数量 */
+    int destroyed;               /**< 已调用 DestroyPool，等待缓冲区归还 */
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+} SimMbPool;
+
+static SimMbPool *g_pools[SIM_MB_MAX_POOLS];
+static pthread_mutex_t g_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief 全部存活的缓冲区 (fd 反查用) */
+static SimMb *g_mb_list = NULL;
+static pthread_mutex_t g_mb_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int g_sys_inited = 0;
+
+/* =========================================================================
+ *                              公共工具
+ * ========================================================================= */
+
+uint64_t sim_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int sim_env_int(const char *name, int def) {
+    const char *value = getenv(name);
+    if (!value || !*value) return def;
+
+    char *end = NULL;
+    long v = strtol(value, &end, 10);
+    if (*end != '\0' || v < 0) return def;
+    return (int)v;
+}
+
+void sim_cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+int sim_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, int timeout_ms) {
+    if (timeout_ms == 0) return -1;
+    if (timeout_ms < 0) {
+        pthread_cond_wait(cond, mutex);
+        return 0;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return pthread_cond_timedwait(cond, mutex, &deadline) == ETIMEDOUT ? -1 : 0;
+}
+
+/* =========================================================================
+ *                              缓冲区分配
+ * ========================================================================= */
+
+static SimMb *sim_mb_alloc(size_t size, SimMbPool *pool) {
+    SimMb *mb = (SimMb *)calloc(1, sizeof(SimMb));
+    if (!mb) return NULL;
+
+    mb->size = size;
+    mb->pool = pool;
+    mb->fd = memfd_create("sim-mb", MFD_CLOEXEC);
+    if (mb->fd >= 0 && ftruncate(mb->fd, (off_t)size) == 0) {
+        mb->vir = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mb->fd, 0);
+        if (mb->vir == MAP_FAILED) mb->vir = NULL;
+    }
+    if (!mb->vir) {
+        if (mb->fd >= 0) close(mb->fd);
+        mb->fd = -1;
+        mb->vir = malloc(size);
+        if (!mb->vir) {
+            free(mb);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_lock(&g_mb_list_lock);
+    mb->next_all = g_mb_list;
+    g_mb_list = mb;
+    pthread_mutex_unlock(&g_mb_list_lock);
+    return mb;
+}
+
+static void sim_mb_free(SimMb *mb) {
+    pthread_mutex_lock(&g_mb_list_lock);
+    for (SimMb **p = &g_mb_list; *p; p = &(*p)->next_all) {
+        if (*p == mb) {
+            *p = mb->next_all;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_mb_list_lock);
+
+    if (mb->fd >= 0) {
+        munmap(mb->vir, mb->size);
+        close(mb->fd);
+    } else {
+        free(mb->vir);
+    }
+    free(mb);
+}
+
+/**
+ * @brief 释放缓冲池本身 (所有缓冲区都已归还)
+ */
+static void sim_pool_free(SimMbPool *pool) {
+    for (int i = 0; i < pool->count; i++) {
+        sim_mb_free(pool->blocks[i]);
+    }
+    free(pool->blocks);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->not_empty);
+    free(pool);
+}
+
+void sim_mb_retain(MB_BLK mb) {
+    if (mb) __atomic_add_fetch(&((SimMb *)mb)->refcount, 1, __ATOMIC_RELAXED);
+}
+
+void *sim_mb_fd_to_vir(int fd, size_t *size) {
+    void *vir = NULL;
+
+    pthread_mutex_lock(&g_mb_list_lock);
+    for (SimMb *mb = g_mb_list; mb; mb = mb->next_all) {
+        if (mb->fd == fd) {
+            vir = mb->vir;
+            if (size) *size = mb->size;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_mb_list_lock);
+    return vir;
+}
+
+/* =========================================================================
+ *                              MB 接口
+ * ========================================================================= */
+
+MB_POOL RK_MPI_MB_CreatePool(MB_POOL_CONFIG_S *pstMbPoolCfg) {
+    if (!pstMbPoolCfg || pstMbPoolCfg->u64MBSize == 0 || pstMbPoolCfg->u32MBCnt == 0) {
+        return MB_INVALID_POOLID;
+    }
+
+    SimMbPool *pool = (SimMbPool *)calloc(1, sizeof(SimMbPool));
+    if (!pool) return MB_INVALID_POOLID;
+    pool->mb_size = (size_t)pstMbPoolCfg->u64MBSize;
+    pool->blocks = (SimMb **)calloc(pstMbPoolCfg->u32MBCnt, sizeof(SimMb *));
+    pthread_mutex_init(&pool->lock, NULL);
+    sim_cond_init(&pool->not_empty);
+    if (!pool->blocks) {
+        sim_pool_free(pool);
+        return MB_INVALID_POOLID;
+    }
+
+    // 板端 bPreAlloc = RK_FALSE 时按需分配，仿真统一预分配
+    for (RK_U32 i = 0; i < pstMbPoolCfg->u32MBCnt; i++) {
+        SimMb *mb = sim_mb_alloc(pool->mb_size, pool);
+        if (!mb) {
+            LOG_ERROR("Out of memory allocating %u x %zu bytes\n", pstMbPoolCfg->u32MBCnt,
+                      pool->mb_size);
+            sim_pool_free(pool);
+            return MB_INVALID_POOLID;
+        }
+        pool->blocks[pool->count++] = mb;
+        mb->next_free = pool->free_list;
+        pool->free_list = mb;
+    }
+
+    pthread_mutex_lock(&g_pools_lock);
+    for (int i = 0; i < SIM_MB_MAX_POOLS; i++) {
+        if (!g_pools[i]) {
+            pool->id = (MB_POOL)i;
+            g_pools[i] = pool;
+            pthread_mutex_unlock(&g_pools_lock);
+            return pool->id;
+        }
+    }
+    pthread_mutex_unlock(&g_pools_lock);
+
+    LOG_ERROR("Too many MB pools\n");
+    sim_pool_free(pool);
+    return MB_INVALID_POOLID;
+}
+
+RK_S32 RK_MPI_MB_DestroyPool(MB_POOL pool_id) {
+    if (pool_id >= SIM_MB_MAX_POOLS) return RK_SIM_ERR(RK_ID_MB, RK_ERR_ILLEGAL_PARAM);
+
+    pthread_mutex_lock(&g_pools_lock);
+    SimMbPool *pool = g_pools[pool_id];
+    g_pools[pool_id] = NULL;
+    pthread_mutex_unlock(&g_pools_lock);
+    if (!pool) return RK_SIM_ERR(RK_ID_MB, RK_ERR_UNEXIST);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->destroyed = 1;
+    int outstanding = pool->outstanding;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (outstanding == 0) {
+        sim_pool_free(pool);
+    } else {
+        LOG_DEBUG("Pool %u destroyed with %d blocks held, freed on last release\n",
+                  pool_id, outstanding);
+    }
+    return RK_SUCCESS;
+}
+
+MB_BLK RK_MPI_MB_GetMB(MB_POOL pool_id, RK_U64 u64Size, RK_BOOL bBlock) {
+    if (pool_id >= SIM_MB_MAX_POOLS) return MB_INVALID_HANDLE;
+
+    pthread_mutex_lock(&g_pools_lock);
+    SimMbPool *pool = g_pools[pool_id];
+    pthread_mutex_unlock(&g_pools_lock);
+    if (!pool || u64Size > pool->mb_size) return MB_INVALID_HANDLE;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->free_list && bBlock && !pool->destroyed) {
+        pthread_cond_wait(&pool->not_empty, &pool->lock);
+    }
+    SimMb *mb = pool->destroyed ? NULL : pool->free_list;
+    if (mb) {
+        pool->free_list = mb->next_free;
+        pool->outstanding++;
+        mb->refcount = 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return mb;
+}
+
+RK_S32 RK_MPI_MB_ReleaseMB(MB_BLK handle) {
+    SimMb *mb = (SimMb *)handle;
+    if (!mb) return RK_SIM_ERR(RK_ID_MB, RK_ERR_NULL_PTR);
+    if (__atomic_sub_fetch(&mb->refcount, 1, __ATOMIC_ACQ_REL) != 0) return RK_SUCCESS;
+
+    SimMbPool *pool = mb->pool;
+    if (!pool) {
+        sim_mb_free(mb);
+        return RK_SUCCESS;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    mb->next_free = pool->free_list;
+    pool->free_list = mb;
+    pool->outstanding--;
+    int release_pool = pool->destroyed && pool->outstanding == 0;
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (release_pool) sim_pool_free(pool);
+    return RK_SUCCESS;
+}
+
+void *RK_MPI_MB_Handle2VirAddr(MB_BLK mb) {
+    return mb ? ((SimMb *)mb)->vir : NULL;
+}
+
+RK_S32 RK_MPI_MB_Handle2Fd(MB_BLK mb) {
+    return mb ? ((SimMb *)mb)->fd : -1;
+}
+
+RK_U64 RK_MPI_MB_GetSize(MB_BLK mb) {
+    return mb ? (RK_U64)((SimMb *)mb)->size : 0;
+}
+
+/* =========================================================================
+ *                              SYS 接口
+ * ========================================================================= */
+
+RK_S32 RK_MPI_SYS_Init(void) {
+    if (!g_sys_inited) {
+        g_sys_inited = 1;
+        LOG_INFO("Host simulation backend: VI/VENC/RGN/RGA run on the CPU\n");
+    }
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_SYS_Exit(void) {
+    g_sys_inited = 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_SYS_Bind(const MPP_CHN_S *pstSrcChn, const MPP_CHN_S *pstDestChn) {
+    if (!pstSrcChn || !pstDestChn) return RK_SIM_ERR(RK_ID_SYS, RK_ERR_NULL_PTR);
+    if (pstSrcChn->enModId != RK_ID_VI || pstDestChn->enModId != RK_ID_VENC) {
+        LOG_ERROR("Only VI -> VENC bind is simulated\n");
+        return RK_SIM_ERR(RK_ID_SYS, RK_ERR_NOT_PERM);
+    }
+    return sim_vi_bind(pstSrcChn->s32DevId, pstSrcChn->s32ChnId, pstDestChn->s32ChnId);
+}
+
+RK_S32 RK_MPI_SYS_UnBind(const MPP_CHN_S *pstSrcChn, const MPP_CHN_S *pstDestChn) {
+    if (!pstSrcChn || !pstDestChn) return RK_SIM_ERR(RK_ID_SYS, RK_ERR_NULL_PTR);
+    if (pstSrcChn->enModId != RK_ID_VI || pstDestChn->enModId != RK_ID_VENC) {
+        return RK_SIM_ERR(RK_ID_SYS, RK_ERR_NOT_PERM);
+    }
+    return sim_vi_unbind(pstSrcChn->s32DevId, pstSrcChn->s32ChnId, pstDestChn->s32ChnId);
+}
+
+RK_S32 RK_MPI_SYS_MmzFlushCache(MB_BLK mb, RK_BOOL bReadOnly) {
+    (void)bReadOnly;
+    return mb ? RK_SUCCESS : RK_SIM_ERR(RK_ID_SYS, RK_ERR_NULL_PTR);
+}
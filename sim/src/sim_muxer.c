@@ -0,0 +1,138 @@
+/**
+ * @file sim_muxer.c
+ * @brief rkmuxer 仿真
+ *
+ * 上行带宽按"链路忙到何时"建模：每次写入把忙碌时间推后 len * 8 / kbps，
+ * 积压超过 SIM_MUXER_SOCKBUF_MS (相当于 socket 发送缓冲区) 时阻塞到积压回落，
+ * 与 librtmp 在弱网下阻塞 send 的表现一致。
+ */
+
+#include "sim_internal.h"
+#include "rkmuxer.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_muxer"
+
+/** @brief muxer 实例数 (0~2 录像，3~5 RTMP) */
+#define SIM_MUXER_MAX           8
+
+/** @brief 允许积压的发送时长 (毫秒) */
+#define SIM_MUXER_SOCKBUF_MS    100
+
+typedef struct {
+    int active;
+    FILE *dump;                  /**< RV_SIM_DUMP_DIR 下的 Annex-B 文件 */
+    uint64_t busy_until_us;      /**< 链路发送完已写入数据的时间 */
+    uint64_t video_frames;
+    uint64_t video_bytes;
+    uint64_t blocked_us;         /**< 写入被带宽限制阻塞的总时长 */
+} SimMuxer;
+
+static SimMuxer g_muxers[SIM_MUXER_MAX];
+static pthread_mutex_t g_muxer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 按上行带宽占用链路，必要时阻塞 (不持有锁)
+ */
+static void sim_muxer_throttle(SimMuxer *m, unsigned int len) {
+    int kbps = sim_env_int("RV_SIM_UPLINK_KBPS", 0);
+    if (kbps <= 0) return;
+
+    pthread_mutex_lock(&g_muxer_lock);
+    uint64_t now = sim_now_us();
+    if (m->busy_until_us < now) m->busy_until_us = now;
+    m->busy_until_us += (uint64_t)len * 8 * 1000 / (uint64_t)kbps;
+    uint64_t backlog = m->busy_until_us - now;
+    pthread_mutex_unlock(&g_muxer_lock);
+
+    if (backlog > SIM_MUXER_SOCKBUF_MS * 1000) {
+        uint64_t wait = backlog - SIM_MUXER_SOCKBUF_MS * 1000;
+        usleep((useconds_t)wait);
+        __atomic_add_fetch(&m->blocked_us, wait, __ATOMIC_RELAXED);
+    }
+}
+
+int rkmuxer_init(int id, char *format, const char *file_path, VideoParam *video_param,
+                 AudioParam *audio_param) {
+    (void)audio_param;
+    if (id < 0 || id >= SIM_MUXER_MAX || !video_param) return -1;
+
+    pthread_mutex_lock(&g_muxer_lock);
+    SimMuxer *m = &g_muxers[id];
+    if (m->active) {
+        pthread_mutex_unlock(&g_muxer_lock);
+        return -1;
+    }
+    memset(m, 0, sizeof(*m));
+    m->active = 1;
+
+    const char *dir = getenv("RV_SIM_DUMP_DIR");
+    if (dir && *dir) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/muxer%d.%s", dir, id,
+                 strcmp(video_param->codec, "H.265") == 0 ? "h265" : "h264");
+        m->dump = fopen(path, "wb");
+        if (!m->dump) LOG_WARN("Cannot create %s: %s\n", path, strerror(errno));
+    }
+    pthread_mutex_unlock(&g_muxer_lock);
+
+    LOG_INFO("muxer %d: %s -> %s, %dx%d %s (uplink %d kbps)\n", id, format ? format : "?",
+             file_path ? file_path : "?", video_param->width, video_param->height,
+             video_param->codec, sim_env_int("RV_SIM_UPLINK_KBPS", 0));
+    return 0;
+}
+
+int rkmuxer_deinit(int id) {
+    if (id < 0 || id >= SIM_MUXER_MAX) return -1;
+
+    pthread_mutex_lock(&g_muxer_lock);
+    SimMuxer *m = &g_muxers[id];
+    if (!m->active) {
+        pthread_mutex_unlock(&g_muxer_lock);
+        return -1;
+    }
+    if (m->dump) fclose(m->dump);
+    m->active = 0;
+    pthread_mutex_unlock(&g_muxer_lock);
+
+    LOG_INFO("muxer %d: %llu video frames, %llu bytes, blocked %llu ms by uplink\n", id,
+             (unsigned long long)m->video_frames, (unsigned long long)m->video_bytes,
+             (unsigned long long)(m->blocked_us / 1000));
+    return 0;
+}
+
+int rkmuxer_write_video_frame(int id, unsigned char *buffer, unsigned int buffer_size,
+                              int64_t present_time, int key_frame) {
+    (void)present_time;
+    (void)key_frame;
+    if (id < 0 || id >= SIM_MUXER_MAX || !buffer) return -1;
+
+    SimMuxer *m = &g_muxers[id];
+    if (!m->active) return -1;
+
+    sim_muxer_throttle(m, buffer_size);
+    if (m->dump) fwrite(buffer, 1, buffer_size, m->dump);
+    m->video_frames++;
+    m->video_bytes += buffer_size;
+    return 0;
+}
+
+int rkmuxer_write_audio_frame(int id, unsigned char *buffer, unsigned int buffer_size,
+                              int64_t present_time) {
+    (void)present_time;
+    if (id < 0 || id >= SIM_MUXER_MAX || !buffer) return -1;
+
+    SimMuxer *m = &g_muxers[id];
+    if (!m->active) return -1;
+    sim_muxer_throttle(m, buffer_size);
+    return 0;
+}
@@ -0,0 +1,500 @@
+/**
+ * @file sim_rga.c
+ * @brief im2d (RGA) 的 CPU 实现
+ *
+ * 缓冲区可以是虚拟地址，也可以是仿真 MB 的 fd (通过 sim_mb_fd_to_vir 反查映射)。
+ *
+ * - 拷贝/缩放/裁剪/旋转/翻转统一走逐平面的最近邻变换，不做插值；
+ *   输入输出格式必须相同，格式转换用 imcvtcolor_t；
+ * - 颜色转换支持 NV12/NV21 与 RGB888/BGR888/RGBA8888/RGBX8888/BGRA8888 之间互转 (BT.601 limited range)，
+ *   尺寸必须相同；
+ * - 混合只支持 32 位带 alpha 的前景叠加到 32 位或 NV12/NV21 背景的左上角。
+ *
+ * 所有接口同步完成，sync 参数被忽略。
+ */
+
+#include "sim_internal.h"
+#include "rga/im2d.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_rga"
+
+/** @brief 单个平面的描述 (坐标以该平面的像素为单位) */
+typedef struct {
+    uint8_t *base;               /**< 平面起始地址 */
+    int stride;                  /**< 行字节数 */
+    int bpp;                     /**< 每像素字节数 */
+    int xdiv;                    /**< 相对亮度平面的水平下采样 */
+    int ydiv;                    /**< 相对亮度平面的垂直下采样 */
+} SimPlane;
+
+/* =========================================================================
+ *                              缓冲区解析
+ * ========================================================================= */
+
+static uint8_t *sim_rga_addr(const rga_buffer_t *buf) {
+    if (buf->vir_addr) return (uint8_t *)buf->vir_addr;
+    if (buf->fd >= 0) return (uint8_t *)sim_mb_fd_to_vir(buf->fd, NULL);
+    return NULL;
+}
+
+static int sim_rga_packed_bpp(int format) {
+    switch (format) {
+        case RK_FORMAT_RGBA_8888:
+        case RK_FORMAT_RGBX_8888:
+        case RK_FORMAT_BGRA_8888:   return 4;
+        case RK_FORMAT_RGB_888:
+        case RK_FORMAT_BGR_888:     return 3;
+        case RK_FORMAT_RGB_565:     return 2;
+        default:                    return 0;
+    }
+}
+
+/**
+ * @brief 按格式拆分平面
+ *
+ * @return 平面数，格式不支持或地址无效时返回 0
+ */
+static int sim_rga_planes(const rga_buffer_t *buf, SimPlane planes[3]) {
+    uint8_t *base = sim_rga_addr(buf);
+    if (!base || buf->width <= 0 || buf->height <= 0) return 0;
+
+    int ws = buf->wstride > 0 ? buf->wstride : buf->width;
+    int hs = buf->hstride > 0 ? buf->hstride : buf->height;
+    size_t luma = (size_t)ws * hs;
+
+    int bpp = sim_rga_packed_bpp(buf->format);
+    if (bpp) {
+        planes[0] = (SimPlane){ base, ws * bpp, bpp, 1, 1 };
+        return 1;
+    }
+
+    switch (buf->format) {
+        case RK_FORMAT_YCbCr_420_SP:
+        case RK_FORMAT_YCrCb_420_SP:
+            planes[0] = (SimPlane){ base, ws, 1, 1, 1 };
+            planes[1] = (SimPlane){ base + luma, ws, 2, 2, 2 };
+            return 2;
+        case RK_FORMAT_YCbCr_422_SP:
+            planes[0] = (SimPlane){ base, ws, 1, 1, 1 };
+            planes[1] = (SimPlane){ base + luma, ws, 2, 2, 1 };
+            return 2;
+        case RK_FORMAT_YCbCr_420_P:
+            planes[0] = (SimPlane){ base, ws, 1, 1, 1 };
+            planes[1] = (SimPlane){ base + luma, ws / 2, 1, 2, 2 };
+            planes[2] = (SimPlane){ base + luma * 5 / 4, ws / 2, 1, 2, 2 };
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+static im_rect sim_rga_full_rect(const rga_buffer_t *buf) {
+    return (im_rect){ 0, 0, buf->width, buf->height };
+}
+
+static int sim_rga_rect_valid(const rga_buffer_t *buf, const im_rect *r) {
+    return r->x >= 0 && r->y >= 0 && r->width > 0 && r->height > 0 &&
+           r->x + r->width <= buf->width && r->y + r->height <= buf->height;
+}
+
+/* =========================================================================
+ *                              几何变换
+ * ========================================================================= */
+
+/**
+ * @brief 最近邻变换 (缩放/裁剪/旋转/翻转的公共实现)
+ *
+ * 目标矩形中每个像素取中心点，先翻转再按旋转角度映射回源矩形。
+ */
+static IM_STATUS sim_rga_transform(const rga_buffer_t *src, const rga_buffer_t *dst,
+                                   im_rect srect, im_rect drect, int usage) {
+    if (src->format != dst->format) {
+        LOG_ERROR("Format conversion needs imcvtcolor (0x%x -> 0x%x)\n", src->format, dst->format);
+        return IM_STATUS_NOT_SUPPORTED;
+    }
+    if (!sim_rga_rect_valid(src, &srect) || !sim_rga_rect_valid(dst, &drect)) {
+        return IM_STATUS_INVALID_PARAM;
+    }
+
+    SimPlane sp[3], dp[3];
+    int n = sim_rga_planes(src, sp);
+    if (n == 0 || sim_rga_planes(dst, dp) != n) return IM_STATUS_INVALID_PARAM;
+
+    int rot = usage & (IM_HAL_TRANSFORM_ROT_90 | IM_HAL_TRANSFORM_ROT_180 | IM_HAL_TRANSFORM_ROT_270);
+    for (int p = 0; p < n; p++) {
+        int bpp = sp[p].bpp;
+        int sx0 = srect.x / sp[p].xdiv, sy0 = srect.y / sp[p].ydiv;
+        int sw = srect.width / sp[p].xdiv, sh = srect.height / sp[p].ydiv;
+        int dx0 = drect.x / dp[p].xdiv, dy0 = drect.y / dp[p].ydiv;
+        int dw = drect.width / dp[p].xdiv, dh = drect.height / dp[p].ydiv;
+        if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) continue;
+
+        // 无旋转翻转且尺寸相同: 逐行拷贝
+        if (usage == 0 && sw == dw && sh == dh) {
+            for (int y = 0; y < dh; y++) {
+                memcpy(dp[p].base + (size_t)(dy0 + y) * dp[p].stride + (size_t)dx0 * bpp,
+                       sp[p].base + (size_t)(sy0 + y) * sp[p].stride + (size_t)sx0 * bpp,
+                       (size_t)dw * bpp);
+            }
+            continue;
+        }
+
+        for (int y = 0; y < dh; y++) {
+            uint8_t *drow = dp[p].base + (size_t)(dy0 + y) * dp[p].stride + (size_t)dx0 * bpp;
+            // 16.16 定点的归一化坐标
+            uint32_t v = (uint32_t)(((2ull * y + 1) << 16) / (2ull * dh));
+            if (usage & IM_HAL_TRANSFORM_FLIP_V) v = 0xffff - v;
+            for (int x = 0; x < dw; x++) {
+                uint32_t u = (uint32_t)(((2ull * x + 1) << 16) / (2ull * dw));
+                if (usage & IM_HAL_TRANSFORM_FLIP_H) u = 0xffff - u;
+
+                uint32_t su = u, sv = v;
+                if (rot == IM_HAL_TRANSFORM_ROT_90) {
+                    su = v;
+                    sv = 0xffff - u;
+                } else if (rot == IM_HAL_TRANSFORM_ROT_180) {
+                    su = 0xffff - u;
+                    sv = 0xffff - v;
+                } else if (rot == IM_HAL_TRANSFORM_ROT_270) {
+                    su = 0xffff - v;
+                    sv = u;
+                }
+
+                int sx = sx0 + (int)(((uint64_t)su * (uint32_t)sw) >> 16);
+                int sy = sy0 + (int)(((uint64_t)sv * (uint32_t)sh) >> 16);
+                memcpy(drow + (size_t)x * bpp,
+                       sp[p].base + (size_t)sy * sp[p].stride + (size_t)sx * bpp, (size_t)bpp);
+            }
+        }
+    }
+    return IM_STATUS_SUCCESS;
+}
+
+/* =========================================================================
+ *                              颜色转换
+ * ========================================================================= */
+
+static uint8_t sim_clamp8(int v) {
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+/** @brief 读取打包格式像素的 RGB 分量 */
+static void sim_rga_get_rgb(int format, const uint8_t *px, int *r, int *g, int *b) {
+    if (format == RK_FORMAT_BGR_888 || format == RK_FORMAT_BGRA_8888) {
+        *b = px[0]; *g = px[1]; *r = px[2];
+    } else {
+        *r = px[0]; *g = px[1]; *b = px[2];
+    }
+}
+
+static void sim_rga_put_rgb(int format, uint8_t *px, int r, int g, int b) {
+    if (format == RK_FORMAT_BGR_888 || format == RK_FORMAT_BGRA_8888) {
+        px[0] = (uint8_t)b; px[1] = (uint8_t)g; px[2] = (uint8_t)r;
+    } else {
+        px[0] = (uint8_t)r; px[1] = (uint8_t)g; px[2] = (uint8_t)b;
+    }
+    if (sim_rga_packed_bpp(format) == 4) px[3] = 0xff;
+}
+
+static void sim_rgb_to_yuv(int r, int g, int b, int *y, int *u, int *v) {
+    *y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    *u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+    *v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+static void sim_yuv_to_rgb(int y, int u, int v, int *r, int *g, int *b) {
+    int c = 298 * (y - 16);
+    int d = u - 128;
+    int e = v - 128;
+    *r = sim_clamp8((c + 409 * e + 128) >> 8);
+    *g = sim_clamp8((c - 100 * d - 208 * e + 128) >> 8);
+    *b = sim_clamp8((c + 516 * d + 128) >> 8);
+}
+
+static int sim_rga_is_sp420(int format) {
+    return format == RK_FORMAT_YCbCr_420_SP || format == RK_FORMAT_YCrCb_420_SP;
+}
+
+/* =========================================================================
+ *                              外部接口实现
+ * ========================================================================= */
+
+rga_buffer_t wrapbuffer_virtualaddr_t(void *vir_addr, int width, int height, int wstride,
+                                      int hstride, int format) {
+    rga_buffer_t buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.vir_addr = vir_addr;
+    buf.fd = -1;
+    buf.width = width;
+    buf.height = height;
+    buf.wstride = wstride;
+    buf.hstride = hstride;
+    buf.format = format;
+    return buf;
+}
+
+rga_buffer_t wrapbuffer_fd_t(int fd, int width, int height, int wstride, int hstride, int format) {
+    rga_buffer_t buf = wrapbuffer_virtualaddr_t(NULL, width, height, wstride, hstride, format);
+    buf.fd = fd;
+    return buf;
+}
+
+const char *querystring(int name) {
+    switch (name) {
+        case RGA_VENDOR:    return "Host simulation";
+        case RGA_VERSION:   return "sim-cpu";
+        default:            return "not supported by the CPU im2d";
+    }
+}
+
+const char *imStrError_t(IM_STATUS status) {
+    switch (status) {
+        case IM_STATUS_NOERROR:
+        case IM_STATUS_SUCCESS:         return "success";
+        case IM_STATUS_NOT_SUPPORTED:   return "not supported";
+        case IM_STATUS_OUT_OF_MEMORY:   return "out of memory";
+        case IM_STATUS_INVALID_PARAM:   return "invalid parameter";
+        case IM_STATUS_ILLEGAL_PARAM:   return "illegal parameter";
+        default:                        return "failed";
+    }
+}
+
+IM_STATUS imcopy_t(const rga_buffer_t src, rga_buffer_t dst, int sync) {
+    (void)sync;
+    if (src.width != dst.width || src.height != dst.height) return IM_STATUS_INVALID_PARAM;
+    return sim_rga_transform(&src, &dst, sim_rga_full_rect(&src), sim_rga_full_rect(&dst), 0);
+}
+
+IM_STATUS imresize_t(const rga_buffer_t src, rga_buffer_t dst, double fx, double fy,
+                     int interpolation, int sync) {
+    (void)interpolation;
+    (void)sync;
+    // 给出缩放系数时按系数确定目标尺寸, 否则使用 dst 的尺寸
+    if (fx > 0 && fy > 0) {
+        dst.width = (int)(src.width * fx);
+        dst.height = (int)(src.height * fy);
+    }
+    return sim_rga_transform(&src, &dst, sim_rga_full_rect(&src), sim_rga_full_rect(&dst), 0);
+}
+
+IM_STATUS imcrop_t(const rga_buffer_t src, rga_buffer_t dst, im_rect rect, int sync) {
+    (void)sync;
+    return sim_rga_transform(&src, &dst, rect, (im_rect){ 0, 0, rect.width, rect.height }, 0);
+}
+
+IM_STATUS imrotate_t(const rga_buffer_t src, rga_buffer_t dst, int rotation, int sync) {
+    (void)sync;
+    return sim_rga_transform(&src, &dst, sim_rga_full_rect(&src), sim_rga_full_rect(&dst), rotation);
+}
+
+IM_STATUS imflip_t(const rga_buffer_t src, rga_buffer_t dst, int mode, int sync) {
+    (void)sync;
+    return sim_rga_transform(&src, &dst, sim_rga_full_rect(&src), sim_rga_full_rect(&dst), mode);
+}
+
+IM_STATUS improcess(rga_buffer_t src, rga_buffer_t dst, rga_buffer_t pat, im_rect srect,
+                    im_rect drect, im_rect prect, int usage) {
+    (void)pat;
+    (void)prect;
+    if (srect.width == 0 || srect.height == 0) srect = sim_rga_full_rect(&src);
+    if (drect.width == 0 || drect.height == 0) drect = sim_rga_full_rect(&dst);
+    return sim_rga_transform(&src, &dst, srect, drect, usage);
+}
+
+IM_STATUS imcvtcolor_t(rga_buffer_t src, rga_buffer_t dst, int sfmt, int dfmt, int mode, int sync) {
+    (void)mode;
+    (void)sync;
+    src.format = sfmt;
+    dst.format = dfmt;
+    if (sfmt == dfmt) return imcopy_t(src, dst, 1);
+    if (src.width != dst.width || src.height != dst.height) return IM_STATUS_INVALID_PARAM;
+
+    SimPlane sp[3], dp[3];
+    if (sim_rga_planes(&src, sp) == 0 || sim_rga_planes(&dst, dp) == 0) {
+        return IM_STATUS_INVALID_PARAM;
+    }
+    int w = src.width & ~1;
+    int h = src.height & ~1;
+
+    // NV12 <-> NV21: 交换色度
+    if (sim_rga_is_sp420(sfmt) && sim_rga_is_sp420(dfmt)) {
+        for (int y = 0; y < src.height; y++) {
+            memcpy(dp[0].base + (size_t)y * dp[0].stride, sp[0].base + (size_t)y * sp[0].stride,
+                   (size_t)src.width);
+        }
+        for (int y = 0; y < h / 2; y++) {
+            const uint8_t *s = sp[1].base + (size_t)y * sp[1].stride;
+            uint8_t *d = dp[1].base + (size_t)y * dp[1].stride;
+            for (int x = 0; x < w / 2; x++) {
+                d[2 * x] = s[2 * x + 1];
+                d[2 * x + 1] = s[2 * x];
+            }
+        }
+        return IM_STATUS_SUCCESS;
+    }
+
+    int sbpp = sim_rga_packed_bpp(sfmt);
+    int dbpp = sim_rga_packed_bpp(dfmt);
+
+    // YUV420SP -> RGB
+    if (sim_rga_is_sp420(sfmt) && dbpp >= 3) {
+        int swap = sfmt == RK_FORMAT_YCrCb_420_SP;
+        for (int y = 0; y < h; y++) {
+            const uint8_t *yrow = sp[0].base + (size_t)y * sp[0].stride;
+            const uint8_t *uv = sp[1].base + (size_t)(y / 2) * sp[1].stride;
+            uint8_t *drow = dp[0].base + (size_t)y * dp[0].stride;
+            for (int x = 0; x < w; x++) {
+                int u = uv[(x & ~1) + swap], v = uv[(x & ~1) + 1 - swap];
+                int r, g, b;
+                sim_yuv_to_rgb(yrow[x], u, v, &r, &g, &b);
+                sim_rga_put_rgb(dfmt, drow + (size_t)x * dbpp, r, g, b);
+            }
+        }
+        return IM_STATUS_SUCCESS;
+    }
+
+    // RGB -> YUV420SP: 色度取每个 2x2 块的左上像素
+    if (sbpp >= 3 && sim_rga_is_sp420(dfmt)) {
+        int swap = dfmt == RK_FORMAT_YCrCb_420_SP;
+        for (int y = 0; y < h; y++) {
+            const uint8_t *srow = sp[0].base + (size_t)y * sp[0].stride;
+            uint8_t *yrow = dp[0].base + (size_t)y * dp[0].stride;
+            uint8_t *uv = dp[1].base + (size_t)(y / 2) * dp[1].stride;
+            for (int x = 0; x < w; x++) {
+                int r, g, b, yy, u, v;
+                sim_rga_get_rgb(sfmt, srow + (size_t)x * sbpp, &r, &g, &b);
+                sim_rgb_to_yuv(r, g, b, &yy, &u, &v);
+                yrow[x] = sim_clamp8(yy);
+                if (!(x & 1) && !(y & 1)) {
+                    uv[x + swap] = sim_clamp8(u);
+                    uv[x + 1 - swap] = sim_clamp8(v);
+                }
+            }
+        }
+        return IM_STATUS_SUCCESS;
+    }
+
+    // RGB 系列之间: 重排分量
+    if (sbpp >= 3 && dbpp >= 3) {
+        for (int y = 0; y < src.height; y++) {
+            const uint8_t *srow = sp[0].base + (size_t)y * sp[0].stride;
+            uint8_t *drow = dp[0].base + (size_t)y * dp[0].stride;
+            for (int x = 0; x < src.width; x++) {
+                int r, g, b;
+                sim_rga_get_rgb(sfmt, srow + (size_t)x * sbpp, &r, &g, &b);
+                sim_rga_put_rgb(dfmt, drow + (size_t)x * dbpp, r, g, b);
+                if (sbpp == 4 && dbpp == 4) drow[(size_t)x * dbpp + 3] = srow[(size_t)x * sbpp + 3];
+            }
+        }
+        return IM_STATUS_SUCCESS;
+    }
+
+    LOG_ERROR("cvtcolor 0x%x -> 0x%x is not simulated\n", sfmt, dfmt);
+    return IM_STATUS_NOT_SUPPORTED;
+}
+
+IM_STATUS imfill_t(rga_buffer_t dst, im_rect rect, int color, int sync) {
+    (void)sync;
+    if (!sim_rga_rect_valid(&dst, &rect)) return IM_STATUS_INVALID_PARAM;
+
+    SimPlane dp[3];
+    int n = sim_rga_planes(&dst, dp);
+    if (n == 0) return IM_STATUS_INVALID_PARAM;
+
+    // color 为 ARGB8888
+    int a = ((uint32_t)color >> 24) & 0xff;
+    int r = (color >> 16) & 0xff, g = (color >> 8) & 0xff, b = color & 0xff;
+
+    int bpp = sim_rga_packed_bpp(dst.format);
+    if (bpp >= 3) {
+        uint8_t px[4];
+        sim_rga_put_rgb(dst.format, px, r, g, b);
+        if (bpp == 4) px[3] = (uint8_t)a;
+        for (int y = rect.y; y < rect.y + rect.height; y++) {
+            uint8_t *row = dp[0].base + (size_t)y * dp[0].stride;
+            for (int x = rect.x; x < rect.x + rect.width; x++) memcpy(row + (size_t)x * bpp, px, (size_t)bpp);
+        }
+        return IM_STATUS_SUCCESS;
+    }
+    if (sim_rga_is_sp420(dst.format)) {
+        int yy, u, v;
+        sim_rgb_to_yuv(r, g, b, &yy, &u, &v);
+        int swap = dst.format == RK_FORMAT_YCrCb_420_SP;
+        for (int y = rect.y; y < rect.y + rect.height; y++) {
+            memset(dp[0].base + (size_t)y * dp[0].stride + rect.x, sim_clamp8(yy), (size_t)rect.width);
+        }
+        for (int y = rect.y / 2; y < (rect.y + rect.height) / 2; y++) {
+            uint8_t *uv = dp[1].base + (size_t)y * dp[1].stride;
+            for (int x = rect.x & ~1; x < rect.x + rect.width - 1; x += 2) {
+                uv[x + swap] = sim_clamp8(u);
+                uv[x + 1 - swap] = sim_clamp8(v);
+            }
+        }
+        return IM_STATUS_SUCCESS;
+    }
+    return IM_STATUS_NOT_SUPPORTED;
+}
+
+IM_STATUS imblend_t(const rga_buffer_t srcA, const rga_buffer_t srcB, rga_buffer_t dst,
+                    int mode, int sync) {
+    (void)sync;
+    if (mode != IM_ALPHA_BLEND_SRC_OVER) return IM_STATUS_NOT_SUPPORTED;
+    // 未给出 srcB 时把 srcA 叠加到 dst 上
+    if (srcB.width > 0 && sim_rga_addr(&srcB) && sim_rga_addr(&srcB) != sim_rga_addr(&dst)) {
+        return IM_STATUS_NOT_SUPPORTED;
+    }
+
+    int fbpp = sim_rga_packed_bpp(srcA.format);
+    if (fbpp != 4) return IM_STATUS_NOT_SUPPORTED;
+
+    SimPlane fp[3], dp[3];
+    if (sim_rga_planes(&srcA, fp) == 0 || sim_rga_planes(&dst, dp) == 0) {
+        return IM_STATUS_INVALID_PARAM;
+    }
+
+    int ga = srcA.global_alpha > 0 && srcA.global_alpha < 255 ? srcA.global_alpha : 255;
+    int w = srcA.width < dst.width ? srcA.width : dst.width;
+    int h = srcA.height < dst.height ? srcA.height : dst.height;
+    int dbpp = sim_rga_packed_bpp(dst.format);
+    int yuv = sim_rga_is_sp420(dst.format);
+    if (dbpp < 3 && !yuv) return IM_STATUS_NOT_SUPPORTED;
+    int swap = dst.format == RK_FORMAT_YCrCb_420_SP;
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t *frow = fp[0].base + (size_t)y * fp[0].stride;
+        for (int x = 0; x < w; x++) {
+            const uint8_t *px = frow + (size_t)x * 4;
+            int alpha = px[3] * ga / 255;
+            if (alpha == 0) continue;
+            int r, g, b;
+            sim_rga_get_rgb(srcA.format, px, &r, &g, &b);
+
+            if (!yuv) {
+                uint8_t *d = dp[0].base + (size_t)y * dp[0].stride + (size_t)x * dbpp;
+                int dr, dg, db;
+                sim_rga_get_rgb(dst.format, d, &dr, &dg, &db);
+                sim_rga_put_rgb(dst.format, d, dr + (r - dr) * alpha / 255,
+                                dg + (g - dg) * alpha / 255, db + (b - db) * alpha / 255);
+                continue;
+            }
+
+            int yy, u, v;
+            sim_rgb_to_yuv(r, g, b, &yy, &u, &v);
+            uint8_t *dy = dp[0].base + (size_t)y * dp[0].stride + x;
+            *dy = sim_clamp8(*dy + (yy - *dy) * alpha / 255);
+            if (!(x & 1) && !(y & 1)) {
+                uint8_t *uv = dp[1].base + (size_t)(y / 2) * dp[1].stride + x;
+                uv[swap] = sim_clamp8(uv[swap] + (u - uv[swap]) * alpha / 255);
+                uv[1 - swap] = sim_clamp8(uv[1 - swap] + (v - uv[1 - swap]) * alpha / 255);
+            }
+        }
+    }
+    return IM_STATUS_SUCCESS;
+}
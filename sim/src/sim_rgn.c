@@ -0,0 +1,144 @@
+/**
+ * @file sim_rgn.c
+ * @brief 区域叠加 (RGN) 仿真
+ *
+ * 仿真编码器不输出真实图像，区域只做登记和参数检查，
+ * 使 OSD 模块的创建、更新、绑定流程与板端走同样的错误分支。
+ */
+
+#include "sim_internal.h"
+#include "rk_mpi_rgn.h"
+#include "rk_mpi_venc.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_rgn"
+
+/**
+ * @brief 区域状态
+ */
+typedef struct {
+    int created;
+    RGN_ATTR_S attr;
+    uint32_t attached;           /**< 已绑定的 VENC 通道位图 */
+    uint32_t bitmap_updates;     /**< SetBitMap 次数 */
+} SimRgn;
+
+static SimRgn g_rgns[RGN_HANDLE_MAX];
+static pthread_mutex_t g_rgn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int sim_rgn_valid(RGN_HANDLE handle) {
+    return handle >= 0 && handle < RGN_HANDLE_MAX;
+}
+
+RK_S32 RK_MPI_RGN_Create(RGN_HANDLE Handle, const RGN_ATTR_S *pstRegion) {
+    if (!sim_rgn_valid(Handle)) return RK_ERR_RGN_INVALID_CHNID;
+    if (!pstRegion) return RK_ERR_RGN_NULL_PTR;
+    if (pstRegion->enType >= RGN_BUTT) return RK_ERR_RGN_ILLEGAL_PARAM;
+    if (pstRegion->enType == OVERLAY_RGN &&
+        (pstRegion->unAttr.stOverlay.stSize.u32Width == 0 ||
+         pstRegion->unAttr.stOverlay.stSize.u32Height == 0)) {
+        return RK_ERR_RGN_ILLEGAL_PARAM;
+    }
+
+    pthread_mutex_lock(&g_rgn_lock);
+    SimRgn *rgn = &g_rgns[Handle];
+    if (rgn->created) {
+        pthread_mutex_unlock(&g_rgn_lock);
+        return RK_ERR_RGN_EXIST;
+    }
+    memset(rgn, 0, sizeof(*rgn));
+    rgn->created = 1;
+    rgn->attr = *pstRegion;
+    pthread_mutex_unlock(&g_rgn_lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_RGN_Destroy(RGN_HANDLE Handle) {
+    if (!sim_rgn_valid(Handle)) return RK_ERR_RGN_INVALID_CHNID;
+
+    pthread_mutex_lock(&g_rgn_lock);
+    SimRgn *rgn = &g_rgns[Handle];
+    if (!rgn->created) {
+        pthread_mutex_unlock(&g_rgn_lock);
+        return RK_ERR_RGN_UNEXIST;
+    }
+    if (rgn->attached) {
+        LOG_WARN("Region %d destroyed while still attached (0x%x)\n", Handle, rgn->attached);
+    }
+    rgn->created = 0;
+    pthread_mutex_unlock(&g_rgn_lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_RGN_SetBitMap(RGN_HANDLE Handle, const BITMAP_S *pstBitmap) {
+    if (!sim_rgn_valid(Handle)) return RK_ERR_RGN_INVALID_CHNID;
+    if (!pstBitmap || !pstBitmap->pData) return RK_ERR_RGN_NULL_PTR;
+
+    pthread_mutex_lock(&g_rgn_lock);
+    SimRgn *rgn = &g_rgns[Handle];
+    RK_S32 ret = RK_SUCCESS;
+    if (!rgn->created) {
+        ret = RK_ERR_RGN_UNEXIST;
+    } else if (rgn->attr.enType != OVERLAY_RGN) {
+        ret = RK_ERR_RGN_NOT_PERM;
+    } else if (pstBitmap->u32Width > rgn->attr.unAttr.stOverlay.stSize.u32Width ||
+               pstBitmap->u32Height > rgn->attr.unAttr.stOverlay.stSize.u32Height) {
+        ret = RK_ERR_RGN_ILLEGAL_PARAM;
+    } else {
+        rgn->bitmap_updates++;
+    }
+    pthread_mutex_unlock(&g_rgn_lock);
+    return ret;
+}
+
+RK_S32 RK_MPI_RGN_AttachToChn(RGN_HANDLE Handle, const MPP_CHN_S *pstChn,
+                              const RGN_CHN_ATTR_S *pstChnAttr) {
+    if (!sim_rgn_valid(Handle)) return RK_ERR_RGN_INVALID_CHNID;
+    if (!pstChn || !pstChnAttr) return RK_ERR_RGN_NULL_PTR;
+    if (pstChn->enModId != RK_ID_VENC || pstChn->s32ChnId < 0 ||
+        pstChn->s32ChnId >= VENC_MAX_CHN_NUM) {
+        return RK_ERR_RGN_ILLEGAL_PARAM;
+    }
+
+    pthread_mutex_lock(&g_rgn_lock);
+    SimRgn *rgn = &g_rgns[Handle];
+    RK_S32 ret = RK_SUCCESS;
+    uint32_t bit = 1u << pstChn->s32ChnId;
+    if (!rgn->created) {
+        ret = RK_ERR_RGN_UNEXIST;
+    } else if (pstChnAttr->enType != rgn->attr.enType) {
+        ret = RK_ERR_RGN_ILLEGAL_PARAM;
+    } else if (rgn->attached & bit) {
+        ret = RK_ERR_RGN_EXIST;
+    } else {
+        rgn->attached |= bit;
+    }
+    pthread_mutex_unlock(&g_rgn_lock);
+    return ret;
+}
+
+RK_S32 RK_MPI_RGN_DetachFromChn(RGN_HANDLE Handle, const MPP_CHN_S *pstChn) {
+    if (!sim_rgn_valid(Handle)) return RK_ERR_RGN_INVALID_CHNID;
+    if (!pstChn) return RK_ERR_RGN_NULL_PTR;
+    if (pstChn->s32ChnId < 0 || pstChn->s32ChnId >= VENC_MAX_CHN_NUM) {
+        return RK_ERR_RGN_ILLEGAL_PARAM;
+    }
+
+    pthread_mutex_lock(&g_rgn_lock);
+    SimRgn *rgn = &g_rgns[Handle];
+    RK_S32 ret = RK_SUCCESS;
+    uint32_t bit = 1u << pstChn->s32ChnId;
+    if (!rgn->created || !(rgn->attached & bit)) {
+        ret = RK_ERR_RGN_UNEXIST;
+    } else {
+        rgn->attached &= ~bit;
+    }
+    pthread_mutex_unlock(&g_rgn_lock);
+    return ret;
+}
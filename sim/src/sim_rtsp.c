@@ -0,0 +1,134 @@
+/**
+ * @file sim_rtsp.c
+ * @brief rtsp_demo 仿真
+ *
+ * 不监听端口，只统计每个会话收到的帧数与字节数，删除会话时打印。
+ * rtsp_do_event 直接返回，推流线程的开销只剩本项目自身的代码。
+ */
+
+#include "sim_internal.h"
+#include "rtsp_demo.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_rtsp"
+
+typedef struct {
+    int port;
+} SimRtspDemo;
+
+typedef struct {
+    char path[64];
+    int video_codec;
+    uint64_t video_frames;
+    uint64_t video_bytes;
+    uint64_t audio_frames;
+    uint64_t audio_bytes;
+} SimRtspSession;
+
+rtsp_demo_handle create_rtsp_demo(int port) {
+    SimRtspDemo *demo = (SimRtspDemo *)calloc(1, sizeof(SimRtspDemo));
+    if (!demo) return NULL;
+    demo->port = port;
+    LOG_INFO("RTSP server simulated on port %d (no socket is opened)\n", port);
+    return demo;
+}
+
+rtsp_session_handle rtsp_new_session(rtsp_demo_handle demo, const char *path) {
+    if (!demo || !path) return NULL;
+    SimRtspSession *session = (SimRtspSession *)calloc(1, sizeof(SimRtspSession));
+    if (!session) return NULL;
+    strncpy(session->path, path, sizeof(session->path) - 1);
+    return session;
+}
+
+int rtsp_set_video(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len) {
+    (void)codec_data;
+    (void)data_len;
+    if (!session) return -1;
+    ((SimRtspSession *)session)->video_codec = codec_id;
+    return 0;
+}
+
+int rtsp_set_audio(rtsp_session_handle session, int codec_id, const uint8_t *codec_data,
+                   int data_len) {
+    (void)codec_id;
+    (void)codec_data;
+    (void)data_len;
+    return session ? 0 : -1;
+}
+
+int rtsp_set_audio_sample_rate(rtsp_session_handle session, int sample_rate) {
+    (void)sample_rate;
+    return session ? 0 : -1;
+}
+
+int rtsp_set_audio_channels(rtsp_session_handle session, int channels) {
+    (void)channels;
+    return session ? 0 : -1;
+}
+
+int rtsp_tx_video(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+    (void)ts;
+    if (!session || !frame || len <= 0) return -1;
+    SimRtspSession *s = (SimRtspSession *)session;
+    s->video_frames++;
+    s->video_bytes += (uint64_t)len;
+    return len;
+}
+
+int rtsp_tx_audio(rtsp_session_handle session, const uint8_t *frame, int len, uint64_t ts) {
+    (void)ts;
+    if (!session || !frame || len <= 0) return -1;
+    SimRtspSession *s = (SimRtspSession *)session;
+    s->audio_frames++;
+    s->audio_bytes += (uint64_t)len;
+    return len;
+}
+
+int rtsp_sync_video_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime) {
+    (void)ts;
+    (void)ntptime;
+    return session ? 0 : -1;
+}
+
+int rtsp_sync_audio_ts(rtsp_session_handle session, uint64_t ts, uint64_t ntptime) {
+    (void)ts;
+    (void)ntptime;
+    return session ? 0 : -1;
+}
+
+void rtsp_del_session(rtsp_session_handle session) {
+    if (!session) return;
+    SimRtspSession *s = (SimRtspSession *)session;
+    LOG_INFO("RTSP %s: %llu video frames (%llu bytes), %llu audio frames\n", s->path,
+             (unsigned long long)s->video_frames, (unsigned long long)s->video_bytes,
+             (unsigned long long)s->audio_frames);
+    free(s);
+}
+
+void rtsp_del_demo(rtsp_demo_handle demo) {
+    free(demo);
+}
+
+int rtsp_do_event(rtsp_demo_handle demo) {
+    return demo ? 0 : -1;
+}
+
+uint64_t rtsp_get_reltime(void) {
+    return sim_now_us();
+}
+
+uint64_t rtsp_get_ntptime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
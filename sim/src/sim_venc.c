@@ -0,0 +1,604 @@
+/**
+ * @file sim_venc.c
+ * @brief 视频编码 (VENC) 仿真
+ *
+ * 每个通道一个编码线程：从深度为 SIM_VENC_IN_DEPTH 的输入队列取帧，
+ * 按目标帧率抽帧，睡眠模拟的编码耗时后生成一帧 Annex-B 码流。
+ *
+ * 码流大小由码控参数决定：平均每帧 bitrate / 8 / fps 字节，I 帧约为 P 帧的 4 倍，
+ * 整个 GOP 的总量与目标码率一致，再加 ±10% 的抖动。每帧码流占用一个码流 MB，
+ * 码流 MB 共 u32StreamBufCnt 个，应用层不及时 ReleaseStream 时与硬件一样丢帧。
+ *
+ * GetFd 返回 eventfd (EFD_SEMAPHORE)，计数等于待取的码流帧数，
+ * 水平触发的 epoll 在码流取完之前会一直返回可读。
+ */
+
+#define _GNU_SOURCE
+#include "sim_internal.h"
+#include "rk_mpi_mb.h"
+#include "rk_mpi_venc.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_venc"
+
+/** @brief 输入帧队列深度 (SendFrame 在队列满时返回 BUF_FULL) */
+#define SIM_VENC_IN_DEPTH       2
+
+/** @brief 码流缓冲区数量上限 */
+#define SIM_VENC_MAX_STREAM_BUF 16
+
+/** @brief I 帧与 P 帧的大小比例 */
+#define SIM_VENC_I_P_RATIO      4
+
+/**
+ * @brief 通道状态
+ */
+typedef struct {
+    int created;
+    volatile int recv;           /**< 已 StartRecvFrame */
+    VENC_CHN_ATTR_S attr;        /**< 当前属性 (lock 保护) */
+
+    pthread_mutex_t lock;
+    pthread_cond_t in_ready;     /**< 输入队列非空 / 通道停止 */
+    pthread_cond_t in_space;     /**< 输入队列有空位 */
+    pthread_cond_t out_ready;    /**< 输出队列非空 */
+
+    VIDEO_FRAME_INFO_S in[SIM_VENC_IN_DEPTH];
+    int in_head;
+    int in_count;
+
+    VENC_PACK_S out[SIM_VENC_MAX_STREAM_BUF];
+    RK_U32 out_qp[SIM_VENC_MAX_STREAM_BUF];  /**< 各输出帧的 QP */
+    int out_head;
+    int out_count;
+    MB_POOL stream_pool;
+
+    int efd;                     /**< GetFd 返回的 eventfd，-1 表示未创建 */
+    pthread_t thread;
+    volatile int running;
+
+    RK_S32 recv_left;            /**< 剩余接收帧数，-1 不限 */
+    RK_U32 seq;                  /**< 输出码流序号 */
+    RK_U32 gop_pos;              /**< 当前帧在 GOP 中的位置 */
+    int idr_request;             /**< RequestIDR 置位 */
+    RK_U32 fps_acc;              /**< 抽帧累加器 */
+    RK_U32 rand_state;           /**< 码流大小抖动 */
+    RK_U32 dropped;              /**< 码流缓冲区不足丢弃的帧 */
+} SimVencChn;
+
+static SimVencChn g_chns[VENC_MAX_CHN_NUM];
+static pthread_once_t g_init_once = PTHREAD_ONCE_INIT;
+
+/* 固定的参数集：SPS/PPS 在通道生命周期内不变，与硬件默认配置下的行为一致 */
+static const uint8_t k_h264_headers[] = {
+    0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0xac, 0xd1, 0x00, 0x78, 0x02, 0x27, 0xe5, 0xc0, 0x44,
+    0, 0, 0, 1, 0x68, 0xeb, 0xef, 0x2c,
+};
+
+static const uint8_t k_h265_headers[] = {
+    0, 0, 0, 1, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x5d,
+    0, 0, 0, 1, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02, 0x80,
+    0, 0, 0, 1, 0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40,
+};
+
+static void sim_venc_init_once(void) {
+    for (int i = 0; i < VENC_MAX_CHN_NUM; i++) {
+        pthread_mutex_init(&g_chns[i].lock, NULL);
+        sim_cond_init(&g_chns[i].in_ready);
+        sim_cond_init(&g_chns[i].in_space);
+        sim_cond_init(&g_chns[i].out_ready);
+        g_chns[i].efd = -1;
+        g_chns[i].stream_pool = MB_INVALID_POOLID;
+    }
+}
+
+static SimVencChn *sim_venc_chn(VENC_CHN chn) {
+    if (chn < 0 || chn >= VENC_MAX_CHN_NUM) return NULL;
+    pthread_once(&g_init_once, sim_venc_init_once);
+    return &g_chns[chn];
+}
+
+static int sim_venc_is_h265(const VENC_CHN_ATTR_S *attr) {
+    return attr->stVencAttr.enType == RK_VIDEO_ID_HEVC;
+}
+
+/** @brief 码控参数 (H.264 与 H.265 的 CBR/VBR 结构布局相同) */
+static const VENC_H264_CBR_S *sim_venc_rc(const VENC_CHN_ATTR_S *attr) {
+    return &attr->stRcAttr.stH264Cbr;
+}
+
+static int sim_venc_check_attr(const VENC_CHN_ATTR_S *attr) {
+    if (attr->stVencAttr.enType != RK_VIDEO_ID_AVC && attr->stVencAttr.enType != RK_VIDEO_ID_HEVC) {
+        LOG_ERROR("Only H.264/H.265 are simulated\n");
+        return -1;
+    }
+    const VENC_H264_CBR_S *rc = sim_venc_rc(attr);
+    if (attr->stVencAttr.u32PicWidth == 0 || attr->stVencAttr.u32PicHeight == 0 ||
+        rc->u32Gop == 0 || rc->u32BitRate == 0 ||
+        rc->fr32DstFrameRateNum == 0 || rc->u32SrcFrameRateNum == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* =========================================================================
+ *                              编码线程
+ * ========================================================================= */
+
+/**
+ * @brief 计算本帧的码流大小 (字节)
+ */
+static size_t sim_venc_frame_bytes(SimVencChn *c, const VENC_H264_CBR_S *rc, int is_idr) {
+    RK_U32 gop = rc->u32Gop;
+    uint64_t fps = rc->fr32DstFrameRateNum / (rc->fr32DstFrameRateDen ? rc->fr32DstFrameRateDen : 1);
+    uint64_t avg = (uint64_t)rc->u32BitRate / 8 / (fps ? fps : 1);
+
+    // 一个 GOP 有 1 个 I 帧和 gop-1 个 P 帧，总量等于 gop * avg
+    uint64_t bytes = avg * gop / (gop + SIM_VENC_I_P_RATIO - 1);
+    if (is_idr) bytes *= SIM_VENC_I_P_RATIO;
+
+    c->rand_state = c->rand_state * 1103515245u + 12345u;
+    int jitter = (int)((c->rand_state >> 16) % 21) - 10;
+    bytes = bytes * (uint64_t)(100 + jitter) / 100;
+    return bytes < 64 ? 64 : (size_t)bytes;
+}
+
+/**
+ * @brief 按每像素比特数估算本帧 QP
+ *
+ * 近似码控的经验关系：0.1 bpp 对应 QP 30，比特数每翻倍 QP 减 6；I 帧比 P 帧低 2。
+ */
+static RK_U32 sim_venc_frame_qp(const VENC_CHN_ATTR_S *attr, const VENC_H264_CBR_S *rc, int is_idr) {
+    double pixels = (double)attr->stVencAttr.u32PicWidth * attr->stVencAttr.u32PicHeight;
+    double fps = (double)rc->fr32DstFrameRateNum / (rc->fr32DstFrameRateDen ? rc->fr32DstFrameRateDen : 1);
+    double bpp = (double)rc->u32BitRate / fps / pixels;
+    double qp = 30.0 - 6.0 * log2(bpp / 0.1) - (is_idr ? 2 : 0);
+    if (qp < 10) qp = 10;
+    if (qp > 51) qp = 51;
+    return (RK_U32)(qp + 0.5);
+}
+
+/**
+ * @brief 生成一帧 Annex-B 码流
+ *
+ * 载荷取自输入图像的亮度采样并置最低位，不会出现 00 00 0x 的起始码序列。
+ *
+ * @return 码流长度
+ */
+static size_t sim_venc_write_stream(const SimVencChn *c, const VIDEO_FRAME_S *frame, int is_idr,
+                                    uint8_t *out, size_t cap, size_t payload) {
+    int h265 = sim_venc_is_h265(&c->attr);
+    size_t len = 0;
+
+    if (is_idr) {
+        const uint8_t *hdr = h265 ? k_h265_headers : k_h264_headers;
+        size_t hdr_len = h265 ? sizeof(k_h265_headers) : sizeof(k_h264_headers);
+        memcpy(out, hdr, hdr_len);
+        len = hdr_len;
+    }
+
+    static const uint8_t start_code[4] = { 0, 0, 0, 1 };
+    memcpy(out + len, start_code, sizeof(start_code));
+    len += sizeof(start_code);
+    if (h265) {
+        out[len++] = is_idr ? 0x26 : 0x02;   // IDR_W_RADL / TRAIL_R
+        out[len++] = 0x01;
+    } else {
+        out[len++] = is_idr ? 0x65 : 0x41;
+    }
+
+    if (len + payload > cap) payload = cap > len ? cap - len : 0;
+    const uint8_t *luma = (const uint8_t *)RK_MPI_MB_Handle2VirAddr(frame->pMbBlk);
+    size_t luma_size = (size_t)frame->u32VirWidth * frame->u32VirHeight;
+    size_t step = luma_size / (payload ? payload : 1) + 1;
+    for (size_t i = 0; i < payload; i++) {
+        out[len + i] = (luma ? luma[(i * step) % luma_size] : 0x55) | 1;
+    }
+    return len + payload;
+}
+
+/**
+ * @brief 处理一帧输入 (不持有 lock)
+ */
+static void sim_venc_encode(SimVencChn *c, VENC_CHN chn, const VIDEO_FRAME_INFO_S *in,
+                            int us_per_mpix) {
+    pthread_mutex_lock(&c->lock);
+    VENC_CHN_ATTR_S attr = c->attr;
+    const VENC_H264_CBR_S *rc = sim_venc_rc(&attr);
+
+    // 源帧率到目标帧率的抽帧
+    RK_U32 src_fps = rc->u32SrcFrameRateNum;
+    RK_U32 dst_fps = rc->fr32DstFrameRateNum;
+    c->fps_acc += dst_fps;
+    if (c->fps_acc < src_fps) {
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+    c->fps_acc -= src_fps;
+
+    int is_idr = c->idr_request || c->gop_pos == 0 || c->gop_pos >= rc->u32Gop;
+    if (is_idr) {
+        c->idr_request = 0;
+        c->gop_pos = 0;
+    }
+    c->gop_pos++;
+    pthread_mutex_unlock(&c->lock);
+
+    uint64_t start = sim_now_us();
+    size_t payload = sim_venc_frame_bytes(c, rc, is_idr);
+    MB_BLK mb = RK_MPI_MB_GetMB(c->stream_pool, attr.stVencAttr.u32BufSize, RK_FALSE);
+    if (!mb) {
+        // 码流缓冲区被应用层占满: 与硬件一样丢掉这一帧, 下一帧强制 IDR 以便恢复
+        pthread_mutex_lock(&c->lock);
+        c->dropped++;
+        c->idr_request = 1;
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+    size_t len = sim_venc_write_stream(c, &in->stVFrame, is_idr,
+                                       (uint8_t *)RK_MPI_MB_Handle2VirAddr(mb),
+                                       (size_t)RK_MPI_MB_GetSize(mb), payload);
+
+    if (us_per_mpix > 0) {
+        uint64_t cost = (uint64_t)us_per_mpix * in->stVFrame.u32Width * in->stVFrame.u32Height / 1000000;
+        uint64_t spent = sim_now_us() - start;
+        if (cost > spent) usleep((useconds_t)(cost - spent));
+    }
+
+    VENC_PACK_S pack;
+    memset(&pack, 0, sizeof(pack));
+    pack.pMbBlk = mb;
+    pack.u32Len = (RK_U32)len;
+    pack.u64PTS = in->stVFrame.u64PTS;
+    pack.bFrameEnd = RK_TRUE;
+    if (sim_venc_is_h265(&attr)) {
+        pack.DataType.enH265EType = is_idr ? H265E_NALU_IDRSLICE : H265E_NALU_PSLICE;
+    } else {
+        pack.DataType.enH264EType = is_idr ? H264E_NALU_IDRSLICE : H264E_NALU_PSLICE;
+    }
+
+    RK_U32 qp = sim_venc_frame_qp(&attr, rc, is_idr);
+    pthread_mutex_lock(&c->lock);
+    c->out[(c->out_head + c->out_count) % SIM_VENC_MAX_STREAM_BUF] = pack;
+    c->out_qp[(c->out_head + c->out_count) % SIM_VENC_MAX_STREAM_BUF] = qp;
+    c->out_count++;
+    if (c->efd >= 0) {
+        uint64_t one = 1;
+        if (write(c->efd, &one, sizeof(one)) < 0) {
+            LOG_WARN("VENC[%d] eventfd write failed: %s\n", chn, strerror(errno));
+        }
+    }
+    pthread_cond_signal(&c->out_ready);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static void *sim_venc_thread(void *arg) {
+    SimVencChn *c = (SimVencChn *)arg;
+    VENC_CHN chn = (VENC_CHN)(c - g_chns);
+    int us_per_mpix = sim_env_int("RV_SIM_VENC_US_PER_MPIX", 4000);
+    char name[16];
+
+    snprintf(name, sizeof(name), "sim_venc%d", chn);
+    prctl(PR_SET_NAME, name, 0, 0, 0);
+
+    pthread_mutex_lock(&c->lock);
+    while (c->running) {
+        if (c->in_count == 0) {
+            pthread_cond_wait(&c->in_ready, &c->lock);
+            continue;
+        }
+        VIDEO_FRAME_INFO_S in = c->in[c->in_head];
+        pthread_mutex_unlock(&c->lock);
+
+        sim_venc_encode(c, chn, &in, us_per_mpix);
+
+        // 编码完成才出队，编码中的帧也占用一个输入深度，与硬件持有输入缓冲区的时长一致
+        pthread_mutex_lock(&c->lock);
+        c->in_head = (c->in_head + 1) % SIM_VENC_IN_DEPTH;
+        c->in_count--;
+        pthread_cond_signal(&c->in_space);
+        pthread_mutex_unlock(&c->lock);
+        RK_MPI_MB_ReleaseMB(in.stVFrame.pMbBlk);
+        pthread_mutex_lock(&c->lock);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+/* =========================================================================
+ *                              通道接口
+ * ========================================================================= */
+
+RK_S32 RK_MPI_VENC_CreateChn(VENC_CHN VeChn, const VENC_CHN_ATTR_S *pstAttr) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstAttr) return RK_ERR_VENC_NULL_PTR;
+    if (c->created) return RK_ERR_VENC_EXIST;
+    if (sim_venc_check_attr(pstAttr) != 0) return RK_ERR_VENC_ILLEGAL_PARAM;
+
+    RK_U32 buf_cnt = pstAttr->stVencAttr.u32StreamBufCnt;
+    if (buf_cnt == 0) buf_cnt = 2;
+    if (buf_cnt > SIM_VENC_MAX_STREAM_BUF) buf_cnt = SIM_VENC_MAX_STREAM_BUF;
+    RK_U32 buf_size = pstAttr->stVencAttr.u32BufSize;
+    if (buf_size == 0) {
+        buf_size = pstAttr->stVencAttr.u32PicWidth * pstAttr->stVencAttr.u32PicHeight * 3 / 2;
+    }
+
+    MB_POOL_CONFIG_S pool_cfg;
+    memset(&pool_cfg, 0, sizeof(pool_cfg));
+    pool_cfg.u64MBSize = buf_size;
+    pool_cfg.u32MBCnt = buf_cnt;
+    c->stream_pool = RK_MPI_MB_CreatePool(&pool_cfg);
+    if (c->stream_pool == MB_INVALID_POOLID) return RK_ERR_VENC_NOMEM;
+
+    pthread_mutex_lock(&c->lock);
+    c->attr = *pstAttr;
+    c->attr.stVencAttr.u32StreamBufCnt = buf_cnt;
+    c->attr.stVencAttr.u32BufSize = buf_size;
+    c->in_head = c->in_count = 0;
+    c->out_head = c->out_count = 0;
+    c->seq = 0;
+    c->gop_pos = 0;
+    c->idr_request = 0;
+    c->fps_acc = 0;
+    c->dropped = 0;
+    c->rand_state = (RK_U32)VeChn + 1;
+    c->recv = 0;
+    c->running = 1;
+    pthread_mutex_unlock(&c->lock);
+
+    if (pthread_create(&c->thread, NULL, sim_venc_thread, c) != 0) {
+        c->running = 0;
+        RK_MPI_MB_DestroyPool(c->stream_pool);
+        c->stream_pool = MB_INVALID_POOLID;
+        return RK_ERR_VENC_NOMEM;
+    }
+    c->created = 1;
+
+    const VENC_H264_CBR_S *rc = sim_venc_rc(&c->attr);
+    LOG_INFO("VENC[%d] %s %ux%u, %u bps, %u/%u fps, gop %u\n", VeChn,
+             sim_venc_is_h265(&c->attr) ? "H.265" : "H.264",
+             c->attr.stVencAttr.u32PicWidth, c->attr.stVencAttr.u32PicHeight,
+             rc->u32BitRate, rc->u32SrcFrameRateNum, rc->fr32DstFrameRateNum, rc->u32Gop);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_DestroyChn(VENC_CHN VeChn) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    pthread_mutex_lock(&c->lock);
+    c->recv = 0;
+    c->running = 0;
+    pthread_cond_broadcast(&c->in_ready);
+    pthread_cond_broadcast(&c->in_space);
+    pthread_cond_broadcast(&c->out_ready);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->thread, NULL);
+
+    pthread_mutex_lock(&c->lock);
+    while (c->in_count > 0) {
+        RK_MPI_MB_ReleaseMB(c->in[c->in_head].stVFrame.pMbBlk);
+        c->in_head = (c->in_head + 1) % SIM_VENC_IN_DEPTH;
+        c->in_count--;
+    }
+    while (c->out_count > 0) {
+        RK_MPI_MB_ReleaseMB(c->out[c->out_head].pMbBlk);
+        c->out_head = (c->out_head + 1) % SIM_VENC_MAX_STREAM_BUF;
+        c->out_count--;
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    // 应用层仍持有的码流包 ReleaseStream 后缓冲池才真正释放
+    RK_MPI_MB_DestroyPool(c->stream_pool);
+    c->stream_pool = MB_INVALID_POOLID;
+    if (c->efd >= 0) {
+        close(c->efd);
+        c->efd = -1;
+    }
+    if (c->dropped) LOG_INFO("VENC[%d] dropped %u frames (stream buffers full)\n", VeChn, c->dropped);
+    c->created = 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_GetChnAttr(VENC_CHN VeChn, VENC_CHN_ATTR_S *pstChnAttr) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstChnAttr) return RK_ERR_VENC_NULL_PTR;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    pthread_mutex_lock(&c->lock);
+    *pstChnAttr = c->attr;
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_SetChnAttr(VENC_CHN VeChn, const VENC_CHN_ATTR_S *pstChnAttr) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstChnAttr) return RK_ERR_VENC_NULL_PTR;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+    if (sim_venc_check_attr(pstChnAttr) != 0) return RK_ERR_VENC_ILLEGAL_PARAM;
+
+    pthread_mutex_lock(&c->lock);
+    // 编码格式、分辨率和缓冲区是创建时确定的, 运行中只允许修改码控参数
+    if (pstChnAttr->stVencAttr.enType != c->attr.stVencAttr.enType ||
+        pstChnAttr->stVencAttr.u32PicWidth != c->attr.stVencAttr.u32PicWidth ||
+        pstChnAttr->stVencAttr.u32PicHeight != c->attr.stVencAttr.u32PicHeight) {
+        pthread_mutex_unlock(&c->lock);
+        return RK_ERR_VENC_NOT_PERM;
+    }
+    RK_U32 old_gop = sim_venc_rc(&c->attr)->u32Gop;
+    c->attr.stRcAttr = pstChnAttr->stRcAttr;
+    c->attr.stGopAttr = pstChnAttr->stGopAttr;
+    if (sim_venc_rc(&c->attr)->u32Gop != old_gop) c->gop_pos = 0;
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_StartRecvFrame(VENC_CHN VeChn, const VENC_RECV_PIC_PARAM_S *pstRecvParam) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstRecvParam) return RK_ERR_VENC_NULL_PTR;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    pthread_mutex_lock(&c->lock);
+    c->recv_left = pstRecvParam->s32RecvPicNum;
+    c->recv = 1;
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_StopRecvFrame(VENC_CHN VeChn) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+    c->recv = 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_SendFrame(VENC_CHN VeChn, const VIDEO_FRAME_INFO_S *pstFrame, RK_S32 s32MilliSec) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstFrame || !pstFrame->stVFrame.pMbBlk) return RK_ERR_VENC_NULL_PTR;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    pthread_mutex_lock(&c->lock);
+    if (!c->recv || c->recv_left == 0) {
+        pthread_mutex_unlock(&c->lock);
+        return RK_ERR_VENC_NOT_PERM;
+    }
+    // 输入队列满时等待编码线程处理完一帧
+    while (c->in_count >= SIM_VENC_IN_DEPTH && c->running) {
+        if (sim_cond_wait(&c->in_space, &c->lock, s32MilliSec) != 0) break;
+    }
+    if (c->in_count >= SIM_VENC_IN_DEPTH || !c->running) {
+        pthread_mutex_unlock(&c->lock);
+        return RK_ERR_VENC_BUF_FULL;
+    }
+
+    sim_mb_retain(pstFrame->stVFrame.pMbBlk);
+    c->in[(c->in_head + c->in_count) % SIM_VENC_IN_DEPTH] = *pstFrame;
+    c->in_count++;
+    if (c->recv_left > 0) c->recv_left--;
+    pthread_cond_signal(&c->in_ready);
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_GetStream(VENC_CHN VeChn, VENC_STREAM_S *pstStream, RK_S32 s32MilliSec) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstStream || !pstStream->pstPack) return RK_ERR_VENC_NULL_PTR;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    pthread_mutex_lock(&c->lock);
+    while (c->out_count == 0 && c->running) {
+        if (sim_cond_wait(&c->out_ready, &c->lock, s32MilliSec) != 0) break;
+    }
+    if (c->out_count == 0) {
+        pthread_mutex_unlock(&c->lock);
+        return RK_ERR_VENC_BUF_EMPTY;
+    }
+
+    *pstStream->pstPack = c->out[c->out_head];
+    memset(&pstStream->stH264Info, 0, sizeof(pstStream->stH264Info));
+    pstStream->stH264Info.u32PicBytesNum = c->out[c->out_head].u32Len;
+    pstStream->stH264Info.u32StartQp = c->out_qp[c->out_head];
+    pstStream->stH264Info.u32MeanQp = c->out_qp[c->out_head];
+    c->out_head = (c->out_head + 1) % SIM_VENC_MAX_STREAM_BUF;
+    c->out_count--;
+    pstStream->u32PackCount = 1;
+    pstStream->u32Seq = c->seq++;
+    if (c->efd >= 0) {
+        uint64_t value;
+        if (read(c->efd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+            LOG_WARN("VENC[%d] eventfd read failed: %s\n", VeChn, strerror(errno));
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_ReleaseStream(VENC_CHN VeChn, VENC_STREAM_S *pstStream) {
+    if (!sim_venc_chn(VeChn)) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstStream || !pstStream->pstPack) return RK_ERR_VENC_NULL_PTR;
+
+    for (RK_U32 i = 0; i < pstStream->u32PackCount; i++) {
+        RK_MPI_MB_ReleaseMB(pstStream->pstPack[i].pMbBlk);
+    }
+    pstStream->u32PackCount = 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_RequestIDR(VENC_CHN VeChn, RK_BOOL bInstant) {
+    (void)bInstant;
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    pthread_mutex_lock(&c->lock);
+    c->idr_request = 1;
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_QueryStatus(VENC_CHN VeChn, VENC_CHN_STATUS_S *pstStatus) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!pstStatus) return RK_ERR_VENC_NULL_PTR;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    memset(pstStatus, 0, sizeof(*pstStatus));
+    pthread_mutex_lock(&c->lock);
+    pstStatus->u32LeftPics = (RK_U32)c->in_count;
+    pstStatus->u32LeftStreamFrames = (RK_U32)c->out_count;
+    pstStatus->u32CurPacks = c->out_count ? 1 : 0;
+    for (int i = 0; i < c->out_count; i++) {
+        pstStatus->u32LeftStreamBytes += c->out[(c->out_head + i) % SIM_VENC_MAX_STREAM_BUF].u32Len;
+    }
+    pstStatus->u32LeftRecvPics = c->recv_left < 0 ? 0 : (RK_U32)c->recv_left;
+    pstStatus->u32LeftEncPics = (RK_U32)c->in_count;
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VENC_GetFd(VENC_CHN VeChn) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+    if (!c->created) return RK_ERR_VENC_UNEXIST;
+
+    pthread_mutex_lock(&c->lock);
+    if (c->efd < 0) {
+        c->efd = eventfd((unsigned int)c->out_count, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+    }
+    int fd = c->efd;
+    pthread_mutex_unlock(&c->lock);
+    return fd >= 0 ? fd : RK_ERR_VENC_NOMEM;
+}
+
+RK_S32 RK_MPI_VENC_CloseFd(VENC_CHN VeChn) {
+    SimVencChn *c = sim_venc_chn(VeChn);
+    if (!c) return RK_ERR_VENC_INVALID_CHNID;
+
+    pthread_mutex_lock(&c->lock);
+    if (c->efd >= 0) {
+        close(c->efd);
+        c->efd = -1;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
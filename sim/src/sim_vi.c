@@ -0,0 +1,481 @@
+/**
+ * @file sim_vi.c
+ * @brief 视频输入 (VI) 仿真
+ *
+ * 每个启用的通道一个出帧线程，按 sim_sensor_fps() 的节拍用绝对时间定时，
+ * 避免累积漂移。帧来自通道自己的 MB 池 (u32BufCount 个)，缓冲区不够时
+ * 与板端一样丢帧并计入 u32VbFail。
+ *
+ * 每帧先送给 Bind 的 VENC 通道，再放入深度为 u32Depth 的最新帧队列
+ * 供 GetChnFrame 取用，队列满时丢弃最旧的帧。
+ */
+
+#include "sim_internal.h"
+#include "rk_mpi_mb.h"
+#include "rk_mpi_vi.h"
+#include "rk_mpi_venc.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/prctl.h>
+
+#ifdef LOG_TAG
+#undef LOG_TAG
+#endif
+#define LOG_TAG "sim_vi"
+
+/** @brief 每个通道最多 Bind 的 VENC 数量 */
+#define SIM_VI_MAX_BINDS        4
+
+/** @brief GetChnFrame 队列的最大深度 */
+#define SIM_VI_MAX_DEPTH        8
+
+/** @brief 行宽对齐 (与 ISP 输出一致) */
+#define SIM_VI_STRIDE_ALIGN     16
+
+#define ALIGN_UP(x, a)          (((x) + (a) - 1) / (a) * (a))
+
+/**
+ * @brief 设备状态
+ */
+typedef struct {
+    int configured;              /**< 已 SetDevAttr */
+    int enabled;
+} SimViDev;
+
+/**
+ * @brief 通道状态
+ */
+typedef struct {
+    int configured;              /**< 已 SetChnAttr */
+    int enabled;
+    VI_CHN_ATTR_S attr;
+    RK_U32 stride;               /**< 行宽 (字节) */
+    size_t frame_size;           /**< 单帧大小 */
+    MB_POOL pool;
+
+    pthread_t thread;
+    volatile int running;
+    FILE *src_file;              /**< RV_SIM_VI_FILE，NULL 时使用测试图案 */
+
+    pthread_mutex_t lock;        /**< 保护 binds 与 ring */
+    pthread_cond_t ready;        /**< ring 有新帧 */
+    VENC_CHN binds[SIM_VI_MAX_BINDS];
+    int bind_count;
+    VIDEO_FRAME_INFO_S ring[SIM_VI_MAX_DEPTH];
+    int ring_head;
+    int ring_count;
+
+    RK_U32 frame_id;
+    RK_U32 input_lost;           /**< 缓冲区不够丢弃的帧 (原子访问) */
+    RK_U32 output_lost;          /**< Bind 的 VENC 不收的帧 (原子访问) */
+    RK_U32 vb_fail;              /**< GetMB 失败次数 (原子访问) */
+} SimViChn;
+
+static SimViDev g_devs[VI_MAX_PIPE_NUM];
+static SimViChn g_chns[VI_MAX_PIPE_NUM][VI_MAX_CHN_NUM];
+static pthread_once_t g_init_once = PTHREAD_ONCE_INIT;
+
+static void sim_vi_init_once(void) {
+    for (int p = 0; p < VI_MAX_PIPE_NUM; p++) {
+        for (int c = 0; c < VI_MAX_CHN_NUM; c++) {
+            pthread_mutex_init(&g_chns[p][c].lock, NULL);
+            sim_cond_init(&g_chns[p][c].ready);
+            g_chns[p][c].pool = MB_INVALID_POOLID;
+        }
+    }
+}
+
+static SimViChn *sim_vi_chn(VI_PIPE pipe, VI_CHN chn) {
+    if (pipe < 0 || pipe >= VI_MAX_PIPE_NUM || chn < 0 || chn >= VI_MAX_CHN_NUM) return NULL;
+    pthread_once(&g_init_once, sim_vi_init_once);
+    return &g_chns[pipe][chn];
+}
+
+/* =========================================================================
+ *                              帧内容
+ * ========================================================================= */
+
+/**
+ * @brief 测试图案：随帧号滚动的亮度渐变，加一个水平移动的亮块
+ *
+ * 按行 memset 生成，1080p 每帧只需几百微秒，不影响出帧节拍。
+ */
+static void sim_vi_fill_pattern(SimViChn *c, uint8_t *buf, RK_U32 frame_id) {
+    RK_U32 w = c->attr.stSize.u32Width;
+    RK_U32 h = c->attr.stSize.u32Height;
+    RK_U32 box = h / 4;
+    RK_U32 box_x = (frame_id * 8) % (w > box ? w - box : 1);
+    RK_U32 box_y = (h - box) / 2;
+
+    for (RK_U32 y = 0; y < h; y++) {
+        uint8_t *row = buf + (size_t)y * c->stride;
+        memset(row, 16 + (int)((y * 200 / h + frame_id) % 200), w);
+        if (y >= box_y && y < box_y + box) memset(row + box_x, 235, box);
+    }
+
+    uint8_t *uv = buf + (size_t)c->stride * h;
+    for (RK_U32 y = 0; y < h / 2; y++) {
+        memset(uv + (size_t)y * c->stride, 128, w);
+    }
+}
+
+/**
+ * @brief 从原始 NV12 文件读取一帧 (文件按紧凑行宽存储，读到结尾从头循环)
+ *
+ * @return 0 成功，-1 读取失败 (调用者改用测试图案)
+ */
+static int sim_vi_fill_file(SimViChn *c, uint8_t *buf) {
+    RK_U32 w = c->attr.stSize.u32Width;
+    RK_U32 rows = c->attr.stSize.u32Height * 3 / 2;
+
+    for (RK_U32 y = 0; y < rows; y++) {
+        uint8_t *row = buf + (size_t)y * c->stride;
+        if (fread(row, 1, w, c->src_file) == w) continue;
+        if (y != 0) return -1;
+        rewind(c->src_file);
+        if (fread(row, 1, w, c->src_file) != w) return -1;
+    }
+    return 0;
+}
+
+static void sim_vi_open_file(SimViChn *c) {
+    const char *path = getenv("RV_SIM_VI_FILE");
+    if (!path || !*path) return;
+
+    size_t frame = (size_t)c->attr.stSize.u32Width * c->attr.stSize.u32Height * 3 / 2;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        LOG_WARN("Cannot open %s: %s, using test pattern\n", path, strerror(errno));
+        return;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    if (size <= 0 || (size_t)size % frame != 0) {
+        LOG_WARN("%s is not a %ux%u NV12 sequence, using test pattern\n", path,
+                 c->attr.stSize.u32Width, c->attr.stSize.u32Height);
+        fclose(fp);
+        return;
+    }
+    LOG_INFO("VI reads %ld frames from %s\n", size / (long)frame, path);
+    c->src_file = fp;
+}
+
+/* =========================================================================
+ *                              出帧线程
+ * ========================================================================= */
+
+/**
+ * @brief 丢弃 ring 中最旧的帧 (调用者持有 lock)
+ *
+ * u32Depth 只保留最新的几帧，没人取帧时轮转是正常行为，不计入丢帧。
+ */
+static void sim_vi_ring_drop_oldest(SimViChn *c) {
+    VIDEO_FRAME_INFO_S *old = &c->ring[c->ring_head];
+    RK_MPI_MB_ReleaseMB(old->stVFrame.pMbBlk);
+    c->ring_head = (c->ring_head + 1) % SIM_VI_MAX_DEPTH;
+    c->ring_count--;
+}
+
+static MB_BLK sim_vi_get_buffer(SimViChn *c) {
+    MB_BLK mb = RK_MPI_MB_GetMB(c->pool, c->frame_size, RK_FALSE);
+    if (mb) return mb;
+
+    // 缓冲区都被占用时，没人取走的旧帧让位给新帧
+    pthread_mutex_lock(&c->lock);
+    if (c->ring_count > 0) sim_vi_ring_drop_oldest(c);
+    pthread_mutex_unlock(&c->lock);
+    return RK_MPI_MB_GetMB(c->pool, c->frame_size, RK_FALSE);
+}
+
+static void *sim_vi_thread(void *arg) {
+    SimViChn *c = (SimViChn *)arg;
+    int idx = (int)(c - &g_chns[0][0]);
+    char name[32];  // 内核截断到 15 字符
+    struct timespec next;
+
+    snprintf(name, sizeof(name), "sim_vi%d_%d", idx / VI_MAX_CHN_NUM, idx % VI_MAX_CHN_NUM);
+    prctl(PR_SET_NAME, name, 0, 0, 0);
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (c->running) {
+        int fps = sim_sensor_fps();
+        long period_ns = 1000000000L / (fps > 0 ? fps : 30);
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+        }
+        if (!c->running) break;
+
+        RK_U32 frame_id = c->frame_id++;
+        MB_BLK mb = sim_vi_get_buffer(c);
+        if (!mb) {
+            __atomic_add_fetch(&c->vb_fail, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&c->input_lost, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        uint8_t *buf = (uint8_t *)RK_MPI_MB_Handle2VirAddr(mb);
+        if (!c->src_file || sim_vi_fill_file(c, buf) != 0) {
+            sim_vi_fill_pattern(c, buf, frame_id);
+        }
+
+        VIDEO_FRAME_INFO_S info;
+        memset(&info, 0, sizeof(info));
+        info.stVFrame.pMbBlk = mb;
+        info.stVFrame.u32Width = c->attr.stSize.u32Width;
+        info.stVFrame.u32Height = c->attr.stSize.u32Height;
+        info.stVFrame.u32VirWidth = c->stride;
+        info.stVFrame.u32VirHeight = c->attr.stSize.u32Height;
+        info.stVFrame.enPixelFormat = RK_FMT_YUV420SP;
+        info.stVFrame.u32TimeRef = frame_id * 2;
+        info.stVFrame.u64PTS = sim_now_us();
+
+        VENC_CHN binds[SIM_VI_MAX_BINDS];
+        pthread_mutex_lock(&c->lock);
+        int bind_count = c->bind_count;
+        memcpy(binds, c->binds, sizeof(binds));
+        pthread_mutex_unlock(&c->lock);
+
+        for (int i = 0; i < bind_count; i++) {
+            if (RK_MPI_VENC_SendFrame(binds[i], &info, 0) != RK_SUCCESS) {
+                __atomic_add_fetch(&c->output_lost, 1, __ATOMIC_RELAXED);
+            }
+        }
+
+        RK_U32 depth = c->attr.u32Depth;
+        if (depth > 0) {
+            pthread_mutex_lock(&c->lock);
+            if (c->ring_count >= (int)depth) sim_vi_ring_drop_oldest(c);
+            sim_mb_retain(mb);
+            c->ring[(c->ring_head + c->ring_count) % SIM_VI_MAX_DEPTH] = info;
+            c->ring_count++;
+            pthread_cond_signal(&c->ready);
+            pthread_mutex_unlock(&c->lock);
+        }
+
+        RK_MPI_MB_ReleaseMB(mb);
+    }
+    return NULL;
+}
+
+/* =========================================================================
+ *                              Bind (供 SYS 调用)
+ * ========================================================================= */
+
+RK_S32 sim_vi_bind(VI_PIPE pipe, VI_CHN chn, VENC_CHN venc_chn) {
+    SimViChn *c = sim_vi_chn(pipe, chn);
+    if (!c) return RK_ERR_VI_INVALID_CHNID;
+
+    pthread_mutex_lock(&c->lock);
+    for (int i = 0; i < c->bind_count; i++) {
+        if (c->binds[i] == venc_chn) {
+            pthread_mutex_unlock(&c->lock);
+            return RK_SIM_ERR(RK_ID_SYS, RK_ERR_EXIST);
+        }
+    }
+    if (c->bind_count >= SIM_VI_MAX_BINDS) {
+        pthread_mutex_unlock(&c->lock);
+        return RK_SIM_ERR(RK_ID_SYS, RK_ERR_NOMEM);
+    }
+    c->binds[c->bind_count++] = venc_chn;
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 sim_vi_unbind(VI_PIPE pipe, VI_CHN chn, VENC_CHN venc_chn) {
+    SimViChn *c = sim_vi_chn(pipe, chn);
+    if (!c) return RK_ERR_VI_INVALID_CHNID;
+
+    pthread_mutex_lock(&c->lock);
+    for (int i = 0; i < c->bind_count; i++) {
+        if (c->binds[i] == venc_chn) {
+            c->binds[i] = c->binds[--c->bind_count];
+            pthread_mutex_unlock(&c->lock);
+            return RK_SUCCESS;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return RK_SIM_ERR(RK_ID_SYS, RK_ERR_UNEXIST);
+}
+
+/* =========================================================================
+ *                              设备接口
+ * ========================================================================= */
+
+RK_S32 RK_MPI_VI_GetDevAttr(VI_DEV ViDev, VI_DEV_ATTR_S *pstDevAttr) {
+    if (ViDev < 0 || ViDev >= VI_MAX_PIPE_NUM) return RK_ERR_VI_INVALID_CHNID;
+    if (!pstDevAttr) return RK_ERR_VI_ILLEGAL_PARAM;
+    if (!g_devs[ViDev].configured) return RK_ERR_VI_NOT_CONFIG;
+    memset(pstDevAttr, 0, sizeof(*pstDevAttr));
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_SetDevAttr(VI_DEV ViDev, const VI_DEV_ATTR_S *pstDevAttr) {
+    if (ViDev < 0 || ViDev >= VI_MAX_PIPE_NUM) return RK_ERR_VI_INVALID_CHNID;
+    if (!pstDevAttr) return RK_ERR_VI_ILLEGAL_PARAM;
+    g_devs[ViDev].configured = 1;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_GetDevIsEnable(VI_DEV ViDev) {
+    if (ViDev < 0 || ViDev >= VI_MAX_PIPE_NUM) return RK_ERR_VI_INVALID_CHNID;
+    return g_devs[ViDev].enabled ? RK_SUCCESS : RK_ERR_VI_NOT_PERM;
+}
+
+RK_S32 RK_MPI_VI_EnableDev(VI_DEV ViDev) {
+    if (ViDev < 0 || ViDev >= VI_MAX_PIPE_NUM) return RK_ERR_VI_INVALID_CHNID;
+    if (!g_devs[ViDev].configured) return RK_ERR_VI_NOT_CONFIG;
+    g_devs[ViDev].enabled = 1;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_DisableDev(VI_DEV ViDev) {
+    if (ViDev < 0 || ViDev >= VI_MAX_PIPE_NUM) return RK_ERR_VI_INVALID_CHNID;
+    g_devs[ViDev].enabled = 0;
+    g_devs[ViDev].configured = 0;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_SetDevBindPipe(VI_DEV ViDev, const VI_DEV_BIND_PIPE_S *pstDevBindPipe) {
+    if (ViDev < 0 || ViDev >= VI_MAX_PIPE_NUM) return RK_ERR_VI_INVALID_CHNID;
+    if (!pstDevBindPipe || pstDevBindPipe->u32Num == 0 ||
+        pstDevBindPipe->u32Num > VI_MAX_PIPE_NUM) {
+        return RK_ERR_VI_ILLEGAL_PARAM;
+    }
+    return RK_SUCCESS;
+}
+
+/* =========================================================================
+ *                              通道接口
+ * ========================================================================= */
+
+RK_S32 RK_MPI_VI_SetChnAttr(VI_PIPE ViPipe, VI_CHN ViChn, const VI_CHN_ATTR_S *pstChnAttr) {
+    SimViChn *c = sim_vi_chn(ViPipe, ViChn);
+    if (!c) return RK_ERR_VI_INVALID_CHNID;
+    if (!pstChnAttr || pstChnAttr->stSize.u32Width == 0 || pstChnAttr->stSize.u32Height == 0 ||
+        ((pstChnAttr->stSize.u32Width | pstChnAttr->stSize.u32Height) & 1) ||
+        pstChnAttr->enPixelFormat != RK_FMT_YUV420SP || pstChnAttr->u32Depth > SIM_VI_MAX_DEPTH) {
+        return RK_ERR_VI_ILLEGAL_PARAM;
+    }
+    if (c->enabled) return RK_ERR_VI_NOT_PERM;
+
+    c->attr = *pstChnAttr;
+    if (c->attr.stIspOpt.u32BufCount == 0) c->attr.stIspOpt.u32BufCount = 4;
+    c->stride = ALIGN_UP(c->attr.stSize.u32Width, SIM_VI_STRIDE_ALIGN);
+    c->frame_size = (size_t)c->stride * c->attr.stSize.u32Height * 3 / 2;
+    c->configured = 1;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_EnableChn(VI_PIPE ViPipe, VI_CHN ViChn) {
+    SimViChn *c = sim_vi_chn(ViPipe, ViChn);
+    if (!c) return RK_ERR_VI_INVALID_CHNID;
+    if (!c->configured) return RK_ERR_VI_NOT_CONFIG;
+    if (c->enabled) return RK_SUCCESS;
+
+    MB_POOL_CONFIG_S pool_cfg;
+    memset(&pool_cfg, 0, sizeof(pool_cfg));
+    pool_cfg.u64MBSize = c->frame_size;
+    pool_cfg.u32MBCnt = c->attr.stIspOpt.u32BufCount;
+    c->pool = RK_MPI_MB_CreatePool(&pool_cfg);
+    if (c->pool == MB_INVALID_POOLID) return RK_SIM_ERR(RK_ID_VI, RK_ERR_NOMEM);
+
+    sim_vi_open_file(c);
+    c->frame_id = 0;
+    c->ring_head = 0;
+    c->ring_count = 0;
+    c->running = 1;
+    if (pthread_create(&c->thread, NULL, sim_vi_thread, c) != 0) {
+        c->running = 0;
+        RK_MPI_MB_DestroyPool(c->pool);
+        c->pool = MB_INVALID_POOLID;
+        return RK_SIM_ERR(RK_ID_VI, RK_ERR_NOMEM);
+    }
+    c->enabled = 1;
+
+    LOG_INFO("VI pipe %d chn %d: %ux%u stride %u, %u buffers, %d fps\n", ViPipe, ViChn,
+             c->attr.stSize.u32Width, c->attr.stSize.u32Height, c->stride,
+             c->attr.stIspOpt.u32BufCount, sim_sensor_fps());
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_DisableChn(VI_PIPE ViPipe, VI_CHN ViChn) {
+    SimViChn *c = sim_vi_chn(ViPipe, ViChn);
+    if (!c) return RK_ERR_VI_INVALID_CHNID;
+    if (!c->enabled) return RK_SUCCESS;
+
+    c->running = 0;
+    pthread_join(c->thread, NULL);
+    c->enabled = 0;
+
+    pthread_mutex_lock(&c->lock);
+    while (c->ring_count > 0) {
+        RK_MPI_MB_ReleaseMB(c->ring[c->ring_head].stVFrame.pMbBlk);
+        c->ring_head = (c->ring_head + 1) % SIM_VI_MAX_DEPTH;
+        c->ring_count--;
+    }
+    pthread_cond_broadcast(&c->ready);
+    pthread_mutex_unlock(&c->lock);
+
+    if (c->src_file) {
+        fclose(c->src_file);
+        c->src_file = NULL;
+    }
+    // 应用层仍持有的帧归还后缓冲池才真正释放
+    RK_MPI_MB_DestroyPool(c->pool);
+    c->pool = MB_INVALID_POOLID;
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_GetChnFrame(VI_PIPE ViPipe, VI_CHN ViChn, VIDEO_FRAME_INFO_S *pstFrameInfo,
+                             RK_S32 s32MilliSec) {
+    SimViChn *c = sim_vi_chn(ViPipe, ViChn);
+    if (!c) return RK_ERR_VI_INVALID_CHNID;
+    if (!pstFrameInfo) return RK_ERR_VI_ILLEGAL_PARAM;
+    if (!c->enabled) return RK_ERR_VI_NOT_PERM;
+
+    pthread_mutex_lock(&c->lock);
+    while (c->ring_count == 0 && c->enabled) {
+        if (sim_cond_wait(&c->ready, &c->lock, s32MilliSec) != 0) break;
+    }
+    if (c->ring_count == 0) {
+        pthread_mutex_unlock(&c->lock);
+        return RK_ERR_VI_BUF_EMPTY;
+    }
+    *pstFrameInfo = c->ring[c->ring_head];
+    c->ring_head = (c->ring_head + 1) % SIM_VI_MAX_DEPTH;
+    c->ring_count--;
+    pthread_mutex_unlock(&c->lock);
+    return RK_SUCCESS;
+}
+
+RK_S32 RK_MPI_VI_ReleaseChnFrame(VI_PIPE ViPipe, VI_CHN ViChn, const VIDEO_FRAME_INFO_S *pstFrameInfo) {
+    if (!sim_vi_chn(ViPipe, ViChn)) return RK_ERR_VI_INVALID_CHNID;
+    if (!pstFrameInfo || !pstFrameInfo->stVFrame.pMbBlk) return RK_ERR_VI_ILLEGAL_PARAM;
+    return RK_MPI_MB_ReleaseMB(pstFrameInfo->stVFrame.pMbBlk);
+}
+
+RK_S32 RK_MPI_VI_QueryChnStatus(VI_PIPE ViPipe, VI_CHN ViChn, VI_CHN_STATUS_S *pstChnStatus) {
+    SimViChn *c = sim_vi_chn(ViPipe, ViChn);
+    if (!c) return RK_ERR_VI_INVALID_CHNID;
+    if (!pstChnStatus) return RK_ERR_VI_ILLEGAL_PARAM;
+
+    memset(pstChnStatus, 0, sizeof(*pstChnStatus));
+    pstChnStatus->bEnable = c->enabled ? RK_TRUE : RK_FALSE;
+    pstChnStatus->stSize = c->attr.stSize;
+    pstChnStatus->u32FrameRate = (RK_U32)sim_sensor_fps();
+    pstChnStatus->u32CurFrameID = c->frame_id;
+    pstChnStatus->u32InputLostFrame = __atomic_load_n(&c->input_lost, __ATOMIC_RELAXED);
+    pstChnStatus->u32OutputLostFrame = __atomic_load_n(&c->output_lost, __ATOMIC_RELAXED);
+    pstChnStatus->u32VbFail = __atomic_load_n(&c->vb_fail, __ATOMIC_RELAXED);
+    return RK_SUCCESS;
+}